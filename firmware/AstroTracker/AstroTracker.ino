@@ -28,6 +28,7 @@
 #include "src/core/cexception/exceptions.h"
 #include "src/core/cexception/cexception.h"
 #include "src/syshal/syshal_pmu.h"
+#include "src/core/debug/debug.h"
 
 void setup()
 {
@@ -53,5 +54,8 @@ void loop()
     {
       sm_main_exception_handler(e);
     }
+
+    // Send the debug records of this pass once the work is done
+    debug_process();
   }
 }
@@ -25,11 +25,14 @@
 
 #include "an_command.h"
 
-uint8_t COMMAND::begin(Stream &commandPort, bool with_cmd_ack)
+uint8_t COMMAND::begin(LoopbackStream &commandPort, bool with_cmd_ack)
 {
   _commandSerial = &commandPort;
   _with_cmd_ack = with_cmd_ack;
 
+  an_decoder_initialise(&an_decoder, rx_data, sizeof(rx_data));
+  rx_packet_valid = false;
+
   return CMD_NO_ERROR;
 }
 
@@ -113,6 +116,56 @@ uint8_t COMMAND::receive_config_packet(config_packet_t *config_packet)
   }
 }
 
+void COMMAND::send_config_delta_packet(config_delta_packet_t *config_delta_packet, uint8_t data_length)
+{
+  an_packet_t an_packet;
+  encode_config_delta_packet(&an_packet, config_delta_packet, data_length);
+  an_packet_transmit(&an_packet);
+}
+
+uint8_t COMMAND::receive_config_delta_packet(config_delta_packet_t *config_delta_packet, uint8_t *data_length)
+{
+  an_packet_t an_packet;
+  if (an_packet_receive(&an_packet, sizeof(config_delta_packet_t)) &&
+      decode_config_delta_packet(config_delta_packet, data_length, &an_packet))
+  {
+    if (_with_cmd_ack == true)
+      send_packet_acknowledge(an_packet, 0);
+    return CMD_NO_ERROR;
+  }
+  else
+  {
+    if (_with_cmd_ack == true)
+      send_packet_acknowledge(an_packet, 1);
+    return CMD_ERROR_AN_PACKET_NOT_VALID;
+  }
+}
+
+void COMMAND::send_log_dump_packet(log_dump_packet_t *log_dump_packet)
+{
+  an_packet_t an_packet;
+  encode_log_dump_packet(&an_packet, log_dump_packet);
+  an_packet_transmit(&an_packet);
+}
+
+uint8_t COMMAND::receive_log_dump_packet(log_dump_packet_t *log_dump_packet)
+{
+  an_packet_t an_packet;
+  if (an_packet_receive(&an_packet, sizeof(log_dump_packet_t)) &&
+      decode_log_dump_packet(log_dump_packet, &an_packet))
+  {
+    if (_with_cmd_ack == true)
+      send_packet_acknowledge(an_packet, 0);
+    return CMD_NO_ERROR;
+  }
+  else
+  {
+    if (_with_cmd_ack == true)
+      send_packet_acknowledge(an_packet, 1);
+    return CMD_ERROR_AN_PACKET_NOT_VALID;
+  }
+}
+
 void COMMAND::send_cmd_data_packet(cmd_data_packet_t *cmd_data_packet)
 {
   an_packet_t an_packet;
@@ -263,6 +316,31 @@ uint8_t COMMAND::receive_asset_status_packet(asset_status_packet_t *asset_status
   }
 }
 
+void COMMAND::send_profiler_status_packet(profiler_status_packet_t *profiler_status_packet)
+{
+  an_packet_t an_packet;
+  encode_profiler_status_packet(&an_packet, profiler_status_packet);
+  an_packet_transmit(&an_packet);
+}
+
+uint8_t COMMAND::receive_profiler_status_packet(profiler_status_packet_t *profiler_status_packet)
+{
+  an_packet_t an_packet;
+  if (an_packet_receive(&an_packet, sizeof(profiler_status_packet_t)) &&
+      decode_profiler_status_packet(profiler_status_packet, &an_packet))
+  {
+    if (_with_cmd_ack == true)
+      send_packet_acknowledge(an_packet, 0);
+    return CMD_NO_ERROR;
+  }
+  else
+  {
+    if (_with_cmd_ack == true)
+      send_packet_acknowledge(an_packet, 1);
+    return CMD_ERROR_AN_PACKET_NOT_VALID;
+  }
+}
+
 void COMMAND::send_sat_bulletin_packet(sat_bulletin_packet_t *sat_bulletin_packet)
 {
   an_packet_t an_packet;
@@ -311,38 +389,49 @@ uint8_t COMMAND::receive_request_packet(uint8_t *id)
 
 uint8_t COMMAND::an_packet_receive_id(uint8_t *an_packet_id)
 {
-  uint16_t rx_ctr = 0;
+  const uint8_t *buffer;
+  size_t buffer_size;
+
+  rx_packet_valid = false;
 
-  while (_commandSerial->available())
+  // Decode straight from the stream buffer, a packet split across several writes is reassembled
+  while (!rx_packet_valid && (buffer_size = _commandSerial->acquireRead(&buffer)) > 0)
   {
-    rx_buffer[rx_ctr] = (uint8_t)_commandSerial->read();
-    rx_ctr++;
+    size_t consumed;
+    rx_packet_valid = an_packet_decode(&an_decoder, buffer, buffer_size, &consumed, &rx_packet);
 
-    if (rx_ctr > AN_DECODE_MAXIMUM_FILL_SIZE)
+    if ((_printDebug == true) && (_printFullDebug == true))
     {
-      break; // Something went wrong...
+      _debugSerial->println("CMD: app -> asset:");
+      print_array_to_hex((uint8_t *)buffer, consumed);
     }
-  }
 
-  if ((_printDebug == true) && (_printFullDebug == true))
-  {
-    _debugSerial->println("CMD: app -> asset:");
-    print_array_to_hex(rx_buffer, rx_ctr);
+    _commandSerial->release(consumed);
   }
 
-  // Clean uart buffer:
-  _commandSerial->flush();
+  // Clean the stream, the bytes following a packet (e.g. padding) are dropped
+  _commandSerial->release(_commandSerial->available());
 
-  // Quick check on data structure (data content is not yet validated)
-  if (rx_buffer[2] != 0)
+  if (rx_packet_valid)
   {
-    *an_packet_id = rx_buffer[1];
+    *an_packet_id = rx_packet.id;
     return CMD_NO_ERROR;
   }
   else
     return CMD_ERROR_AN_PACKET_NOT_VALID;
 }
 
+const an_packet_ref_t *COMMAND::an_packet_received(void)
+{
+  return rx_packet_valid ? &rx_packet : NULL;
+}
+
+void COMMAND::an_packet_receive_reset(void)
+{
+  an_decoder_reset(&an_decoder);
+  rx_packet_valid = false;
+}
+
 void COMMAND::an_packet_transmit(an_packet_t *an_packet)
 {
   an_packet_encode(an_packet);
@@ -360,17 +449,25 @@ void COMMAND::an_packet_transmit(an_packet_t *an_packet)
   _commandSerial->write(buf, AN_PACKET_HEADER_SIZE + an_packet->an_length);
 }
 
+// The received packet must not be longer than packet_length, decode_*_packet() check the exact length
 bool COMMAND::an_packet_receive(an_packet_t *an_packet, uint8_t packet_length)
 {
-  an_decoder_t an_decoder;
-
-  an_decoder_initialise(&an_decoder);
+  if (!rx_packet_valid)
+  {
+    memset(an_packet, 0, sizeof(an_packet_t));
+    return false;
+  }
 
-  memcpy(an_decoder.an_buffer, rx_buffer, AN_PACKET_HEADER_SIZE + packet_length);
+  // The header is kept even when the packet is rejected, the acknowledge refers to it
+  an_packet->id = rx_packet.id;
+  an_packet->an_length = rx_packet.an_length;
+  memcpy(an_packet->header, rx_packet.header, AN_PACKET_HEADER_SIZE);
 
-  an_decoder.buffer_length = AN_PACKET_HEADER_SIZE + packet_length;
+  if (rx_packet.an_length > packet_length || rx_packet.an_length > AN_MAXIMUM_PACKET_SIZE)
+    return false;
 
-  return an_packet_decode(&an_decoder, an_packet);
+  memcpy(an_packet->data, rx_packet.data, rx_packet.an_length);
+  return true;
 }
 
 void COMMAND::send_packet_acknowledge(an_packet_t an_packet_ack, uint8_t acknowledge_result)
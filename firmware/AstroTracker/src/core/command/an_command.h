@@ -34,6 +34,7 @@
 
 #include "an_packet_protocol.h"
 #include "an_packets.h"
+#include "../loopbackstream/LoopbackStream.h"
 
 typedef enum
 {
@@ -44,11 +45,13 @@ typedef enum
 class COMMAND
 {
 public:
-    uint8_t begin(Stream &commandPort, bool with_cmd_ack);
+    uint8_t begin(LoopbackStream &commandPort, bool with_cmd_ack);
     void end();
 
     uint8_t request_is_available();
     uint8_t an_packet_receive_id(uint8_t *an_packet_id);
+    const an_packet_ref_t *an_packet_received(void); // Packet found by an_packet_receive_id(), may be a bulk one
+    void an_packet_receive_reset(void);              // Drop a partly decoded packet, for streams of whole packets
 
     uint8_t receive_request_packet(uint8_t *id);
 
@@ -58,6 +61,12 @@ public:
     void send_config_packet(config_packet_t *config_packet);
     uint8_t receive_config_packet(config_packet_t *config_packet);
 
+    void send_config_delta_packet(config_delta_packet_t *config_delta_packet, uint8_t data_length);
+    uint8_t receive_config_delta_packet(config_delta_packet_t *config_delta_packet, uint8_t *data_length);
+
+    void send_log_dump_packet(log_dump_packet_t *log_dump_packet);
+    uint8_t receive_log_dump_packet(log_dump_packet_t *log_dump_packet);
+
     void send_cmd_data_packet(cmd_data_packet_t *cmd_data_packet);
     uint8_t receive_cmd_data_packet(cmd_data_packet_t *cmd_data_packet);
 
@@ -76,6 +85,9 @@ public:
     void send_asset_status_packet(asset_status_packet_t *asset_status_packet);
     uint8_t receive_asset_status_packet(asset_status_packet_t *asset_status_packet);
 
+    void send_profiler_status_packet(profiler_status_packet_t *profiler_status_packet);
+    uint8_t receive_profiler_status_packet(profiler_status_packet_t *profiler_status_packet);
+
     void send_sat_bulletin_packet(sat_bulletin_packet_t *sat_bulletin_packet);
     uint8_t receive_sat_bulletin_packet(sat_bulletin_packet_t *sat_bulletin_packet);
 
@@ -84,14 +96,17 @@ public:
     void disableDebugging(void);
 
 private:
-    Stream *_commandSerial;
+    LoopbackStream *_commandSerial;
     Stream *_debugSerial;
 
     bool _printDebug = false;     // Flag to print the serial commands we are sending to the Serial port for debug
     bool _printFullDebug = false; // Flag to print full debug messages. Useful for UART debugging
     bool _with_cmd_ack = true;    // Enable, disable commands acknowledge
 
-    uint8_t rx_buffer[AN_DECODE_MAXIMUM_FILL_SIZE] = {0};
+    an_decoder_t an_decoder;
+    an_packet_ref_t rx_packet;
+    bool rx_packet_valid = false;
+    uint8_t rx_data[AN_BULK_MAXIMUM_PACKET_SIZE];
 
     void an_packet_transmit(an_packet_t *an_packet);
     bool an_packet_receive(an_packet_t *an_packet,
@@ -26,12 +26,11 @@
 #include "an_packet_protocol.h"
 
 /*
-   Function to calculate crc16 over provided table
+   Function to update a crc16 with the provided table, start with 0xFFFF
 */
-uint16_t calculate_crc16(uint8_t *data, uint16_t an_length)
+uint16_t calculate_crc16(uint16_t crc, const uint8_t *data, uint16_t an_length)
 {
   uint16_t x;
-  uint16_t crc = 0xFFFF;
 
   while (an_length--)
   {
@@ -46,76 +45,100 @@ uint16_t calculate_crc16(uint8_t *data, uint16_t an_length)
 /*
    Function to calculate a 4 byte LRC
 */
-uint8_t calculate_header_lrc(uint8_t *data)
+uint8_t calculate_header_lrc(const uint8_t *data)
 {
   return ((data[0] + data[1] + data[2] + data[3]) ^ 0xFF) + 1;
 }
 
 /*
-   Initialise the decoder
+   Initialise the decoder, decoded data is stored in the data_size bytes at data
 */
-void an_decoder_initialise(an_decoder_t *an_decoder)
+void an_decoder_initialise(an_decoder_t *an_decoder, uint8_t *data, uint16_t data_size)
 {
-  an_decoder->buffer_length = 0;
+  an_decoder->data = data;
+  an_decoder->data_size = data_size;
   an_decoder->crc_errors = 0;
+  an_decoder_reset(an_decoder);
 }
 
 /*
-   Function to decode an_packets from raw data
-   To fill buffer set an_packet to NULL
-   To decode packets set buffer to NULL and buffer_length to zero
-   returns TRUE (1) if a packet was decoded or FALSE (0) if no packet was decoded
+   Drop any partially received packet
 */
-bool an_packet_decode(an_decoder_t *an_decoder, an_packet_t *an_packet)
+void an_decoder_reset(an_decoder_t *an_decoder)
 {
-  uint16_t decode_iterator = 0;
-  bool packet_decoded = false;
-  uint8_t header_lrc;
-  uint16_t crc;
+  an_decoder->state = AN_DECODER_STATE_HEADER;
+  an_decoder->header_length = 0;
+}
 
-  while (decode_iterator + AN_PACKET_HEADER_SIZE <= an_decoder->buffer_length)
+/*
+   Function to decode an_packets from a stream of raw data
+   Every byte is looked at once: the data may be given in chunks of any size, a packet split
+   across several calls is reassembled
+   consumed is set to the number of bytes used, it stops right after a packet
+   returns TRUE (1) if a packet was decoded or FALSE (0) if more data is needed
+*/
+bool an_packet_decode(an_decoder_t *an_decoder, const uint8_t *buffer, size_t length, size_t *consumed,
+                      an_packet_ref_t *an_packet)
+{
+  size_t decode_iterator = 0;
+
+  while (decode_iterator < length)
   {
-    header_lrc = an_decoder->an_buffer[decode_iterator++];
-    if (header_lrc == calculate_header_lrc(&an_decoder->an_buffer[decode_iterator]))
+    if (an_decoder->state == AN_DECODER_STATE_HEADER)
     {
-      an_packet->id = an_decoder->an_buffer[decode_iterator++];
-      an_packet->an_length = an_decoder->an_buffer[decode_iterator++];
-      crc = an_decoder->an_buffer[decode_iterator++];
-      crc |= an_decoder->an_buffer[decode_iterator++] << 8;
-
-      if (decode_iterator + an_packet->an_length > an_decoder->buffer_length)
-      {
-        decode_iterator -= AN_PACKET_HEADER_SIZE;
-        break;
-      }
+      an_decoder->header[an_decoder->header_length++] = buffer[decode_iterator++];
+      if (an_decoder->header_length < AN_PACKET_HEADER_SIZE)
+        continue;
 
-      if (crc == calculate_crc16(&an_decoder->an_buffer[decode_iterator], an_packet->an_length))
+      if (an_decoder->header[0] == calculate_header_lrc(&an_decoder->header[1]) &&
+          an_decoder->header[2] <= an_decoder->data_size)
       {
-        packet_decoded = true;
-        memcpy(an_packet->header, &an_decoder->an_buffer[decode_iterator - AN_PACKET_HEADER_SIZE], AN_PACKET_HEADER_SIZE * sizeof(uint8_t));
-        memcpy(an_packet->data, &an_decoder->an_buffer[decode_iterator], an_packet->an_length * sizeof(uint8_t));
-        decode_iterator += an_packet->an_length;
-        break;
+        an_decoder->state = AN_DECODER_STATE_DATA;
+        an_decoder->data_length = 0;
+        an_decoder->crc = 0xFFFF;
       }
       else
       {
-        decode_iterator -= (AN_PACKET_HEADER_SIZE - 1);
-        an_decoder->crc_errors++;
+        // Slide the window by one byte
+        memmove(&an_decoder->header[0], &an_decoder->header[1], AN_PACKET_HEADER_SIZE - 1);
+        an_decoder->header_length--;
+        continue;
       }
     }
-  }
-  if (decode_iterator < an_decoder->buffer_length)
-  {
-    if (decode_iterator > 0)
+
+    uint16_t an_length = an_decoder->header[2];
+    size_t chunk_size = an_length - an_decoder->data_length;
+    if (chunk_size > length - decode_iterator)
+      chunk_size = length - decode_iterator;
+
+    memcpy(&an_decoder->data[an_decoder->data_length], &buffer[decode_iterator], chunk_size);
+    an_decoder->crc = calculate_crc16(an_decoder->crc, &buffer[decode_iterator], chunk_size);
+    an_decoder->data_length += chunk_size;
+    decode_iterator += chunk_size;
+
+    if (an_decoder->data_length < an_length)
+      continue;
+
+    // The packet is complete, either way look for the next header
+    an_decoder_reset(an_decoder);
+
+    uint16_t crc = an_decoder->header[3] | (an_decoder->header[4] << 8);
+    if (crc == an_decoder->crc)
     {
-      memmove(&an_decoder->an_buffer[0], &an_decoder->an_buffer[decode_iterator], (an_decoder->buffer_length - decode_iterator) * sizeof(uint8_t));
-      an_decoder->buffer_length -= decode_iterator;
+      an_packet->id = an_decoder->header[1];
+      an_packet->an_length = an_length;
+      an_packet->header = an_decoder->header;
+      an_packet->data = an_decoder->data;
+      *consumed = decode_iterator;
+      return true;
     }
+
+    // Unlike a wrong LRC the packet is dropped whole, its data has already been consumed
+    an_decoder->crc_errors++;
   }
-  else
-    an_decoder->buffer_length = 0;
 
-  return packet_decoded;
+  *consumed = decode_iterator;
+  return false;
 }
 
 /*
@@ -126,7 +149,7 @@ void an_packet_encode(an_packet_t *an_packet)
   uint16_t crc;
   an_packet->header[1] = an_packet->id;
   an_packet->header[2] = an_packet->an_length;
-  crc = calculate_crc16(an_packet->data, an_packet->an_length);
+  crc = calculate_crc16(0xFFFF, an_packet->data, an_packet->an_length);
   memcpy(&an_packet->header[3], &crc, sizeof(uint16_t));
   an_packet->header[0] = calculate_header_lrc(&an_packet->header[1]);
 }
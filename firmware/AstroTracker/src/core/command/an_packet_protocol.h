@@ -34,19 +34,25 @@
 
 #define AN_PACKET_HEADER_SIZE 5
 #define AN_MAXIMUM_PACKET_SIZE 58   // Default Arduino buffer size is 64
-#define AN_DECODE_BUFFER_SIZE 2 * (AN_MAXIMUM_PACKET_SIZE + AN_PACKET_HEADER_SIZE)
-#define AN_DECODE_MAXIMUM_FILL_SIZE (AN_MAXIMUM_PACKET_SIZE + AN_PACKET_HEADER_SIZE)
+#define AN_BULK_MAXIMUM_PACKET_SIZE 255 // Largest length the header can describe, for bulk transfers
 #define an_packet_pointer(packet) (packet)->header
 #define an_packet_size(packet) ((packet)->an_length + AN_PACKET_HEADER_SIZE) * sizeof(uint8_t)
 
-#define an_decoder_pointer(an_decoder) &(an_decoder)->an_buffer[(an_decoder)->buffer_length]
-#define an_decoder_size(an_decoder) (sizeof((an_decoder)->an_buffer) - (an_decoder)->buffer_length)
-#define an_decoder_increment(an_decoder, bytes_received) (an_decoder)->buffer_length += bytes_received
+typedef enum
+{
+    AN_DECODER_STATE_HEADER, // Looking for a header with a valid LRC
+    AN_DECODER_STATE_DATA,   // Receiving the data, the CRC is updated as it arrives
+} an_decoder_state_t;
 
 typedef struct
 {
-    uint8_t an_buffer[AN_DECODE_BUFFER_SIZE];
-    uint16_t buffer_length;
+    an_decoder_state_t state;
+    uint8_t header[AN_PACKET_HEADER_SIZE]; // Window slid one byte at a time while looking for a header
+    uint8_t header_length;
+    uint8_t *data; // Storage provided by the user, packets longer than data_size are skipped
+    uint16_t data_size;
+    uint16_t data_length;
+    uint16_t crc;
     uint32_t crc_errors;
 } an_decoder_t;
 
@@ -58,8 +64,19 @@ typedef struct
     uint8_t data[AN_MAXIMUM_PACKET_SIZE];
 } an_packet_t;
 
-void an_decoder_initialise(an_decoder_t *an_decoder);
-bool an_packet_decode(an_decoder_t *an_decoder, an_packet_t *an_packet);
+// A decoded packet, it points to the decoder and stays valid until the next call to an_packet_decode()
+typedef struct
+{
+    uint8_t id;
+    uint8_t an_length;
+    const uint8_t *header;
+    const uint8_t *data;
+} an_packet_ref_t;
+
+void an_decoder_initialise(an_decoder_t *an_decoder, uint8_t *data, uint16_t data_size);
+void an_decoder_reset(an_decoder_t *an_decoder);
+bool an_packet_decode(an_decoder_t *an_decoder, const uint8_t *buffer, size_t length, size_t *consumed,
+                      an_packet_ref_t *an_packet);
 void an_packet_encode(an_packet_t *an_packet);
 
 #endif
@@ -209,6 +209,106 @@ uint8_t decode_config_packet(config_packet_t *config_packet, an_packet_t *an_pac
   return packet_decoded;
 }
 
+void encode_config_delta_packet(an_packet_t *an_packet, config_delta_packet_t *config_delta_packet, uint8_t data_length)
+{
+  if (data_length > CONFIG_DELTA_PACKET_DATA_MAX_SIZE)
+    data_length = CONFIG_DELTA_PACKET_DATA_MAX_SIZE;
+  an_packet->id = packet_id_config_delta;
+  an_packet->an_length = CONFIG_DELTA_PACKET_HDR_SIZE + data_length;
+  memcpy(an_packet->data, config_delta_packet, an_packet->an_length);
+}
+
+uint8_t decode_config_delta_packet(config_delta_packet_t *config_delta_packet, uint8_t *data_length, an_packet_t *an_packet)
+{
+  uint8_t packet_decoded = false;
+  if (an_packet->id == packet_id_config_delta &&
+      an_packet->an_length >= CONFIG_DELTA_PACKET_HDR_SIZE &&
+      an_packet->an_length <= sizeof(config_delta_packet_t))
+  {
+    memcpy(config_delta_packet, an_packet->data, an_packet->an_length);
+    *data_length = an_packet->an_length - CONFIG_DELTA_PACKET_HDR_SIZE;
+    packet_decoded = true;
+  }
+  return packet_decoded;
+}
+
+void encode_log_dump_packet(an_packet_t *an_packet, log_dump_packet_t *log_dump_packet)
+{
+  an_packet->id = packet_id_log_dump;
+  an_packet->an_length = sizeof(log_dump_packet_t);
+  memcpy(an_packet->data, log_dump_packet, sizeof(log_dump_packet_t));
+}
+
+uint8_t decode_log_dump_packet(log_dump_packet_t *log_dump_packet, an_packet_t *an_packet)
+{
+  uint8_t packet_decoded = false;
+  if (an_packet->id == packet_id_log_dump && an_packet->an_length == sizeof(log_dump_packet_t))
+  {
+    memcpy(log_dump_packet, an_packet->data, sizeof(log_dump_packet_t));
+    packet_decoded = true;
+  }
+  return packet_decoded;
+}
+
+void encode_log_record_packet(an_packet_t *an_packet, log_record_packet_t *log_record_packet, uint8_t data_length)
+{
+  if (data_length > LOG_RECORD_PACKET_DATA_MAX_SIZE)
+    data_length = LOG_RECORD_PACKET_DATA_MAX_SIZE;
+  an_packet->id = packet_id_log_record;
+  an_packet->an_length = LOG_RECORD_PACKET_HDR_SIZE + data_length;
+  memcpy(an_packet->data, log_record_packet, an_packet->an_length);
+}
+
+uint8_t decode_log_record_packet(log_record_packet_t *log_record_packet, uint8_t *data_length, an_packet_t *an_packet)
+{
+  uint8_t packet_decoded = false;
+  if (an_packet->id == packet_id_log_record &&
+      an_packet->an_length >= LOG_RECORD_PACKET_HDR_SIZE &&
+      an_packet->an_length <= sizeof(log_record_packet_t))
+  {
+    memcpy(log_record_packet, an_packet->data, an_packet->an_length);
+    *data_length = an_packet->an_length - LOG_RECORD_PACKET_HDR_SIZE;
+    packet_decoded = true;
+  }
+  return packet_decoded;
+}
+
+void encode_log_dump_end_packet(an_packet_t *an_packet, log_dump_end_packet_t *log_dump_end_packet)
+{
+  an_packet->id = packet_id_log_dump_end;
+  an_packet->an_length = sizeof(log_dump_end_packet_t);
+  memcpy(an_packet->data, log_dump_end_packet, sizeof(log_dump_end_packet_t));
+}
+
+uint8_t decode_log_dump_end_packet(log_dump_end_packet_t *log_dump_end_packet, an_packet_t *an_packet)
+{
+  uint8_t packet_decoded = false;
+  if (an_packet->id == packet_id_log_dump_end && an_packet->an_length == sizeof(log_dump_end_packet_t))
+  {
+    memcpy(log_dump_end_packet, an_packet->data, sizeof(log_dump_end_packet_t));
+    packet_decoded = true;
+  }
+  return packet_decoded;
+}
+
+void encode_profiler_status_packet(an_packet_t *an_packet, profiler_status_packet_t *profiler_status_packet)
+{
+  an_packet->id = packet_id_profiler_status;
+  an_packet->an_length = sizeof(profiler_status_packet_t);
+  memcpy(an_packet->data, profiler_status_packet, sizeof(profiler_status_packet_t));
+}
+
+uint8_t decode_profiler_status_packet(profiler_status_packet_t *profiler_status_packet, an_packet_t *an_packet)
+{
+  uint8_t packet_decoded = false;
+  if (an_packet->id == packet_id_profiler_status && an_packet->an_length == sizeof(profiler_status_packet_t))
+  {
+    memcpy(profiler_status_packet, an_packet->data, sizeof(profiler_status_packet_t));
+    packet_decoded = true;
+  }
+  return packet_decoded;
+}
+
 void encode_request_packet(an_packet_t *an_packet, uint8_t requested_packet_id)
 {
   an_packet->id = packet_id_request;
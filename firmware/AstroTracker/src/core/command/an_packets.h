@@ -50,6 +50,11 @@ typedef enum
     packet_id_config,
     packet_id_geoloc,
     packet_id_sat_bulletin,
+    packet_id_config_delta,
+    packet_id_log_dump,
+    packet_id_log_record,
+    packet_id_log_dump_end,
+    packet_id_profiler_status,
 } packet_id_e;
 
 static const char *packet_id_str[] =
@@ -68,6 +73,11 @@ static const char *packet_id_str[] =
         [packet_id_config] = "AN_PACKET_CONFIG",
         [packet_id_geoloc] = "AN_PACKET_GEOLOC",
         [packet_id_sat_bulletin] = "AN_PACKET_SAT_BULLETIN",
+        [packet_id_config_delta] = "AN_PACKET_CONFIG_DELTA",
+        [packet_id_log_dump] = "AN_PACKET_LOG_DUMP",
+        [packet_id_log_record] = "AN_PACKET_LOG_RECORD",
+        [packet_id_log_dump_end] = "AN_PACKET_LOG_DUMP_END",
+        [packet_id_profiler_status] = "AN_PACKET_PROFILER_STATUS",
 };
 
 typedef enum
@@ -193,6 +203,52 @@ typedef struct __attribute__((__packed__))
     uint32_t t_expir;
 } sat_bulletin_packet_t;
 
+#define CONFIG_DELTA_PACKET_DATA_MAX_SIZE (33) // Fits a 40 B satellite command
+
+typedef struct __attribute__((__packed__))
+{
+    uint8_t transfer_id; // Shared by all the fragments of one delta
+    uint8_t fragment;    // bits 0-3: fragment index, bits 4-7: number of fragments - 1
+    uint8_t data[CONFIG_DELTA_PACKET_DATA_MAX_SIZE];
+} config_delta_packet_t;
+
+#define CONFIG_DELTA_PACKET_HDR_SIZE (sizeof(config_delta_packet_t) - CONFIG_DELTA_PACKET_DATA_MAX_SIZE)
+#define CONFIG_DELTA_PACKET_FRAGMENT_INDEX(fragment) ((fragment) & 0x0F)
+#define CONFIG_DELTA_PACKET_FRAGMENT_NB(fragment) (((fragment) >> 4) + 1)
+
+typedef struct __attribute__((__packed__))
+{
+    uint16_t offset; // First logger slot to send, 0 for a full dump
+} log_dump_packet_t;
+
+#define LOG_RECORD_PACKET_DATA_MAX_SIZE (40)
+
+typedef struct __attribute__((__packed__))
+{
+    uint16_t offset; // Logger slot of the record, resume an interrupted dump from offset + 1
+    uint8_t tag;
+    uint8_t status;
+    uint32_t createdDate;
+    uint32_t acknowledgedDate;
+    uint8_t data[LOG_RECORD_PACKET_DATA_MAX_SIZE];
+} log_record_packet_t;
+
+#define LOG_RECORD_PACKET_HDR_SIZE (sizeof(log_record_packet_t) - LOG_RECORD_PACKET_DATA_MAX_SIZE)
+
+typedef struct __attribute__((__packed__))
+{
+    uint16_t record_nb; // Number of records sent since the log dump request
+} log_dump_end_packet_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint8_t zone; // profiler_zone_t, one packet is sent per zone
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t max_us;
+} profiler_status_packet_t;
+
 void encode_acknowledge_packet(an_packet_t *an_packet, acknowledge_packet_t *acknowledge_packet);
 uint8_t decode_acknowledge_packet(acknowledge_packet_t *acknowledge_packet, an_packet_t *an_packet);
 
@@ -223,6 +279,21 @@ uint8_t decode_sat_bulletin_packet(sat_bulletin_packet_t *sat_bulletin_packet, a
 void encode_config_packet(an_packet_t *an_packet, config_packet_t *config_packet);
 uint8_t decode_config_packet(config_packet_t *config_packet, an_packet_t *an_packet);
 
+void encode_config_delta_packet(an_packet_t *an_packet, config_delta_packet_t *config_delta_packet, uint8_t data_length);
+uint8_t decode_config_delta_packet(config_delta_packet_t *config_delta_packet, uint8_t *data_length, an_packet_t *an_packet);
+
+void encode_log_dump_packet(an_packet_t *an_packet, log_dump_packet_t *log_dump_packet);
+uint8_t decode_log_dump_packet(log_dump_packet_t *log_dump_packet, an_packet_t *an_packet);
+
+void encode_log_record_packet(an_packet_t *an_packet, log_record_packet_t *log_record_packet, uint8_t data_length);
+uint8_t decode_log_record_packet(log_record_packet_t *log_record_packet, uint8_t *data_length, an_packet_t *an_packet);
+
+void encode_log_dump_end_packet(an_packet_t *an_packet, log_dump_end_packet_t *log_dump_end_packet);
+uint8_t decode_log_dump_end_packet(log_dump_end_packet_t *log_dump_end_packet, an_packet_t *an_packet);
+
+void encode_profiler_status_packet(an_packet_t *an_packet, profiler_status_packet_t *profiler_status_packet);
+uint8_t decode_profiler_status_packet(profiler_status_packet_t *profiler_status_packet, an_packet_t *an_packet);
+
 void encode_request_packet(an_packet_t *an_packet, uint8_t requested_packet_id);
 uint8_t decode_request_packet(uint8_t *id, an_packet_t *an_packet);
 
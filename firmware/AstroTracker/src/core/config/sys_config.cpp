@@ -27,38 +27,126 @@
 #include "sys_config.h"
 #include "sys_config_priv.h"
 #include "../debug/debug.h"
+#include "../../syshal/syshal_flash.h"
+
+#define SYS_CONFIG_STORE_MAGIC (0x31474643) // "CFG1"
+
+// Header of each of the A/B copies in flash
+typedef struct __attribute__((__packed__))
+{
+    uint32_t magic;
+    uint32_t sequence; // Incremented at each write, the valid copy with the highest one is the current one
+    uint16_t size;     // sizeof(sys_config_t) when written
+    uint32_t crc;      // CRC-32 of the image
+} sys_config_store_hdr_t;
+
+typedef struct __attribute__((__packed__))
+{
+    sys_config_store_hdr_t hdr;
+    sys_config_t image;
+} sys_config_store_t;
+
+static_assert(sizeof(sys_config_store_t) <= SYSHAL_FLASH_CONFIG_SLOT_SIZE, "sys_config_t does not fit in a flash slot");
 
 // Exposed variables
 sys_config_t sys_config; // Configuration data stored in RAM
 
+static bool dirty = false;         // RAM configuration changed since the last load/save
+static bool store_valid = false;   // A valid copy exists in flash
+static uint8_t store_slot = 0;     // Slot of the current copy
+static uint32_t store_sequence = 0;
+static uint32_t store_crc = 0;     // CRC of the current copy
+
+// Private functions
+uint32_t sys_config_crc32_priv(const void *data, size_t size);
+
+#define SYS_CONFIG_TAG_ID(TAG, ID, MEMBER, COMPULSORY) TAG,
+#define SYS_CONFIG_TAG_ENTRY(TAG, ID, MEMBER, COMPULSORY) SYS_CONFIG_TAG(TAG, sys_config.MEMBER, COMPULSORY),
+#define SYS_CONFIG_TAG_SIZE_CHECK(TAG, ID, MEMBER, COMPULSORY) \
+    static_assert(sizeof(sys_config.MEMBER) >= sizeof(sys_config_hdr_t) + 1, #TAG " has no contents");
+#define SYS_CONFIG_DEPENDENCY_TAG(TAG, REQUIRED, ADDRESS, BITMASK, VALUE) TAG,
+#define SYS_CONFIG_DEPENDENCY_ENTRY(TAG, REQUIRED, ADDRESS, BITMASK, VALUE) \
+    SYS_CONFIG_REQUIRED_IF_MATCH_BITMASK(TAG, REQUIRED, ADDRESS, BITMASK, VALUE),
+
+#define SYS_CONFIG_TAG_GROUP(tag) ((tag) >> 8)
+#define SYS_CONFIG_TAG_GROUP_NB (0x0B) // Highest tag group + 1
+
+static constexpr uint16_t sys_config_tag_ids[] = {SYS_CONFIG_TAG_LIST(SYS_CONFIG_TAG_ID)};
+static constexpr uint16_t sys_config_dependency_tags[] = {SYS_CONFIG_DEPENDENCY_LIST(SYS_CONFIG_DEPENDENCY_TAG)};
+
+#define SYS_CONFIG_TAG_NB (sizeof(sys_config_tag_ids) / sizeof(sys_config_tag_ids[0]))
+#define SYS_CONFIG_DEPENDENCY_NB (sizeof(sys_config_dependency_tags) / sizeof(uint16_t))
+
+// Number of tags with an id lower than tag
+static constexpr uint8_t sys_config_tags_below_priv(uint32_t tag, size_t i)
+{
+    return i >= SYS_CONFIG_TAG_NB ? 0 : (sys_config_tag_ids[i] < tag) + sys_config_tags_below_priv(tag, i + 1);
+}
+
+// Tags are sorted and the ids of a group are consecutive, so their index is the group first index plus an offset
+static constexpr bool sys_config_tags_dense_priv(size_t i)
+{
+    return i + 1 >= SYS_CONFIG_TAG_NB ||
+           (sys_config_tag_ids[i] < sys_config_tag_ids[i + 1] &&
+            (SYS_CONFIG_TAG_GROUP(sys_config_tag_ids[i]) != SYS_CONFIG_TAG_GROUP(sys_config_tag_ids[i + 1]) ||
+             sys_config_tag_ids[i] + 1 == sys_config_tag_ids[i + 1]) &&
+            sys_config_tags_dense_priv(i + 1));
+}
+
+// Bit i set if the dependency i involves tag
+static constexpr uint32_t sys_config_dependency_mask_priv(uint16_t tag, size_t i)
+{
+    return i >= SYS_CONFIG_DEPENDENCY_NB ? 0 : ((sys_config_dependency_tags[i] == tag ? (1UL << i) : 0) | sys_config_dependency_mask_priv(tag, i + 1));
+}
+
+#define SYS_CONFIG_GROUP_FIRST(group) sys_config_tags_below_priv((group) << 8, 0)
+
+// Index in sys_config_lookup_table of the first tag of each group
+static constexpr uint8_t sys_config_group_first[SYS_CONFIG_TAG_GROUP_NB + 1] =
+    {
+        SYS_CONFIG_GROUP_FIRST(0x00), SYS_CONFIG_GROUP_FIRST(0x01), SYS_CONFIG_GROUP_FIRST(0x02),
+        SYS_CONFIG_GROUP_FIRST(0x03), SYS_CONFIG_GROUP_FIRST(0x04), SYS_CONFIG_GROUP_FIRST(0x05),
+        SYS_CONFIG_GROUP_FIRST(0x06), SYS_CONFIG_GROUP_FIRST(0x07), SYS_CONFIG_GROUP_FIRST(0x08),
+        SYS_CONFIG_GROUP_FIRST(0x09), SYS_CONFIG_GROUP_FIRST(0x0A), SYS_CONFIG_GROUP_FIRST(0x0B),
+};
+
+static_assert(sys_config_tags_dense_priv(0), "SYS_CONFIG_TAG_LIST must be sorted with consecutive ids in each group");
+static_assert(sys_config_group_first[SYS_CONFIG_TAG_GROUP_NB] == SYS_CONFIG_TAG_NB, "Tag group out of SYS_CONFIG_TAG_GROUP_NB");
+static_assert(SYS_CONFIG_DEPENDENCY_NB <= 32, "Dependencies are tracked in a uint32_t");
+SYS_CONFIG_TAG_LIST(SYS_CONFIG_TAG_SIZE_CHECK)
+
 static const sys_config_lookup_table_t sys_config_lookup_table[] =
     {
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_DEBUG_SETTINGS, sys_config.debug_settings, false),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_BLE_SETTINGS, sys_config.ble_settings, true),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_GPS_SETTINGS, sys_config.gps_settings, true),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_SAT_SETTINGS, sys_config.sat_settings, true),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_SCREEN_SETTINGS, sys_config.screen_settings, true),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_SATPASS_SETTINGS, sys_config.satpass_settings, true),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_SCHEDULER_GPS_SETTINGS, sys_config.gps_scheduler_settings, true),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_SCHEDULER_SATPASS_SETTINGS, sys_config.satpass_scheduler_settings, false),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_BATTERY_LOW_THRESHOLD, sys_config.battery_low_threshold, false),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_GPS_LOG_POSITION_ENABLE, sys_config.gps_log_position_enable, false),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_SATPASS_PREDICTOR_ENABLE, sys_config.satpass_predictor_enable, false),
-        SYS_CONFIG_TAG(SYS_CONFIG_TAG_LOGGING_ENABLE, sys_config.logging_enable, false),
+        SYS_CONFIG_TAG_LIST(SYS_CONFIG_TAG_ENTRY)
+};
+
+static const dependancy_lookup_table_t dependancy_lookup_table[] =
+    {
+        SYS_CONFIG_DEPENDENCY_LIST(SYS_CONFIG_DEPENDENCY_ENTRY)
 };
 
+static_assert(NUM_OF_TAGS == SYS_CONFIG_TAG_NB, "Every tag must have a lookup table entry");
+
 static int sys_config_get_index(uint16_t tag, uint32_t *index)
 {
-    for (uint32_t i = 0; i < NUM_OF_TAGS; ++i)
-    {
-        if (sys_config_lookup_table[i].tag == tag)
-        {
-            *index = i;
-            return SYS_CONFIG_NO_ERROR;
-        }
-    }
+    uint16_t group = SYS_CONFIG_TAG_GROUP(tag);
+
+    if (group >= SYS_CONFIG_TAG_GROUP_NB)
+        return SYS_CONFIG_ERROR_INVALID_TAG;
+
+    uint32_t first = sys_config_group_first[group];
+    uint32_t last = sys_config_group_first[group + 1];
 
-    return SYS_CONFIG_ERROR_INVALID_TAG;
+    if (first == last)
+        return SYS_CONFIG_ERROR_INVALID_TAG;
+
+    // Ids below the first one of the group wrap around and fail the range check
+    uint32_t i = first + (uint16_t)(tag - sys_config_lookup_table[first].tag);
+    if (i >= last)
+        return SYS_CONFIG_ERROR_INVALID_TAG;
+
+    *index = i;
+    return SYS_CONFIG_NO_ERROR;
 }
 
 bool sys_config_exists(uint16_t tag)
@@ -93,6 +181,7 @@ int sys_config_unset(uint16_t tag)
         return ret;
 
     TAG_SET_FLAG(sys_config_lookup_table[index]) = false;
+    dirty = true;
     return SYS_CONFIG_NO_ERROR;
 }
 
@@ -127,43 +216,54 @@ int sys_config_is_required(uint16_t tag, bool *required)
 
     *required = false;
 
-    /*
-    // Scan through all the dependencies to see if another tag requires this one
-    for (uint32_t i = 0; i < NUM_OF_DEPENDENCIES; ++i)
+    // Scan through the dependencies mentioning this tag, found at build time
+    for (uint32_t mask = sys_config_lookup_table[index].dependencies; mask; mask &= mask - 1)
     {
-        // If there's a mention of this tag in a dependency
-        if (dependancy_lookup_table[i].tag == tag)
+        uint32_t i = __builtin_ctz(mask);
+        if (i >= NUM_OF_DEPENDENCIES)
+            break;
+
+        const dependancy_lookup_table_t *dependancy = &dependancy_lookup_table[i];
+
+        // Is the other tag set?
+        bool is_set;
+        if (sys_config_is_set(dependancy->tag_dependant, &is_set) || !is_set)
+            continue;
+
+        // Does its value match that which is required to trigger this dependancy?
+        uint32_t value = 0;
+        memcpy(&value, dependancy->address, dependancy->size); // Fields are packed, avoid unaligned reads
+        if ((value & dependancy->bitmask) != dependancy->value)
+            continue;
+
+        // A dependency is not fulfilled
+        if (!TAG_SET_FLAG(sys_config_lookup_table[index]))
         {
-            // Is this other tag valid?
-            bool is_set;
-            if (SYS_CONFIG_NO_ERROR == sys_config_is_set(dependancy_lookup_table[i].tag_dependant, &is_set))
-            {
-                // Is this other tag set?
-                if (!is_set)
-                    continue;
-
-                // Does this tag value match that which is required to trigger this dependancy?
-                if ((*(uint32_t *)dependancy_lookup_table[i].address & dependancy_lookup_table[i].bitmask) == dependancy_lookup_table[i].value)
-                {
-                    // Is the tag it relies on set and thus it's dependency sorted?
-                    if (sys_config_is_set(dependancy_lookup_table[i].tag, &is_set))
-                        continue;
-
-                    if (is_set)
-                        continue;
-
-                    // A dependency is not fulfilled
-                    *required = true;
-                    break;
-                }
-            }
+            *required = true;
+            break;
         }
     }
-    */
 
     return SYS_CONFIG_NO_ERROR;
 }
 
+// Would the tag be required once unset, the configuration is left untouched
+int sys_config_is_required_if_unset(uint16_t tag, bool *required)
+{
+    uint32_t index;
+    int ret = sys_config_get_index(tag, &index);
+
+    if (ret)
+        return ret;
+
+    bool set = TAG_SET_FLAG(sys_config_lookup_table[index]);
+    TAG_SET_FLAG(sys_config_lookup_table[index]) = false;
+    ret = sys_config_is_required(tag, required);
+    TAG_SET_FLAG(sys_config_lookup_table[index]) = set;
+
+    return ret;
+}
+
 int sys_config_get(uint16_t tag, void **value)
 {
     uint32_t index;
@@ -201,6 +301,7 @@ int sys_config_set(uint16_t tag, const void *data, size_t length)
 
     // Set the set flag
     TAG_SET_FLAG(sys_config_lookup_table[index]) = true;
+    dirty = true;
 
     if (sys_config_lookup_table[index].setter)
         sys_config_lookup_table[index].setter();
@@ -219,4 +320,106 @@ int sys_config_iterate(uint16_t *tag, uint16_t *last_index)
     *tag = sys_config_lookup_table[idx].tag;
 
     return SYS_CONFIG_NO_ERROR;
-}
\ No newline at end of file
+}
+
+uint32_t sys_config_crc32_priv(const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (size--)
+    {
+        crc ^= *bytes++;
+        for (uint8_t i = 0; i < 8; ++i)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+
+    return ~crc;
+}
+
+// Replace the RAM configuration by the most recent valid copy in flash
+int sys_config_load(void)
+{
+    sys_config_store_t store;
+    bool found = false;
+
+    for (uint8_t slot = 0; slot < SYSHAL_FLASH_CONFIG_SLOT_NB; ++slot)
+    {
+        if (syshal_flash_config_read(slot, &store, sizeof(store)))
+            continue;
+
+        if (store.hdr.magic != SYS_CONFIG_STORE_MAGIC ||
+            store.hdr.size != sizeof(sys_config_t) ||
+            store.image.format_version != SYS_CONFIG_FORMAT_VERSION ||
+            store.hdr.crc != sys_config_crc32_priv(&store.image, sizeof(sys_config_t)))
+            continue;
+
+        // Keep the newest one, a torn write leaves the previous copy valid
+        if (found && (int32_t)(store.hdr.sequence - store_sequence) <= 0)
+            continue;
+
+        memcpy(&sys_config, &store.image, sizeof(sys_config_t));
+        store_slot = slot;
+        store_sequence = store.hdr.sequence;
+        store_crc = store.hdr.crc;
+        found = true;
+    }
+
+    if (!found)
+        return SYS_CONFIG_ERROR_NO_VALID_CONFIG_FILE_FOUND;
+
+    store_valid = true;
+    dirty = false;
+
+    DEBUG_PR_TRACE("Configuration loaded from slot %d (sequence %lu). %s()", store_slot, store_sequence, __FUNCTION__);
+
+    return SYS_CONFIG_NO_ERROR;
+}
+
+// Write the RAM configuration back to flash if it changed, in the slot not holding the current copy
+int sys_config_save(void)
+{
+    if (!dirty)
+        return SYS_CONFIG_NO_ERROR;
+
+    sys_config.format_version = SYS_CONFIG_FORMAT_VERSION;
+    uint32_t crc = sys_config_crc32_priv(&sys_config, sizeof(sys_config_t));
+
+    if (store_valid && crc == store_crc)
+    {
+        dirty = false;
+        return SYS_CONFIG_NO_ERROR;
+    }
+
+    sys_config_store_t store;
+    store.hdr.magic = SYS_CONFIG_STORE_MAGIC;
+    store.hdr.sequence = store_valid ? (store_sequence + 1) : 0;
+    store.hdr.size = sizeof(sys_config_t);
+    store.hdr.crc = crc;
+    memcpy(&store.image, &sys_config, sizeof(sys_config_t));
+
+    uint8_t slot = store_valid ? ((store_slot + 1) % SYSHAL_FLASH_CONFIG_SLOT_NB) : 0;
+    if (syshal_flash_config_write(slot, &store, sizeof(store)))
+        return SYS_CONFIG_ERROR_FS;
+
+    store_valid = true;
+    store_slot = slot;
+    store_sequence = store.hdr.sequence;
+    store_crc = crc;
+    dirty = false;
+
+    DEBUG_PR_TRACE("Configuration saved in slot %d (sequence %lu). %s()", store_slot, store_sequence, __FUNCTION__);
+
+    return SYS_CONFIG_NO_ERROR;
+}
+
+// To be called after writing sys_config fields directly instead of through sys_config_set()
+void sys_config_mark_dirty(void)
+{
+    dirty = true;
+}
+
+bool sys_config_is_dirty(void)
+{
+    return dirty;
+}
@@ -41,6 +41,8 @@
 #define SYS_CONFIG_ERROR_NO_VALID_CONFIG_FILE_FOUND (-5)
 #define SYS_CONFIG_ERROR_FS (-6)
 
+#define SYS_CONFIG_FORMAT_VERSION (8) // Increment when sys_config_t changes, stored images of another version are ignored
+
 #define SYS_CONFIG_TAG_ID_SIZE (sizeof(uint16_t))
 #define SYS_CONFIG_TAG_DATA_SIZE(tag_type) (sizeof(((tag_type *)0)->contents))      // Size of data in tag. We exclude the set member
 #define SYS_CONFIG_TAG_MAX_SIZE (SYS_CONFIG_MAX_DATA_SIZE + SYS_CONFIG_TAG_ID_SIZE) // Max size the configuration tag can be
@@ -48,45 +50,62 @@
 bool sys_config_exists(uint16_t tag);
 int sys_config_is_set(uint16_t tag, bool *set);
 int sys_config_is_required(uint16_t tag, bool *required);
+int sys_config_is_required_if_unset(uint16_t tag, bool *required);
 int sys_config_get(uint16_t tag, void **value);
 int sys_config_set(uint16_t tag, const void *data, size_t length);
 int sys_config_unset(uint16_t tag);
 int sys_config_size(uint16_t tag, size_t *size);
 int sys_config_iterate(uint16_t *tag, uint16_t *last_index);
+int sys_config_load(void);
+int sys_config_save(void);
+void sys_config_mark_dirty(void);
+bool sys_config_is_dirty(void);
+
+// Every configuration tag, sorted by id: X(TAG, ID, MEMBER, COMPULSORY)
+// Ids are (group << 8) | number, the numbers used in a group must be consecutive
+#define SYS_CONFIG_TAG_LIST(X)                                                           \
+    /* DEBUG */                                                                          \
+    X(SYS_CONFIG_TAG_DEBUG_SETTINGS, 0x0000, debug_settings, false)                      \
+    /* BLE */                                                                            \
+    X(SYS_CONFIG_TAG_BLE_SETTINGS, 0x0001, ble_settings, true)                           \
+    /* GPS */                                                                            \
+    X(SYS_CONFIG_TAG_GPS_SETTINGS, 0x0002, gps_settings, true)                           \
+    X(SYS_CONFIG_TAG_GPS_LOG_POSITION_ENABLE, 0x0003, gps_log_position_enable, false)    \
+    /* SAT */                                                                            \
+    X(SYS_CONFIG_TAG_SAT_SETTINGS, 0x0004, sat_settings, true)                           \
+    /* SATPASS */                                                                        \
+    X(SYS_CONFIG_TAG_SATPASS_SETTINGS, 0x0005, satpass_settings, true)                   \
+    X(SYS_CONFIG_TAG_SATPASS_PREDICTOR_ENABLE, 0x0006, satpass_predictor_enable, false)  \
+    /* SCREEN */                                                                         \
+    X(SYS_CONFIG_TAG_SCREEN_SETTINGS, 0x0007, screen_settings, true)                     \
+    /* SCHEDULER */                                                                      \
+    X(SYS_CONFIG_TAG_SCHEDULER_GPS_SETTINGS, 0x0008, gps_scheduler_settings, true)       \
+    X(SYS_CONFIG_TAG_SCHEDULER_SATPASS_SETTINGS, 0x0009, satpass_scheduler_settings, false) \
+    X(SYS_CONFIG_TAG_SCHEDULER_WAKE_SETTINGS, 0x000A, wake_scheduler_settings, false)    \
+    X(SYS_CONFIG_TAG_SCHEDULER_GPS_ADAPTIVE_SETTINGS, 0x000B, gps_adaptive_scheduler_settings, false) \
+    /* SATPASS */                                                                        \
+    X(SYS_CONFIG_TAG_SATPASS_ORBITS, 0x000C, satpass_orbits, false)                      \
+    /* BATTERY (0x0900 was the battery log enable, never stored) */                      \
+    X(SYS_CONFIG_TAG_BATTERY_LOW_THRESHOLD, 0x0901, battery_low_threshold, false)        \
+    /* LOGGINGS */                                                                       \
+    X(SYS_CONFIG_TAG_LOGGING_ENABLE, 0x0902, logging_enable, false)                      \
+    /* BATTERY */                                                                        \
+    X(SYS_CONFIG_TAG_BATTERY_SETTINGS, 0x0903, battery_settings, false)                  \
+    /* SENSORS */                                                                        \
+    X(SYS_CONFIG_TAG_SENSOR_SETTINGS, 0x0904, sensor_settings, false)                    \
+    /* GEOFENCE */                                                                       \
+    X(SYS_CONFIG_TAG_GEOFENCE_SETTINGS, 0x0A00, geofence_settings, false)                \
+    X(SYS_CONFIG_TAG_GEOFENCE_0, 0x0A01, geofence[0], false)                             \
+    X(SYS_CONFIG_TAG_GEOFENCE_1, 0x0A02, geofence[1], false)                             \
+    X(SYS_CONFIG_TAG_GEOFENCE_2, 0x0A03, geofence[2], false)                             \
+    X(SYS_CONFIG_TAG_GEOFENCE_3, 0x0A04, geofence[3], false)
 
+#define SYS_CONFIG_TAG_ENUM(TAG, ID, MEMBER, COMPULSORY) TAG = ID,
 enum
 {
-    // DEBUG
-    SYS_CONFIG_TAG_DEBUG_SETTINGS,
-
-    // BLE
-    SYS_CONFIG_TAG_BLE_SETTINGS,
-
-    // GPS
-    SYS_CONFIG_TAG_GPS_SETTINGS,
-    SYS_CONFIG_TAG_GPS_LOG_POSITION_ENABLE,
-
-    // SAT
-    SYS_CONFIG_TAG_SAT_SETTINGS,
-
-    // SATPASS
-    SYS_CONFIG_TAG_SATPASS_SETTINGS,
-    SYS_CONFIG_TAG_SATPASS_PREDICTOR_ENABLE,
-
-    // SCREEN
-    SYS_CONFIG_TAG_SCREEN_SETTINGS,
-
-    // SCHEDULER
-    SYS_CONFIG_TAG_SCHEDULER_GPS_SETTINGS,
-    SYS_CONFIG_TAG_SCHEDULER_SATPASS_SETTINGS,
-
-    // BATTERY
-    SYS_CONFIG_TAG_BATTERY_LOG_ENABLE = 0x0900, // The battery charge state shall be enabled for logging.
-    SYS_CONFIG_TAG_BATTERY_LOW_THRESHOLD,       // If set, the device will enter the low battery state and preserve any data when the battery charge goes below this threshold
-
-    // LOGGINGS
-    SYS_CONFIG_TAG_LOGGING_ENABLE,
+    SYS_CONFIG_TAG_LIST(SYS_CONFIG_TAG_ENUM)
 };
+#undef SYS_CONFIG_TAG_ENUM
 
 typedef struct __attribute__((__packed__))
 {
@@ -98,6 +117,7 @@ typedef struct __attribute__((__packed__))
     sys_config_hdr_t hdr;
     struct __attribute__((__packed__))
     {
+        uint8_t level; // debug_level_t, selects among the levels built in (see DEBUG_LEVEL_MAX)
     } contents;
 } sys_config_debug_settings_t;
 
@@ -176,6 +196,29 @@ typedef struct __attribute__((__packed__))
     } contents;
 } sys_config_satpass_scheduler_settings_t;
 
+typedef struct __attribute__((__packed__))
+{
+    sys_config_hdr_t hdr;
+    struct __attribute__((__packed__))
+    {
+        uint16_t slack_s; // Alarms and satellite jobs this close are merged in one wake up
+    } contents;
+} sys_config_wake_scheduler_settings_t;
+
+// Replaces the fixed interval_h of the GPS scheduler when set
+typedef struct __attribute__((__packed__))
+{
+    sys_config_hdr_t hdr;
+    struct __attribute__((__packed__))
+    {
+        uint16_t interval_min_m;       // While moving
+        uint16_t interval_max_m;       // Longest interval while stationary
+        uint8_t backoff;               // The interval is multiplied by this after each stationary fix
+        uint16_t distance_threshold_m; // Moving above this displacement, on top of the fixes accuracy
+        uint16_t speed_threshold_mm_s; // Moving above this ground speed
+    } contents;
+} sys_config_gps_adaptive_scheduler_settings_t;
+
 typedef struct __attribute__((__packed__))
 {
     sys_config_hdr_t hdr;
@@ -187,11 +230,33 @@ typedef struct __attribute__((__packed__))
         uint16_t sat_pass_search_window_back_step_s; // Step back when detecting observation window
         uint16_t sat_pass_terminal_wakeup_margin_s;  // 1/2 sat pass window size
         uint8_t sat_pass_min_elevation_d;            // Minimum satellite elevation
-        int32_t lon;                                 // Terminal location for simulation
-        int32_t lat;                                 // Terminal location for simulation
+        int32_t lon;                                 // Terminal location for simulation (deg * 1E7)
+        int32_t lat;                                 // Terminal location for simulation (deg * 1E7)
     } contents;
 } sys_config_satpass_settings_t;
 
+#define SYS_CONFIG_SATPASS_ORBIT_NB (8) // Satellites the pass predictor can follow
+
+// Mean circular orbit of one satellite, from the operator published elements
+typedef struct __attribute__((__packed__))
+{
+    uint32_t epoch;      // UNIX time of the elements
+    float altitude_km;   // Mean altitude above the spherical earth
+    float inclination_d; // Orbit inclination
+    float raan_d;        // Right ascension of the ascending node at epoch
+    float arg_lat_d;     // Argument of latitude at epoch
+} sys_config_satpass_orbit_t;
+
+typedef struct __attribute__((__packed__))
+{
+    sys_config_hdr_t hdr;
+    struct __attribute__((__packed__))
+    {
+        uint8_t orbit_nb; // Entries of orbit used
+        sys_config_satpass_orbit_t orbit[SYS_CONFIG_SATPASS_ORBIT_NB];
+    } contents;
+} sys_config_satpass_orbits_t;
+
 typedef struct __attribute__((__packed__))
 {
     sys_config_hdr_t hdr;
@@ -228,6 +293,67 @@ typedef struct __attribute__((__packed__))
     } contents;
 } sys_config_logging_enable_t;
 
+#define SYS_CONFIG_BATTERY_CURVE_SIZE (11) // Open circuit voltage every 10 % of state of charge
+
+typedef struct __attribute__((__packed__))
+{
+    sys_config_hdr_t hdr;
+    struct __attribute__((__packed__))
+    {
+        uint16_t capacity_mah;
+        uint16_t internal_resistance_mohm;                // Used to compensate the voltage drop of the load
+        uint16_t curve_mv[SYS_CONFIG_BATTERY_CURVE_SIZE]; // From 100 % down to 0 %
+    } contents;
+} sys_config_battery_settings_t;
+
+#define SYS_CONFIG_SENSOR_NB (2) // sensor_id_t entries
+
+typedef struct __attribute__((__packed__))
+{
+    uint16_t interval_s;  // 0 to not sample the sensor
+    uint8_t aggregate_nb; // Above 1, every aggregate_nb samples are logged as min, max and mean
+} sys_config_sensor_t;
+
+typedef struct __attribute__((__packed__))
+{
+    sys_config_hdr_t hdr;
+    struct __attribute__((__packed__))
+    {
+        sys_config_sensor_t sensor[SYS_CONFIG_SENSOR_NB];
+    } contents;
+} sys_config_sensor_settings_t;
+
+typedef struct __attribute__((__packed__))
+{
+    sys_config_hdr_t hdr;
+    struct __attribute__((__packed__))
+    {
+        uint8_t policy;       // geofence_policy_t, which fixes are uplinked
+        uint16_t heartbeat_m; // Uplink a fix at least this often whatever the policy, 0 for never
+    } contents;
+} sys_config_geofence_settings_t;
+
+#define SYS_CONFIG_GEOFENCE_NB (4)         // SYS_CONFIG_TAG_GEOFENCE_* tags
+#define SYS_CONFIG_GEOFENCE_VERTEX_NB (16) // A fence tag must fit in a single config delta
+
+typedef struct __attribute__((__packed__))
+{
+    int32_t lat; // deg * 1E7
+    int32_t lon; // deg * 1E7
+} sys_config_geofence_point_t;
+
+typedef struct __attribute__((__packed__))
+{
+    sys_config_hdr_t hdr;
+    struct __attribute__((__packed__))
+    {
+        uint8_t type;      // geofence_type_t
+        uint8_t vertex_nb; // Polygon vertices used, a circle only uses its centre vertex[0]
+        uint16_t radius_m; // Circle radius
+        sys_config_geofence_point_t vertex[SYS_CONFIG_GEOFENCE_VERTEX_NB];
+    } contents;
+} sys_config_geofence_t;
+
 typedef struct
 {
     uint8_t format_version; // A version number to keep track of the format/contents of this struct
@@ -238,11 +364,18 @@ typedef struct
     sys_config_screen_settings_t screen_settings;
     sys_config_gps_scheduler_settings_t gps_scheduler_settings;
     sys_config_satpass_scheduler_settings_t satpass_scheduler_settings;
+    sys_config_wake_scheduler_settings_t wake_scheduler_settings;
+    sys_config_gps_adaptive_scheduler_settings_t gps_adaptive_scheduler_settings;
     sys_config_satpass_settings_t satpass_settings;
+    sys_config_satpass_orbits_t satpass_orbits;
     sys_config_battery_low_threshold_t battery_low_threshold;
     sys_config_gps_log_position_enable_t gps_log_position_enable;
     sys_config_satpass_predictor_enable_t satpass_predictor_enable;
     sys_config_logging_enable_t logging_enable;
+    sys_config_battery_settings_t battery_settings;
+    sys_config_sensor_settings_t sensor_settings;
+    sys_config_geofence_settings_t geofence_settings;
+    sys_config_geofence_t geofence[SYS_CONFIG_GEOFENCE_NB];
 } sys_config_t;
 
 extern sys_config_t sys_config;
@@ -0,0 +1,177 @@
+/******************************************************************************************
+ * File:        sys_config_delta.cpp
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#include <string.h>
+#include "sys_config_delta.h"
+#include "../debug/debug.h"
+
+static_assert(SYS_CONFIG_DELTA_FRAGMENT_NB_MAX <= 8, "Received fragments are tracked in a uint8_t");
+
+// Reassembly of a fragmented delta
+static uint8_t rx_buffer[SYS_CONFIG_DELTA_MAX_SIZE];
+static bool rx_active = false;
+static uint8_t rx_transfer_id;
+static uint8_t rx_fragment_nb;
+static uint8_t rx_fragment_mask; // One bit per received fragment
+static size_t rx_length;         // Known once the last fragment is received
+
+// Satellite commands may be delivered more than once, do not apply a transfer twice
+static bool last_applied_valid = false;
+static uint8_t last_applied_transfer_id;
+
+// Private functions
+int sys_config_delta_check_priv(const uint8_t *delta, size_t length);
+
+int sys_config_delta_check_priv(const uint8_t *delta, size_t length)
+{
+    size_t offset = 0;
+
+    while (offset < length)
+    {
+        if (length - offset < SYS_CONFIG_DELTA_RECORD_HDR_SIZE)
+            return SYS_CONFIG_DELTA_ERROR_TRUNCATED;
+
+        uint16_t tag = delta[offset] | ((uint16_t)delta[offset + 1] << 8);
+        uint8_t tag_length = delta[offset + 2];
+        offset += SYS_CONFIG_DELTA_RECORD_HDR_SIZE;
+
+        size_t size;
+        if (sys_config_size(tag, &size))
+        {
+            DEBUG_PR_WARN("%s() unknown tag 0x%04X", __FUNCTION__, tag);
+            return SYS_CONFIG_DELTA_ERROR_INVALID_TAG;
+        }
+
+        if (tag_length != 0 && tag_length != size)
+        {
+            DEBUG_PR_WARN("%s() tag 0x%04X length %u, expected %u", __FUNCTION__, tag, tag_length, (unsigned int)size);
+            return SYS_CONFIG_DELTA_ERROR_WRONG_SIZE;
+        }
+
+        if (length - offset < tag_length)
+            return SYS_CONFIG_DELTA_ERROR_TRUNCATED;
+
+        // Without a required tag the device would not boot past the configuration check
+        bool required;
+        if (tag_length == 0 && (sys_config_is_required_if_unset(tag, &required) || required))
+        {
+            DEBUG_PR_WARN("%s() tag 0x%04X is required and cannot be unset", __FUNCTION__, tag);
+            return SYS_CONFIG_DELTA_ERROR_REQUIRED_TAG;
+        }
+
+        offset += tag_length;
+    }
+
+    return SYS_CONFIG_DELTA_NO_ERROR;
+}
+
+int sys_config_delta_init(void)
+{
+    rx_active = false;
+    last_applied_valid = false;
+
+    return SYS_CONFIG_DELTA_NO_ERROR;
+}
+
+int sys_config_delta_apply(const uint8_t *delta, size_t length)
+{
+    if (delta == NULL && length)
+        return SYS_CONFIG_DELTA_ERROR_INVALID_PARAM;
+
+    // Validate the whole delta first so that it is applied entirely or not at all
+    int ret = sys_config_delta_check_priv(delta, length);
+    if (ret)
+        return ret;
+
+    size_t offset = 0;
+    while (offset < length)
+    {
+        uint16_t tag = delta[offset] | ((uint16_t)delta[offset + 1] << 8);
+        uint8_t tag_length = delta[offset + 2];
+        offset += SYS_CONFIG_DELTA_RECORD_HDR_SIZE;
+
+        if (tag_length)
+            sys_config_set(tag, &delta[offset], tag_length);
+        else
+            sys_config_unset(tag);
+
+        DEBUG_PR_TRACE("%s() tag 0x%04X %s", __FUNCTION__, tag, tag_length ? "set" : "unset");
+
+        offset += tag_length;
+    }
+
+    return SYS_CONFIG_DELTA_NO_ERROR;
+}
+
+int sys_config_delta_receive(uint8_t transfer_id, uint8_t fragment_index, uint8_t fragment_nb,
+                             const uint8_t *data, size_t length, bool *applied)
+{
+    if (applied == NULL || (data == NULL && length))
+        return SYS_CONFIG_DELTA_ERROR_INVALID_PARAM;
+
+    *applied = false;
+
+    if (fragment_nb == 0 || fragment_nb > SYS_CONFIG_DELTA_FRAGMENT_NB_MAX ||
+        fragment_index >= fragment_nb || length > SYS_CONFIG_DELTA_FRAGMENT_SIZE)
+        return SYS_CONFIG_DELTA_ERROR_INVALID_PARAM;
+
+    // Only the last fragment may be shorter
+    if (fragment_index < fragment_nb - 1 && length != SYS_CONFIG_DELTA_FRAGMENT_SIZE)
+        return SYS_CONFIG_DELTA_ERROR_INVALID_PARAM;
+
+    if (last_applied_valid && transfer_id == last_applied_transfer_id)
+        return SYS_CONFIG_DELTA_NO_ERROR;
+
+    // A new transfer drops any incomplete one
+    if (!rx_active || transfer_id != rx_transfer_id || fragment_nb != rx_fragment_nb)
+    {
+        rx_active = true;
+        rx_transfer_id = transfer_id;
+        rx_fragment_nb = fragment_nb;
+        rx_fragment_mask = 0;
+        rx_length = 0;
+    }
+
+    memcpy(&rx_buffer[fragment_index * SYS_CONFIG_DELTA_FRAGMENT_SIZE], data, length);
+    rx_fragment_mask |= 1 << fragment_index;
+
+    if (fragment_index == fragment_nb - 1)
+        rx_length = fragment_index * SYS_CONFIG_DELTA_FRAGMENT_SIZE + length;
+
+    if (rx_fragment_mask != (uint8_t)((1 << fragment_nb) - 1))
+        return SYS_CONFIG_DELTA_NO_ERROR;
+
+    rx_active = false;
+
+    int ret = sys_config_delta_apply(rx_buffer, rx_length);
+    if (ret)
+        return ret;
+
+    last_applied_valid = true;
+    last_applied_transfer_id = transfer_id;
+    *applied = true;
+
+    return SYS_CONFIG_DELTA_NO_ERROR;
+}
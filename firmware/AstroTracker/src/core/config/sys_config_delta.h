@@ -0,0 +1,59 @@
+/******************************************************************************************
+ * File:        sys_config_delta.h
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#ifndef _SYS_CONFIG_DELTA_H_
+#define _SYS_CONFIG_DELTA_H_
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "sys_config.h"
+
+#define SYS_CONFIG_DELTA_NO_ERROR (0)
+#define SYS_CONFIG_DELTA_ERROR_INVALID_PARAM (-1)
+#define SYS_CONFIG_DELTA_ERROR_INVALID_TAG (-2)
+#define SYS_CONFIG_DELTA_ERROR_WRONG_SIZE (-3)
+#define SYS_CONFIG_DELTA_ERROR_TRUNCATED (-4)
+#define SYS_CONFIG_DELTA_ERROR_REQUIRED_TAG (-5)
+
+// A delta is a list of records, each one being:
+//   uint16_t tag    SYS_CONFIG_TAG_* id, little endian
+//   uint8_t length  0 to unset the tag, else the size of the tag contents
+//   uint8_t value[length]
+#define SYS_CONFIG_DELTA_RECORD_HDR_SIZE (3)
+
+#define SYS_CONFIG_DELTA_FRAGMENT_SIZE (33)  // 40 B satellite command - 5 B AN header - 2 B fragment header
+#define SYS_CONFIG_DELTA_FRAGMENT_NB_MAX (5) // Enough for the largest tag, the satellite orbits
+#define SYS_CONFIG_DELTA_MAX_SIZE (SYS_CONFIG_DELTA_FRAGMENT_SIZE * SYS_CONFIG_DELTA_FRAGMENT_NB_MAX)
+
+int sys_config_delta_init(void);
+int sys_config_delta_apply(const uint8_t *delta, size_t length);
+int sys_config_delta_receive(uint8_t transfer_id, uint8_t fragment_index, uint8_t fragment_nb,
+                             const uint8_t *data, size_t length, bool *applied);
+
+#endif /* _SYS_CONFIG_DELTA_H_ */
@@ -40,34 +40,35 @@
         .data = (void *)&DATA,                                        \
         .length = sizeof(DATA) - sizeof(sys_config_hdr_t),            \
         .compulsory = COMPULSORY,                                     \
+        .dependencies = sys_config_dependency_mask_priv(TAG, 0),      \
         .getter = GETTER,                                             \
         .setter = SETTER                                              \
     }
 
 #define SYS_CONFIG_REQUIRED_IF_MATCH(TAG, REQUIRED, ADDRESS, VALUE) \
-    {                                                               \
-        .tag = TAG,                                                 \
-        .tag_dependant = REQUIRED,                                  \
-        .address = (void *)&ADDRESS,                                \
-        .bitmask = (__typeof__(ADDRESS))0xFFFFFFFF,                 \
-        .value = VALUE                                              \
-    }
+    SYS_CONFIG_REQUIRED_IF_MATCH_BITMASK(TAG, REQUIRED, ADDRESS, 0xFFFFFFFF, VALUE)
 
 #define SYS_CONFIG_REQUIRED_IF_MATCH_BITMASK(TAG, REQUIRED, ADDRESS, BITMASK, VALUE) \
     {                                                                                \
         .tag = TAG,                                                                  \
         .tag_dependant = REQUIRED,                                                   \
         .address = (void *)&ADDRESS,                                                 \
+        .size = sizeof(ADDRESS),                                                     \
         .bitmask = (__typeof__(ADDRESS))BITMASK,                                     \
         .value = VALUE                                                               \
     }
 
+// Tags only required when another one is set with a given value:
+// X(TAG, REQUIRED, ADDRESS, BITMASK, VALUE), TAG is required if REQUIRED is set and (ADDRESS & BITMASK) == VALUE
+#define SYS_CONFIG_DEPENDENCY_LIST(X)
+
 typedef struct __attribute__((__packed__))
 {
     uint16_t tag;
     void *data;
     size_t length;
     bool compulsory;
+    uint32_t dependencies; // One bit per dependancy_lookup_table entry involving this tag
     void (*getter)(void);
     void (*setter)(void);
 } sys_config_lookup_table_t;
@@ -77,12 +78,13 @@ typedef struct __attribute__((__packed__))
     uint16_t tag;
     uint16_t tag_dependant;
     void *address;
+    uint8_t size; // Size of the field at address, at most 4 bytes
     uint32_t bitmask;
     uint32_t value;
 } dependancy_lookup_table_t;
 
 #define NUM_OF_TAGS (sizeof(sys_config_lookup_table) / sizeof(sys_config_lookup_table_t))
-// #define NUM_OF_DEPENDENCIES (sizeof(dependancy_lookup_table) / sizeof(dependancy_lookup_table_t))
+#define NUM_OF_DEPENDENCIES (sizeof(dependancy_lookup_table) / sizeof(dependancy_lookup_table_t))
 
 #define TAG_SET_FLAG(TAG_LOOKUP) (((sys_config_hdr_t *)TAG_LOOKUP.data)->set)
 
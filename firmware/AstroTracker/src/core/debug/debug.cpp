@@ -25,7 +25,7 @@
 
 #include "debug.h"
 
-debug_level_t g_debug_level = DEBUG_TRACE;
+debug_level_t g_debug_level = DEBUG_LEVEL_MAX;
 
 const char *g_dbg_lvl[] =
     {
@@ -46,6 +46,188 @@ int debug_init(void)
     return DEBUG_NO_ERROR;
 }
 
+// Runtime level, it can only select among the levels built in
+int debug_update_config(syshal_debug_config_t debug_config)
+{
+    if (debug_config.debug == NULL)
+        return DEBUG_ERROR_INVALID_PARAM;
+
+    if (debug_config.debug->hdr.set && debug_config.debug->contents.level <= DEBUG_TRACE)
+        g_debug_level = (debug_level_t)debug_config.debug->contents.level;
+    else
+        g_debug_level = DEBUG_LEVEL_MAX;
+
+    return DEBUG_NO_ERROR;
+}
+
+#if !defined(DEBUG_DISABLED) && !defined(DEBUG_IMMEDIATE)
+
+static_assert((DEBUG_LOG_BUFFER_SIZE & (DEBUG_LOG_BUFFER_SIZE - 1)) == 0, "DEBUG_LOG_BUFFER_SIZE must be a power of two");
+static_assert(DEBUG_LOG_HDR_SIZE + DEBUG_LOG_ARGS_MAX_SIZE - 3 <= UINT8_MAX, "Record length does not fit in a uint8_t");
+
+// Records waiting to be sent, written by debug_log() (also from interrupts) and read by debug_process()
+// The indexes run freely, they are masked when the buffer is accessed
+static uint8_t log_buffer[DEBUG_LOG_BUFFER_SIZE];
+static volatile uint16_t log_head = 0;
+static volatile uint16_t log_tail = 0;
+static uint32_t log_dropped = 0;
+
+// Start of the format strings, created by the linker for the debug_fmt section
+extern const char __start_debug_fmt[];
+
+// Private functions
+uint32_t debug_enter_critical_priv(void);
+void debug_exit_critical_priv(uint32_t primask);
+void debug_log_write_priv(uint16_t head, const uint8_t *data, size_t length);
+void debug_log_append_priv(debug_level_t level, uint16_t fmt_id, uint32_t timestamp, const uint8_t *args, size_t args_length);
+
+uint32_t debug_enter_critical_priv(void)
+{
+#if defined(NRF52_SERIES) || defined(ARDUINO_ARCH_SAMD)
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+#else
+    return 0;
+#endif
+}
+
+void debug_exit_critical_priv(uint32_t primask)
+{
+#if defined(NRF52_SERIES) || defined(ARDUINO_ARCH_SAMD)
+    __set_PRIMASK(primask);
+#else
+    (void)primask;
+#endif
+}
+
+void debug_log_write_priv(uint16_t head, const uint8_t *data, size_t length)
+{
+    uint16_t index = head & (DEBUG_LOG_BUFFER_SIZE - 1);
+    size_t first = DEBUG_LOG_BUFFER_SIZE - index;
+    if (first > length)
+        first = length;
+
+    memcpy(&log_buffer[index], data, first);
+    memcpy(log_buffer, &data[first], length - first);
+}
+
+// To be called with interrupts disabled, once the room is checked
+void debug_log_append_priv(debug_level_t level, uint16_t fmt_id, uint32_t timestamp, const uint8_t *args, size_t args_length)
+{
+    uint8_t header[DEBUG_LOG_HDR_SIZE];
+    size_t length = DEBUG_LOG_HDR_SIZE + args_length;
+    uint16_t head = log_head;
+
+    header[0] = DEBUG_LOG_SYNC_0;
+    header[1] = DEBUG_LOG_SYNC_1;
+    header[2] = length - 3;
+    header[3] = level;
+    memcpy(&header[4], &fmt_id, sizeof(fmt_id));
+    memcpy(&header[6], &timestamp, sizeof(timestamp));
+
+    debug_log_write_priv(head, header, DEBUG_LOG_HDR_SIZE);
+    debug_log_write_priv(head + DEBUG_LOG_HDR_SIZE, args, args_length);
+    log_head = head + length;
+}
+
+// Safe to call from interrupt context, the record is dropped when the buffer is full
+void debug_log(debug_level_t level, const char *fmt, const uint8_t *args, size_t args_length)
+{
+    uint16_t fmt_id = fmt - __start_debug_fmt;
+    uint32_t timestamp = syshal_time_get_ticks_ms();
+
+    uint8_t dropped[1 + sizeof(uint32_t)] = {DEBUG_LOG_ARG_UINT32};
+
+    uint32_t primask = debug_enter_critical_priv();
+
+    // Lost records are reported just before the next one that fits
+    size_t length = DEBUG_LOG_HDR_SIZE + args_length;
+    if (log_dropped)
+        length += DEBUG_LOG_HDR_SIZE + sizeof(dropped);
+
+    size_t free_size = DEBUG_LOG_BUFFER_SIZE - (uint16_t)(log_head - log_tail);
+    if (length <= free_size)
+    {
+        if (log_dropped)
+        {
+            memcpy(&dropped[1], &log_dropped, sizeof(log_dropped));
+            debug_log_append_priv(DEBUG_WARN, DEBUG_LOG_FMT_ID_DROPPED, timestamp, dropped, sizeof(dropped));
+            log_dropped = 0;
+        }
+        debug_log_append_priv(level, fmt_id, timestamp, args, args_length);
+    }
+    else
+    {
+        log_dropped++;
+    }
+
+    debug_exit_critical_priv(primask);
+}
+
+// Low priority drain, sends what fits in the UART transmit buffer without blocking
+void debug_process(void)
+{
+    uint16_t head = log_head;
+    uint16_t tail = log_tail;
+
+    while (head != tail)
+    {
+        uint16_t index = tail & (DEBUG_LOG_BUFFER_SIZE - 1);
+        size_t length = (uint16_t)(head - tail);
+        if (length > (size_t)(DEBUG_LOG_BUFFER_SIZE - index))
+            length = DEBUG_LOG_BUFFER_SIZE - index;
+
+        int room = UART_DEBUG.availableForWrite();
+        if (room <= 0)
+            break;
+        if (length > (size_t)room)
+            length = room;
+
+        tail += UART_DEBUG.write(&log_buffer[index], length);
+        log_tail = tail;
+    }
+}
+
+// Blocking, to be called before sleeping or resetting
+void debug_flush(void)
+{
+    uint16_t tail = log_tail;
+
+    while (log_head != tail)
+    {
+        uint16_t head = log_head;
+        uint16_t index = tail & (DEBUG_LOG_BUFFER_SIZE - 1);
+        size_t length = (uint16_t)(head - tail);
+        if (length > (size_t)(DEBUG_LOG_BUFFER_SIZE - index))
+            length = DEBUG_LOG_BUFFER_SIZE - index;
+
+        tail += UART_DEBUG.write(&log_buffer[index], length);
+        log_tail = tail;
+    }
+
+    UART_DEBUG.flush();
+}
+
+#else
+
+void debug_log(debug_level_t level, const char *fmt, const uint8_t *args, size_t args_length)
+{
+    // Empty
+}
+
+void debug_process(void)
+{
+    // Empty
+}
+
+void debug_flush(void)
+{
+    UART_DEBUG.flush();
+}
+
+#endif
+
 /*
  * Source: https://gist.github.com/ridencww/4e5d10097fee0b0f7f6b?permalink_comment_id=3617754
  *
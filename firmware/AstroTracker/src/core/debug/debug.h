@@ -38,6 +38,7 @@
 
 #define DEBUG_NO_ERROR (0)
 #define DEBUG_ERROR_DEVICE (-1)
+#define DEBUG_ERROR_INVALID_PARAM (-2)
 
 typedef enum
 {
@@ -49,6 +50,24 @@ typedef enum
     DEBUG_TRACE,
 } debug_level_t;
 
+// Compile-time filtering
+//
+// DEBUG_LEVEL_MAX is the most verbose level built in the firmware, e.g. -DDEBUG_LEVEL_MAX=DEBUG_WARN
+// for a production build. A module can lower it for itself by defining DEBUG_MODULE_LEVEL before
+// its first #include. Calls above these levels are removed with their format string and arguments,
+// g_debug_level (see debug_update_config()) filters the remaining ones at runtime.
+#ifndef DEBUG_LEVEL_MAX
+#define DEBUG_LEVEL_MAX DEBUG_TRACE
+#endif
+
+#ifndef DEBUG_MODULE_LEVEL
+#define DEBUG_MODULE_LEVEL DEBUG_LEVEL_MAX
+#endif
+
+// Arguments are only evaluated when this is true, it is constant false for the levels not built
+#define DEBUG_LEVEL_ENABLED(lvl) \
+    ((lvl) <= DEBUG_LEVEL_MAX && (lvl) <= DEBUG_MODULE_LEVEL && g_debug_level >= (lvl))
+
 extern const char * g_dbg_lvl[];
 extern debug_level_t g_debug_level;
 
@@ -58,9 +77,169 @@ typedef struct
 } syshal_debug_config_t;
 
 int debug_init(void);
+int debug_update_config(syshal_debug_config_t debug_config);
 void serial_printf(const char* fmt, ...);
 
-#ifndef DEBUG_DISABLED
+// Deferred logging, the default unless DEBUG_IMMEDIATE is defined
+//
+// Call sites do not format anything: they append a binary record to a ring buffer and return.
+// debug_process() copies the buffered records to UART_DEBUG when there is room, debug_flush()
+// waits until all of them are sent. tools/decode_debug_log.py renders them back to text with
+// the format strings extracted from the firmware ELF.
+//
+// Record layout, little endian:
+//   uint8_t sync[2]       DEBUG_LOG_SYNC_0, DEBUG_LOG_SYNC_1
+//   uint8_t length        Bytes following this field
+//   uint8_t level         debug_level_t
+//   uint16_t fmt_id       Offset of the format string in the debug_fmt section
+//   uint32_t timestamp    syshal_time_get_ticks_ms()
+//   uint8_t args[]        For each argument its DEBUG_LOG_ARG_* type then its value
+#define DEBUG_LOG_BUFFER_SIZE (1024) // Must be a power of two
+#define DEBUG_LOG_ARGS_MAX_SIZE (64) // Extra arguments are dropped
+#define DEBUG_LOG_STRING_MAX_SIZE (32) // Longer strings are truncated
+#define DEBUG_LOG_SYNC_0 (0xA5)
+#define DEBUG_LOG_SYNC_1 (0x5A)
+#define DEBUG_LOG_HDR_SIZE (10)
+#define DEBUG_LOG_FMT_ID_DROPPED (0xFFFF) // One uint32_t argument, the number of records lost
+
+#define DEBUG_LOG_ARG_INT32 (0)
+#define DEBUG_LOG_ARG_UINT32 (1)
+#define DEBUG_LOG_ARG_INT64 (2)
+#define DEBUG_LOG_ARG_UINT64 (3)
+#define DEBUG_LOG_ARG_FLOAT (4)
+#define DEBUG_LOG_ARG_STRING (5) // uint8_t length then the characters
+#define DEBUG_LOG_ARG_POINTER (6)
+
+#define DEBUG_FMT_SECTION __attribute__((section("debug_fmt")))
+
+void debug_log(debug_level_t level, const char *fmt, const uint8_t *args, size_t args_length);
+void debug_process(void);
+void debug_flush(void);
+
+#if !defined(DEBUG_DISABLED) && !defined(DEBUG_IMMEDIATE)
+
+#include <type_traits>
+
+static inline size_t debug_log_arg_priv(uint8_t *args, size_t offset, uint8_t type, const void *value, size_t size)
+{
+    if (offset + 1 + size > DEBUG_LOG_ARGS_MAX_SIZE)
+        return offset;
+
+    args[offset] = type;
+    memcpy(&args[offset + 1], value, size);
+    return offset + 1 + size;
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, size_t>::type
+debug_log_arg_priv(uint8_t *args, size_t offset, T value)
+{
+    if (sizeof(T) > sizeof(uint32_t))
+    {
+        if (std::is_signed<T>::value)
+        {
+            int64_t v = value;
+            return debug_log_arg_priv(args, offset, DEBUG_LOG_ARG_INT64, &v, sizeof(v));
+        }
+        uint64_t v = value;
+        return debug_log_arg_priv(args, offset, DEBUG_LOG_ARG_UINT64, &v, sizeof(v));
+    }
+
+    if (std::is_signed<T>::value)
+    {
+        int32_t v = value;
+        return debug_log_arg_priv(args, offset, DEBUG_LOG_ARG_INT32, &v, sizeof(v));
+    }
+    uint32_t v = value;
+    return debug_log_arg_priv(args, offset, DEBUG_LOG_ARG_UINT32, &v, sizeof(v));
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_floating_point<T>::value, size_t>::type
+debug_log_arg_priv(uint8_t *args, size_t offset, T value)
+{
+    float v = value;
+    return debug_log_arg_priv(args, offset, DEBUG_LOG_ARG_FLOAT, &v, sizeof(v));
+}
+
+// Strings are copied, they may not exist anymore when the record is sent. They are truncated to the space left
+static inline size_t debug_log_arg_priv(uint8_t *args, size_t offset, const char *value)
+{
+    if (value == NULL)
+        value = "(null)";
+
+    if (offset + 2 > DEBUG_LOG_ARGS_MAX_SIZE)
+        return offset;
+
+    size_t space = DEBUG_LOG_ARGS_MAX_SIZE - offset - 2;
+    if (space > DEBUG_LOG_STRING_MAX_SIZE)
+        space = DEBUG_LOG_STRING_MAX_SIZE;
+
+    // Not strnlen(), the bound would exceed the size of short constant strings
+    size_t length = 0;
+    while (length < space && value[length])
+        length++;
+
+    args[offset] = DEBUG_LOG_ARG_STRING;
+    args[offset + 1] = length;
+    memcpy(&args[offset + 2], value, length);
+    return offset + 2 + length;
+}
+
+static inline size_t debug_log_arg_priv(uint8_t *args, size_t offset, char *value)
+{
+    return debug_log_arg_priv(args, offset, (const char *)value);
+}
+
+template <typename T>
+static inline size_t debug_log_arg_priv(uint8_t *args, size_t offset, T *value)
+{
+    uint32_t v = (uint32_t)(uintptr_t)value;
+    return debug_log_arg_priv(args, offset, DEBUG_LOG_ARG_POINTER, &v, sizeof(v));
+}
+
+static inline size_t debug_log_args_priv(uint8_t *, size_t offset)
+{
+    return offset;
+}
+
+template <typename T, typename... Args>
+static inline size_t debug_log_args_priv(uint8_t *args, size_t offset, T value, Args... values)
+{
+    offset = debug_log_arg_priv(args, offset, value);
+    return debug_log_args_priv(args, offset, values...);
+}
+
+template <typename... Args>
+static inline void debug_log_priv(debug_level_t level, const char *fmt, Args... values)
+{
+    uint8_t args[DEBUG_LOG_ARGS_MAX_SIZE] = {};
+    debug_log(level, fmt, args, debug_log_args_priv(args, 0, values...));
+}
+
+// The format string only exists in the debug_fmt section, its offset is the record fmt_id
+#define DEBUG_LOG(lvl, fmt, ...) \
+    do { \
+        static const char debug_fmt[] DEBUG_FMT_SECTION = fmt; \
+        debug_log_priv(lvl, debug_fmt, ## __VA_ARGS__); \
+    } while (0)
+
+#define DEBUG_PR(fmt, ...)           DEBUG_LOG(DEBUG_NONE, fmt, ## __VA_ARGS__)
+
+#define DEBUG_PR_T(lvl, fmt, ...) \
+    do { \
+        if (DEBUG_LEVEL_ENABLED(lvl)) { \
+        DEBUG_LOG(lvl, fmt, ## __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define DEBUG_PR_SYS(fmt, ...)       DEBUG_PR_T(DEBUG_SYSTEM, fmt, ## __VA_ARGS__)
+#define DEBUG_PR_INFO(fmt, ...)      DEBUG_PR_T(DEBUG_INFO, fmt, ## __VA_ARGS__)
+#define DEBUG_PR_WARN(fmt, ...)      DEBUG_PR_T(DEBUG_WARN, fmt, ## __VA_ARGS__)
+#define DEBUG_PR_ERROR(fmt, ...)     DEBUG_PR_T(DEBUG_ERROR, fmt, ## __VA_ARGS__)
+#define DEBUG_PR_TRACE(fmt, ...)     DEBUG_PR_T(DEBUG_TRACE, fmt, ## __VA_ARGS__)
+
+#elif !defined(DEBUG_DISABLED)
 
 #define DEBUG_PR(fmt, ...)     serial_printf(fmt "\n\r", ## __VA_ARGS__)
 
@@ -68,7 +247,7 @@ void serial_printf(const char* fmt, ...);
 
 #define DEBUG_PR_T(lvl, fmt, ...) \
     do { \
-        if (g_debug_level >= lvl) { \
+        if (DEBUG_LEVEL_ENABLED(lvl)) { \
         DEBUG_PR("%lu\t%s\t" fmt, \
         TIME_IN_SECONDS, \
         g_dbg_lvl[lvl], ## __VA_ARGS__); \
@@ -83,7 +262,7 @@ void serial_printf(const char* fmt, ...);
 
 #else
 
-#define DEBUG_PR_T(lvl, color, fmt, ...)   if (g_debug_level >= lvl) { \
+#define DEBUG_PR_T(lvl, color, fmt, ...)   if (DEBUG_LEVEL_ENABLED(lvl)) { \
     DEBUG_PR("\e[39;49m" "%lu\t" color "%s\t" fmt, \
     TIME_IN_SECONDS, \
     g_dbg_lvl[lvl], ## __VA_ARGS__); \
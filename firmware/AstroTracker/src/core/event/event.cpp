@@ -0,0 +1,163 @@
+/******************************************************************************************
+ * File:        event.cpp
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#include "event.h"
+#include "../debug/debug.h"
+
+// One bit per event_id_t, several posts of the same event before a dispatch are merged
+static volatile uint32_t pending = 0;
+
+#if defined(NRF52_SERIES)
+// Given on each post, a post between the pending check and the wait is kept for the wait
+static SemaphoreHandle_t wake_semaphore = NULL;
+#endif
+
+// Private functions
+uint32_t event_enter_critical_priv(void);
+void event_exit_critical_priv(uint32_t primask);
+
+uint32_t event_enter_critical_priv(void)
+{
+#if defined(NRF52_SERIES) || defined(ARDUINO_ARCH_SAMD)
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+#else
+    return 0;
+#endif
+}
+
+void event_exit_critical_priv(uint32_t primask)
+{
+#if defined(NRF52_SERIES) || defined(ARDUINO_ARCH_SAMD)
+    __set_PRIMASK(primask);
+#else
+    (void)primask;
+#endif
+}
+
+int event_init(void)
+{
+    pending = 0;
+
+#if defined(NRF52_SERIES)
+    if (wake_semaphore == NULL)
+        wake_semaphore = xSemaphoreCreateBinary();
+#endif
+
+    return EVENT_NO_ERROR;
+}
+
+int event_term(void)
+{
+    pending = 0;
+
+    return EVENT_NO_ERROR;
+}
+
+// Safe to call from interrupt context
+void event_post(event_id_t id)
+{
+    if (id >= EVENT_NB)
+        return;
+
+    uint32_t primask = event_enter_critical_priv();
+    pending |= (1UL << id);
+    event_exit_critical_priv(primask);
+
+#if defined(NRF52_SERIES)
+    if (wake_semaphore == NULL)
+        return;
+
+    if (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk)
+    {
+        BaseType_t higher_priority_woken = pdFALSE;
+        xSemaphoreGiveFromISR(wake_semaphore, &higher_priority_woken);
+        portYIELD_FROM_ISR(higher_priority_woken);
+    }
+    else
+    {
+        xSemaphoreGive(wake_semaphore);
+    }
+#endif
+}
+
+bool event_is_pending(void)
+{
+    return pending != 0;
+}
+
+// Block until an event is posted, the CPU sleeps meanwhile
+void event_wait(void)
+{
+#if defined(NRF52_SERIES)
+    // A give left from an already dispatched post only costs one more check
+    while (!event_is_pending())
+        xSemaphoreTake(wake_semaphore, portMAX_DELAY);
+#elif defined(ARDUINO_ARCH_SAMD)
+    // An interrupt still ends WFI with PRIMASK set, it runs once unmasked and the check is repeated masked
+    __disable_irq();
+    while (!event_is_pending())
+    {
+        __DSB();
+        __WFI();
+        __enable_irq();
+        __disable_irq();
+    }
+    __enable_irq();
+#endif
+}
+
+uint32_t event_get_pending(void)
+{
+    return pending;
+}
+
+// Run the handler of each pending event once, events posted by a handler are left for the next dispatch
+int event_dispatch(const event_handler_t handlers[EVENT_NB], void *context, uint8_t *nb_dispatched)
+{
+    if (handlers == NULL)
+        return EVENT_ERROR_INVALID_PARAM;
+
+    uint32_t primask = event_enter_critical_priv();
+    uint32_t events = pending;
+    pending = 0;
+    event_exit_critical_priv(primask);
+
+    uint8_t count = 0;
+    for (uint8_t id = 0; events != 0; id++, events >>= 1)
+    {
+        if ((events & 1) && handlers[id] != NULL)
+        {
+            handlers[id](context);
+            count++;
+        }
+    }
+
+    if (nb_dispatched != NULL)
+        *nb_dispatched = count;
+
+    return EVENT_NO_ERROR;
+}
@@ -0,0 +1,64 @@
+/******************************************************************************************
+ * File:        event.h
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#ifndef _EVENT_h
+#define _EVENT_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define EVENT_NO_ERROR (0)
+#define EVENT_ERROR_INVALID_PARAM (-1)
+
+// Wake up reasons, dispatched in this order
+typedef enum
+{
+    EVENT_RTC_ALARM,          // RTC compare match (scheduler alarm or watchdog timeout)
+    EVENT_SAT_PIN,            // Astronode event pin
+    EVENT_GPS_TX_READY,       // GNSS has data waiting on I2C
+    EVENT_BUTTON,             // User button pressed
+    EVENT_BLE_RX,             // Data received over BLE
+    EVENT_BLE_TX_READY,       // BLE notifications sent, room for more
+    EVENT_SAT_STATUS_REQUEST, // Read the satellite module status
+    EVENT_SATPASS_UPDATE,     // Schedule the next satellite pass
+    EVENT_LOGGER_DATA,        // New logger slots to push to the satellite module
+    EVENT_SCREEN_ACTIVATION,  // Wake up the display
+    EVENT_NB,
+} event_id_t;
+
+typedef void (*event_handler_t)(void *context);
+
+int event_init(void);
+int event_term(void);
+void event_post(event_id_t id);
+bool event_is_pending(void);
+void event_wait(void);
+uint32_t event_get_pending(void);
+int event_dispatch(const event_handler_t handlers[EVENT_NB], void *context, uint8_t *nb_dispatched);
+
+#endif
@@ -0,0 +1,366 @@
+/******************************************************************************************
+ * File:        geofence.cpp
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#include <math.h>
+#include "geofence.h"
+#include "../debug/debug.h"
+
+/* Containment
+ *
+ * Fixes and fences stay in the deg * 1E7 integers of the GPS. Coordinates are taken relative to
+ * the tested point, the longitude wrapped to +-180 deg so that a fence may cross the antimeridian,
+ * which keeps them in an int32_t and their products in an int64_t. A fence must span less than
+ * 180 deg of longitude.
+ *
+ * A polygon contains the point if an odd number of its edges cross the half line east of it. Only
+ * the edges across the latitude of the point are looked at, and of those only the ones with an end
+ * on each side of its longitude need a 64 bits cross product. The bounding box of each fence,
+ * relative to its first vertex, is computed with the configuration and rejects the distant fixes.
+ *
+ * A circle compares squared distances, the longitude being scaled by the cosine of the latitude
+ * of the centre in Q15.
+ */
+
+#define GEOFENCE_E7_90_DEG (900000000L)
+#define GEOFENCE_E7_180_DEG (1800000000L)
+#define GEOFENCE_E7_PER_100_M (8993) // Degrees * 1E7 of latitude per 100 m
+#define GEOFENCE_COS_Q15_ONE (32768)
+
+typedef struct
+{
+    bool used;
+    int32_t lat_min; // Polygon bounding box
+    int32_t lat_max;
+    int32_t dlon_min; // Relative to the longitude of vertex[0], circles too
+    int32_t dlon_max;
+    int32_t radius_e7; // Circle radius in degrees * 1E7 of latitude
+    int32_t cos_q15;   // Cosine of the circle centre latitude
+} geofence_state_t;
+
+static geofence_config_t config;
+static geofence_state_t state[SYS_CONFIG_GEOFENCE_NB];
+
+// Uplink policy
+static bool inside_known = false;
+static uint8_t last_inside; // One bit per fence
+static bool uplink_known = false;
+static uint32_t last_uplink;
+
+static const char *const geofence_type_str[] =
+    {
+        [GEOFENCE_CIRCLE] = "CIRCLE",
+        [GEOFENCE_POLYGON] = "POLYGON",
+};
+
+static const char *const geofence_policy_str[] =
+    {
+        [GEOFENCE_UPLINK_ALL] = "ALL",
+        [GEOFENCE_UPLINK_OUTSIDE] = "OUTSIDE",
+        [GEOFENCE_UPLINK_TRANSITION] = "TRANSITION",
+};
+
+// Private functions
+int32_t geofence_wrap_priv(int32_t lon, int32_t lon_ref);
+bool geofence_circle_contains_priv(const sys_config_geofence_t *fence, const geofence_state_t *s, int32_t lat, int32_t lon);
+int geofence_prepare_priv(const sys_config_geofence_t *fence, geofence_state_t *s);
+
+// Longitude relative to lon_ref, in [-180, 180) deg
+int32_t geofence_wrap_priv(int32_t lon, int32_t lon_ref)
+{
+    int64_t delta = (int64_t)lon - lon_ref;
+
+    if (delta >= GEOFENCE_E7_180_DEG)
+        delta -= 2 * (int64_t)GEOFENCE_E7_180_DEG;
+    else if (delta < -GEOFENCE_E7_180_DEG)
+        delta += 2 * (int64_t)GEOFENCE_E7_180_DEG;
+
+    return (int32_t)delta;
+}
+
+// Latitudes within +-90 deg, the point within the longitudes of the polygon as checked by its bounding box
+bool geofence_polygon_contains(const sys_config_geofence_point_t *vertex, uint16_t vertex_nb, int32_t lat, int32_t lon)
+{
+    if (vertex == NULL || vertex_nb < 3)
+        return false;
+
+    bool inside = false;
+
+    // Edge from a to b, relative to the point (x east, y north)
+    sys_config_geofence_point_t prev = vertex[vertex_nb - 1]; // Copy, the vertices are packed
+    int32_t ay = prev.lat - lat;
+    int32_t a_lon = prev.lon;
+
+    for (uint16_t i = 0; i < vertex_nb; i++)
+    {
+        sys_config_geofence_point_t v = vertex[i];
+        int32_t by = v.lat - lat;
+
+        if ((ay > 0) != (by > 0))
+        {
+            int32_t ax = geofence_wrap_priv(a_lon, lon);
+            int32_t bx = geofence_wrap_priv(v.lon, lon);
+
+            if (ax > 0 && bx > 0)
+                inside = !inside;
+            else if (ax > 0 || bx > 0)
+            {
+                // The edge crosses the latitude of the point east of it if its x there, cross / (by - ay), is positive.
+                // A point on the edge is not east of it, like with a vertical edge through the point.
+                int64_t cross = (int64_t)ax * by - (int64_t)ay * bx;
+                if (cross != 0 && (cross > 0) == (by > ay))
+                    inside = !inside;
+            }
+        }
+
+        ay = by;
+        a_lon = v.lon;
+    }
+
+    return inside;
+}
+
+bool geofence_circle_contains_priv(const sys_config_geofence_t *fence, const geofence_state_t *s, int32_t lat, int32_t lon)
+{
+    sys_config_geofence_point_t centre = fence->contents.vertex[0];
+
+    int32_t dy = lat - centre.lat;
+    int32_t dx = geofence_wrap_priv(lon, centre.lon);
+
+    if (dx < s->dlon_min || dx > s->dlon_max || dy < -s->radius_e7 || dy > s->radius_e7)
+        return false;
+
+    int64_t dx_scaled = ((int64_t)dx * s->cos_q15) / GEOFENCE_COS_Q15_ONE;
+
+    return dx_scaled * dx_scaled + (int64_t)dy * dy <= (int64_t)s->radius_e7 * s->radius_e7;
+}
+
+int geofence_prepare_priv(const sys_config_geofence_t *fence, geofence_state_t *s)
+{
+    uint8_t type = fence->contents.type;
+    uint8_t vertex_nb = fence->contents.vertex_nb;
+    sys_config_geofence_point_t origin = fence->contents.vertex[0];
+
+    s->used = false;
+
+    if (type == GEOFENCE_CIRCLE)
+    {
+        if (fence->contents.radius_m == 0 || origin.lat < -GEOFENCE_E7_90_DEG || origin.lat > GEOFENCE_E7_90_DEG)
+            return GEOFENCE_ERROR_INVALID_PARAM;
+
+        s->radius_e7 = ((uint32_t)fence->contents.radius_m * GEOFENCE_E7_PER_100_M) / 100;
+
+        float cos_lat = cosf((float)origin.lat * 1E-7f * (float)M_PI / 180.0f);
+        s->cos_q15 = (int32_t)(cos_lat * GEOFENCE_COS_Q15_ONE);
+        if (s->cos_q15 < 1)
+            s->cos_q15 = 1;
+
+        // Longitude span of the circle, up to the whole circle of latitude near the poles
+        int64_t dlon = ((int64_t)s->radius_e7 * GEOFENCE_COS_Q15_ONE) / s->cos_q15;
+        if (dlon >= GEOFENCE_E7_180_DEG)
+            dlon = GEOFENCE_E7_180_DEG;
+
+        s->dlon_min = -(int32_t)dlon;
+        s->dlon_max = (int32_t)dlon;
+    }
+    else if (type == GEOFENCE_POLYGON)
+    {
+        if (vertex_nb < 3 || vertex_nb > SYS_CONFIG_GEOFENCE_VERTEX_NB)
+            return GEOFENCE_ERROR_INVALID_PARAM;
+
+        s->lat_min = s->lat_max = origin.lat;
+        s->dlon_min = s->dlon_max = 0;
+
+        for (uint8_t i = 0; i < vertex_nb; i++)
+        {
+            sys_config_geofence_point_t v = fence->contents.vertex[i];
+            int32_t dlon = geofence_wrap_priv(v.lon, origin.lon);
+
+            if (v.lat < -GEOFENCE_E7_90_DEG || v.lat > GEOFENCE_E7_90_DEG)
+                return GEOFENCE_ERROR_INVALID_PARAM;
+
+            if (v.lat < s->lat_min)
+                s->lat_min = v.lat;
+            if (v.lat > s->lat_max)
+                s->lat_max = v.lat;
+            if (dlon < s->dlon_min)
+                s->dlon_min = dlon;
+            if (dlon > s->dlon_max)
+                s->dlon_max = dlon;
+        }
+
+        if ((int64_t)s->dlon_max - s->dlon_min >= GEOFENCE_E7_180_DEG)
+            return GEOFENCE_ERROR_INVALID_PARAM;
+    }
+    else
+        return GEOFENCE_ERROR_INVALID_PARAM;
+
+    s->used = true;
+
+    return GEOFENCE_NO_ERROR;
+}
+
+int geofence_init(void)
+{
+    config.settings = NULL;
+    config.fence = NULL;
+
+    for (uint8_t i = 0; i < SYS_CONFIG_GEOFENCE_NB; i++)
+        state[i].used = false;
+
+    inside_known = false;
+    uplink_known = false;
+
+    return GEOFENCE_NO_ERROR;
+}
+
+int geofence_term(void)
+{
+    return geofence_init();
+}
+
+// Invalid fences are not used, the valid ones still are
+int geofence_update_config(geofence_config_t geofence_config)
+{
+    DEBUG_PR_TRACE("Update GEOFENCE configuration. %s()", __FUNCTION__);
+
+    if (geofence_config.settings == NULL || geofence_config.fence == NULL)
+        return GEOFENCE_ERROR_INVALID_PARAM;
+
+    int ret = GEOFENCE_NO_ERROR;
+
+    config = geofence_config;
+
+    if (config.settings->hdr.set && config.settings->contents.policy >= GEOFENCE_POLICY_NB)
+    {
+        DEBUG_PR_WARN("Invalid geofence policy %u, every fix is uplinked. %s()", config.settings->contents.policy, __FUNCTION__);
+        ret = GEOFENCE_ERROR_INVALID_PARAM;
+    }
+
+    for (uint8_t i = 0; i < SYS_CONFIG_GEOFENCE_NB; i++)
+    {
+        state[i].used = false;
+
+        if (!config.fence[i].hdr.set)
+            continue;
+
+        if (geofence_prepare_priv(&config.fence[i], &state[i]))
+        {
+            DEBUG_PR_WARN("Invalid geofence %u ignored. %s()", i, __FUNCTION__);
+            ret = GEOFENCE_ERROR_INVALID_PARAM;
+            continue;
+        }
+
+        DEBUG_PR_TRACE("Geofence %u: %s", i, geofence_type_str[config.fence[i].contents.type]);
+    }
+
+    // The fences may have moved, the next fix is uplinked
+    inside_known = false;
+
+    return ret;
+}
+
+// Bit i of inside is set if the point is in fence i
+int geofence_check(int32_t lat, int32_t lon, uint8_t *inside)
+{
+    if (inside == NULL)
+        return GEOFENCE_ERROR_INVALID_PARAM;
+
+    *inside = 0;
+
+    for (uint8_t i = 0; i < SYS_CONFIG_GEOFENCE_NB; i++)
+    {
+        const geofence_state_t *s = &state[i];
+        if (!s->used)
+            continue;
+
+        const sys_config_geofence_t *fence = &config.fence[i];
+        bool contains;
+
+        if (fence->contents.type == GEOFENCE_CIRCLE)
+            contains = geofence_circle_contains_priv(fence, s, lat, lon);
+        else
+        {
+            int32_t dlon = geofence_wrap_priv(lon, fence->contents.vertex[0].lon);
+
+            contains = lat >= s->lat_min && lat <= s->lat_max && dlon >= s->dlon_min && dlon <= s->dlon_max &&
+                       geofence_polygon_contains(fence->contents.vertex, fence->contents.vertex_nb, lat, lon);
+        }
+
+        if (contains)
+            *inside |= 1 << i;
+    }
+
+    return GEOFENCE_NO_ERROR;
+}
+
+// Apply the uplink policy to a new fix
+int geofence_fix(uint32_t timestamp, int32_t lat, int32_t lon, bool *uplink)
+{
+    if (uplink == NULL)
+        return GEOFENCE_ERROR_INVALID_PARAM;
+
+    uint8_t inside;
+    geofence_check(lat, lon, &inside);
+
+    bool transition = !inside_known || inside != last_inside;
+    if (transition && inside_known)
+        DEBUG_PR_INFO("Geofence transition 0x%02X -> 0x%02X", last_inside, inside);
+
+    inside_known = true;
+    last_inside = inside;
+
+    geofence_policy_t policy = GEOFENCE_UPLINK_ALL;
+    uint16_t heartbeat_m = 0;
+    if (config.settings != NULL && config.settings->hdr.set && config.settings->contents.policy < GEOFENCE_POLICY_NB)
+    {
+        policy = (geofence_policy_t)config.settings->contents.policy;
+        heartbeat_m = config.settings->contents.heartbeat_m;
+    }
+
+    bool heartbeat = heartbeat_m && (!uplink_known || timestamp - last_uplink >= (uint32_t)heartbeat_m * 60);
+
+    switch (policy)
+    {
+    case GEOFENCE_UPLINK_OUTSIDE:
+        *uplink = transition || heartbeat || inside == 0;
+        break;
+    case GEOFENCE_UPLINK_TRANSITION:
+        *uplink = transition || heartbeat;
+        break;
+    default:
+        *uplink = true;
+        break;
+    }
+
+    if (*uplink)
+    {
+        uplink_known = true;
+        last_uplink = timestamp;
+    }
+    else
+        DEBUG_PR_TRACE("Fix not uplinked, %s policy. %s()", geofence_policy_str[policy], __FUNCTION__);
+
+    return GEOFENCE_NO_ERROR;
+}
@@ -0,0 +1,70 @@
+/******************************************************************************************
+ * File:        geofence.h
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#ifndef _GEOFENCE_h
+#define _GEOFENCE_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "../config/sys_config.h"
+
+#define GEOFENCE_NO_ERROR (0)
+#define GEOFENCE_ERROR_INVALID_PARAM (-1)
+
+typedef enum
+{
+    GEOFENCE_CIRCLE,
+    GEOFENCE_POLYGON,
+    GEOFENCE_TYPE_NB,
+} geofence_type_t;
+
+// Fixes are always uplinked on entering or leaving a fence and on the heartbeat
+typedef enum
+{
+    GEOFENCE_UPLINK_ALL,        // Every fix
+    GEOFENCE_UPLINK_OUTSIDE,    // Every fix taken outside of all fences
+    GEOFENCE_UPLINK_TRANSITION, // Transitions and heartbeats only
+    GEOFENCE_POLICY_NB,
+} geofence_policy_t;
+
+typedef struct
+{
+    sys_config_geofence_settings_t *settings;
+    sys_config_geofence_t *fence; // SYS_CONFIG_GEOFENCE_NB fences, unset ones are not used
+} geofence_config_t;
+
+int geofence_init(void);
+int geofence_term(void);
+int geofence_update_config(geofence_config_t geofence_config);
+int geofence_check(int32_t lat, int32_t lon, uint8_t *inside);
+int geofence_fix(uint32_t timestamp, int32_t lat, int32_t lon, bool *uplink);
+
+bool geofence_polygon_contains(const sys_config_geofence_point_t *vertex, uint16_t vertex_nb, int32_t lat, int32_t lon);
+
+#endif
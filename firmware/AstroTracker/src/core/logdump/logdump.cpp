@@ -0,0 +1,226 @@
+/******************************************************************************************
+ * File:        logdump.cpp
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#include "logdump.h"
+#include "../debug/debug.h"
+#include "../logger/logger.h"
+#include "../command/an_packets.h"
+#include "../../syshal/syshal_ble.h"
+
+/* Log dump over BLE
+ *
+ * Every logger slot from the requested offset is sent as a log record AN packet, followed by a
+ * log dump end packet. The packets are written back to back in a byte stream and cut in
+ * notifications as large as the negotiated MTU allows, so several records share a notification.
+ * When the softdevice queue is full the dump pauses until EVENT_BLE_TX_READY.
+ */
+
+static bool active = false;
+static bool end_queued = false;
+static uint16_t offset;          // Next logger slot to read
+static logdump_stats_t stats;
+
+// Encoded packets not yet notified, at most one notification plus one packet
+static uint8_t tx_buffer[SYSHAL_BLE_PAYLOAD_MAX_SIZE + AN_PACKET_HEADER_SIZE + AN_MAXIMUM_PACKET_SIZE];
+static size_t tx_length;
+static size_t tx_position;
+
+// Private functions
+void logdump_append_priv(an_packet_t *an_packet);
+void logdump_fill_priv(size_t size);
+void logdump_finish_priv(void);
+
+void logdump_append_priv(an_packet_t *an_packet)
+{
+    an_packet_encode(an_packet);
+    memcpy(&tx_buffer[tx_length], an_packet->header, AN_PACKET_HEADER_SIZE);
+    memcpy(&tx_buffer[tx_length + AN_PACKET_HEADER_SIZE], an_packet->data, an_packet->an_length);
+    tx_length += an_packet_size(an_packet);
+}
+
+// Encode records until size bytes are waiting or the dump is complete
+void logdump_fill_priv(size_t size)
+{
+    if (tx_position)
+    {
+        memmove(tx_buffer, &tx_buffer[tx_position], tx_length - tx_position);
+        tx_length -= tx_position;
+        tx_position = 0;
+    }
+
+    while (tx_length < size && !end_queued)
+    {
+        an_packet_t an_packet;
+
+        if (offset >= LOGGER_NB_SLOTS)
+        {
+            log_dump_end_packet_t log_dump_end_packet;
+            log_dump_end_packet.record_nb = stats.record_nb;
+            encode_log_dump_end_packet(&an_packet, &log_dump_end_packet);
+            logdump_append_priv(&an_packet);
+            end_queued = true;
+            break;
+        }
+
+        uint16_t slot = offset++;
+        void *buffer;
+        uint16_t buffer_size;
+        uint8_t tag;
+        uint32_t createdDate, acknowledgedDate;
+        logger_slot_status_id_t status;
+
+        if (logger_get_data(slot + 1, &buffer, &buffer_size, &tag, &createdDate, &acknowledgedDate, &status))
+            continue; // Empty slot
+
+        if (buffer_size > LOG_RECORD_PACKET_DATA_MAX_SIZE)
+        {
+            DEBUG_PR_WARN("Slot %u too large for a log record. %s()", slot, __FUNCTION__);
+            continue;
+        }
+
+        log_record_packet_t log_record_packet;
+        log_record_packet.offset = slot;
+        log_record_packet.tag = tag;
+        log_record_packet.status = status;
+        log_record_packet.createdDate = createdDate;
+        log_record_packet.acknowledgedDate = acknowledgedDate;
+        memcpy(log_record_packet.data, buffer, buffer_size);
+        encode_log_record_packet(&an_packet, &log_record_packet, buffer_size);
+        logdump_append_priv(&an_packet);
+        stats.record_nb++;
+    }
+}
+
+void logdump_finish_priv(void)
+{
+    active = false;
+    syshal_ble_set_link_mode(SYSHAL_BLE_LINK_LOW_POWER);
+}
+
+int logdump_init(void)
+{
+    active = false;
+
+    return LOGDUMP_NO_ERROR;
+}
+
+int logdump_term(void)
+{
+    return logdump_stop();
+}
+
+// Start a dump at the given logger slot, restarts any dump in progress
+int logdump_start(uint16_t first_slot)
+{
+    if (first_slot > LOGGER_NB_SLOTS)
+        return LOGDUMP_ERROR_INVALID_PARAM;
+
+    active = true;
+    end_queued = false;
+    offset = first_slot;
+    tx_length = 0;
+    tx_position = 0;
+    stats.record_nb = 0;
+    stats.bytes_sent = 0;
+
+    if (syshal_ble_set_link_mode(SYSHAL_BLE_LINK_THROUGHPUT))
+        DEBUG_PR_WARN("Could not shorten the connection interval. %s()", __FUNCTION__);
+
+    DEBUG_PR_TRACE("Log dump from slot %u. %s()", first_slot, __FUNCTION__);
+
+    return LOGDUMP_NO_ERROR;
+}
+
+int logdump_stop(void)
+{
+    if (active)
+        logdump_finish_priv();
+
+    return LOGDUMP_NO_ERROR;
+}
+
+bool logdump_is_active(void)
+{
+    return active;
+}
+
+// Send up to LOGDUMP_BURST_NB notifications, more is set if it should be called again right away
+int logdump_process(bool *more)
+{
+    if (more == NULL)
+        return LOGDUMP_ERROR_INVALID_PARAM;
+
+    *more = false;
+
+    if (!active)
+        return LOGDUMP_NO_ERROR;
+
+    // Read once per call, the MTU exchange may complete during the dump
+    size_t payload_size = syshal_ble_get_payload_size();
+
+    for (uint8_t burst = 0; burst < LOGDUMP_BURST_NB; ++burst)
+    {
+        logdump_fill_priv(payload_size);
+
+        if (tx_position == tx_length)
+        {
+            DEBUG_PR_TRACE("Log dump complete, %u records. %s()", stats.record_nb, __FUNCTION__);
+            logdump_finish_priv();
+            return LOGDUMP_NO_ERROR;
+        }
+
+        size_t chunk_size = tx_length - tx_position;
+        if (chunk_size > payload_size)
+            chunk_size = payload_size;
+
+        int ret = syshal_ble_send_notification(&tx_buffer[tx_position], chunk_size);
+        if (ret == SYSHAL_BLE_ERROR_BUSY)
+            return LOGDUMP_NO_ERROR; // Resumed by EVENT_BLE_TX_READY
+
+        if (ret)
+        {
+            DEBUG_PR_WARN("Log dump aborted, error %d. %s()", ret, __FUNCTION__);
+            logdump_finish_priv();
+            return LOGDUMP_ERROR_BLE;
+        }
+
+        tx_position += chunk_size;
+        stats.bytes_sent += chunk_size;
+    }
+
+    *more = true;
+
+    return LOGDUMP_NO_ERROR;
+}
+
+int logdump_get_stats(logdump_stats_t *stats_out)
+{
+    if (stats_out == NULL)
+        return LOGDUMP_ERROR_INVALID_PARAM;
+
+    *stats_out = stats;
+
+    return LOGDUMP_NO_ERROR;
+}
@@ -0,0 +1,55 @@
+/******************************************************************************************
+ * File:        logdump.h
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#ifndef _LOGDUMP_h
+#define _LOGDUMP_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define LOGDUMP_NO_ERROR (0)
+#define LOGDUMP_ERROR_INVALID_PARAM (-1)
+#define LOGDUMP_ERROR_BLE (-2)
+
+#define LOGDUMP_BURST_NB (8) // Notifications sent per logdump_process() call, keeps the main loop responsive
+
+typedef struct
+{
+    uint16_t record_nb;  // Records sent since logdump_start()
+    uint32_t bytes_sent; // Bytes notified since logdump_start()
+} logdump_stats_t;
+
+int logdump_init(void);
+int logdump_term(void);
+int logdump_start(uint16_t first_slot);
+int logdump_stop(void);
+bool logdump_is_active(void);
+int logdump_process(bool *more);
+int logdump_get_stats(logdump_stats_t *stats);
+
+#endif
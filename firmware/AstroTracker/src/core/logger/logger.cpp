@@ -25,6 +25,7 @@
 
 #include "logger.h"
 #include "../debug/debug.h"
+#include "../profiler/profiler.h"
 #include "../../syshal/syshal_rtc.h"
 
 typedef struct __attribute__((__packed__))
@@ -72,6 +73,8 @@ int logger_term(void)
 
 int logger_insert_data(void *buffer, uint16_t size, uint8_t tag, uint32_t createdDate, uint16_t *id)
 {
+	PROFILER_ZONE(PROFILER_ZONE_LOGGER_WRITE);
+
 	for (uint16_t i = 0; i < LOGGER_NB_SLOTS; i++)
 	{
 		if (logger_struct[i].id == 0)
@@ -103,6 +106,8 @@ int logger_insert_data(void *buffer, uint16_t size, uint8_t tag, uint32_t create
 
 int logger_get_data(uint16_t id, void **buffer, uint16_t *size, uint8_t *tag, uint32_t *createdDate, uint32_t *acknowledgedDate, logger_slot_status_id_t *status)
 {
+	PROFILER_ZONE(PROFILER_ZONE_LOGGER_READ);
+
 	for (uint16_t i = 0; i < LOGGER_NB_SLOTS; i++)
 	{
 		if (logger_struct[i].id == id)
@@ -123,6 +128,8 @@ int logger_get_data(uint16_t id, void **buffer, uint16_t *size, uint8_t *tag, ui
 
 int logger_clear_slot(uint16_t id)
 {
+	PROFILER_ZONE(PROFILER_ZONE_LOGGER_WRITE);
+
 	for (uint16_t i = 0; i < LOGGER_NB_SLOTS; i++) // Check if slot id != 0
 	{
 		if (logger_struct[i].id == id)
@@ -181,6 +188,8 @@ int logger_get_number_free_msg_slots(uint16_t *count)
 
 int logger_get_oldest_slot_id(uint16_t *id)
 {
+	PROFILER_ZONE(PROFILER_ZONE_LOGGER_READ);
+
 	*id = 0;
 
 	uint32_t oldest_slot_epoch = 0xFFFFFFFF;
@@ -205,6 +214,8 @@ int logger_get_oldest_slot_id(uint16_t *id)
 
 int logger_get_youngest_slot_id(uint16_t *id)
 {
+	PROFILER_ZONE(PROFILER_ZONE_LOGGER_READ);
+
 	*id = 0;
 
 	uint32_t youngest_slot_epoch = 0x00000000;
@@ -229,6 +240,8 @@ int logger_get_youngest_slot_id(uint16_t *id)
 
 int logger_get_youngest_slot_id_older_than(uint16_t *id, uint32_t *createdDate, uint32_t thresh_epoch)
 {
+	PROFILER_ZONE(PROFILER_ZONE_LOGGER_READ);
+
 	*id = 0;
 
 	uint32_t youngest_slot_epoch = 0x00000000;
@@ -255,6 +268,8 @@ int logger_get_youngest_slot_id_older_than(uint16_t *id, uint32_t *createdDate,
 
 int logger_get_tag_from_slot_id(uint16_t id, uint8_t *tag)
 {
+	PROFILER_ZONE(PROFILER_ZONE_LOGGER_READ);
+
 	for (uint16_t i = 0; i < LOGGER_NB_SLOTS; i++)
 	{
 		if (logger_struct[i].id == id)
@@ -268,6 +283,8 @@ int logger_get_tag_from_slot_id(uint16_t id, uint8_t *tag)
 
 int logger_set_status_of_slot_id(uint16_t id, logger_slot_status_id_t status)
 {
+	PROFILER_ZONE(PROFILER_ZONE_LOGGER_WRITE);
+
 	for (uint16_t i = 0; i < LOGGER_NB_SLOTS; i++)
 	{
 		if (logger_struct[i].id == id)
@@ -281,6 +298,8 @@ int logger_set_status_of_slot_id(uint16_t id, logger_slot_status_id_t status)
 
 int logger_set_acknowledgeddate_of_slot_id(uint16_t id, uint32_t acknowledgedDate)
 {
+	PROFILER_ZONE(PROFILER_ZONE_LOGGER_WRITE);
+
 	for (uint16_t i = 0; i < LOGGER_NB_SLOTS; i++)
 	{
 		if (logger_struct[i].id == id)
@@ -6,8 +6,15 @@
 
 LoopbackStream::LoopbackStream(uint16_t buffer_size)
 {
-  this->buffer = (uint8_t *)malloc(buffer_size);
-  this->buffer_size = buffer_size;
+  uint16_t capacity = 1;
+  while (capacity < buffer_size)
+  {
+    capacity <<= 1;
+  }
+
+  this->buffer = (uint8_t *)malloc(capacity);
+  this->buffer_size = capacity;
+  this->mask = capacity - 1;
   this->pos = 0;
   this->size = 0;
 }
@@ -31,25 +38,56 @@ int LoopbackStream::read()
   else
   {
     int ret = buffer[pos];
-    pos++;
+    pos = (pos + 1) & mask;
     size--;
-    if (pos == buffer_size)
-    {
-      pos = 0;
-    }
     return ret;
   }
 }
 
-size_t LoopbackStream::write(uint8_t *buffer, size_t buffer_size)
+size_t LoopbackStream::read(uint8_t *buffer, size_t length)
 {
-  size_t i;
-  for (i = 0; i < buffer_size; i++)
+  length = peek(buffer, length);
+  release(length);
+  return length;
+}
+
+size_t LoopbackStream::peek(uint8_t *buffer, size_t length)
+{
+  if (length > size)
+  {
+    length = size;
+  }
+
+  size_t first = buffer_size - pos;
+  if (first > length)
   {
-    if (!write(buffer[i]))
-      break;
+    first = length;
   }
-  return i;
+
+  memcpy(buffer, &this->buffer[pos], first);
+  memcpy(&buffer[first], this->buffer, length - first);
+  return length;
+}
+
+size_t LoopbackStream::write(const uint8_t *buffer, size_t buffer_size)
+{
+  size_t free_size = this->buffer_size - size;
+  if (buffer_size > free_size)
+  {
+    buffer_size = free_size;
+  }
+
+  uint16_t p = (pos + size) & mask;
+  size_t first = this->buffer_size - p;
+  if (first > buffer_size)
+  {
+    first = buffer_size;
+  }
+
+  memcpy(&this->buffer[p], buffer, first);
+  memcpy(this->buffer, &buffer[first], buffer_size - first);
+  size += buffer_size;
+  return buffer_size;
 }
 
 size_t LoopbackStream::write(uint8_t v)
@@ -60,17 +98,48 @@ size_t LoopbackStream::write(uint8_t v)
   }
   else
   {
-    int p = pos + size;
-    if (p >= buffer_size)
-    {
-      p -= buffer_size;
-    }
-    buffer[p] = v;
+    buffer[(pos + size) & mask] = v;
     size++;
     return 1;
   }
 }
 
+size_t LoopbackStream::acquireRead(const uint8_t **data)
+{
+  *data = &buffer[pos];
+  size_t first = buffer_size - pos;
+  return first < size ? first : size;
+}
+
+void LoopbackStream::release(size_t length)
+{
+  if (length > size)
+  {
+    length = size;
+  }
+  pos = (pos + length) & mask;
+  size -= length;
+}
+
+size_t LoopbackStream::acquireWrite(uint8_t **data)
+{
+  uint16_t p = (pos + size) & mask;
+  *data = &buffer[p];
+  size_t first = buffer_size - p;
+  size_t free_size = buffer_size - size;
+  return first < free_size ? first : free_size;
+}
+
+void LoopbackStream::commit(size_t length)
+{
+  size_t free_size = buffer_size - size;
+  if (length > free_size)
+  {
+    length = free_size;
+  }
+  size += length;
+}
+
 int LoopbackStream::available()
 {
   return size;
@@ -83,15 +152,13 @@ int LoopbackStream::availableForWrite()
 
 bool LoopbackStream::contains(char ch)
 {
-  for (int i = 0; i < size; i++)
+  size_t first = buffer_size - pos;
+  if (first > size)
   {
-    int p = (pos + i) % buffer_size;
-    if (buffer[p] == ch)
-    {
-      return true;
-    }
+    first = size;
   }
-  return false;
+  return memchr(&buffer[pos], ch, first) != NULL ||
+         memchr(buffer, ch, size - first) != NULL;
 }
 
 int LoopbackStream::peek()
@@ -12,11 +12,15 @@
  * If the buffer overflows, the last bytes written are lost.
  *
  * It can be used as a buffering layer between components.
+ *
+ * The capacity is rounded up to a power of two. Bulk reads and writes copy at most two spans, one on each
+ * side of the wrap point, and acquire/release give direct access to the buffer without copying.
  */
 class LoopbackStream : public Stream
 {
   uint8_t *buffer;
   uint16_t buffer_size;
+  uint16_t mask; // buffer_size - 1
   uint16_t pos, size;
 
 public:
@@ -28,8 +32,9 @@ public:
   /** Clear the buffer */
   void clear();
 
+  using Print::write;
   virtual size_t write(uint8_t);
-  virtual size_t write(uint8_t *buffer, size_t buffer_size);
+  virtual size_t write(const uint8_t *buffer, size_t buffer_size);
   virtual int availableForWrite(void);
 
   virtual int available();
@@ -37,4 +42,18 @@ public:
   virtual int read();
   virtual int peek();
   virtual void flush();
+
+  /** Copy up to length bytes out, read() consumes them and peek() does not */
+  size_t read(uint8_t *buffer, size_t length);
+  size_t peek(uint8_t *buffer, size_t length);
+
+  /** Zero copy read: point data to the oldest bytes, returns how many are contiguous */
+  size_t acquireRead(const uint8_t **data);
+  /** Consume length bytes, after acquireRead() or to skip data */
+  void release(size_t length);
+
+  /** Zero copy write: point data to the free space, returns how many bytes are contiguous */
+  size_t acquireWrite(uint8_t **data);
+  /** Append length bytes written through acquireWrite() */
+  void commit(size_t length);
 };
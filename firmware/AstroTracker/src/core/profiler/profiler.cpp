@@ -0,0 +1,125 @@
+/******************************************************************************************
+ * File:        profiler.cpp
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#include "profiler.h"
+
+#ifdef WITH_PROFILER
+
+const char *const profiler_zone_str[PROFILER_ZONE_NB] =
+    {
+        [PROFILER_ZONE_GPS_TICK] = "GPS_TICK",
+        [PROFILER_ZONE_SAT_TICK] = "SAT_TICK",
+        [PROFILER_ZONE_SAT_REQUEST] = "SAT_REQUEST",
+        [PROFILER_ZONE_SAT_ANSWER] = "SAT_ANSWER",
+        [PROFILER_ZONE_LOGGER_WRITE] = "LOGGER_WRITE",
+        [PROFILER_ZONE_LOGGER_READ] = "LOGGER_READ",
+        [PROFILER_ZONE_SCHEDULER_TICK] = "SCHEDULER_TICK",
+        [PROFILER_ZONE_SCREEN_RENDER] = "SCREEN_RENDER",
+};
+
+static profiler_stats_t stats[PROFILER_ZONE_NB];
+
+int profiler_init(void)
+{
+#if defined(NRF52_SERIES)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    profiler_reset();
+
+    return PROFILER_NO_ERROR;
+}
+
+void profiler_reset(void)
+{
+    for (uint8_t i = 0; i < PROFILER_ZONE_NB; i++)
+    {
+        stats[i].count = 0;
+        stats[i].min = UINT32_MAX;
+        stats[i].max = 0;
+        stats[i].total = 0;
+    }
+}
+
+uint32_t profiler_cycles(void)
+{
+#if defined(NRF52_SERIES)
+    return DWT->CYCCNT;
+#elif defined(ARDUINO_ARCH_SAMD)
+    // SysTick counts down from LOAD once per millisecond, extend it with millis()
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t pending, value;
+    do
+    {
+        pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+        value = SysTick->VAL;
+    } while (pending != (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)); // Reloaded in between
+
+    uint32_t ms = millis() + (pending ? 1 : 0); // Interrupt of the last reload not served yet
+    uint32_t cycles = ms * (SysTick->LOAD + 1) + (SysTick->LOAD - value);
+
+    __set_PRIMASK(primask);
+    return cycles;
+#else
+    return micros();
+#endif
+}
+
+uint32_t profiler_cycles_to_us(uint32_t cycles)
+{
+#if defined(NRF52_SERIES) || defined(ARDUINO_ARCH_SAMD)
+    return cycles / (SystemCoreClock / 1000000);
+#else
+    return cycles; // profiler_cycles() counts microseconds
+#endif
+}
+
+void profiler_record(profiler_zone_t zone, uint32_t cycles)
+{
+    profiler_stats_t *zone_stats = &stats[zone];
+
+    zone_stats->count++;
+    zone_stats->total += cycles;
+    if (cycles < zone_stats->min)
+        zone_stats->min = cycles;
+    if (cycles > zone_stats->max)
+        zone_stats->max = cycles;
+}
+
+int profiler_get_stats(profiler_zone_t zone, profiler_stats_t *stats_out)
+{
+    if (zone >= PROFILER_ZONE_NB || stats_out == NULL)
+        return PROFILER_ERROR_INVALID_PARAM;
+
+    *stats_out = stats[zone];
+
+    return PROFILER_NO_ERROR;
+}
+
+#endif /* WITH_PROFILER */
@@ -0,0 +1,98 @@
+/******************************************************************************************
+ * File:        profiler.h
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define PROFILER_NO_ERROR (0)
+#define PROFILER_ERROR_INVALID_PARAM (-1)
+
+// Instrumented code, one set of statistics each
+typedef enum
+{
+    PROFILER_ZONE_GPS_TICK,       // syshal_gps_tick()
+    PROFILER_ZONE_SAT_TICK,       // syshal_sat_tick()
+    PROFILER_ZONE_SAT_REQUEST,    // ASTRONODE command encoded and written
+    PROFILER_ZONE_SAT_ANSWER,     // ASTRONODE answer waited for and decoded
+    PROFILER_ZONE_LOGGER_WRITE,   // logger_insert_data(), logger_clear_slot(), logger_set_*()
+    PROFILER_ZONE_LOGGER_READ,    // logger_get_*()
+    PROFILER_ZONE_SCHEDULER_TICK, // scheduler_tick()
+    PROFILER_ZONE_SCREEN_RENDER,  // syshal_screen_tick() with the display awake
+    PROFILER_ZONE_NB,
+} profiler_zone_t;
+
+// In CPU cycles, min and max are only meaningful once count != 0
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} profiler_stats_t;
+
+// Profiling is only built with -DWITH_PROFILER, PROFILER_ZONE() expands to nothing otherwise.
+// Zones are timed with the DWT cycle counter on nRF52 and with SysTick (the millis() timer) on
+// SAMD21, a zone longer than 2^32 cycles (about 89 s at 48 MHz) is not measured correctly.
+// Zones must only be entered from the main loop, not from interrupts.
+#ifdef WITH_PROFILER
+
+extern const char *const profiler_zone_str[PROFILER_ZONE_NB]; // Names for the status reply
+
+int profiler_init(void);
+void profiler_reset(void);
+uint32_t profiler_cycles(void);
+uint32_t profiler_cycles_to_us(uint32_t cycles);
+void profiler_record(profiler_zone_t zone, uint32_t cycles);
+int profiler_get_stats(profiler_zone_t zone, profiler_stats_t *stats);
+
+// Times the enclosing block, from its declaration to the end of the scope
+class profiler_scope_t
+{
+public:
+    profiler_scope_t(profiler_zone_t zone) : _zone(zone), _start(profiler_cycles()) {}
+    ~profiler_scope_t() { profiler_record(_zone, profiler_cycles() - _start); }
+
+private:
+    profiler_zone_t _zone;
+    uint32_t _start;
+};
+
+#define PROFILER_CONCAT_PRIV(a, b) a##b
+#define PROFILER_SCOPE_NAME_PRIV(line) PROFILER_CONCAT_PRIV(profiler_scope_, line)
+#define PROFILER_ZONE(zone) profiler_scope_t PROFILER_SCOPE_NAME_PRIV(__LINE__)(zone)
+
+#else
+
+#define PROFILER_ZONE(zone)
+
+#endif /* WITH_PROFILER */
+
+#endif /* _PROFILER_H_ */
@@ -0,0 +1,404 @@
+/******************************************************************************************
+ * File:        satpass.cpp
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#include "satpass.h"
+#include <math.h>
+#include "../debug/debug.h"
+
+/* Pass search
+ *
+ * The satellite is visible above the minimum elevation when the central angle between the
+ * observer and the sub-satellite point is below lambda_max. This angle cannot change faster
+ * than the satellite mean motion plus the earth rotation, so far from the horizon the search
+ * jumps straight to the earliest time the satellite could become visible. Close to the
+ * horizon it falls back to sat_pass_search_step_s and the crossing is then refined to the
+ * second by bisection.
+ *
+ * Each satellite keeps its propagation state and the last searched time, so asking for the
+ * next pass once the previous one has elapsed only searches the new part of the window.
+ */
+
+#define SATPASS_EARTH_RADIUS_KM (6378.137f)
+#define SATPASS_EARTH_MU_KM3_S2 (398600.4418)
+#define SATPASS_EARTH_J2 (1.08262668e-3)
+#define SATPASS_EARTH_ROTATION_RAD_S (7.2921159e-5f)
+
+#define SATPASS_J2000_UNIX_S (946728000)         // 2000-01-01 12:00:00 UTC
+#define SATPASS_GMST_J2000_D (280.46061837)      // Greenwich sidereal angle at J2000
+#define SATPASS_GMST_RATE_D_DAY (360.98564736629) // Greenwich sidereal angle rate
+
+#define SATPASS_REBASE_PERIOD_S (172800) // Keep float propagation times small enough
+#define SATPASS_RATE_MARGIN (1.02f)      // Safety margin on the central angle rate bound
+
+#define DEG_TO_RAD_D (M_PI / 180.0)
+
+typedef struct
+{
+    // Constant terms of the orbit
+    float mean_motion;   // rad/s
+    float raan_rate;     // rad/s
+    float sin_incl;
+    float cos_incl;
+    float rate_max;      // Upper bound of the central angle rate in rad/s
+    float lambda_max;    // Central angle at the minimum elevation in rad
+
+    // Propagation state at t_ref
+    uint32_t t_ref;
+    float arg_lat_ref;
+    float node_lon_ref;  // Longitude of the ascending node (RAAN - GMST)
+
+    // Search state
+    uint32_t searched_from;
+    uint32_t searched_until; // Every second in [searched_from, searched_until[ has been searched
+    bool next_valid;
+    satpass_pass_t next;
+} satpass_cache_t;
+
+static satpass_config_t config;
+static satpass_orbit_t orbits[SATPASS_NB_SATELLITES_MAX];
+static satpass_cache_t cache[SATPASS_NB_SATELLITES_MAX];
+static uint8_t nb_orbits = 0;
+static satpass_stats_t stats;
+
+// Observer unit vector in ECEF
+static float obs_x, obs_y, obs_z;
+
+// Private functions
+void satpass_prepare_priv(uint8_t sat_id);
+void satpass_rebase_priv(uint8_t sat_id, uint32_t timestamp);
+float satpass_central_angle_priv(uint8_t sat_id, uint32_t timestamp);
+uint32_t satpass_bisect_priv(uint8_t sat_id, uint32_t t_lo, uint32_t t_hi, bool visible_hi);
+uint32_t satpass_step_priv(uint8_t sat_id, float lambda);
+int satpass_search_priv(uint8_t sat_id, uint32_t timestamp, uint32_t t_end);
+
+int satpass_init(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    config.satpass = NULL;
+    config.orbits = NULL;
+    nb_orbits = 0; // Orbits come with the configuration (SYS_CONFIG_TAG_SATPASS_ORBITS)
+
+    return SATPASS_NO_ERROR;
+}
+
+int satpass_term(void)
+{
+    config.satpass = NULL;
+    config.orbits = NULL;
+    nb_orbits = 0;
+
+    return SATPASS_NO_ERROR;
+}
+
+int satpass_update_config(satpass_config_t satpass_config)
+{
+    DEBUG_PR_TRACE("Update SATPASS predictor configuration. %s()", __FUNCTION__);
+
+    if (satpass_config.satpass->hdr.set &&
+        (satpass_config.satpass->contents.sat_pass_search_step_s == 0))
+        return SATPASS_ERROR_INVALID_PARAM;
+
+    config = satpass_config;
+
+    // Orbits published by the operator, received with the configuration. Without valid ones no pass is predicted
+    nb_orbits = 0;
+    if (config.orbits != NULL && config.orbits->hdr.set)
+    {
+        uint8_t orbit_nb = config.orbits->contents.orbit_nb;
+        bool valid = orbit_nb <= SATPASS_NB_SATELLITES_MAX;
+
+        satpass_orbit_t new_orbits[SATPASS_NB_SATELLITES_MAX];
+        for (uint8_t i = 0; valid && i < orbit_nb; i++)
+        {
+            sys_config_satpass_orbit_t orbit = config.orbits->contents.orbit[i]; // Copy, the settings are packed
+            new_orbits[i].epoch = orbit.epoch;
+            new_orbits[i].altitude_km = orbit.altitude_km;
+            new_orbits[i].inclination_d = orbit.inclination_d;
+            new_orbits[i].raan_d = orbit.raan_d;
+            new_orbits[i].arg_lat_d = orbit.arg_lat_d;
+            valid = orbit.altitude_km > 0.0f;
+        }
+
+        if (!valid || satpass_set_orbits(new_orbits, orbit_nb))
+            DEBUG_PR_WARN("Invalid satellite orbits, no pass is predicted. %s()", __FUNCTION__);
+    }
+
+    if (!config.satpass->hdr.set)
+        return SATPASS_NO_ERROR;
+
+    float lat = (float)(config.satpass->contents.lat * (1e-7 * DEG_TO_RAD_D));
+    float lon = (float)(config.satpass->contents.lon * (1e-7 * DEG_TO_RAD_D));
+    obs_x = cosf(lat) * cosf(lon);
+    obs_y = cosf(lat) * sinf(lon);
+    obs_z = sinf(lat);
+
+    // Observer or threshold may have changed, drop all cached passes
+    for (uint8_t i = 0; i < nb_orbits; i++)
+        satpass_prepare_priv(i);
+
+    return SATPASS_NO_ERROR;
+}
+
+int satpass_set_orbits(const satpass_orbit_t *new_orbits, uint8_t nb_new_orbits)
+{
+    if ((nb_new_orbits == 0) || (nb_new_orbits > SATPASS_NB_SATELLITES_MAX))
+        return SATPASS_ERROR_INVALID_PARAM;
+
+    memcpy(orbits, new_orbits, nb_new_orbits * sizeof(satpass_orbit_t));
+    nb_orbits = nb_new_orbits;
+
+    for (uint8_t i = 0; i < nb_orbits; i++)
+        satpass_prepare_priv(i);
+
+    return SATPASS_NO_ERROR;
+}
+
+int satpass_get_next_pass(uint32_t timestamp, satpass_pass_t *pass)
+{
+    if ((config.satpass == NULL) || (!config.satpass->hdr.set) || (nb_orbits == 0))
+        return SATPASS_ERROR_INVALID_STATE;
+
+#ifndef DEBUG_DISABLED
+    uint32_t evaluations = stats.evaluations;
+#endif
+    uint32_t t_end = timestamp + config.satpass->contents.sat_pass_search_window_size_s;
+    bool found = false;
+
+    for (uint8_t i = 0; i < nb_orbits; i++)
+    {
+        // Time went backward (RTC update), the cached search is not usable
+        if (timestamp < cache[i].searched_from)
+            satpass_prepare_priv(i);
+
+        // Cached pass has elapsed
+        if (cache[i].next_valid && (cache[i].next.los <= timestamp))
+            cache[i].next_valid = false;
+
+        if (!cache[i].next_valid && (cache[i].searched_until < t_end))
+            satpass_search_priv(i, timestamp, t_end);
+
+        if (cache[i].next_valid &&
+            (cache[i].next.aos < t_end) &&
+            (!found || (cache[i].next.aos < pass->aos)))
+        {
+            *pass = cache[i].next;
+            found = true;
+        }
+    }
+
+    DEBUG_PR_TRACE("SATPASS search done with %d evaluations. %s()", stats.evaluations - evaluations, __FUNCTION__);
+
+    if (!found)
+        return SATPASS_ERROR_NO_PASS_FOUND;
+
+    return SATPASS_NO_ERROR;
+}
+
+int satpass_get_stats(satpass_stats_t *stats_out)
+{
+    *stats_out = stats;
+
+    return SATPASS_NO_ERROR;
+}
+
+void satpass_prepare_priv(uint8_t sat_id)
+{
+    satpass_orbit_t *orbit = &orbits[sat_id];
+    satpass_cache_t *c = &cache[sat_id];
+
+    double a = SATPASS_EARTH_RADIUS_KM + orbit->altitude_km;
+    double n = sqrt(SATPASS_EARTH_MU_KM3_S2 / (a * a * a));
+    double incl = orbit->inclination_d * DEG_TO_RAD_D;
+    double raan_rate = -1.5 * n * SATPASS_EARTH_J2 * (SATPASS_EARTH_RADIUS_KM / a) * (SATPASS_EARTH_RADIUS_KM / a) * cos(incl);
+
+    c->mean_motion = (float)n;
+    c->raan_rate = (float)raan_rate;
+    c->sin_incl = (float)sin(incl);
+    c->cos_incl = (float)cos(incl);
+    c->rate_max = (float)(n + fabs(raan_rate) + SATPASS_EARTH_ROTATION_RAD_S) * SATPASS_RATE_MARGIN;
+
+    if (config.satpass != NULL)
+    {
+        double elev = config.satpass->contents.sat_pass_min_elevation_d * DEG_TO_RAD_D;
+        c->lambda_max = (float)(acos(SATPASS_EARTH_RADIUS_KM * cos(elev) / a) - elev);
+    }
+    else
+    {
+        c->lambda_max = 0.0f;
+    }
+
+    c->t_ref = 0;
+    c->searched_from = 0;
+    c->searched_until = 0;
+    c->next_valid = false;
+}
+
+void satpass_rebase_priv(uint8_t sat_id, uint32_t timestamp)
+{
+    satpass_orbit_t *orbit = &orbits[sat_id];
+    satpass_cache_t *c = &cache[sat_id];
+
+    double dt = (double)timestamp - (double)orbit->epoch;
+    double days_j2000 = ((double)timestamp - SATPASS_J2000_UNIX_S) / 86400.0;
+    double gmst = (SATPASS_GMST_J2000_D + SATPASS_GMST_RATE_D_DAY * days_j2000) * DEG_TO_RAD_D;
+    double arg_lat = orbit->arg_lat_d * DEG_TO_RAD_D + (double)c->mean_motion * dt;
+    double raan = orbit->raan_d * DEG_TO_RAD_D + (double)c->raan_rate * dt;
+
+    c->t_ref = timestamp;
+    c->arg_lat_ref = (float)fmod(arg_lat, 2.0 * M_PI);
+    c->node_lon_ref = (float)fmod(raan - gmst, 2.0 * M_PI);
+
+    stats.rebases++;
+}
+
+float satpass_central_angle_priv(uint8_t sat_id, uint32_t timestamp)
+{
+    satpass_cache_t *c = &cache[sat_id];
+
+    // Rebase on fixed boundaries so a given second always gives the same result
+    if ((c->t_ref == 0) || (timestamp < c->t_ref) || ((timestamp - c->t_ref) >= SATPASS_REBASE_PERIOD_S))
+        satpass_rebase_priv(sat_id, timestamp - (timestamp % SATPASS_REBASE_PERIOD_S));
+
+    float dt = (float)(timestamp - c->t_ref);
+    float arg_lat = c->arg_lat_ref + c->mean_motion * dt;
+    float node_lon = c->node_lon_ref + (c->raan_rate - SATPASS_EARTH_ROTATION_RAD_S) * dt;
+
+    float sin_u = sinf(arg_lat);
+    float cos_u = cosf(arg_lat);
+    float sin_o = sinf(node_lon);
+    float cos_o = cosf(node_lon);
+
+    // Sub-satellite point unit vector in ECEF
+    float x = cos_u * cos_o - sin_u * sin_o * c->cos_incl;
+    float y = cos_u * sin_o + sin_u * cos_o * c->cos_incl;
+    float z = sin_u * c->sin_incl;
+
+    float cos_lambda = x * obs_x + y * obs_y + z * obs_z;
+    if (cos_lambda > 1.0f)
+        cos_lambda = 1.0f;
+    else if (cos_lambda < -1.0f)
+        cos_lambda = -1.0f;
+
+    stats.evaluations++;
+
+    return acosf(cos_lambda);
+}
+
+// Return the first second of ]t_lo, t_hi] with the visibility state of t_hi
+uint32_t satpass_bisect_priv(uint8_t sat_id, uint32_t t_lo, uint32_t t_hi, bool visible_hi)
+{
+    while ((t_hi - t_lo) > 1)
+    {
+        uint32_t t_mid = t_lo + (t_hi - t_lo) / 2;
+        bool visible_mid = satpass_central_angle_priv(sat_id, t_mid) <= cache[sat_id].lambda_max;
+
+        if (visible_mid == visible_hi)
+            t_hi = t_mid;
+        else
+            t_lo = t_mid;
+    }
+
+    return t_hi;
+}
+
+// Return the next time step, the visibility cannot change before that time
+uint32_t satpass_step_priv(uint8_t sat_id, float lambda)
+{
+    float margin = fabsf(lambda - cache[sat_id].lambda_max);
+    uint32_t step = (uint32_t)(margin / cache[sat_id].rate_max);
+
+    if (step < config.satpass->contents.sat_pass_search_step_s)
+        step = config.satpass->contents.sat_pass_search_step_s;
+
+    return step;
+}
+
+int satpass_search_priv(uint8_t sat_id, uint32_t timestamp, uint32_t t_end)
+{
+    satpass_cache_t *c = &cache[sat_id];
+
+    if (c->searched_until < timestamp)
+    {
+        c->searched_from = timestamp;
+        c->searched_until = timestamp;
+    }
+
+    // Look for the acquisition of signal
+    uint32_t t = c->searched_until;
+    float lambda = satpass_central_angle_priv(sat_id, t);
+    uint32_t aos = t;
+
+    if (lambda > c->lambda_max)
+    {
+        bool visible = false;
+        while (t < t_end)
+        {
+            uint32_t t_next = t + satpass_step_priv(sat_id, lambda);
+            lambda = satpass_central_angle_priv(sat_id, t_next);
+
+            if (lambda <= c->lambda_max)
+            {
+                aos = satpass_bisect_priv(sat_id, t, t_next, true);
+                t = t_next;
+                visible = true;
+                break;
+            }
+
+            t = t_next;
+        }
+
+        if (!visible)
+        {
+            c->searched_until = t;
+            return SATPASS_ERROR_NO_PASS_FOUND;
+        }
+    }
+
+    // Look for the loss of signal, a pass is always shorter than half an orbit
+    uint32_t t_limit = t + (uint32_t)(M_PI / c->mean_motion);
+    uint32_t los = t_limit;
+
+    while (t < t_limit)
+    {
+        uint32_t t_next = t + satpass_step_priv(sat_id, lambda);
+        lambda = satpass_central_angle_priv(sat_id, t_next);
+
+        if (lambda > c->lambda_max)
+        {
+            los = satpass_bisect_priv(sat_id, t, t_next, false);
+            break;
+        }
+
+        t = t_next;
+    }
+
+    c->next.aos = aos;
+    c->next.los = los;
+    c->next.sat_id = sat_id;
+    c->next_valid = true;
+    c->searched_until = los;
+
+    return SATPASS_NO_ERROR;
+}
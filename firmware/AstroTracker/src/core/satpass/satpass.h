@@ -0,0 +1,82 @@
+/******************************************************************************************
+ * File:        satpass.h
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#ifndef _SATPASS_h
+#define _SATPASS_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "../config/sys_config.h"
+
+#define SATPASS_NO_ERROR (0)
+#define SATPASS_ERROR_INVALID_STATE (-1)
+#define SATPASS_ERROR_INVALID_PARAM (-2)
+#define SATPASS_ERROR_NO_PASS_FOUND (-3)
+
+#define SATPASS_NB_SATELLITES_MAX (8)
+
+// Mean circular orbit of one satellite, valid around epoch
+typedef struct
+{
+    uint32_t epoch;      // UNIX time of the elements
+    float altitude_km;   // Mean altitude above the spherical earth
+    float inclination_d; // Orbit inclination
+    float raan_d;        // Right ascension of the ascending node at epoch
+    float arg_lat_d;     // Argument of latitude at epoch
+} satpass_orbit_t;
+
+typedef struct
+{
+    uint32_t aos; // First second above the minimum elevation
+    uint32_t los; // First second below the minimum elevation
+    uint8_t sat_id;
+} satpass_pass_t;
+
+typedef struct
+{
+    uint32_t evaluations; // Number of position evaluations since init
+    uint32_t rebases;     // Number of double precision propagations since init
+} satpass_stats_t;
+
+static_assert(SATPASS_NB_SATELLITES_MAX == SYS_CONFIG_SATPASS_ORBIT_NB, "sys_config_satpass_orbits_t needs one entry per satellite");
+
+typedef struct
+{
+    sys_config_satpass_settings_t *satpass;
+    sys_config_satpass_orbits_t *orbits; // No pass is predicted until they are set
+} satpass_config_t;
+
+int satpass_init(void);
+int satpass_term(void);
+int satpass_update_config(satpass_config_t satpass_config);
+int satpass_set_orbits(const satpass_orbit_t *orbits, uint8_t nb_orbits);
+int satpass_get_next_pass(uint32_t timestamp, satpass_pass_t *pass);
+int satpass_get_stats(satpass_stats_t *stats);
+
+#endif
@@ -37,7 +37,9 @@ uint32_t (*rtc_getTime_ptr)(void);
 
 CronEventClass::CronEventClass()
 {
+  type = dtCronAlarm;
   memset(&expr, 0, sizeof(expr));
+  period = 0;
   onTickHandler = NULL; // prevent a callback until this pointer is explicitly set
   nextTrigger = 0;
   isEnabled = isOneShot = false;
@@ -54,7 +56,17 @@ void CronEventClass::updateNextTrigger()
     if (onTickHandler != NULL && nextTrigger <= timenow)
     {
       // update alarm if next trigger is not yet in the future
-      nextTrigger = cron_next(&expr, timenow);
+      switch (type)
+      {
+      case dtIntervalAlarm:
+        nextTrigger = (timenow / period + 1) * period;
+        break;
+      case dtTimestampAlarm:
+        break; // fixed trigger time, fires as soon as serviced
+      default:
+        nextTrigger = cron_next(&expr, timenow);
+        break;
+      }
     }
   }
 }
@@ -65,8 +77,10 @@ void CronEventClass::updateNextTrigger()
 CronClass::CronClass(uint32_t (*rtc_getTime)(void))
 {
   isServicing = false;
+  heapSize = 0;
   for (uint8_t id = 0; id < dtNBR_ALARMS; id++)
   {
+    heapIndex[id] = dtINVALID_ALARM_ID;
     free(id); // ensure all Alarms are cleared and available for allocation
   }
   rtc_getTime_ptr = rtc_getTime;
@@ -78,6 +92,7 @@ void CronClass::enable(CronID_t ID)
   {
     Alarm[ID].isEnabled = true;
     Alarm[ID].updateNextTrigger();
+    heapUpdate(ID);
   }
 }
 
@@ -86,6 +101,7 @@ void CronClass::disable(CronID_t ID)
   if (isAllocated(ID))
   {
     Alarm[ID].isEnabled = false;
+    heapRemove(ID);
   }
 }
 
@@ -93,7 +109,10 @@ void CronClass::free(CronID_t ID)
 {
   if (isAllocated(ID))
   {
+    heapRemove(ID);
+    Alarm[ID].type = dtCronAlarm;
     memset(&(Alarm[ID].expr), 0, sizeof(Alarm[ID].expr));
+    Alarm[ID].period = 0;
     Alarm[ID].onTickHandler = NULL;
     Alarm[ID].nextTrigger = 0;
     Alarm[ID].isEnabled = false;
@@ -158,23 +177,28 @@ void CronClass::serviceAlarms()
   if (!isServicing)
   {
     isServicing = true;
-    for (servicedCronId = 0; servicedCronId < dtNBR_ALARMS; servicedCronId++)
+    time_t timenow = (*rtc_getTime_ptr)(); // time(nullptr)
+    // only the heap top can be due, each alarm fires at most once per call
+    for (uint8_t n = 0; n < dtNBR_ALARMS && heapSize > 0; n++)
     {
-      if (Alarm[servicedCronId].isEnabled && ((*rtc_getTime_ptr)() >= Alarm[servicedCronId].nextTrigger))
-      { // time(nullptr)
-        OnTick_t TickHandler = Alarm[servicedCronId].onTickHandler;
-        if (Alarm[servicedCronId].isOneShot)
-        {
-          free(servicedCronId); // free the ID if mode is OnShot
-        }
-        else
-        {
-          Alarm[servicedCronId].updateNextTrigger();
-        }
-        if (TickHandler != NULL)
-        {
-          (*TickHandler)(); // call the handler
-        }
+      servicedCronId = heap[0];
+      if (timenow < Alarm[servicedCronId].nextTrigger)
+      {
+        break;
+      }
+      OnTick_t TickHandler = Alarm[servicedCronId].onTickHandler;
+      if (Alarm[servicedCronId].isOneShot)
+      {
+        free(servicedCronId); // free the ID if mode is OnShot
+      }
+      else
+      {
+        Alarm[servicedCronId].updateNextTrigger();
+        heapSiftDown(heapIndex[servicedCronId]);
+      }
+      if (TickHandler != NULL)
+      {
+        (*TickHandler)(); // call the handler
       }
     }
     isServicing = false;
@@ -184,25 +208,12 @@ void CronClass::serviceAlarms()
 // returns the absolute time of the next scheduled alarm, or 0 if none
 time_t CronClass::getNextTrigger(CronID_t *ID) const
 {
-  time_t nextTrigger = 0;
-
-  for (uint8_t id = 0; id < dtNBR_ALARMS; id++)
+  if (heapSize == 0)
   {
-    if (isAllocated(id))
-    {
-      if (nextTrigger == 0)
-      {
-        nextTrigger = Alarm[id].nextTrigger;
-        *ID = id;
-      }
-      else if (Alarm[id].nextTrigger < nextTrigger)
-      {
-        nextTrigger = Alarm[id].nextTrigger;
-        *ID = id;
-      }
-    }
+    return 0;
   }
-  return nextTrigger;
+  *ID = heap[0];
+  return Alarm[heap[0]].nextTrigger;
 }
 
 time_t CronClass::getNextTrigger(CronID_t ID) const
@@ -219,25 +230,158 @@ time_t CronClass::getNextTrigger(CronID_t ID) const
 
 // attempt to create a cron alarm and return CronID if successful
 CronID_t CronClass::create(char *cronstring, OnTick_t onTickHandler, bool isOneShot)
+{
+  // the expression is parsed once here, updateNextTrigger() only walks the bitsets
+  cron_expr expr;
+  const char *err = NULL;
+  memset(&expr, 0, sizeof(expr));
+  cron_parse_expr(cronstring, &expr, &err);
+  if (err)
+  {
+    return dtINVALID_ALARM_ID;
+  }
+  CronID_t id = allocate(dtCronAlarm, onTickHandler, isOneShot);
+  if (id != dtINVALID_ALARM_ID)
+  {
+    Alarm[id].expr = expr;
+    enable(id);
+  }
+  return id;
+}
+
+// attempt to create a periodic alarm and return CronID if successful
+CronID_t CronClass::createInterval(uint32_t period, OnTick_t onTickHandler, bool isOneShot)
+{
+  if (period == 0)
+  {
+    return dtINVALID_ALARM_ID;
+  }
+  CronID_t id = allocate(dtIntervalAlarm, onTickHandler, isOneShot);
+  if (id != dtINVALID_ALARM_ID)
+  {
+    Alarm[id].period = period;
+    enable(id);
+  }
+  return id;
+}
+
+// attempt to create a single alarm at timestamp and return CronID if successful
+CronID_t CronClass::createAt(time_t timestamp, OnTick_t onTickHandler)
+{
+  CronID_t id = allocate(dtTimestampAlarm, onTickHandler, true);
+  if (id != dtINVALID_ALARM_ID)
+  {
+    Alarm[id].nextTrigger = timestamp;
+    enable(id);
+  }
+  return id;
+}
+
+// returns the first free id, set up for type but not yet enabled
+CronID_t CronClass::allocate(dtAlarmType_t type, OnTick_t onTickHandler, bool isOneShot)
 {
   for (uint8_t id = 0; id < dtNBR_ALARMS; id++)
   {
     if (!isAllocated(id))
     {
       // here if there is an Alarm id that is not allocated
-      const char *err = NULL;
-      memset(&(Alarm[id].expr), 0, sizeof(Alarm[id].expr));
-      cron_parse_expr(cronstring, &(Alarm[id].expr), &err);
-      if (err)
-      {
-        memset(&(Alarm[id].expr), 0, sizeof(Alarm[id].expr));
-        return dtINVALID_ALARM_ID;
-      }
+      Alarm[id].type = type;
       Alarm[id].onTickHandler = onTickHandler;
       Alarm[id].isOneShot = isOneShot;
-      enable(id);
-      return id; // alarm created ok
+      return id;
     }
   }
-  return dtINVALID_ALARM_ID; // no IDs available or time is invalid
+  return dtINVALID_ALARM_ID; // no IDs available
+}
+
+//***********************************************************
+//* Heap Methods
+
+void CronClass::heapSwap(uint8_t i, uint8_t j)
+{
+  CronID_t tmp = heap[i];
+  heap[i] = heap[j];
+  heap[j] = tmp;
+  heapIndex[heap[i]] = i;
+  heapIndex[heap[j]] = j;
+}
+
+void CronClass::heapSiftUp(uint8_t i)
+{
+  while (i > 0)
+  {
+    uint8_t parent = (i - 1) / 2;
+    if (Alarm[heap[parent]].nextTrigger <= Alarm[heap[i]].nextTrigger)
+    {
+      break;
+    }
+    heapSwap(i, parent);
+    i = parent;
+  }
+}
+
+void CronClass::heapSiftDown(uint8_t i)
+{
+  while (true)
+  {
+    uint8_t smallest = i;
+    uint8_t left = 2 * i + 1;
+    uint8_t right = 2 * i + 2;
+    if (left < heapSize && Alarm[heap[left]].nextTrigger < Alarm[heap[smallest]].nextTrigger)
+    {
+      smallest = left;
+    }
+    if (right < heapSize && Alarm[heap[right]].nextTrigger < Alarm[heap[smallest]].nextTrigger)
+    {
+      smallest = right;
+    }
+    if (smallest == i)
+    {
+      break;
+    }
+    heapSwap(i, smallest);
+    i = smallest;
+  }
+}
+
+void CronClass::heapInsert(CronID_t ID)
+{
+  heap[heapSize] = ID;
+  heapIndex[ID] = heapSize;
+  heapSize++;
+  heapSiftUp(heapIndex[ID]);
+}
+
+void CronClass::heapRemove(CronID_t ID)
+{
+  uint8_t i = heapIndex[ID];
+  if (i == dtINVALID_ALARM_ID)
+  {
+    return;
+  }
+  heapSize--;
+  heapIndex[ID] = dtINVALID_ALARM_ID;
+  if (i != heapSize)
+  {
+    // move the last element in the hole and restore the heap order
+    CronID_t moved = heap[heapSize];
+    heap[i] = moved;
+    heapIndex[moved] = i;
+    heapSiftUp(i);
+    heapSiftDown(heapIndex[moved]);
+  }
+}
+
+// insert the alarm or restore the heap order after its nextTrigger changed
+void CronClass::heapUpdate(CronID_t ID)
+{
+  if (heapIndex[ID] == dtINVALID_ALARM_ID)
+  {
+    heapInsert(ID);
+  }
+  else
+  {
+    heapSiftUp(heapIndex[ID]);
+    heapSiftDown(heapIndex[ID]);
+  }
 }
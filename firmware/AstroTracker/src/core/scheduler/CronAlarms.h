@@ -40,7 +40,7 @@ extern "C"
 #elif defined(ESP8266)
 #define dtNBR_ALARMS 20 // for esp8266 chip - max is 255
 #else
-#define dtNBR_ALARMS 6 // assume non-AVR has more memory
+#define dtNBR_ALARMS 16 // assume non-AVR has more memory
 #endif
 #endif
 
@@ -54,13 +54,22 @@ typedef CronID_t CronId; // Arduino friendly name
 
 typedef void (*OnTick_t)(); // alarm callback function typedef
 
+typedef enum
+{
+  dtCronAlarm,     // next trigger computed from the parsed cron expression
+  dtIntervalAlarm, // triggers every period seconds, aligned on the epoch
+  dtTimestampAlarm // triggers once at a fixed time
+} dtAlarmType_t;
+
 // class defining an alarm instance, only used by dtAlarmsClass
 class CronEventClass
 {
 public:
   CronEventClass();
   void updateNextTrigger();
-  cron_expr expr;
+  dtAlarmType_t type;
+  cron_expr expr;  // only used by dtCronAlarm
+  uint32_t period; // only used by dtIntervalAlarm
   OnTick_t onTickHandler;
   time_t nextTrigger;
   bool isEnabled; // the timer is only actioned if isEnabled is true
@@ -75,6 +84,18 @@ private:
   uint8_t isServicing;
   uint8_t servicedCronId; // the alarm currently being serviced
   void serviceAlarms();
+  CronID_t allocate(dtAlarmType_t type, OnTick_t onTickHandler, bool isOneShot);
+
+  // binary min-heap of the enabled alarms, ordered by nextTrigger
+  CronID_t heap[dtNBR_ALARMS];
+  uint8_t heapIndex[dtNBR_ALARMS]; // position of each alarm in heap, dtINVALID_ALARM_ID if absent
+  uint8_t heapSize;
+  void heapSwap(uint8_t i, uint8_t j);
+  void heapSiftUp(uint8_t i);
+  void heapSiftDown(uint8_t i);
+  void heapInsert(CronID_t ID);
+  void heapRemove(CronID_t ID);
+  void heapUpdate(CronID_t ID);
 
 public:
   CronClass(uint32_t (*rtc_getTime)(void));
@@ -83,6 +104,12 @@ public:
   CronID_t create(char *cronstring, OnTick_t onTickHandler, bool isOneShot);
   // isOneShot - trigger once at the given time in the future
 
+  // Functions to create alarms without cron strings
+  CronID_t createInterval(uint32_t period, OnTick_t onTickHandler, bool isOneShot);
+  // period - seconds between triggers, triggers are aligned on multiples of period since the epoch
+  CronID_t createAt(time_t timestamp, OnTick_t onTickHandler);
+  // timestamp - absolute time of the single trigger
+
   // Function that must be evaluated often (at least once every main loop)
   void delay(unsigned long ms = 0);
 
@@ -24,32 +24,81 @@
  ******************************************************************************************/
 
 #include "scheduler.h"
+#include <math.h>
 #include "CronAlarms.h"
 #include "../debug/debug.h"
+#include "../profiler/profiler.h"
 #include "../../syshal/syshal_rtc.h"
 
+/* Wake planning
+ *
+ * Every wake up from deep sleep costs the MCU and, when it needs it, the satellite module
+ * start up. Alarms that fall within slack_s after the earliest one are serviced together,
+ * at the time of the last of them, so the earlier ones are delayed by up to slack_s. The
+ * timeout wake up (watchdog, polling) is never delayed but it joins the group the same way.
+ *
+ * Satellite jobs do not power the module on their own. A requested job waits up to slack_s
+ * and is run at the last wake up before that deadline, together with every other pending
+ * job, so that e.g. the slots logged after a fix, the sensor blocks and the status refresh
+ * share one power up of the module.
+ */
+
+/* Adaptive GPS interval
+ *
+ * With the adaptive settings the GPS alarm is a single shot, armed interval_s after the last
+ * start. A fix further than distance_threshold_m from the previous one (on top of the accuracy
+ * of both) or faster than speed_threshold_mm_s means the asset moves and sets the interval back
+ * to interval_min_m. A stationary fix multiplies it by backoff, up to interval_max_m. Without
+ * a fix the interval is left as is.
+ */
+
 CronClass Cron = CronClass(syshal_rtc_return_timestamp);
 
 static scheduler_gps_config_t gps_config;
 static scheduler_satpass_config_t satpass_config;
+static scheduler_wake_config_t wake_config;
 
 CronId scheduler_alarm_gps_start_id = dtINVALID_ALARM_ID;
 CronId scheduler_alarm_satpass_start_id = dtINVALID_ALARM_ID;
+CronId scheduler_alarm_sensor_sample_id = dtINVALID_ALARM_ID; // One alarm for every sensor, the sensors coalesce their samples
 
-char scheduler_alarm_gps_start_cron_expr[18];
-char scheduler_alarm_satpass_start_cron_expr[18];
+uint32_t scheduler_alarm_gps_start_interval_s;
+uint32_t scheduler_alarm_satpass_start_timestamp;
 
 #define SCHEDULER_ALARM_TIMEOUT_S 900
+#define SCHEDULER_GPS_E7_DEG_TO_M (0.0111195f) // 1e-7 degree of great circle, mean earth radius
+
+static bool gps_adaptive = false;
+static uint32_t gps_adaptive_interval_s;
+static uint32_t gps_adaptive_start; // Last GPS start
+static bool gps_last_fix_valid = false;
+static int32_t gps_last_fix_lat;
+static int32_t gps_last_fix_lon;
+static uint32_t gps_last_fix_hacc_mm;
+#define SCHEDULER_WAKE_SLACK_MAX_S (SCHEDULER_ALARM_TIMEOUT_S / 2) // Alarms delayed more would be freed
+
+static uint32_t wake_slack_s = 0;
+static uint32_t job_pending = 0; // One bit per scheduler_job_t
+static uint32_t job_deadline[SCHEDULER_JOB_NB];
 
 // Private functions
 int scheduler_gps_set_alarm_config_priv(uint8_t interval_h);
+int scheduler_gps_set_adaptive_config_priv(void);
+int scheduler_gps_adaptive_arm_priv(void);
+uint32_t scheduler_gps_distance_m_priv(int32_t lat_a, int32_t lon_a, int32_t lat_b, int32_t lon_b);
 void scheduler_gps_start_callback_priv(void);
 int scheduler_satpass_set_alarm_config_priv(uint32_t timestamp);
 void scheduler_satpass_start_callback_priv(void);
+void scheduler_sensor_sample_callback_priv(void);
+void scheduler_alarm_freed_priv(CronId id);
+int scheduler_job_request_priv(scheduler_job_t job, uint32_t deadline);
 
 int scheduler_init(void)
 {
-    // Empty
+    wake_slack_s = 0;
+    job_pending = 0;
+    gps_adaptive = false;
+    gps_last_fix_valid = false;
 
     return SCHEDULER_NO_ERROR;
 }
@@ -60,6 +109,18 @@ int scheduler_gps_update_config(scheduler_gps_config_t scheduler_gps_config)
 
     gps_config = scheduler_gps_config;
 
+    int ret = SCHEDULER_NO_ERROR;
+
+    gps_adaptive = false;
+    if ((gps_config.adaptive != NULL) && gps_config.adaptive->hdr.set)
+    {
+        DEBUG_PR_TRACE("Update adaptive GPS alarm. %s()", __FUNCTION__);
+        if (scheduler_gps_set_adaptive_config_priv())
+            ret = SCHEDULER_ERROR_INVALID_PARAM; // Fixed interval then
+        else
+            gps_adaptive = true;
+    }
+
     if (gps_config.scheduler->hdr.set)
     {
         DEBUG_PR_TRACE("Update GPS alarm. %s()", __FUNCTION__);
@@ -75,7 +136,7 @@ int scheduler_gps_update_config(scheduler_gps_config_t scheduler_gps_config)
         }
     }
 
-    return SCHEDULER_NO_ERROR;
+    return ret;
 }
 
 int scheduler_satpass_update_config(scheduler_satpass_config_t scheduler_satpass_config)
@@ -102,6 +163,24 @@ int scheduler_satpass_update_config(scheduler_satpass_config_t scheduler_satpass
     return SCHEDULER_NO_ERROR;
 }
 
+int scheduler_wake_update_config(scheduler_wake_config_t scheduler_wake_config)
+{
+    DEBUG_PR_TRACE("Update WAKE configuration. %s()", __FUNCTION__);
+
+    wake_config = scheduler_wake_config;
+    wake_slack_s = 0;
+
+    if (wake_config.scheduler->hdr.set)
+    {
+        if (wake_config.scheduler->contents.slack_s > SCHEDULER_WAKE_SLACK_MAX_S)
+            return SCHEDULER_ERROR_INVALID_PARAM;
+
+        wake_slack_s = wake_config.scheduler->contents.slack_s;
+    }
+
+    return SCHEDULER_NO_ERROR;
+}
+
 int scheduler_term(void)
 {
     DEBUG_PR_WARN("%s Not implemented", __FUNCTION__);
@@ -116,6 +195,65 @@ int scheduler_get_timestamp_next_alarm(uint32_t *timestamp)
     return SCHEDULER_NO_ERROR;
 }
 
+// Next wake up: the next group of alarms, or after timeout_s if that is sooner or within the group
+int scheduler_get_timestamp_wakeup(uint32_t timeout_s, uint32_t *timestamp)
+{
+    uint32_t timestamp_now = syshal_rtc_return_timestamp();
+    uint32_t timestamp_wakeup = timestamp_now + timeout_s;
+    uint32_t timestamp_next_alarm;
+
+    scheduler_get_timestamp_next_alarm(&timestamp_next_alarm);
+
+    if ((timestamp_next_alarm != 0) && (timestamp_next_alarm < timestamp_wakeup))
+    {
+        uint32_t timestamp_group = timestamp_next_alarm;
+        uint32_t timestamp_group_max = timestamp_next_alarm + wake_slack_s;
+
+        // The satellite pass wake up margin has no room for the slack, the group never ends after it
+        if (Cron.isAllocated(scheduler_alarm_satpass_start_id))
+        {
+            uint32_t trigger = (uint32_t)Cron.getNextTrigger(scheduler_alarm_satpass_start_id);
+            if ((trigger >= timestamp_next_alarm) && (trigger < timestamp_group_max))
+                timestamp_group_max = trigger;
+        }
+
+        // An alarm already due is not delayed
+        if (timestamp_next_alarm > timestamp_now)
+        {
+            for (CronId id = 0; id < dtNBR_ALARMS; id++)
+            {
+                uint32_t trigger = (uint32_t)Cron.getNextTrigger(id);
+                if ((trigger > timestamp_group) && (trigger <= timestamp_group_max))
+                    timestamp_group = trigger;
+            }
+        }
+
+        // The timeout wake up is part of the group too
+        if (timestamp_wakeup > timestamp_group_max)
+            timestamp_wakeup = timestamp_group;
+    }
+
+    *timestamp = timestamp_wakeup;
+
+    return SCHEDULER_NO_ERROR;
+}
+
+int scheduler_set_rtc_alarm(uint32_t timeout_s)
+{
+    uint32_t timestamp_now = syshal_rtc_return_timestamp();
+    uint32_t timestamp_wakeup;
+
+    scheduler_get_timestamp_wakeup(timeout_s, &timestamp_wakeup);
+
+    // Alarm already due, let the next tick service it
+    if (timestamp_wakeup <= timestamp_now)
+        return SCHEDULER_ERROR_INVALID_STATE;
+
+    syshal_rtc_set_alarm(timestamp_wakeup, NULL);
+
+    return SCHEDULER_NO_ERROR;
+}
+
 int scheduler_gps_start(void)
 {
     DEBUG_PR_TRACE("%s() called.", __FUNCTION__);
@@ -123,9 +261,15 @@ int scheduler_gps_start(void)
     // Schedule scheduler GPS start
     if (Cron.isAllocated(scheduler_alarm_gps_start_id) == false)
     {
-        scheduler_alarm_gps_start_id = Cron.create(scheduler_alarm_gps_start_cron_expr,
-                                                   scheduler_gps_start_callback_priv,
-                                                   false);
+        if (gps_adaptive)
+        {
+            gps_adaptive_start = syshal_rtc_return_timestamp();
+            return scheduler_gps_adaptive_arm_priv();
+        }
+
+        scheduler_alarm_gps_start_id = Cron.createInterval(scheduler_alarm_gps_start_interval_s,
+                                                           scheduler_gps_start_callback_priv,
+                                                           false);
 
         if (scheduler_alarm_gps_start_id == dtINVALID_ALARM_ID)
         {
@@ -157,9 +301,8 @@ int scheduler_satpass_start(void)
     // Schedule scheduler SATPASS start
     if (Cron.isAllocated(scheduler_alarm_satpass_start_id) == false)
     {
-        scheduler_alarm_satpass_start_id = Cron.create(scheduler_alarm_satpass_start_cron_expr,
-                                                       scheduler_satpass_start_callback_priv,
-                                                       true);
+        scheduler_alarm_satpass_start_id = Cron.createAt(scheduler_alarm_satpass_start_timestamp,
+                                                         scheduler_satpass_start_callback_priv);
 
         if (scheduler_alarm_satpass_start_id == dtINVALID_ALARM_ID)
         {
@@ -184,14 +327,175 @@ int scheduler_satpass_stop(void)
     return SCHEDULER_NO_ERROR;
 }
 
+// Replaces the pending sensor alarm, if any
+int scheduler_sensor_start(uint32_t timestamp)
+{
+    if (Cron.isAllocated(scheduler_alarm_sensor_sample_id))
+    {
+        if ((uint32_t)Cron.getNextTrigger(scheduler_alarm_sensor_sample_id) == timestamp)
+            return SCHEDULER_NO_ERROR;
+
+        Cron.free(scheduler_alarm_sensor_sample_id);
+    }
+
+    scheduler_alarm_sensor_sample_id = Cron.createAt(timestamp, scheduler_sensor_sample_callback_priv);
+
+    if (scheduler_alarm_sensor_sample_id == dtINVALID_ALARM_ID)
+    {
+        DEBUG_PR_WARN("Job cannot be scheduled. %s", __FUNCTION__);
+        return SCHEDULER_ERROR_INVALID_STATE;
+    }
+
+    return SCHEDULER_NO_ERROR;
+}
+
+int scheduler_sensor_stop(void)
+{
+    DEBUG_PR_TRACE("%s() called.", __FUNCTION__);
+
+    if (Cron.isAllocated(scheduler_alarm_sensor_sample_id))
+    {
+        Cron.free(scheduler_alarm_sensor_sample_id);
+        scheduler_alarm_sensor_sample_id = dtINVALID_ALARM_ID;
+    }
+
+    return SCHEDULER_NO_ERROR;
+}
+
+// Call on every PVT fix, in adaptive mode it sets the time of the next GPS start
+int scheduler_gps_fix(int32_t lat, int32_t lon, uint32_t hacc_mm, int32_t speed_mm_s)
+{
+    if (!gps_adaptive)
+        return SCHEDULER_NO_ERROR;
+
+    bool moving = (speed_mm_s > gps_config.adaptive->contents.speed_threshold_mm_s);
+
+    if (gps_last_fix_valid)
+    {
+        uint32_t distance_m = scheduler_gps_distance_m_priv(gps_last_fix_lat, gps_last_fix_lon, lat, lon);
+        uint32_t accuracy_m = (gps_last_fix_hacc_mm + hacc_mm) / 1000;
+        if (distance_m > gps_config.adaptive->contents.distance_threshold_m + accuracy_m)
+            moving = true;
+    }
+    else
+    {
+        moving = true; // Nothing to compare with, stay tight
+    }
+
+    gps_last_fix_valid = true;
+    gps_last_fix_lat = lat;
+    gps_last_fix_lon = lon;
+    gps_last_fix_hacc_mm = hacc_mm;
+
+    uint32_t interval_min_s = (uint32_t)gps_config.adaptive->contents.interval_min_m * 60;
+    uint32_t interval_max_s = (uint32_t)gps_config.adaptive->contents.interval_max_m * 60;
+
+    if (moving)
+        gps_adaptive_interval_s = interval_min_s;
+    else
+        gps_adaptive_interval_s *= gps_config.adaptive->contents.backoff; // No overflow, interval_max_m < 2^16
+
+    if (gps_adaptive_interval_s > interval_max_s)
+        gps_adaptive_interval_s = interval_max_s;
+
+    DEBUG_PR_TRACE("GPS %s, next start in %lu s. %s()", moving ? "moving" : "stationary", gps_adaptive_interval_s, __FUNCTION__);
+
+    if (Cron.isAllocated(scheduler_alarm_gps_start_id))
+        return scheduler_gps_adaptive_arm_priv();
+
+    return SCHEDULER_NO_ERROR;
+}
+
+// Accelerometer hook, call it on movement so that the next fix is taken within interval_min_m
+int scheduler_gps_motion(void)
+{
+    if (!gps_adaptive)
+        return SCHEDULER_NO_ERROR;
+
+    uint32_t interval_min_s = (uint32_t)gps_config.adaptive->contents.interval_min_m * 60;
+    if (gps_adaptive_interval_s <= interval_min_s)
+        return SCHEDULER_NO_ERROR;
+
+    gps_adaptive_interval_s = interval_min_s;
+
+    if (Cron.isAllocated(scheduler_alarm_gps_start_id))
+        return scheduler_gps_adaptive_arm_priv();
+
+    return SCHEDULER_NO_ERROR;
+}
+
+int scheduler_gps_get_interval(uint32_t *interval_s)
+{
+    *interval_s = gps_adaptive ? gps_adaptive_interval_s : scheduler_alarm_gps_start_interval_s;
+
+    return SCHEDULER_NO_ERROR;
+}
+
+int scheduler_gps_set_adaptive_config_priv(void)
+{
+    uint16_t interval_min_m = gps_config.adaptive->contents.interval_min_m;
+    uint16_t interval_max_m = gps_config.adaptive->contents.interval_max_m;
+
+    if ((interval_min_m == 0) || (interval_max_m < interval_min_m) || (gps_config.adaptive->contents.backoff == 0))
+    {
+        DEBUG_PR_ERROR("Adaptive GPS alarm not valid. Ignored.");
+        return SCHEDULER_ERROR_INVALID_PARAM;
+    }
+
+    // Start tight, the first fixes tell whether the asset moves
+    gps_adaptive_interval_s = (uint32_t)interval_min_m * 60;
+
+    return SCHEDULER_NO_ERROR;
+}
+
+// (Re)arms the single shot GPS alarm, interval_s after the last start or now if that is past
+int scheduler_gps_adaptive_arm_priv(void)
+{
+    uint32_t timestamp = gps_adaptive_start + gps_adaptive_interval_s;
+    uint32_t timestamp_now = syshal_rtc_return_timestamp();
+
+    if (timestamp < timestamp_now)
+        timestamp = timestamp_now;
+
+    if (Cron.isAllocated(scheduler_alarm_gps_start_id))
+        Cron.free(scheduler_alarm_gps_start_id);
+
+    scheduler_alarm_gps_start_id = Cron.createAt(timestamp, scheduler_gps_start_callback_priv);
+
+    if (scheduler_alarm_gps_start_id == dtINVALID_ALARM_ID)
+    {
+        DEBUG_PR_WARN("Job cannot be scheduled. %s", __FUNCTION__);
+        return SCHEDULER_ERROR_INVALID_STATE;
+    }
+
+    return SCHEDULER_NO_ERROR;
+}
+
+// Equirectangular approximation, fine over the distance covered between two fixes
+uint32_t scheduler_gps_distance_m_priv(int32_t lat_a, int32_t lon_a, int32_t lat_b, int32_t lon_b)
+{
+    int64_t dlon = (int64_t)lon_b - lon_a;
+    if (dlon > 1800000000)
+        dlon -= 3600000000LL;
+    else if (dlon < -1800000000)
+        dlon += 3600000000LL;
+
+    float lat_mid_rad = ((float)lat_a + (float)lat_b) * 0.5e-7f * (float)(M_PI / 180.0);
+    float dx = (float)dlon * cosf(lat_mid_rad) * SCHEDULER_GPS_E7_DEG_TO_M;
+    float dy = (float)((int64_t)lat_b - lat_a) * SCHEDULER_GPS_E7_DEG_TO_M;
+
+    return (uint32_t)sqrtf(dx * dx + dy * dy);
+}
+
 int scheduler_gps_set_alarm_config_priv(uint8_t interval_h)
 {
     DEBUG_PR_TRACE("Setting new rates for GPS. %s", __FUNCTION__);
 
     if ((interval_h >= 1) && (interval_h <= 24))
     {
-        sprintf(scheduler_alarm_gps_start_cron_expr, "0 0 */%d * * *", interval_h);
-        DEBUG_PR_TRACE("Scheduler alarm: %s.", scheduler_alarm_gps_start_cron_expr);
+        // Same triggers as the "0 0 */interval_h * * *" cron when interval_h divides 24
+        scheduler_alarm_gps_start_interval_s = (uint32_t)interval_h * 3600;
+        DEBUG_PR_TRACE("Scheduler alarm: every %d s.", scheduler_alarm_gps_start_interval_s);
     }
     else
     {
@@ -208,9 +512,8 @@ int scheduler_satpass_set_alarm_config_priv(uint32_t timestamp)
 
     if ((timestamp > 0) && (timestamp > syshal_rtc_return_timestamp()))
     {
-        time_t timestamp_t = timestamp;
-        sprintf(scheduler_alarm_satpass_start_cron_expr, "%2d %2d %2d %2d %2d *", second(timestamp_t), minute(timestamp_t), hour(timestamp_t), day(timestamp_t), month(timestamp_t));
-        DEBUG_PR_TRACE("Scheduler alarm: %s.", scheduler_alarm_satpass_start_cron_expr);
+        scheduler_alarm_satpass_start_timestamp = timestamp;
+        DEBUG_PR_TRACE("Scheduler alarm: at %d.", scheduler_alarm_satpass_start_timestamp);
     }
     else
     {
@@ -223,6 +526,14 @@ int scheduler_satpass_set_alarm_config_priv(uint32_t timestamp)
 
 void scheduler_gps_start_callback_priv(void)
 {
+    // Single shot in adaptive mode (already freed), rearm it in case no fix comes
+    if (gps_adaptive && !Cron.isAllocated(scheduler_alarm_gps_start_id))
+    {
+        scheduler_alarm_gps_start_id = dtINVALID_ALARM_ID;
+        gps_adaptive_start = syshal_rtc_return_timestamp();
+        scheduler_gps_adaptive_arm_priv();
+    }
+
     scheduler_event_t event;
     event.id = SCHEDULER_EVENT_GPS_START;
     scheduler_gps_callback(&event);
@@ -230,20 +541,86 @@ void scheduler_gps_start_callback_priv(void)
 
 void scheduler_satpass_start_callback_priv(void)
 {
+    // Single shot, already freed. Its slot may be reused by the callback
+    scheduler_alarm_satpass_start_id = dtINVALID_ALARM_ID;
+
     scheduler_event_t event;
     event.id = SCHEDULER_EVENT_SATPASS_START;
     scheduler_satpass_callback(&event);
+}
 
-    // Remove alarm once triggered (single shot)
-    if (Cron.isAllocated(scheduler_alarm_satpass_start_id))
-    {
-        Cron.free(scheduler_alarm_satpass_start_id);
+int scheduler_job_request_priv(scheduler_job_t job, uint32_t deadline)
+{
+    if (job >= SCHEDULER_JOB_NB)
+        return SCHEDULER_ERROR_INVALID_PARAM;
+
+    if (!(job_pending & (1UL << job)) || (deadline < job_deadline[job]))
+        job_deadline[job] = deadline;
+
+    job_pending |= (1UL << job);
+
+    return SCHEDULER_NO_ERROR;
+}
+
+// The job is run within slack_s, with the other pending jobs
+int scheduler_job_request(scheduler_job_t job)
+{
+    return scheduler_job_request_priv(job, syshal_rtc_return_timestamp() + wake_slack_s);
+}
+
+// The job is run before going back to sleep
+int scheduler_job_request_now(scheduler_job_t job)
+{
+    return scheduler_job_request_priv(job, syshal_rtc_return_timestamp());
+}
+
+// Call before sleeping until timestamp_wakeup, the pending jobs are run once one of them cannot wait
+int scheduler_job_tick(uint32_t timestamp_wakeup)
+{
+    bool due = false;
+
+    for (uint8_t job = 0; job < SCHEDULER_JOB_NB; job++)
+        if ((job_pending & (1UL << job)) && (job_deadline[job] < timestamp_wakeup))
+            due = true;
+
+    if (!due)
+        return SCHEDULER_NO_ERROR;
+
+    scheduler_event_t event;
+    event.id = SCHEDULER_EVENT_JOBS;
+    event.jobs = job_pending;
+    job_pending = 0; // Jobs requested by the callback wait for the next tick
+
+    scheduler_job_callback(&event);
+
+    return SCHEDULER_NO_ERROR;
+}
+
+void scheduler_sensor_sample_callback_priv(void)
+{
+    // Single shot, already freed. The callback arms the next one
+    scheduler_alarm_sensor_sample_id = dtINVALID_ALARM_ID;
+
+    scheduler_event_t event;
+    event.id = SCHEDULER_EVENT_SENSOR_SAMPLE;
+    scheduler_sensor_callback(&event);
+}
+
+// Forget a freed alarm, its slot may be given to another one
+void scheduler_alarm_freed_priv(CronId id)
+{
+    if (scheduler_alarm_gps_start_id == id)
+        scheduler_alarm_gps_start_id = dtINVALID_ALARM_ID;
+    if (scheduler_alarm_satpass_start_id == id)
         scheduler_alarm_satpass_start_id = dtINVALID_ALARM_ID;
-    }
+    if (scheduler_alarm_sensor_sample_id == id)
+        scheduler_alarm_sensor_sample_id = dtINVALID_ALARM_ID;
 }
 
 int scheduler_tick(void)
 {
+    PROFILER_ZONE(PROFILER_ZONE_SCHEDULER_TICK);
+
     // DEBUG_PR_TRACE("Process EVENT... %s()", __FUNCTION__);
 
     Cron.delay();
@@ -256,6 +633,7 @@ int scheduler_tick(void)
     {
         DEBUG_PR_WARN("Free alarm %d. Execution time in the past. %s", alarm_next_trigger_id, __FUNCTION__);
         Cron.free(alarm_next_trigger_id);
+        scheduler_alarm_freed_priv(alarm_next_trigger_id);
     }
 
     return SCHEDULER_NO_ERROR;
@@ -270,3 +648,13 @@ __attribute__((weak)) void scheduler_satpass_callback(scheduler_event_t *event)
 {
     DEBUG_PR_WARN("%s Not implemented", __FUNCTION__);
 }
+
+__attribute__((weak)) void scheduler_sensor_callback(scheduler_event_t *event)
+{
+    DEBUG_PR_WARN("%s Not implemented", __FUNCTION__);
+}
+
+__attribute__((weak)) void scheduler_job_callback(scheduler_event_t *event)
+{
+    DEBUG_PR_WARN("%s Not implemented", __FUNCTION__);
+}
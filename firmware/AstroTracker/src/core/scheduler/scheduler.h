@@ -42,16 +42,28 @@ typedef enum
 {
     SCHEDULER_EVENT_GPS_START,
     SCHEDULER_EVENT_SATPASS_START,
+    SCHEDULER_EVENT_SENSOR_SAMPLE,
+    SCHEDULER_EVENT_JOBS,
 } scheduler_event_id_t;
 
+// Work that needs the satellite module, batched in a single power up
+typedef enum
+{
+    SCHEDULER_JOB_LOGGER_PUSH, // Queue the logger slots waiting for transmission
+    SCHEDULER_JOB_SAT_STATUS,  // Read the module status and time
+    SCHEDULER_JOB_NB,
+} scheduler_job_t;
+
 typedef struct
 {
     scheduler_event_id_t id;
+    uint32_t jobs; // SCHEDULER_EVENT_JOBS, one bit per scheduler_job_t
 } scheduler_event_t;
 
 typedef struct
 {
     sys_config_gps_scheduler_settings_t *scheduler;
+    sys_config_gps_adaptive_scheduler_settings_t *adaptive; // Optional
 } scheduler_gps_config_t;
 
 typedef struct
@@ -59,22 +71,42 @@ typedef struct
     sys_config_satpass_scheduler_settings_t *scheduler;
 } scheduler_satpass_config_t;
 
+typedef struct
+{
+    sys_config_wake_scheduler_settings_t *scheduler;
+} scheduler_wake_config_t;
+
 int scheduler_init(void);
 int scheduler_term(void);
 int scheduler_get_timestamp_next_alarm(uint32_t *timestamp);
+int scheduler_get_timestamp_wakeup(uint32_t timeout_s, uint32_t *timestamp);
+int scheduler_set_rtc_alarm(uint32_t timeout_s);
+
+int scheduler_wake_update_config(scheduler_wake_config_t scheduler_wake_config);
+int scheduler_job_request(scheduler_job_t job);
+int scheduler_job_request_now(scheduler_job_t job);
+int scheduler_job_tick(uint32_t timestamp_wakeup);
 
 int scheduler_gps_update_config(scheduler_gps_config_t scheduler_gps_config);
 int scheduler_gps_start(void);
 int scheduler_gps_stop(void);
+int scheduler_gps_fix(int32_t lat, int32_t lon, uint32_t hacc_mm, int32_t speed_mm_s);
+int scheduler_gps_motion(void);
+int scheduler_gps_get_interval(uint32_t *interval_s);
 
 int scheduler_satpass_update_config(scheduler_satpass_config_t scheduler_satpass_config);
 int scheduler_satpass_start(void);
 int scheduler_satpass_stop(void);
 
+int scheduler_sensor_start(uint32_t timestamp);
+int scheduler_sensor_stop(void);
+
 int scheduler_tick(void);
 
 void scheduler_gps_callback(scheduler_event_t *event);
 void scheduler_satpass_callback(scheduler_event_t *event);
+void scheduler_sensor_callback(scheduler_event_t *event);
+void scheduler_job_callback(scheduler_event_t *event);
 
 /* Hints from UBLOX on GNSS configuration and fallback strategy
 https://developer.thingstream.io/guides/location-services/cloudlocate-getting-started/mixed_mode
@@ -0,0 +1,356 @@
+/******************************************************************************************
+ * File:        sensor.cpp
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#include "sensor.h"
+#include "../debug/debug.h"
+#include "../scheduler/scheduler.h"
+#include "../../syshal/syshal_rtc.h"
+#include "../../syshal/syshal_batt.h"
+#include "../../syshal/syshal_temp.h"
+
+/* Sampling
+ *
+ * Every sensor is sampled on a grid of its own interval, so that the samples of a block are
+ * evenly spaced and only the time of the first one needs to be logged. A single scheduler
+ * alarm is armed on the earliest due sample. Whenever the MCU is awake, for that alarm or for
+ * anything else, the sensors due within interval_s / SENSOR_COALESCE_DIV are sampled as well,
+ * so that sensors with close due times share one wake up instead of each leaving deep sleep.
+ * An early sample keeps the time of its grid point.
+ */
+
+#define SENSOR_COALESCE_DIV (8)
+
+typedef int (*sensor_read_t)(int16_t *value);
+
+typedef struct
+{
+    uint32_t due;       // Grid time of the next sample, 0 when the sensor is not sampled
+    uint16_t sample_nb; // Samples in the current block, partial aggregate included
+    sensor_block_t block;
+    int16_t aggregate_min;
+    int16_t aggregate_max;
+    int32_t aggregate_sum;
+    uint8_t aggregate_count;
+} sensor_state_t;
+
+static sensor_config_t config;
+static sensor_state_t state[SENSOR_NB];
+static bool running = false;
+
+// Private functions
+int sensor_read_battery_priv(int16_t *value);
+int sensor_read_temperature_priv(int16_t *value);
+bool sensor_enabled_priv(sensor_id_t sensor, sys_config_sensor_t *sensor_config);
+uint32_t sensor_next_grid_priv(uint32_t timestamp, uint16_t interval_s);
+void sensor_close_aggregate_priv(sensor_id_t sensor);
+void sensor_flush_priv(sensor_id_t sensor);
+void sensor_add_sample_priv(sensor_id_t sensor, uint32_t timestamp, int16_t value);
+void sensor_reset_priv(uint32_t timestamp_now);
+int sensor_arm_priv(void);
+
+static const char *const sensor_str[] =
+    {
+        [SENSOR_BATTERY] = "BATTERY",
+        [SENSOR_TEMPERATURE] = "TEMPERATURE",
+};
+
+static const sensor_read_t sensor_read[] =
+    {
+        [SENSOR_BATTERY] = sensor_read_battery_priv,
+        [SENSOR_TEMPERATURE] = sensor_read_temperature_priv,
+};
+
+int sensor_read_battery_priv(int16_t *value)
+{
+    uint16_t voltage_mv;
+    if (syshal_batt_voltage_mv(&voltage_mv))
+        return SENSOR_ERROR_DEVICE;
+
+    *value = (int16_t)voltage_mv;
+
+    return SENSOR_NO_ERROR;
+}
+
+int sensor_read_temperature_priv(int16_t *value)
+{
+    int8_t temperature;
+    if (syshal_temp_temperature(&temperature))
+        return SENSOR_ERROR_DEVICE;
+
+    *value = temperature;
+
+    return SENSOR_NO_ERROR;
+}
+
+bool sensor_enabled_priv(sensor_id_t sensor, sys_config_sensor_t *sensor_config)
+{
+    if (config.sensor == NULL || !config.sensor->hdr.set)
+        return false;
+
+    *sensor_config = config.sensor->contents.sensor[sensor]; // Copy, the settings are packed
+
+    return sensor_config->interval_s != 0;
+}
+
+uint32_t sensor_next_grid_priv(uint32_t timestamp, uint16_t interval_s)
+{
+    return (timestamp / interval_s + 1) * interval_s;
+}
+
+void sensor_close_aggregate_priv(sensor_id_t sensor)
+{
+    sensor_state_t *s = &state[sensor];
+
+    if (s->aggregate_count == 0)
+        return;
+
+    // Rounded to the nearest, away from zero on ties
+    int32_t half = s->aggregate_count / 2;
+    int32_t mean = (s->aggregate_sum + (s->aggregate_sum >= 0 ? half : -half)) / s->aggregate_count;
+
+    s->block.values[s->block.count++] = s->aggregate_min;
+    s->block.values[s->block.count++] = s->aggregate_max;
+    s->block.values[s->block.count++] = (int16_t)mean;
+    s->aggregate_count = 0;
+}
+
+// Sends the current block, closing any partial aggregate
+void sensor_flush_priv(sensor_id_t sensor)
+{
+    sensor_state_t *s = &state[sensor];
+
+    sensor_close_aggregate_priv(sensor);
+
+    if (s->block.count)
+    {
+        sensor_event_t event;
+        event.id = SENSOR_EVENT_BLOCK;
+        event.block = s->block;
+
+        DEBUG_PR_TRACE("%s() %s, %u values", __FUNCTION__, sensor_str[sensor], s->block.count);
+
+        sensor_callback(&event);
+    }
+
+    s->block.count = 0;
+    s->sample_nb = 0;
+}
+
+void sensor_add_sample_priv(sensor_id_t sensor, uint32_t timestamp, int16_t value)
+{
+    sensor_state_t *s = &state[sensor];
+    uint8_t aggregate_nb = s->block.aggregate_nb;
+
+    // The sample times are implicit, a missed sample starts a new block
+    if (s->sample_nb && timestamp != s->block.timestamp + (uint32_t)s->sample_nb * s->block.interval_s)
+        sensor_flush_priv(sensor);
+
+    if (s->sample_nb == 0)
+        s->block.timestamp = timestamp;
+
+    s->sample_nb++;
+
+    if (aggregate_nb <= 1)
+    {
+        s->block.values[s->block.count++] = value;
+        if (s->block.count == SENSOR_BLOCK_VALUE_NB)
+            sensor_flush_priv(sensor);
+        return;
+    }
+
+    if (s->aggregate_count == 0)
+    {
+        s->aggregate_min = value;
+        s->aggregate_max = value;
+        s->aggregate_sum = 0;
+    }
+
+    if (value < s->aggregate_min)
+        s->aggregate_min = value;
+    if (value > s->aggregate_max)
+        s->aggregate_max = value;
+    s->aggregate_sum += value;
+
+    if (++s->aggregate_count == aggregate_nb)
+    {
+        sensor_close_aggregate_priv(sensor);
+        if (s->block.count + 3 > SENSOR_BLOCK_VALUE_NB)
+            sensor_flush_priv(sensor);
+    }
+}
+
+// Drops the pending samples and restarts every sensor on its grid
+void sensor_reset_priv(uint32_t timestamp_now)
+{
+    for (uint8_t i = 0; i < SENSOR_NB; i++)
+    {
+        sensor_id_t sensor = (sensor_id_t)i;
+        sensor_state_t *s = &state[sensor];
+        sys_config_sensor_t sensor_config;
+
+        s->due = 0;
+        s->sample_nb = 0;
+        s->aggregate_count = 0;
+        s->block.sensor = sensor;
+        s->block.count = 0;
+
+        if (!sensor_enabled_priv(sensor, &sensor_config))
+            continue;
+
+        s->block.interval_s = sensor_config.interval_s;
+        s->block.aggregate_nb = sensor_config.aggregate_nb;
+        s->due = sensor_next_grid_priv(timestamp_now, sensor_config.interval_s);
+    }
+}
+
+int sensor_arm_priv(void)
+{
+    uint32_t due = 0;
+
+    for (uint8_t i = 0; i < SENSOR_NB; i++)
+        if (state[i].due && (due == 0 || state[i].due < due))
+            due = state[i].due;
+
+    if (due == 0)
+        return scheduler_sensor_stop();
+
+    if (scheduler_sensor_start(due))
+        return SENSOR_ERROR_INVALID_STATE;
+
+    return SENSOR_NO_ERROR;
+}
+
+int sensor_init(void)
+{
+    running = false;
+    config.sensor = NULL;
+    sensor_reset_priv(0);
+
+    return SENSOR_NO_ERROR;
+}
+
+int sensor_term(void)
+{
+    return sensor_stop();
+}
+
+int sensor_update_config(sensor_config_t sensor_config)
+{
+    DEBUG_PR_TRACE("Update SENSOR configuration. %s()", __FUNCTION__);
+
+    if (sensor_config.sensor == NULL)
+        return SENSOR_ERROR_INVALID_PARAM;
+
+    // The pending blocks were taken with the previous settings
+    if (running)
+        for (uint8_t i = 0; i < SENSOR_NB; i++)
+            sensor_flush_priv((sensor_id_t)i);
+
+    config = sensor_config;
+    sensor_reset_priv(syshal_rtc_return_timestamp());
+
+    if (running)
+        return sensor_arm_priv();
+
+    return SENSOR_NO_ERROR;
+}
+
+int sensor_start(void)
+{
+    DEBUG_PR_TRACE("%s() called.", __FUNCTION__);
+
+    if (running)
+        return SENSOR_NO_ERROR;
+
+    running = true;
+    sensor_reset_priv(syshal_rtc_return_timestamp());
+
+    return sensor_arm_priv();
+}
+
+int sensor_stop(void)
+{
+    DEBUG_PR_TRACE("%s() called.", __FUNCTION__);
+
+    if (!running)
+        return SENSOR_NO_ERROR;
+
+    for (uint8_t i = 0; i < SENSOR_NB; i++)
+        sensor_flush_priv((sensor_id_t)i);
+
+    running = false;
+    scheduler_sensor_stop();
+
+    return SENSOR_NO_ERROR;
+}
+
+// Call on every wake up, it samples the sensors that are (nearly) due and rearms the alarm
+int sensor_tick(void)
+{
+    if (!running)
+        return SENSOR_ERROR_INVALID_STATE;
+
+    uint32_t timestamp_now = syshal_rtc_return_timestamp();
+
+    for (uint8_t i = 0; i < SENSOR_NB; i++)
+    {
+        sensor_id_t sensor = (sensor_id_t)i;
+        sensor_state_t *s = &state[sensor];
+        uint16_t interval_s = s->block.interval_s;
+
+        if (s->due == 0)
+            continue;
+
+        // The RTC was set back, restart on the new grid
+        if (s->due > timestamp_now + interval_s + interval_s / SENSOR_COALESCE_DIV)
+        {
+            sensor_flush_priv(sensor);
+            s->due = sensor_next_grid_priv(timestamp_now, interval_s);
+        }
+
+        if (s->due > timestamp_now + interval_s / SENSOR_COALESCE_DIV)
+            continue;
+
+        // Late samples are not caught up, they take the last grid time
+        uint32_t timestamp_sample = s->due;
+        if (timestamp_sample <= timestamp_now)
+            timestamp_sample = (timestamp_now / interval_s) * interval_s;
+
+        int16_t value;
+        if (sensor_read[sensor](&value))
+            DEBUG_PR_WARN("%s() %s read failed", __FUNCTION__, sensor_str[sensor]);
+        else
+            sensor_add_sample_priv(sensor, timestamp_sample, value);
+
+        s->due = timestamp_sample + interval_s;
+    }
+
+    return sensor_arm_priv();
+}
+
+__attribute__((weak)) void sensor_callback(sensor_event_t *event)
+{
+    DEBUG_PR_WARN("%s Not implemented", __FUNCTION__);
+}
@@ -0,0 +1,90 @@
+/******************************************************************************************
+ * File:        sensor.h
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#ifndef _SENSOR_h
+#define _SENSOR_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "../config/sys_config.h"
+
+#define SENSOR_NO_ERROR (0)
+#define SENSOR_ERROR_INVALID_STATE (-1)
+#define SENSOR_ERROR_INVALID_PARAM (-2)
+#define SENSOR_ERROR_DEVICE (-3)
+
+#define SENSOR_BLOCK_VALUE_NB (15) // Fits a logger slot and a BLE log dump record
+
+typedef enum
+{
+    SENSOR_BATTERY,     // mV
+    SENSOR_TEMPERATURE, // degC
+    SENSOR_NB,
+} sensor_id_t;
+
+static_assert(SENSOR_NB == SYS_CONFIG_SENSOR_NB, "sys_config_sensor_settings_t needs one entry per sensor");
+
+// Samples of one sensor, taken every interval_s from timestamp on. With aggregate_nb above 1,
+// values holds one min, max, mean triple per aggregate_nb samples, the last one may be partial
+typedef struct
+{
+    sensor_id_t sensor;
+    uint32_t timestamp; // Time of the first sample
+    uint16_t interval_s;
+    uint8_t aggregate_nb;
+    uint8_t count; // Number of values used
+    int16_t values[SENSOR_BLOCK_VALUE_NB];
+} sensor_block_t;
+
+typedef enum
+{
+    SENSOR_EVENT_BLOCK,
+} sensor_event_id_t;
+
+typedef struct
+{
+    sensor_event_id_t id;
+    sensor_block_t block;
+} sensor_event_t;
+
+typedef struct
+{
+    sys_config_sensor_settings_t *sensor;
+} sensor_config_t;
+
+int sensor_init(void);
+int sensor_term(void);
+int sensor_update_config(sensor_config_t sensor_config);
+int sensor_start(void);
+int sensor_stop(void);
+int sensor_tick(void);
+
+void sensor_callback(sensor_event_t *event);
+
+#endif
@@ -26,10 +26,17 @@
 #include "sm_main.h"
 #include <Wire.h>
 #include "../config/sys_config.h"
+#include "../config/sys_config_delta.h"
 #include "../debug/debug.h"
 #include "../scheduler/scheduler.h"
+#include "../event/event.h"
+#include "../satpass/satpass.h"
+#include "../sensor/sensor.h"
+#include "../geofence/geofence.h"
 #include "../config/version.h"
 #include "../logger/logger.h"
+#include "../logdump/logdump.h"
+#include "../profiler/profiler.h"
 #include "../command/an_command.h"
 #include "../loopbackstream/LoopbackStream.h"
 #include "../../syshal/syshal_rtc.h"
@@ -90,7 +97,12 @@ static const char *sm_main_state_str[] =
 #define SOFT_WATCHDOG_TIMEOUT_S (16)  // How many seconds to allow before soft watchdog trips -> DO NOT SET LOWER THAN 16S
 #define HARD_WATCHDOG_TIMEOUT_S (300) // How many seconds to allow before soft watchdog trips -> WILL DEPEND ON HARDWARE CONFIGURATION
 
-#define GPS_ACTIVE_WAKEUP_TIMEOUT_S (3)
+#define GPS_ACTIVE_WAKEUP_TIMEOUT_S (3)    // Polling period of a receiver without TX ready pin
+#define SCREEN_ACTIVE_WAKEUP_TIMEOUT_S (3) // Refresh period of the display
+
+#define GPS_TIME_ACCURACY_S (1)          // PVT timestamps are truncated to the second
+#define SAT_TIME_ACCURACY_S (2)          // Astronode RTC, synchronised on satellite contact
+#define SATPASS_WAKEUP_MIN_MARGIN_S (60) // Time to wake up the terminal and queue the messages
 
 #define SCREEN_DURATION_MS (10000)
 
@@ -98,23 +110,23 @@ static const char *sm_main_state_str[] =
 
 #define KICK_WATCHDOG() syshal_rtc_soft_watchdog_refresh()
 
-static uint8_t last_battery_reading;
+static uint8_t last_battery_reading = UINT8_MAX;
 static volatile bool sensor_logging_enabled = false; // Are sensors currently allowed to log
-static volatile bool logger_new_data_available = false;
 static volatile bool new_config_available = false;
-static volatile bool request_sat_status_update = false;
-static volatile bool request_screen_display_activation = false;
 
 static uint32_t gps_start_time;
 static uint32_t sat_start_time;
 static uint32_t ble_start_time;
-static uint32_t led_finish_time;
-static uint32_t screen_finish_time;
+static uint64_t led_finish_time;
+static uint64_t screen_finish_time;
+
+static uint32_t satpass_armed_aos;  // Pass the satpass alarm is armed for
+static uint32_t satpass_served_aos; // Last pass its data was pushed for
 
 COMMAND syshal_ble_command;
 COMMAND syshal_sat_command;
 LoopbackStream sat_stream;
-LoopbackStream ble_stream;
+LoopbackStream ble_stream(SYSHAL_BLE_PAYLOAD_MAX_SIZE); // Holds a whole BLE write, bulk packets span several of them
 
 typedef struct __attribute__((__packed__))
 {
@@ -142,10 +154,21 @@ typedef struct __attribute__((__packed__))
     uint8_t meas20[20];
 } LOG_RAW_struct;
 
+typedef struct __attribute__((__packed__))
+{
+    uint32_t timestamp; // First sample
+    uint16_t interval_s;
+    uint8_t sensor;
+    uint8_t aggregate_nb; // Above 1, values are min, max, mean triples
+    uint8_t count;
+    int16_t values[SENSOR_BLOCK_VALUE_NB];
+} LOG_SENSOR_struct;
+
 #define LOGGER_TAG_PVT_SLOT (0x01)
 #define LOGGER_TAG_U_MSG_SLOT (0x02)
 #define LOGGER_TAG_U_CMD_SLOT (0x03)
 #define LOGGER_TAG_RAW_SLOT (0x04)
+#define LOGGER_TAG_SENSOR_SLOT (0x05)
 
 typedef struct __attribute__((__packed__))
 {
@@ -162,6 +185,7 @@ typedef struct __attribute__((__packed__))
         uint16_t u_cmd_cnt = 0;
         uint16_t pvt_cnt = 0;
         uint16_t raw_cnt = 0;
+        uint16_t sensor_cnt = 0;
         // uint32_t total_mem_size = 0;
     } logger_counters;
 
@@ -183,7 +207,7 @@ typedef struct __attribute__((__packed__))
 
     struct __attribute__((__packed__))
     {
-        uint32_t up_time_ms = 0;
+        uint64_t up_time_ms = 0;
     } asset_counters;
 } sm_context_t;
 static sm_context_t sm_context;
@@ -194,9 +218,38 @@ static sm_context_t sm_context;
 
 static bool check_configuration_tags_set(void);
 void ble_write_req(void);
+void config_delta_receive(COMMAND *command);
+void screen_status_update(void);
 void logger_push_slots_to_sat(void);
+void sat_status_update(void);
+void satpass_schedule_next_pass(void);
+uint32_t satpass_wakeup_margin(uint32_t aos);
 void state_message_exception_handler(CEXCEPTION_T e);
 
+static void sm_main_event_rtc_alarm(void *context);
+static void sm_main_event_sat_pin(void *context);
+static void sm_main_event_gps_tx_ready(void *context);
+static void sm_main_event_button(void *context);
+static void sm_main_event_ble_tx_ready(void *context);
+static void sm_main_event_sat_status_request(void *context);
+static void sm_main_event_satpass_update(void *context);
+static void sm_main_event_logger_data(void *context);
+static void sm_main_event_screen_activation(void *context);
+
+static const event_handler_t sm_main_operational_event_handlers[EVENT_NB] =
+    {
+        [EVENT_RTC_ALARM] = sm_main_event_rtc_alarm,
+        [EVENT_SAT_PIN] = sm_main_event_sat_pin,
+        [EVENT_GPS_TX_READY] = sm_main_event_gps_tx_ready,
+        [EVENT_BUTTON] = sm_main_event_button,
+        [EVENT_BLE_RX] = NULL, // Commands are processed in the BLE callback, the event only wakes up the loop
+        [EVENT_BLE_TX_READY] = sm_main_event_ble_tx_ready,
+        [EVENT_SAT_STATUS_REQUEST] = sm_main_event_sat_status_request,
+        [EVENT_SATPASS_UPDATE] = sm_main_event_satpass_update,
+        [EVENT_LOGGER_DATA] = sm_main_event_logger_data,
+        [EVENT_SCREEN_ACTIVATION] = sm_main_event_screen_activation,
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////// CALLBACK FUNCTIONS //////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -238,28 +291,38 @@ void syshal_gps_callback(syshal_gps_event_t *event)
 
         // Update RTC time
         DEBUG_PR_TRACE("Update RTC from GPS.");
-        syshal_rtc_set_timestamp(event->pvt.timestamp);
-
-        // Store data
-        uint16_t slot_id = 0;
-        LOG_PVT_struct log_pvt;
-        log_pvt.timestamp = event->pvt.timestamp;
-        log_pvt.lat = event->pvt.lat;
-        log_pvt.lon = event->pvt.lon;
-        log_pvt.SIV = event->pvt.SIV;
-        log_pvt.gSpeed = event->pvt.gSpeed;
+        syshal_rtc_discipline(event->pvt.timestamp, GPS_TIME_ACCURACY_S);
 
         sm_context.gps_counters.last_loc_lat = event->pvt.lat;
         sm_context.gps_counters.last_loc_lon = event->pvt.lon;
         sm_context.gps_counters.time_last_update = event->pvt.timestamp;
 
-        syshal_temp_temperature(&log_pvt.temp);
-        syshal_batt_voltage(&log_pvt.v_bat);
-        logger_insert_data(&log_pvt, sizeof(LOG_PVT_struct), LOGGER_TAG_PVT_SLOT,
-                           syshal_rtc_return_timestamp(), &slot_id);
+        // Stretch or tighten the GPS interval
+        scheduler_gps_fix(event->pvt.lat, event->pvt.lon, event->pvt.hAcc, event->pvt.gSpeed);
 
-        sm_context.logger_counters.pvt_cnt++;
-        logger_new_data_available = true;
+        // Only store the fixes the geofence policy uplinks
+        bool uplink = true;
+        geofence_fix(event->pvt.timestamp, event->pvt.lat, event->pvt.lon, &uplink);
+        if (uplink)
+        {
+            uint16_t slot_id = 0;
+            LOG_PVT_struct log_pvt;
+            log_pvt.timestamp = event->pvt.timestamp;
+            log_pvt.lat = event->pvt.lat;
+            log_pvt.lon = event->pvt.lon;
+            log_pvt.SIV = event->pvt.SIV;
+            log_pvt.gSpeed = event->pvt.gSpeed;
+
+            syshal_temp_temperature(&log_pvt.temp);
+            syshal_batt_voltage(&log_pvt.v_bat);
+            logger_insert_data(&log_pvt, sizeof(LOG_PVT_struct), LOGGER_TAG_PVT_SLOT,
+                               syshal_rtc_return_timestamp(), &slot_id);
+
+            sm_context.logger_counters.pvt_cnt++;
+            event_post(EVENT_LOGGER_DATA);
+        }
+
+        screen_status_update();
         break;
     }
     case SYSHAL_GPS_EVENT_RAW:
@@ -279,7 +342,7 @@ void syshal_gps_callback(syshal_gps_event_t *event)
                                syshal_rtc_return_timestamp(), &slot_id);
 
             sm_context.logger_counters.raw_cnt++;
-            logger_new_data_available = true;
+            event_post(EVENT_LOGGER_DATA);
         }
         break;
     }
@@ -311,7 +374,48 @@ void scheduler_satpass_callback(scheduler_event_t *event)
     switch (event->id)
     {
     case SCHEDULER_EVENT_SATPASS_START:
-        logger_new_data_available = true;
+        scheduler_job_request_now(SCHEDULER_JOB_LOGGER_PUSH); // Queue before the pass
+        satpass_served_aos = satpass_armed_aos;
+        event_post(EVENT_SATPASS_UPDATE);
+        break;
+    default:
+        DEBUG_PR_WARN("Unknown SCHEDULER event in %s() : %d", __FUNCTION__, event->id);
+        break;
+    }
+}
+
+void scheduler_sensor_callback(scheduler_event_t *event)
+{
+    DEBUG_PR_TRACE("%s() called", __FUNCTION__);
+
+    switch (event->id)
+    {
+    case SCHEDULER_EVENT_SENSOR_SAMPLE:
+        sensor_tick();
+        break;
+    default:
+        DEBUG_PR_WARN("Unknown SCHEDULER event in %s() : %d", __FUNCTION__, event->id);
+        break;
+    }
+}
+
+void scheduler_job_callback(scheduler_event_t *event)
+{
+    DEBUG_PR_TRACE("%s() called", __FUNCTION__);
+
+    switch (event->id)
+    {
+    case SCHEDULER_EVENT_JOBS:
+        // A single power up of the satellite module for all the jobs
+        if (!syshal_sat_wake_up())
+        {
+            if (event->jobs & (1UL << SCHEDULER_JOB_LOGGER_PUSH))
+                logger_push_slots_to_sat();
+
+            // Also after a push, the queue has changed
+            sat_status_update();
+        }
+        syshal_sat_shutdown();
         break;
     default:
         DEBUG_PR_WARN("Unknown SCHEDULER event in %s() : %d", __FUNCTION__, event->id);
@@ -319,6 +423,40 @@ void scheduler_satpass_callback(scheduler_event_t *event)
     }
 }
 
+void sensor_callback(sensor_event_t *event)
+{
+    DEBUG_PR_TRACE("%s() called", __FUNCTION__);
+
+    switch (event->id)
+    {
+    case SENSOR_EVENT_BLOCK:
+    {
+        if (!sensor_logging_enabled)
+            break;
+
+        // Store data
+        uint16_t slot_id = 0;
+        LOG_SENSOR_struct log_sensor;
+        log_sensor.timestamp = event->block.timestamp;
+        log_sensor.interval_s = event->block.interval_s;
+        log_sensor.sensor = event->block.sensor;
+        log_sensor.aggregate_nb = event->block.aggregate_nb;
+        log_sensor.count = event->block.count;
+        memcpy(log_sensor.values, event->block.values, sizeof(log_sensor.values));
+
+        logger_insert_data(&log_sensor, sizeof(LOG_SENSOR_struct), LOGGER_TAG_SENSOR_SLOT,
+                           syshal_rtc_return_timestamp(), &slot_id);
+
+        sm_context.logger_counters.sensor_cnt++;
+        event_post(EVENT_LOGGER_DATA);
+        break;
+    }
+    default:
+        DEBUG_PR_WARN("Unknown SENSOR event in %s() : %d", __FUNCTION__, event->id);
+        break;
+    }
+}
+
 void syshal_sat_callback(syshal_sat_event_t *event)
 {
     DEBUG_PR_TRACE("%s() called", __FUNCTION__);
@@ -341,16 +479,19 @@ void syshal_sat_callback(syshal_sat_event_t *event)
         logger_set_status_of_slot_id(event->msg_acknowledged.msg_id, LOGGER_SLOT_STATUS_TRANSMITTED);
         logger_set_acknowledgeddate_of_slot_id(event->msg_acknowledged.msg_id, event->msg_acknowledged.timestamp);
         logger_get_tag_from_slot_id(event->msg_acknowledged.msg_id, &slot_tag);
+        if (slot_tag == LOGGER_TAG_U_MSG_SLOT)
+            syshal_screen_msg_list_ack(SYSHAL_SCREEN_MSG_LIST_TX, event->msg_acknowledged.msg_id);
         if ((slot_tag == LOGGER_TAG_PVT_SLOT) ||
-            (slot_tag == LOGGER_TAG_RAW_SLOT)) // We keep all other slots
+            (slot_tag == LOGGER_TAG_RAW_SLOT) ||
+            (slot_tag == LOGGER_TAG_SENSOR_SLOT)) // We keep all other slots
             logger_clear_slot(event->msg_acknowledged.msg_id);
-        request_sat_status_update = true;
+        event_post(EVENT_SAT_STATUS_REQUEST);
         break;
     }
     case SYSHAL_SAT_EVENT_RESET:
         DEBUG_PR_TRACE("SYSHAL_SAT_EVENT_RESET");
         sm_context.sat_counters.reset_cnt++;
-        request_sat_status_update = true;
+        event_post(EVENT_SAT_STATUS_REQUEST);
         break;
     case SYSHAL_SAT_EVENT_COMMAND_RECEIVED:
     {
@@ -382,6 +523,9 @@ void syshal_sat_callback(syshal_sat_event_t *event)
                     logger_set_acknowledgeddate_of_slot_id(slot_id, event->cmd_received.timestamp);
                     logger_set_status_of_slot_id(slot_id, LOGGER_SLOT_STATUS_TRANSMITTED);
                     sm_context.logger_counters.u_cmd_cnt++;
+                    syshal_screen_msg_list_add(SYSHAL_SCREEN_MSG_LIST_RX, slot_id, log_u_cmd.data,
+                                               sizeof(log_u_cmd.data), true);
+                    screen_status_update();
                 }
                 break;
             }
@@ -416,10 +560,17 @@ void syshal_sat_callback(syshal_sat_event_t *event)
 
                     sys_config.battery_low_threshold.contents.threshold = config_packet.battery_low_threshhold;
 
+                    sys_config_mark_dirty();
                     new_config_available = true;
                 }
                 break;
             }
+            case packet_id_config_delta:
+            {
+                DEBUG_PR_TRACE("Receive configuration delta.");
+                config_delta_receive(&syshal_sat_command);
+                break;
+            }
             case packet_id_sat_bulletin:
             {
                 DEBUG_PR_TRACE("Receive new sat. bulletin.");
@@ -434,12 +585,14 @@ void syshal_sat_callback(syshal_sat_event_t *event)
             default:
                 break;
             }
-
-            // Clear buffer, ready for new command
-            sat_stream.clear();
         }
 
-        request_sat_status_update = true;
+        // Clear buffer, ready for new command. A satellite command holds whole packets, a corrupt one
+        // or stray bytes decoded as a header must not leave the decoder waiting and swallow the next ones
+        syshal_sat_command.an_packet_receive_reset();
+        sat_stream.clear();
+
+        event_post(EVENT_SAT_STATUS_REQUEST);
         break;
     }
     case SYSHAL_SAT_EVENT_MESSAGE_PENDING:
@@ -463,6 +616,7 @@ void syshal_ble_callback(syshal_ble_event_t *event)
         break;
     case SYSHAL_BLE_EVENT_DISCONNECTED:
         sm_context.ble_counters.uptime += syshal_rtc_return_uptime() - ble_start_time;
+        logdump_stop();
         break;
     case SYSHAL_BLE_EVENT_START_ADVERTISING:
         // Empty
@@ -492,7 +646,10 @@ void syshal_ble_callback(syshal_ble_event_t *event)
                     logger_insert_data(&log_u_msg, sizeof(LOG_U_MSG_struct), LOGGER_TAG_U_MSG_SLOT,
                                        syshal_rtc_return_timestamp(), &slot_id);
                     sm_context.logger_counters.u_msg_cnt++;
-                    logger_new_data_available = true;
+                    syshal_screen_msg_list_add(SYSHAL_SCREEN_MSG_LIST_TX, slot_id, log_u_msg.data,
+                                               sizeof(log_u_msg.data), false);
+                    screen_status_update();
+                    event_post(EVENT_LOGGER_DATA);
                     ble_write_req();
                 }
                 break;
@@ -528,10 +685,32 @@ void syshal_ble_callback(syshal_ble_event_t *event)
 
                     sys_config.battery_low_threshold.contents.threshold = config_packet.battery_low_threshhold;
 
+                    sys_config_mark_dirty();
                     new_config_available = true;
                 }
                 break;
             }
+            case packet_id_config_delta:
+            {
+                DEBUG_PR_TRACE("Receive configuration delta.");
+                config_delta_receive(&syshal_ble_command);
+                ble_write_req();
+                break;
+            }
+            case packet_id_log_dump:
+            {
+                DEBUG_PR_TRACE("Receive log dump request.");
+
+                log_dump_packet_t log_dump_packet;
+
+                bool request_valid = !syshal_ble_command.receive_log_dump_packet(&log_dump_packet);
+
+                ble_write_req(); // Acknowledge before the records
+
+                if (request_valid && !logdump_start(log_dump_packet.offset))
+                    event_post(EVENT_BLE_TX_READY);
+                break;
+            }
             case packet_id_sat_bulletin:
             {
                 DEBUG_PR_TRACE("Receive new sat. bulletin.");
@@ -571,7 +750,7 @@ void syshal_ble_callback(syshal_ble_event_t *event)
                         sat_status_packet.uptime = sm_context.sat_counters.status.uptime;
                         sat_status_packet.reset_cnt = sm_context.sat_counters.reset_cnt;
 
-                        request_sat_status_update = true;
+                        event_post(EVENT_SAT_STATUS_REQUEST);
 
                         syshal_ble_command.send_sat_status_packet(&sat_status_packet);
                         ble_write_req();
@@ -623,16 +802,44 @@ void syshal_ble_callback(syshal_ble_event_t *event)
                         DEBUG_PR_TRACE("Send asset status report.");
                         asset_status_packet_t asset_status_packet;
 
-                        asset_status_packet.up_time_ms = sm_context.asset_counters.up_time_ms;
+                        asset_status_packet.up_time_ms = (uint32_t)sm_context.asset_counters.up_time_ms; // Wire format keeps the lower 32 bits
                         asset_status_packet.sys_time = syshal_rtc_return_timestamp();
 
                         syshal_ble_command.send_asset_status_packet(&asset_status_packet);
                         ble_write_req();
                         break;
                     }
+#ifdef WITH_PROFILER
+                    case packet_id_profiler_status:
+                    {
+                        DEBUG_PR_TRACE("Send profiler status report.");
+                        for (uint8_t zone = 0; zone < PROFILER_ZONE_NB; zone++)
+                        {
+                            profiler_status_packet_t profiler_status_packet;
+                            profiler_stats_t stats;
+
+                            profiler_get_stats((profiler_zone_t)zone, &stats);
+
+                            profiler_status_packet.zone = zone;
+                            profiler_status_packet.count = stats.count;
+                            profiler_status_packet.min_us = stats.count ? profiler_cycles_to_us(stats.min) : 0;
+                            profiler_status_packet.avg_us = stats.count ? profiler_cycles_to_us(stats.total / stats.count) : 0;
+                            profiler_status_packet.max_us = profiler_cycles_to_us(stats.max);
+
+                            DEBUG_PR_TRACE("%s: %lu calls, %lu/%lu/%lu us", profiler_zone_str[zone],
+                                           profiler_status_packet.count, profiler_status_packet.min_us,
+                                           profiler_status_packet.avg_us, profiler_status_packet.max_us);
+
+                            syshal_ble_command.send_profiler_status_packet(&profiler_status_packet);
+                            ble_write_req();
+                        }
+                        break;
+                    }
+#endif
                     case packet_id_clear_msg_data:
                         DEBUG_PR_TRACE("Clear all messages in logger.");
                         logger_clear_all_slots_matching_tag(LOGGER_TAG_U_MSG_SLOT);
+                        syshal_screen_msg_list_clear(SYSHAL_SCREEN_MSG_LIST_TX);
                         break;
                     case packet_id_update_loc_data:
                         DEBUG_PR_TRACE("Trig sensors measurement.");
@@ -718,7 +925,7 @@ void syshal_ble_callback(syshal_ble_event_t *event)
     }
 
 #if defined(NRF52_SERIES)
-    resumeLoop();
+    event_post(EVENT_BLE_RX); // Runs in the BLE task, wake up the loop for the state changes above
 #endif
 }
 
@@ -731,6 +938,7 @@ void syshal_screen_callback(syshal_screen_event_t *event)
     case SYSHAL_SCREEN_EVENT_DISPLAY_ON:
         DEBUG_PR_TRACE("Power display ON.");
         screen_finish_time = syshal_time_get_ticks_ms() + SCREEN_DURATION_MS;
+        screen_status_update();
         break;
     case SYSHAL_SCREEN_EVENT_DISPLAY_OFF:
         DEBUG_PR_TRACE("Power display OFF.");
@@ -738,7 +946,7 @@ void syshal_screen_callback(syshal_screen_event_t *event)
     case SYSHAL_SCREEN_EVENT_BUTTON_PRESSED:
         DEBUG_PR_TRACE("User button pressed.");
         screen_finish_time = syshal_time_get_ticks_ms() + SCREEN_DURATION_MS;
-        request_screen_display_activation = true;
+        event_post(EVENT_SCREEN_ACTIVATION);
         break;
     case SYSHAL_SCREEN_EVENT_SHUTDOWN:
         DEBUG_PR_TRACE("Request for shutdown.");
@@ -752,12 +960,16 @@ void syshal_screen_callback(syshal_screen_event_t *event)
         logger_insert_data(&log_u_msg, sizeof(LOG_U_MSG_struct), LOGGER_TAG_U_MSG_SLOT,
                            event->preset_msg.timestamp, &slot_id);
         sm_context.logger_counters.u_msg_cnt++;
-        logger_new_data_available = true;
+        syshal_screen_msg_list_add(SYSHAL_SCREEN_MSG_LIST_TX, slot_id, event->preset_msg.buffer,
+                                   event->preset_msg.buffer_size, false);
+        screen_status_update();
+        event_post(EVENT_LOGGER_DATA);
         break;
     }
     case SYSHAL_SCREEN_EVENT_CLEAR_ALL_USER_MSG:
         DEBUG_PR_TRACE("Clear all messages in logger.");
         logger_clear_all_slots_matching_tag(LOGGER_TAG_U_MSG_SLOT);
+        syshal_screen_msg_list_clear(SYSHAL_SCREEN_MSG_LIST_TX);
         break;
     case SYSHAL_SCREEN_EVENT_UPDATE_GEOLOC:
         DEBUG_PR_TRACE("Trig sensors measurement.");
@@ -765,15 +977,7 @@ void syshal_screen_callback(syshal_screen_event_t *event)
         break;
     case SYSHAL_SCREEN_EVENT_UPDATE_STATUS_REQUEST:
         DEBUG_PR_TRACE("Update status request.");
-        syshal_screen_status_t screen_status;
-        screen_status.last_loc_lat = sm_context.gps_counters.last_loc_lat;
-        screen_status.last_loc_lon = sm_context.gps_counters.last_loc_lon;
-        screen_status.u_msg_cnt = sm_context.logger_counters.u_msg_cnt;
-        screen_status.u_cmd_cnt = sm_context.logger_counters.u_cmd_cnt;
-        screen_status.pvt_cnt = sm_context.logger_counters.pvt_cnt;
-        syshal_temp_temperature(&(screen_status.temp));
-        syshal_batt_voltage(&(screen_status.v_bat));
-        syshal_screen_set_status(screen_status);
+        screen_status_update();
         break;
     default:
         DEBUG_PR_WARN("Unknown SCREEN event in %s() : %d", __FUNCTION__, event->id);
@@ -791,13 +995,20 @@ static void sm_main_boot(sm_handle_t *state_handle)
 
     Try
     {
-        uint32_t state_start_time = syshal_time_get_ticks_ms();
+        uint64_t state_start_time = syshal_time_get_ticks_ms();
 
         if (debug_init())
             Throw(EXCEPTION_BOOT_ERROR);
 
+#ifdef WITH_PROFILER
+        profiler_init(); // Before the first instrumented call
+#endif
+
         syshal_pmu_init();
 
+        if (event_init())
+            Throw(EXCEPTION_BOOT_ERROR);
+
         if (syshal_rtc_init())
             Throw(EXCEPTION_BOOT_ERROR);
 
@@ -859,10 +1070,24 @@ static void sm_main_boot(sm_handle_t *state_handle)
         if (logger_init())
             Throw(EXCEPTION_BOOT_ERROR);
 
+        if (logdump_init())
+            Throw(EXCEPTION_BOOT_ERROR);
+
         if (scheduler_init())
             Throw(EXCEPTION_BOOT_ERROR);
 
-        // Load tracker configuration (TODO: load from file system)
+        if (satpass_init())
+            Throw(EXCEPTION_BOOT_ERROR);
+
+        if (sensor_init())
+            Throw(EXCEPTION_BOOT_ERROR);
+
+        if (geofence_init())
+            Throw(EXCEPTION_BOOT_ERROR);
+
+        // Default tracker configuration, replaced by the stored one if any
+        sys_config.format_version = SYS_CONFIG_FORMAT_VERSION;
+
         sys_config.ble_settings.contents.tx_power = 0;
         sys_config.ble_settings.contents.advert_fast_interval = 32;
         sys_config.ble_settings.contents.advert_slow_interval = 2056; // 152.5 ms, 211.25 ms, 318.75 ms, 417.5 ms, 546.25 ms, 760 ms, 852.5 ms, 1022.5 ms, 1285 ms -> Set Interval in unit of 0.625 ms
@@ -902,11 +1127,22 @@ static void sm_main_boot(sm_handle_t *state_handle)
         sys_config.satpass_scheduler_settings.contents.timestamp = 0; // Will be in the past, scheduler will disgard it immediately
         sys_config.satpass_scheduler_settings.hdr.set = true;
 
+        sys_config.wake_scheduler_settings.contents.slack_s = 120;
+        sys_config.wake_scheduler_settings.hdr.set = true;
+
+        // Hourly while moving, down to the former daily fix while stationary
+        sys_config.gps_adaptive_scheduler_settings.contents.interval_min_m = 60;
+        sys_config.gps_adaptive_scheduler_settings.contents.interval_max_m = 1440;
+        sys_config.gps_adaptive_scheduler_settings.contents.backoff = 2;
+        sys_config.gps_adaptive_scheduler_settings.contents.distance_threshold_m = 100;
+        sys_config.gps_adaptive_scheduler_settings.contents.speed_threshold_mm_s = 500;
+        sys_config.gps_adaptive_scheduler_settings.hdr.set = true;
+
         sys_config.satpass_predictor_enable.contents.enable = false;
         sys_config.satpass_predictor_enable.hdr.set = false;
 
-        sys_config.satpass_settings.contents.lat = 46.5; // Only static stations supported now
-        sys_config.satpass_settings.contents.lon = 6.5;  // Only static stations supported now
+        sys_config.satpass_settings.contents.lat = 465000000; // Only static stations supported now
+        sys_config.satpass_settings.contents.lon = 65000000;  // Only static stations supported now
         sys_config.satpass_settings.contents.sat_pass_search_window_size_s = 86400;
         sys_config.satpass_settings.contents.sat_pass_search_step_s = 30;
         sys_config.satpass_settings.contents.sat_pass_search_window_back_step_s = 600;
@@ -918,9 +1154,39 @@ static void sm_main_boot(sm_handle_t *state_handle)
         sys_config.battery_low_threshold.contents.threshold = 0;
         sys_config.battery_low_threshold.hdr.set = false;
 
+        // Single Li-ion cell
+        static const uint16_t battery_curve_mv[SYS_CONFIG_BATTERY_CURVE_SIZE] = {4200, 4060, 3980, 3920, 3870, 3820,
+                                                                                 3790, 3770, 3740, 3680, 3450};
+        sys_config.battery_settings.contents.capacity_mah = 2000;
+        sys_config.battery_settings.contents.internal_resistance_mohm = 150;
+        memcpy(sys_config.battery_settings.contents.curve_mv, battery_curve_mv, sizeof(battery_curve_mv));
+        sys_config.battery_settings.hdr.set = true;
+
         sys_config.gps_log_position_enable.contents.enable = true;
         sys_config.gps_log_position_enable.hdr.set = true;
 
+        sys_config.sensor_settings.contents.sensor[SENSOR_BATTERY].interval_s = 3600;
+        sys_config.sensor_settings.contents.sensor[SENSOR_BATTERY].aggregate_nb = 1;
+        sys_config.sensor_settings.contents.sensor[SENSOR_TEMPERATURE].interval_s = 600; // Hourly min, max and mean
+        sys_config.sensor_settings.contents.sensor[SENSOR_TEMPERATURE].aggregate_nb = 6;
+        sys_config.sensor_settings.hdr.set = true;
+
+        // No fence is set, so every fix is uplinked until some are received
+        sys_config.geofence_settings.contents.policy = GEOFENCE_UPLINK_OUTSIDE;
+        sys_config.geofence_settings.contents.heartbeat_m = 1440;
+        sys_config.geofence_settings.hdr.set = true;
+
+        if (sys_config_load())
+            DEBUG_PR_WARN("No stored configuration, using defaults.");
+
+        sys_config_delta_init();
+
+        syshal_debug_config_t debug_config = {.debug = &sys_config.debug_settings};
+        debug_update_config(debug_config);
+
+        syshal_batt_config_t batt_config = {.battery = &sys_config.battery_settings};
+        syshal_batt_update_config(batt_config);
+
         // Print General System Info
         DEBUG_PR_SYS("AstroTracker");
         DEBUG_PR_SYS("Compiled: %s %s With %s", COMPILE_DATE, COMPILE_TIME, COMPILER_NAME);
@@ -959,7 +1225,7 @@ static void sm_main_provisioning(sm_handle_t *state_handle)
     {
         KICK_WATCHDOG();
 
-        uint32_t state_start_time = syshal_time_get_ticks_ms();
+        uint64_t state_start_time = syshal_time_get_ticks_ms();
 
         if (sm_is_first_entry(state_handle))
         {
@@ -971,6 +1237,10 @@ static void sm_main_provisioning(sm_handle_t *state_handle)
             led_finish_time = syshal_time_get_ticks_ms() + LED_DURATION_MS;
             syshal_led_set_sequence(RED_GREEN_BLUE, LED_BLINK_TEST_PASSED_DURATION_MS);
 
+            // Configure battery gauge, before the level is checked
+            syshal_batt_config_t batt_config = {.battery = &sys_config.battery_settings};
+            syshal_batt_update_config(batt_config);
+
             // Branch to Battery Low state if battery is beneath threshold
             uint8_t level;
             if (!syshal_batt_level(&level))
@@ -978,6 +1248,10 @@ static void sm_main_provisioning(sm_handle_t *state_handle)
                     level <= sys_config.battery_low_threshold.contents.threshold)
                     sm_set_next_state(state_handle, SM_MAIN_BATTERY_LEVEL_LOW);
 
+            // Configure debug output
+            syshal_debug_config_t debug_config = {.debug = &sys_config.debug_settings};
+            debug_update_config(debug_config);
+
             // Configure GPS
             if (!syshal_gps_wake_up())
             {
@@ -1012,7 +1286,8 @@ static void sm_main_provisioning(sm_handle_t *state_handle)
                 Throw(EXCEPTION_SCREEN_ERROR);
 
             // Configure GPS scheduler
-            scheduler_gps_config_t scheduler_gps_config = {.scheduler = &sys_config.gps_scheduler_settings};
+            scheduler_gps_config_t scheduler_gps_config = {.scheduler = &sys_config.gps_scheduler_settings,
+                                                           .adaptive = &sys_config.gps_adaptive_scheduler_settings};
             if (scheduler_gps_update_config(scheduler_gps_config))
                 Throw(EXCEPTION_SCHEDULER_ERROR);
             scheduler_tick();
@@ -1022,12 +1297,38 @@ static void sm_main_provisioning(sm_handle_t *state_handle)
             if (scheduler_satpass_update_config(scheduler_satpass_config))
                 Throw(EXCEPTION_SCHEDULER_ERROR);
             scheduler_tick();
+
+            // Configure wake up planning
+            scheduler_wake_config_t scheduler_wake_config = {.scheduler = &sys_config.wake_scheduler_settings};
+            if (scheduler_wake_update_config(scheduler_wake_config))
+                Throw(EXCEPTION_SCHEDULER_ERROR);
+
+            // Configure SATPASS predictor
+            satpass_config_t satpass_config = {.satpass = &sys_config.satpass_settings,
+                                               .orbits = &sys_config.satpass_orbits};
+            if (satpass_update_config(satpass_config))
+                Throw(EXCEPTION_SCHEDULER_ERROR);
+
+            // Configure sensors
+            sensor_config_t sensor_config = {.sensor = &sys_config.sensor_settings};
+            if (sensor_update_config(sensor_config))
+                Throw(EXCEPTION_SCHEDULER_ERROR);
+
+            // Configure geofences, an invalid fence is only left out
+            geofence_config_t geofence_config = {.settings = &sys_config.geofence_settings,
+                                                 .fence = sys_config.geofence};
+            if (geofence_update_config(geofence_config))
+                DEBUG_PR_WARN("Invalid geofence configuration.");
+
+            // Keep the applied configuration across resets
+            if (sys_config_save())
+                DEBUG_PR_ERROR("Failed to store the configuration.");
         }
 
         // Turn off led after led_finish_time
         if (syshal_led_is_active())
         {
-            uint32_t current_time = syshal_time_get_ticks_ms();
+            uint64_t current_time = syshal_time_get_ticks_ms();
             if (led_finish_time != 0 && current_time > led_finish_time)
             {
                 syshal_led_off();
@@ -1060,7 +1361,7 @@ static void sm_main_operational(sm_handle_t *state_handle)
     {
         KICK_WATCHDOG();
 
-        uint32_t state_start_time = syshal_time_get_ticks_ms();
+        uint64_t state_start_time = syshal_time_get_ticks_ms();
 
         if (sm_is_first_entry(state_handle))
         {
@@ -1070,7 +1371,10 @@ static void sm_main_operational(sm_handle_t *state_handle)
 
             if (sys_config.logging_enable.hdr.set &&
                 sys_config.logging_enable.contents.enable)
+            {
                 sensor_logging_enabled = true;
+                sensor_start();
+            }
 
             // Led for showing it enters in operational state
             led_finish_time = syshal_time_get_ticks_ms() + LED_DURATION_MS;
@@ -1092,7 +1396,7 @@ static void sm_main_operational(sm_handle_t *state_handle)
             if ((sys_config.satpass_predictor_enable.hdr.set &&
                  sys_config.satpass_predictor_enable.contents.enable))
             {
-                scheduler_satpass_start();
+                satpass_schedule_next_pass();
             }
             else
             {
@@ -1107,86 +1411,13 @@ static void sm_main_operational(sm_handle_t *state_handle)
             syshal_led_tick();
         }
 
-        // Get the battery level state
-        uint8_t level;
-        if (!syshal_batt_level(&level))
-        {
-            // Has our battery level decreased
-            if (last_battery_reading > level)
-            {
-                // Should we check to see if we should enter a low power state?
-                if (sys_config.battery_low_threshold.hdr.set &&
-                    level <= sys_config.battery_low_threshold.contents.threshold)
-                    sm_set_next_state(state_handle, SM_MAIN_BATTERY_LEVEL_LOW);
-
-                last_battery_reading = level;
-            }
-        }
-
-        if ((sys_config.gps_log_position_enable.hdr.set &&
-             sys_config.gps_log_position_enable.contents.enable))
-        {
-            syshal_gps_tick();
-
-            // If we have a raw sample aquired
-            if ((sys_config.gps_settings.hdr.set) &&
-                (sys_config.gps_settings.contents.with_rxm_meas20) &&
-                ((syshal_rtc_return_uptime() - gps_start_time) <= sys_config.gps_settings.contents.raw_timeout_s) &&
-                (syshal_gps_get_state() == SYSHAL_GPS_STATE_FIXED_RAW))
-                syshal_gps_shutdown();
-
-            // If we have a 3D fix
-            if (syshal_gps_get_state() == SYSHAL_GPS_STATE_FIXED)
-                syshal_gps_shutdown();
-
-            // If we have a timeout
-            if ((syshal_rtc_return_uptime() - gps_start_time) > sys_config.gps_settings.contents.pvt_timeout_s)
-                syshal_gps_shutdown();
-        }
-
-        syshal_sat_tick();
-        syshal_screen_tick();
-        syshal_screen_tick(); // TODO: should only be called once
-        scheduler_tick();
-
-        // Request satellite module counters
-        if (request_sat_status_update)
-        {
-            if (!syshal_sat_wake_up())
-            {
-                syshal_sat_read_status(&sm_context.sat_counters.status);
-            }
-            syshal_sat_shutdown();
-            request_sat_status_update = false;
-        }
-
-        // Fallback strategy for satellite pass predictor
-        if ((sys_config.satpass_predictor_enable.hdr.set) &&
-            (sys_config.satpass_predictor_enable.contents.enable) &&
-            ((syshal_rtc_return_timestamp() - sm_context.sat_counters.status.time_start_last_contact) > sys_config.satpass_settings.contents.sat_pass_predictor_timeout_s))
-        {
-            sys_config.satpass_predictor_enable.contents.enable = false;
-            DEBUG_PR_WARN("Satellite pass predictor deactivated. Reason = timeout.");
-        }
-
-        // Push logger data in satellite module
-        if (logger_new_data_available)
-        {
-            logger_push_slots_to_sat();
-            logger_new_data_available = false;
-        }
-
-        // Activate display if requested
-        if (request_screen_display_activation)
-        {
-            syshal_screen_wake_up();
-            request_screen_display_activation = false;
-        }
+        // Only run the handlers of what woke us up
+        event_dispatch(sm_main_operational_event_handlers, state_handle, NULL);
 
         // Turn off led after led_finish_time
         if (syshal_led_is_active())
         {
-            uint32_t current_time = syshal_time_get_ticks_ms();
+            uint64_t current_time = syshal_time_get_ticks_ms();
 
             // If there a no finish time or the current time is less than the finish time
             if (led_finish_time != 0 && current_time > led_finish_time)
@@ -1198,7 +1429,7 @@ static void sm_main_operational(sm_handle_t *state_handle)
         // Turn off screen after screen_finish_time
         if (syshal_screen_get_state() == SYSHAL_SCREEN_STATE_DISPLAYING)
         {
-            uint32_t current_time = syshal_time_get_ticks_ms();
+            uint64_t current_time = syshal_time_get_ticks_ms();
 
             // If there a no finish time or the current time is less than the finish time
             if (screen_finish_time != 0 && current_time > screen_finish_time)
@@ -1209,34 +1440,64 @@ static void sm_main_operational(sm_handle_t *state_handle)
 
         syshal_led_tick();
 
+        // Sample the sensors that are due soon while we are awake anyway
+        if (sensor_logging_enabled)
+            sensor_tick();
+
         // Update asset counters
         sm_context.asset_counters.up_time_ms += syshal_time_get_ticks_ms() - state_start_time;
         state_start_time = syshal_time_get_ticks_ms(); // Reset counter
 
-        // Go to sleep
-        if (!syshal_led_is_active())
+        // Go to sleep, a timer plays the LED pattern unless it is advanced by syshal_led_tick()
+        if (!syshal_led_needs_tick() && !sm_is_last_entry(state_handle))
         {
-            if ((syshal_gps_get_state() == SYSHAL_GPS_STATE_ASLEEP) &&
-                ((syshal_screen_get_state() == SYSHAL_SCREEN_STATE_ASLEEP) ||
-                 (syshal_screen_get_state() == SYSHAL_SCREEN_STATE_UNINIT)))
-            {
-                uint32_t timestamp_next_alarm = 0;
-                scheduler_get_timestamp_next_alarm(&timestamp_next_alarm);
+            // Sleep until the next alarm, we have to kick the hardware watchdog anyway
+            uint32_t timeout_s = HARD_WATCHDOG_TIMEOUT_S;
 
-                // We have to kick the hardware watchdog
-                if ((timestamp_next_alarm - syshal_rtc_return_timestamp()) > HARD_WATCHDOG_TIMEOUT_S)
-                    syshal_rtc_set_alarm(syshal_rtc_return_timestamp() + HARD_WATCHDOG_TIMEOUT_S, NULL);
-                else
-                    syshal_rtc_set_alarm(timestamp_next_alarm, NULL);
+            if (syshal_screen_get_state() == SYSHAL_SCREEN_STATE_DISPLAYING)
+                timeout_s = SCREEN_ACTIVE_WAKEUP_TIMEOUT_S;
 
-                syshal_pmu_sleep(SLEEP_DEEP);
+            // Wake up to turn the LED off after led_finish_time
+            if (syshal_led_is_active() && led_finish_time != 0)
+            {
+                uint64_t current_time = syshal_time_get_ticks_ms();
+                uint32_t led_timeout_s = 1;
+                if (led_finish_time > current_time)
+                    led_timeout_s = (led_finish_time - current_time) / 1000 + 1;
+                if (led_timeout_s < timeout_s)
+                    timeout_s = led_timeout_s;
             }
-            else
+
+            if (syshal_gps_get_state() != SYSHAL_GPS_STATE_ASLEEP)
             {
-                uint32_t timestamp_next_alarm = syshal_rtc_return_timestamp() + GPS_ACTIVE_WAKEUP_TIMEOUT_S;
-                syshal_rtc_set_alarm(timestamp_next_alarm, NULL);
-                syshal_pmu_sleep(SLEEP_DEEP);
+                // Without TX ready pin the receiver is polled, otherwise we only wake up for the fix timeout
+                uint32_t gps_timeout_s = GPS_ACTIVE_WAKEUP_TIMEOUT_S;
+                if (syshal_gps_has_tx_ready())
+                {
+                    uint32_t gps_elapsed_s = syshal_rtc_return_uptime() - gps_start_time;
+                    uint32_t pvt_timeout_s = sys_config.gps_settings.contents.pvt_timeout_s;
+                    gps_timeout_s = (gps_elapsed_s < pvt_timeout_s) ? (pvt_timeout_s - gps_elapsed_s + 1) : 1;
+                }
+                if (gps_timeout_s < timeout_s)
+                    timeout_s = gps_timeout_s;
             }
+
+            // The TX ready interrupt only sees edges, data that is already waiting is served now
+            if (syshal_gps_tx_ready_asserted())
+                event_post(EVENT_GPS_TX_READY);
+
+            // Run the satellite jobs that cannot wait for the next wake up
+            if (!event_is_pending())
+            {
+                uint32_t timestamp_wakeup;
+                scheduler_get_timestamp_wakeup(timeout_s, &timestamp_wakeup);
+                scheduler_job_tick(timestamp_wakeup);
+            }
+
+            if (scheduler_set_rtc_alarm(timeout_s))
+                event_post(EVENT_RTC_ALARM); // Alarm already due, service it on the next pass
+            else if (!event_is_pending())
+                syshal_pmu_sleep(SLEEP_DEEP);
         }
 
         // Branch to Provisioning state if config_if has connected
@@ -1257,8 +1518,12 @@ static void sm_main_operational(sm_handle_t *state_handle)
 
             syshal_led_off();
 
+            sensor_stop(); // Logs the pending samples
             sensor_logging_enabled = false;
 
+            // No more wake up planned in this state
+            scheduler_job_tick(UINT32_MAX);
+
             sm_context.asset_counters.up_time_ms += syshal_time_get_ticks_ms() - state_start_time;
         }
     }
@@ -1278,9 +1543,9 @@ static void sm_main_deactivate(sm_handle_t *state_handle)
     {
         KICK_WATCHDOG();
 
-        uint32_t state_start_time = syshal_time_get_ticks_ms();
+        uint64_t state_start_time = syshal_time_get_ticks_ms();
 
-        uint32_t state_entry_time = 0;
+        uint64_t state_entry_time = 0;
 
         if (sm_is_first_entry(state_handle))
         {
@@ -1326,7 +1591,7 @@ static void sm_main_battery_level_low(sm_handle_t *state_handle)
     {
         KICK_WATCHDOG();
 
-        uint32_t state_start_time = syshal_time_get_ticks_ms();
+        uint64_t state_start_time = syshal_time_get_ticks_ms();
 
         if (sm_is_first_entry(state_handle))
         {
@@ -1359,7 +1624,7 @@ static void sm_main_log_file_full(sm_handle_t *state_handle)
     {
         KICK_WATCHDOG();
 
-        uint32_t state_start_time = syshal_time_get_ticks_ms();
+        uint64_t state_start_time = syshal_time_get_ticks_ms();
 
         if (sm_is_first_entry(state_handle))
         {
@@ -1439,83 +1704,322 @@ static bool check_configuration_tags_set(void)
 
 void ble_write_req(void)
 {
-    uint8_t buffer[256]; // Magic number
-    size_t buffer_size = 0;
-    while (ble_stream.available())
+    // Send straight from the stream buffer, at most two spans when the data wraps around
+    const uint8_t *buffer;
+    size_t buffer_size;
+    while ((buffer_size = ble_stream.acquireRead(&buffer)) > 0)
     {
-        buffer[buffer_size++] = ble_stream.read();
+        syshal_ble_send_message(buffer, buffer_size);
+        ble_stream.release(buffer_size);
     }
-    syshal_ble_send_message(buffer, buffer_size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////// SCREEN_STATUS /////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Pushed on the events that change the status page, the sensors are only read while it can be seen
+void screen_status_update(void)
+{
+    if (syshal_screen_get_state() != SYSHAL_SCREEN_STATE_DISPLAYING)
+        return;
+
+    syshal_screen_status_t screen_status;
+    screen_status.last_loc_lat = sm_context.gps_counters.last_loc_lat;
+    screen_status.last_loc_lon = sm_context.gps_counters.last_loc_lon;
+    screen_status.u_msg_cnt = sm_context.logger_counters.u_msg_cnt;
+    screen_status.u_cmd_cnt = sm_context.logger_counters.u_cmd_cnt;
+    screen_status.pvt_cnt = sm_context.logger_counters.pvt_cnt;
+    syshal_temp_temperature(&(screen_status.temp));
+    syshal_batt_voltage(&(screen_status.v_bat));
+    syshal_screen_set_status(screen_status);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////// CONFIG_DELTA //////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+static_assert(CONFIG_DELTA_PACKET_DATA_MAX_SIZE == SYS_CONFIG_DELTA_FRAGMENT_SIZE, "Config delta fragment size mismatch");
+
+void config_delta_receive(COMMAND *command)
+{
+    config_delta_packet_t config_delta_packet;
+    uint8_t data_length;
+    bool applied;
+
+    if (command->receive_config_delta_packet(&config_delta_packet, &data_length))
+        return;
+
+    int ret = sys_config_delta_receive(config_delta_packet.transfer_id,
+                                       CONFIG_DELTA_PACKET_FRAGMENT_INDEX(config_delta_packet.fragment),
+                                       CONFIG_DELTA_PACKET_FRAGMENT_NB(config_delta_packet.fragment),
+                                       config_delta_packet.data, data_length, &applied);
+    if (ret)
+    {
+        DEBUG_PR_WARN("Configuration delta rejected, error %d", ret);
+        return;
+    }
+
+    if (applied)
+        new_config_available = true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////// LOGGER //////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+// Call with the satellite module awake
 void logger_push_slots_to_sat(void)
 {
-    DEBUG_PR_TRACE("Waking up terminal. %s()", __FUNCTION__);
+    DEBUG_PR_TRACE("%s() called", __FUNCTION__);
 
-    if (!syshal_sat_wake_up())
+    uint32_t prv_slot_epoch = 0xFFFFFFFF;
+
+    for (uint16_t i = 0; i < LOGGER_NB_SLOTS; i++)
     {
-        uint32_t prv_slot_epoch = 0xFFFFFFFF;
+        // Get youngest slot from memory
+        uint16_t slot_id;
+        uint32_t slot_createdDate = 0, slot_acknowledgedDate = 0;
+        uint8_t slot_tag;
+        uint16_t slot_buffer_size;
+        logger_slot_status_id_t status;
+        void *slot_buffer;
 
-        for (uint16_t i = 0; i < LOGGER_NB_SLOTS; i++)
+        logger_get_youngest_slot_id_older_than(&slot_id, &slot_createdDate, prv_slot_epoch);
+        prv_slot_epoch = slot_createdDate;
+
+        // Youngest slot id is 0 means no more data in logger
+        if (slot_id == 0)
         {
-            // Get youngest slot from memory
-            uint16_t slot_id;
-            uint32_t slot_createdDate = 0, slot_acknowledgedDate = 0;
-            uint8_t slot_tag;
-            uint16_t slot_buffer_size;
-            logger_slot_status_id_t status;
-            void *slot_buffer;
-
-            logger_get_youngest_slot_id_older_than(&slot_id, &slot_createdDate, prv_slot_epoch);
-            prv_slot_epoch = slot_createdDate;
-
-            // Youngest slot id is 0 means no more data in logger
-            if (slot_id == 0)
-            {
-                DEBUG_PR_WARN("All slots are empty.");
-                break;
-            }
+            DEBUG_PR_WARN("All slots are empty.");
+            break;
+        }
 
-            time_t slot_epoch_t = slot_createdDate;
-            DEBUG_PR_TRACE("Found slot with ID: %d, epoch: %s", slot_id, asctime(gmtime(&slot_epoch_t)));
+        time_t slot_epoch_t = slot_createdDate;
+        DEBUG_PR_TRACE("Found slot with ID: %d, epoch: %s", slot_id, asctime(gmtime(&slot_epoch_t)));
 
-            if (!logger_get_data(slot_id, &slot_buffer, &slot_buffer_size, &slot_tag, &slot_createdDate, &slot_acknowledgedDate, &status))
+        if (!logger_get_data(slot_id, &slot_buffer, &slot_buffer_size, &slot_tag, &slot_createdDate, &slot_acknowledgedDate, &status))
+        {
+            if (status == LOGGER_SLOT_STATUS_WAITING_TRANSMIT)
             {
-                if (status == LOGGER_SLOT_STATUS_WAITING_TRANSMIT)
-                {
-                    // Fill data buffer for terminal
-                    uint8_t buffer[ASN_MAX_MSG_SIZE];
-                    uint8_t buffer_size = 0;
+                // Fill data buffer for terminal
+                uint8_t buffer[ASN_MAX_MSG_SIZE];
+                uint8_t buffer_size = 0;
 
-                    memcpy(&buffer[buffer_size], &slot_tag, sizeof(slot_tag));
-                    buffer_size += sizeof(slot_tag);
+                memcpy(&buffer[buffer_size], &slot_tag, sizeof(slot_tag));
+                buffer_size += sizeof(slot_tag);
 
-                    memcpy(&buffer[buffer_size], slot_buffer, slot_buffer_size);
-                    buffer_size += slot_buffer_size;
+                memcpy(&buffer[buffer_size], slot_buffer, slot_buffer_size);
+                buffer_size += slot_buffer_size;
 
-                    if ((slot_tag != LOGGER_TAG_PVT_SLOT) &&
-                        (slot_tag != LOGGER_TAG_RAW_SLOT))
-                    {
-                        memcpy(&buffer[buffer_size], &slot_createdDate, sizeof(slot_createdDate));
-                        buffer_size += sizeof(slot_createdDate);
-                    }
-
-                    // Push data buffer to terminal untile queue is full
-                    if (syshal_sat_send_message(buffer, buffer_size, slot_id))
-                        break;
+                if ((slot_tag != LOGGER_TAG_PVT_SLOT) &&
+                    (slot_tag != LOGGER_TAG_RAW_SLOT) &&
+                    (slot_tag != LOGGER_TAG_SENSOR_SLOT))
+                {
+                    memcpy(&buffer[buffer_size], &slot_createdDate, sizeof(slot_createdDate));
+                    buffer_size += sizeof(slot_createdDate);
                 }
+
+                // Push data buffer to terminal untile queue is full
+                if (syshal_sat_send_message(buffer, buffer_size, slot_id))
+                    break;
             }
         }
+    }
+}
+
+// Call with the satellite module awake
+void sat_status_update(void)
+{
+    syshal_sat_read_status(&sm_context.sat_counters.status);
+
+    // Astronode RTC is only valid once it has seen a satellite
+    uint32_t sat_time;
+    if (!syshal_sat_get_time(&sat_time))
+        syshal_rtc_discipline(sat_time, SAT_TIME_ACCURACY_S);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////// EVENT HANDLERS /////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Scheduler alarms, hardware watchdog and polling timeouts
+static void sm_main_event_rtc_alarm(void *context)
+{
+    sm_handle_t *state_handle = (sm_handle_t *)context;
+
+    // Get the battery level state
+    uint8_t level;
+    if (!syshal_batt_level(&level))
+    {
+        // Has our battery level decreased
+        if (last_battery_reading > level)
+        {
+            // Should we check to see if we should enter a low power state?
+            if (sys_config.battery_low_threshold.hdr.set &&
+                level <= sys_config.battery_low_threshold.contents.threshold)
+                sm_set_next_state(state_handle, SM_MAIN_BATTERY_LEVEL_LOW);
+
+            last_battery_reading = level;
+        }
+    }
 
-        // Update satellite context
-        request_sat_status_update = true;
+    scheduler_tick();
+
+    // Fallback strategy for satellite pass predictor
+    if ((sys_config.satpass_predictor_enable.hdr.set) &&
+        (sys_config.satpass_predictor_enable.contents.enable) &&
+        ((syshal_rtc_return_timestamp() - sm_context.sat_counters.status.time_start_last_contact) > sys_config.satpass_settings.contents.sat_pass_predictor_timeout_s))
+    {
+        sys_config.satpass_predictor_enable.contents.enable = false;
+        DEBUG_PR_WARN("Satellite pass predictor deactivated. Reason = timeout.");
     }
 
-    syshal_sat_shutdown();
+    // Poll the receiver and check its timeouts
+    if (syshal_gps_get_state() != SYSHAL_GPS_STATE_ASLEEP)
+        sm_main_event_gps_tx_ready(context);
+
+    // Refresh the display
+    if (syshal_screen_get_state() == SYSHAL_SCREEN_STATE_DISPLAYING)
+        syshal_screen_tick();
+}
+
+static void sm_main_event_sat_pin(void *context)
+{
+    syshal_sat_tick();
+}
+
+static void sm_main_event_gps_tx_ready(void *context)
+{
+    if (!(sys_config.gps_log_position_enable.hdr.set &&
+          sys_config.gps_log_position_enable.contents.enable))
+        return;
+
+    syshal_gps_tick();
+
+    // If we have a raw sample aquired
+    if ((sys_config.gps_settings.hdr.set) &&
+        (sys_config.gps_settings.contents.with_rxm_meas20) &&
+        ((syshal_rtc_return_uptime() - gps_start_time) <= sys_config.gps_settings.contents.raw_timeout_s) &&
+        (syshal_gps_get_state() == SYSHAL_GPS_STATE_FIXED_RAW))
+        syshal_gps_shutdown();
+
+    // If we have a 3D fix
+    if (syshal_gps_get_state() == SYSHAL_GPS_STATE_FIXED)
+        syshal_gps_shutdown();
+
+    // If we have a timeout
+    if ((syshal_rtc_return_uptime() - gps_start_time) > sys_config.gps_settings.contents.pvt_timeout_s)
+        syshal_gps_shutdown();
+}
+
+static void sm_main_event_button(void *context)
+{
+    syshal_screen_tick();
+}
+
+// Continue the log dump, stay awake while the BLE queue accepts more
+static void sm_main_event_ble_tx_ready(void *context)
+{
+    bool more;
+    logdump_process(&more);
+    if (more)
+        event_post(EVENT_BLE_TX_READY);
+}
+
+// Request satellite module counters, read with the next satellite jobs
+static void sm_main_event_sat_status_request(void *context)
+{
+    scheduler_job_request(SCHEDULER_JOB_SAT_STATUS);
+}
+
+// Schedule the next satellite pass once the previous one has started
+static void sm_main_event_satpass_update(void *context)
+{
+    if ((sys_config.satpass_predictor_enable.hdr.set) &&
+        (sys_config.satpass_predictor_enable.contents.enable))
+        satpass_schedule_next_pass();
+}
+
+// Push logger data in satellite module, with the next satellite jobs
+static void sm_main_event_logger_data(void *context)
+{
+    scheduler_job_request(SCHEDULER_JOB_LOGGER_PUSH);
+}
+
+// Activate display if requested
+static void sm_main_event_screen_activation(void *context)
+{
+    // Buttons pressed while displaying are already handled by sm_main_event_button()
+    if (syshal_screen_get_state() == SYSHAL_SCREEN_STATE_DISPLAYING)
+        return;
+
+    syshal_screen_wake_up();
+    syshal_screen_tick();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////// SATPASS /////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Time to wake up before the AOS of a pass
+uint32_t satpass_wakeup_margin(uint32_t aos)
+{
+    uint32_t margin = sys_config.satpass_settings.contents.sat_pass_terminal_wakeup_margin_s;
+    uint32_t uncertainty;
+
+    // Shrink the wake up margin to what the RTC uncertainty at the pass requires
+    if (!syshal_rtc_get_uncertainty(aos, &uncertainty) &&
+        (uncertainty + SATPASS_WAKEUP_MIN_MARGIN_S) < margin)
+        margin = uncertainty + SATPASS_WAKEUP_MIN_MARGIN_S;
+
+    return margin;
+}
+
+void satpass_schedule_next_pass(void)
+{
+    uint32_t timestamp = syshal_rtc_return_timestamp();
+    uint32_t search = timestamp;
+    uint32_t margin;
+    satpass_pass_t pass;
+
+    for (;;)
+    {
+        if (satpass_get_next_pass(search, &pass))
+        {
+            DEBUG_PR_WARN("No satellite pass found in search window. %s()", __FUNCTION__);
+            return;
+        }
+
+        // Passes in progress and served ones are never armed, they would wake up right away
+        if ((pass.aos <= timestamp) || (pass.aos <= satpass_served_aos))
+        {
+            search = pass.los;
+            continue;
+        }
+
+        // Already in the wake up window of this pass, push data now once and aim for the next one
+        margin = satpass_wakeup_margin(pass.aos);
+        if (pass.aos <= timestamp + margin)
+        {
+            scheduler_job_request_now(SCHEDULER_JOB_LOGGER_PUSH);
+            satpass_served_aos = pass.aos;
+            search = pass.los;
+            continue;
+        }
+
+        break;
+    }
+
+    DEBUG_PR_TRACE("Next satellite pass: sat %d, aos %d, los %d, margin %d.", pass.sat_id, pass.aos, pass.los, margin);
+
+    sys_config.satpass_scheduler_settings.contents.timestamp = pass.aos - margin;
+    sys_config.satpass_scheduler_settings.hdr.set = true;
+    satpass_armed_aos = pass.aos;
+
+    scheduler_satpass_config_t scheduler_satpass_config = {.scheduler = &sys_config.satpass_scheduler_settings};
+    if (!scheduler_satpass_update_config(scheduler_satpass_config))
+        scheduler_satpass_start();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
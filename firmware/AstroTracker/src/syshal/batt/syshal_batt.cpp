@@ -25,6 +25,7 @@
 
 #include "../syshal_batt.h"
 #include "../syshal_gpio.h"
+#include "../syshal_time.h"
 #include "../../core/debug/debug.h"
 #include "../syshal_config.h"
 
@@ -32,8 +33,144 @@
 #define SYSHAL_BATT_GPIO_ADC_BATT (GPIO_VBAT)
 #endif
 
+#ifdef VBAT_DIVIDER
+#define SYSHAL_BATT_DIVIDER (VBAT_DIVIDER)
+#else
+#define SYSHAL_BATT_DIVIDER (1)
+#endif
+
+#if defined(ARDUINO_ARCH_SAMD)
+#include "wiring_private.h"
+// The ADC accumulates the conversions itself, the battery is measured against the bandgap reference
+// which removes the error of the 3.3 V regulator on VDDANA
+#define SYSHAL_BATT_ADC_SAMPLENUM (ADC_AVGCTRL_SAMPLENUM_16)
+#define SYSHAL_BATT_BANDGAP_MV (1100) // Typical, the ADC linearity and bias are calibrated by the core at startup
+#else
+#define SYSHAL_BATT_ADC_SAMPLES (16)
+#define SYSHAL_BATT_ADC_REF_MV (3300)
+#define SYSHAL_BATT_ADC_MAX (1023)
+#endif
+
+#define SYSHAL_BATT_SLEEP_CURRENT_UA (50)        // Deep sleep floor: MCU, regulator and divider
+#define SYSHAL_BATT_REST_CURRENT_UA (10000)      // Below it the voltage is close to the open circuit voltage
+#define SYSHAL_BATT_VOLTAGE_WEIGHT_SHIFT (3)     // At rest the voltage corrects 1/8 of the coulomb counting error
+#define SYSHAL_BATT_UAMS_PER_MAH (3600000000ULL) // Counted charge unit: uA.ms
+
+// Typical supply currents [uA] of the energy model, rough figures to refine with measurements of the board
+static const uint32_t load_current_ua[SYSHAL_BATT_LOAD_NB] =
+    {
+        [SYSHAL_BATT_LOAD_MCU] = 6000,
+        [SYSHAL_BATT_LOAD_GPS] = 25000,
+        [SYSHAL_BATT_LOAD_SAT] = 40000,
+        [SYSHAL_BATT_LOAD_SCREEN] = 10000,
+        [SYSHAL_BATT_LOAD_BLE] = 500,
+};
+
+static syshal_batt_config_t config = {.battery = NULL};
+
+// Coulomb counting, the charge is integrated on every load change so that it follows deep sleep
+static uint32_t load_mask;
+static uint64_t load_time_ms;
+static uint64_t charge_uams;       // Drawn and not yet taken from soc_permille
+static int32_t soc_permille = -1;  // Unknown until the first measurement
+
 // Private functions
-// ...
+uint32_t syshal_batt_load_current_priv(void);
+void syshal_batt_count_charge_priv(void);
+int32_t syshal_batt_curve_permille_priv(uint32_t ocv_mv);
+#if defined(ARDUINO_ARCH_SAMD)
+uint16_t syshal_batt_adc_read_priv(uint32_t muxpos);
+#endif
+
+uint32_t syshal_batt_load_current_priv(void)
+{
+    uint32_t current_ua = SYSHAL_BATT_SLEEP_CURRENT_UA;
+
+    for (uint32_t load = 0; load < SYSHAL_BATT_LOAD_NB; load++)
+        if (load_mask & (1u << load))
+            current_ua += load_current_ua[load];
+
+    return current_ua;
+}
+
+void syshal_batt_count_charge_priv(void)
+{
+    uint64_t now = syshal_time_get_ticks_ms();
+
+    charge_uams += (now - load_time_ms) * syshal_batt_load_current_priv();
+    load_time_ms = now;
+}
+
+// State of charge [1/1000] of an open circuit voltage, linear between the points of the discharge curve
+int32_t syshal_batt_curve_permille_priv(uint32_t ocv_mv)
+{
+    // Packed and unaligned, not read through a pointer
+    const uint32_t first_mv = config.battery->contents.curve_mv[0];
+
+    if (ocv_mv >= first_mv)
+        return 1000;
+
+    uint32_t upper_mv = first_mv;
+    for (int32_t i = 1; i < SYS_CONFIG_BATTERY_CURVE_SIZE; i++)
+    {
+        uint32_t lower_mv = config.battery->contents.curve_mv[i];
+        if (ocv_mv > lower_mv)
+            return (SYS_CONFIG_BATTERY_CURVE_SIZE - 1 - i) * 100 + (int32_t)((ocv_mv - lower_mv) * 100 / (upper_mv - lower_mv));
+        upper_mv = lower_mv;
+    }
+
+    return 0;
+}
+
+#if defined(ARDUINO_ARCH_SAMD)
+// Sum of the conversions of an input against VDDANA (full scale of each one is 4095)
+uint16_t syshal_batt_adc_read_priv(uint32_t muxpos)
+{
+    // analogRead() sets up the input and enables the ADC on every call, restore the rest
+    uint8_t refctrl = ADC->REFCTRL.reg;
+    uint8_t avgctrl = ADC->AVGCTRL.reg;
+    uint16_t ctrlb = ADC->CTRLB.reg;
+
+    ADC->CTRLA.bit.ENABLE = 0;
+    while (ADC->STATUS.bit.SYNCBUSY)
+        ;
+
+    ADC->REFCTRL.reg = ADC_REFCTRL_REFSEL_INTVCC1; // VDDANA / 2, full scale is VDDANA with the 1/2 gain
+    ADC->AVGCTRL.reg = SYSHAL_BATT_ADC_SAMPLENUM | ADC_AVGCTRL_ADJRES(0);
+    ADC->INPUTCTRL.reg = ADC_INPUTCTRL_GAIN_DIV2 | ADC_INPUTCTRL_MUXNEG_GND | muxpos;
+    while (ADC->STATUS.bit.SYNCBUSY)
+        ;
+    ADC->CTRLB.reg = (ctrlb & ADC_CTRLB_PRESCALER_Msk) | ADC_CTRLB_RESSEL_16BIT;
+    while (ADC->STATUS.bit.SYNCBUSY)
+        ;
+    ADC->CTRLA.bit.ENABLE = 1;
+    while (ADC->STATUS.bit.SYNCBUSY)
+        ;
+
+    // The first conversion after a change of reference is discarded
+    uint16_t result = 0;
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        ADC->INTFLAG.reg = ADC_INTFLAG_RESRDY;
+        ADC->SWTRIG.bit.START = 1;
+        while (!(ADC->INTFLAG.reg & ADC_INTFLAG_RESRDY))
+            ;
+        result = ADC->RESULT.reg;
+    }
+
+    ADC->CTRLA.bit.ENABLE = 0;
+    while (ADC->STATUS.bit.SYNCBUSY)
+        ;
+
+    ADC->REFCTRL.reg = refctrl;
+    ADC->AVGCTRL.reg = avgctrl;
+    ADC->CTRLB.reg = ctrlb;
+    while (ADC->STATUS.bit.SYNCBUSY)
+        ;
+
+    return result;
+}
+#endif
 
 int syshal_batt_init(void)
 {
@@ -41,6 +178,11 @@ int syshal_batt_init(void)
     syshal_gpio_init(SYSHAL_BATT_GPIO_ADC_BATT, INPUT);
 #endif
 
+    load_mask = 1u << SYSHAL_BATT_LOAD_MCU;
+    load_time_ms = syshal_time_get_ticks_ms();
+    charge_uams = 0;
+    soc_permille = -1;
+
     return SYSHAL_BATT_NO_ERROR;
 }
 
@@ -49,28 +191,112 @@ int syshal_batt_term(void)
     return SYSHAL_BATT_NO_ERROR;
 }
 
-int syshal_batt_voltage(uint8_t *voltage)
+int syshal_batt_update_config(syshal_batt_config_t batt_config)
+{
+    DEBUG_PR_TRACE("Update configuration. %s()", __FUNCTION__);
+
+    config = batt_config;
+
+    // Start again from the voltage with the new curve
+    soc_permille = -1;
+
+    return SYSHAL_BATT_NO_ERROR;
+}
+
+void syshal_batt_set_load(syshal_batt_load_t load, bool on)
+{
+    syshal_batt_count_charge_priv();
+
+    if (on)
+        load_mask |= 1u << load;
+    else
+        load_mask &= ~(1u << load);
+}
+
+int syshal_batt_voltage_mv(uint16_t *voltage_mv)
 {
 #ifdef SYSHAL_BATT_GPIO_ADC_BATT
-    float measuredvbat = (float)(syshal_gpio_analog_read(SYSHAL_BATT_GPIO_ADC_BATT));
-    measuredvbat *= 2;    // we divided by 2, so multiply back
-    measuredvbat *= 3.3;  // Multiply by 3.3V, our reference voltage
-    measuredvbat /= 1024; // convert to voltage
-    *voltage = (uint8_t)(measuredvbat * 10.0);
+#if defined(ARDUINO_ARCH_SAMD)
+    // The pin is disconnected from the ADC in deep sleep
+    pinPeripheral(SYSHAL_BATT_GPIO_ADC_BATT, PIO_ANALOG);
+    uint32_t batt = syshal_batt_adc_read_priv(g_APinDescription[SYSHAL_BATT_GPIO_ADC_BATT].ulADCChannelNumber);
 
-    // DEBUG_PR_TRACE("Read battery voltage: %d", *voltage);
+    SYSCTRL->VREF.reg |= SYSCTRL_VREF_BGOUTEN;
+    uint32_t bandgap = syshal_batt_adc_read_priv(ADC_INPUTCTRL_MUXPOS_BANDGAP);
+    SYSCTRL->VREF.reg &= ~SYSCTRL_VREF_BGOUTEN;
+
+    if (!bandgap)
+        return SYSHAL_BATT_ERROR_DEVICE;
+
+    // Both against VDDANA, which cancels out
+    *voltage_mv = (uint16_t)((batt * SYSHAL_BATT_BANDGAP_MV * SYSHAL_BATT_DIVIDER + bandgap / 2) / bandgap);
+#else
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < SYSHAL_BATT_ADC_SAMPLES; i++)
+        sum += syshal_gpio_analog_read(SYSHAL_BATT_GPIO_ADC_BATT);
+
+    *voltage_mv = (uint16_t)(sum * SYSHAL_BATT_ADC_REF_MV * SYSHAL_BATT_DIVIDER / (SYSHAL_BATT_ADC_SAMPLES * SYSHAL_BATT_ADC_MAX));
+#endif
 #else
-    *voltage = 0;
+    *voltage_mv = 0;
 #endif
 
     return SYSHAL_BATT_NO_ERROR;
 }
 
+int syshal_batt_voltage(uint8_t *voltage)
+{
+    uint16_t voltage_mv;
+    int ret = syshal_batt_voltage_mv(&voltage_mv);
+    if (ret)
+        return ret;
+
+    *voltage = (uint8_t)((voltage_mv + 50) / 100);
+
+    // DEBUG_PR_TRACE("Read battery voltage: %d", *voltage);
+
+    return SYSHAL_BATT_NO_ERROR;
+}
+
 int syshal_batt_level(uint8_t *level)
 {
-    *level = 0; // Not implemented
+    if (config.battery == NULL || !config.battery->hdr.set)
+        return SYSHAL_BATT_ERROR_NOT_CONFIGURED;
+
+    uint16_t voltage_mv;
+    int ret = syshal_batt_voltage_mv(&voltage_mv);
+    if (ret)
+        return ret;
+
+    syshal_batt_count_charge_priv();
+    uint32_t current_ua = syshal_batt_load_current_priv();
+
+    // Add back the drop of the modelled load on the internal resistance, uA * mOhm = nV
+    uint32_t ocv_mv = voltage_mv + (uint32_t)((uint64_t)current_ua * config.battery->contents.internal_resistance_mohm / 1000000);
+    int32_t voltage_permille = syshal_batt_curve_permille_priv(ocv_mv);
+
+    uint64_t permille_uams = config.battery->contents.capacity_mah * (SYSHAL_BATT_UAMS_PER_MAH / 1000);
 
-    // DEBUG_PR_TRACE("Read battery level: %d", *level);
+    if (soc_permille < 0 || !permille_uams)
+    {
+        soc_permille = voltage_permille;
+        charge_uams = 0;
+    }
+    else
+    {
+        int32_t used_permille = (int32_t)(charge_uams / permille_uams);
+        charge_uams -= used_permille * permille_uams;
+        soc_permille = (used_permille < soc_permille) ? (soc_permille - used_permille) : 0;
+
+        // Under load the voltage is off by more than the internal resistance accounts for, only correct at rest
+        if (current_ua <= SYSHAL_BATT_REST_CURRENT_UA)
+            soc_permille += (voltage_permille - soc_permille) / (1 << SYSHAL_BATT_VOLTAGE_WEIGHT_SHIFT);
+    }
+
+    *level = (uint8_t)((soc_permille + 5) / 10);
+
+    DEBUG_PR_TRACE("Battery %u mV, %lu mV open circuit, %lu uA, %ld/1000 from voltage, %u %%. %s()", voltage_mv,
+                   ocv_mv, current_ua, voltage_permille, *level, __FUNCTION__);
 
     return SYSHAL_BATT_NO_ERROR;
-}
\ No newline at end of file
+}
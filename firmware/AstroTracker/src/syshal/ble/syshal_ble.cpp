@@ -25,7 +25,9 @@
 
 #include "../syshal_ble.h"
 #include "../syshal_rtc.h"
+#include "../syshal_batt.h"
 #include "../../core/debug/debug.h"
+#include "../../core/event/event.h"
 #include "../syshal_config.h"
 
 #if defined(NRF52_SERIES) && defined(WITH_BLE)
@@ -36,6 +38,11 @@ BLEUart bleuart; // uart over ble
 
 static syshal_ble_config_t config;
 
+#if defined(NRF52_SERIES) && defined(WITH_BLE)
+static uint16_t connection_handle = BLE_CONN_HANDLE_INVALID;
+static volatile uint8_t tx_credits = 0; // Free entries in the softdevice notification queue
+#endif
+
 #define SYSHAL_BLE_NAME "AstroTracker"
 #define SYSHAL_BLE_MANUFACTURER "Astrocast SA"
 
@@ -44,15 +51,20 @@ void syshal_ble_startAdv_priv(void);
 void syshal_ble_connect_callback_priv(uint16_t conn_handle);
 void syshal_ble_disconnect_callback_priv(uint16_t conn_handle, uint8_t reason);
 void syshal_ble_rx_callback_priv(uint16_t conn_handle);
+#if defined(NRF52_SERIES) && defined(WITH_BLE)
+void syshal_ble_event_callback_priv(ble_evt_t *evt);
+#endif
 
 int syshal_ble_init(void)
 {
 #if defined(NRF52_SERIES) && defined(WITH_BLE)
     // Initialize bletooth
     Bluefruit.autoConnLed(false);
-    Bluefruit.configPrphBandwidth(BANDWIDTH_NORMAL);
+    Bluefruit.configPrphConn(SYSHAL_BLE_MTU_MAX, SYSHAL_BLE_EVENT_LENGTH,
+                             SYSHAL_BLE_HVN_QUEUE_SIZE, BLE_GATTC_WRITE_CMD_TX_QUEUE_SIZE_DEFAULT);
     Bluefruit.begin();
     Bluefruit.setName(SYSHAL_BLE_NAME);
+    Bluefruit.setEventCallback(syshal_ble_event_callback_priv);
     Bluefruit.Periph.setConnectCallback(syshal_ble_connect_callback_priv);
     Bluefruit.Periph.setDisconnectCallback(syshal_ble_disconnect_callback_priv);
 
@@ -62,6 +74,8 @@ int syshal_ble_init(void)
 
     bleuart.begin();
     bleuart.setRxCallback(syshal_ble_rx_callback_priv);
+
+    syshal_batt_set_load(SYSHAL_BATT_LOAD_BLE, true); // Advertises until syshal_ble_term()
 #else
     DEBUG_PR_ERROR("No supported radio. %s()", __FUNCTION__);
 #endif
@@ -113,27 +127,28 @@ int syshal_ble_term(void)
     return SYSHAL_BLE_NO_ERROR;
 }
 
-int syshal_ble_send_message(uint8_t *buffer, size_t buffer_size)
+// Blocking, the message is split in as many notifications as needed
+int syshal_ble_send_message(const uint8_t *buffer, size_t buffer_size)
 {
 #if defined(NRF52_SERIES) && defined(WITH_BLE)
-    // BLE packets cannot be more than 20 bytes, need to be splitted
-    uint8_t buf_size = buffer_size;
-    uint8_t buf_idx = 0;
-    while (buf_size > 0)
+    uint16_t payload_size = syshal_ble_get_payload_size();
+    size_t buf_idx = 0;
+    while (buf_idx < buffer_size)
     {
-        if (buf_size < 20)
-        {
-            if (bleuart.write(&buffer[buf_idx], buf_size) != buf_size)
-                return SYSHAL_BLE_ERROR_LENGTH;
-            buf_size = 0;
-        }
-        else
-        {
-            if (bleuart.write(&buffer[buf_idx], 20) != 20)
-                return SYSHAL_BLE_ERROR_LENGTH;
-            buf_size -= 20;
-            buf_idx += 20;
-        }
+        size_t chunk_size = buffer_size - buf_idx;
+        if (chunk_size > payload_size)
+            chunk_size = payload_size;
+
+        // Waits for room in the notification queue if needed
+        if (bleuart.write(&buffer[buf_idx], chunk_size) != chunk_size)
+            return SYSHAL_BLE_ERROR_LENGTH;
+
+        taskENTER_CRITICAL();
+        if (tx_credits)
+            tx_credits--;
+        taskEXIT_CRITICAL();
+
+        buf_idx += chunk_size;
     }
 #else
     DEBUG_PR_ERROR("No supported radio. %s()", __FUNCTION__);
@@ -142,6 +157,82 @@ int syshal_ble_send_message(uint8_t *buffer, size_t buffer_size)
     return SYSHAL_BLE_NO_ERROR;
 }
 
+// Non blocking, sends a single notification of at most syshal_ble_get_payload_size() bytes
+// EVENT_BLE_TX_READY is posted when SYSHAL_BLE_ERROR_BUSY can be retried
+int syshal_ble_send_notification(const uint8_t *buffer, size_t buffer_size)
+{
+#if defined(NRF52_SERIES) && defined(WITH_BLE)
+    if (connection_handle == BLE_CONN_HANDLE_INVALID)
+        return SYSHAL_BLE_ERROR_DISCONNECTED;
+
+    if (buffer_size > syshal_ble_get_payload_size())
+        return SYSHAL_BLE_ERROR_LENGTH;
+
+    // Reserve a queue entry so that bleuart.write() does not block
+    taskENTER_CRITICAL();
+    bool reserved = tx_credits > 0;
+    if (reserved)
+        tx_credits--;
+    taskEXIT_CRITICAL();
+
+    if (!reserved)
+        return SYSHAL_BLE_ERROR_BUSY;
+
+    if (bleuart.write(buffer, buffer_size) != buffer_size)
+    {
+        taskENTER_CRITICAL();
+        tx_credits++;
+        taskEXIT_CRITICAL();
+        return SYSHAL_BLE_ERROR_FAIL;
+    }
+
+    return SYSHAL_BLE_NO_ERROR;
+#else
+    (void)buffer;
+    (void)buffer_size;
+    DEBUG_PR_ERROR("No supported radio. %s()", __FUNCTION__);
+    return SYSHAL_BLE_ERROR_NOT_DETECTED;
+#endif
+}
+
+// Notification payload of the current connection, grows once the MTU exchange completes
+uint16_t syshal_ble_get_payload_size(void)
+{
+#if defined(NRF52_SERIES) && defined(WITH_BLE)
+    BLEConnection *connection = Bluefruit.Connection(connection_handle);
+    if (connection != NULL)
+    {
+        uint16_t payload_size = connection->getMtu() - SYSHAL_BLE_ATT_HEADER_SIZE;
+        return payload_size < SYSHAL_BLE_PAYLOAD_MAX_SIZE ? payload_size : SYSHAL_BLE_PAYLOAD_MAX_SIZE;
+    }
+#endif
+
+    return SYSHAL_BLE_MTU_DEFAULT - SYSHAL_BLE_ATT_HEADER_SIZE;
+}
+
+int syshal_ble_set_link_mode(syshal_ble_link_mode_t mode)
+{
+#if defined(NRF52_SERIES) && defined(WITH_BLE)
+    BLEConnection *connection = Bluefruit.Connection(connection_handle);
+    if (connection == NULL)
+        return SYSHAL_BLE_ERROR_DISCONNECTED;
+
+    uint16_t interval = (mode == SYSHAL_BLE_LINK_THROUGHPUT) ? SYSHAL_BLE_CONN_INTERVAL_THROUGHPUT : SYSHAL_BLE_CONN_INTERVAL_LOW_POWER;
+
+    DEBUG_PR_TRACE("Request connection interval %u x 1.25 ms. %s()", interval, __FUNCTION__);
+
+    // The central has the final word on the interval
+    if (!connection->requestConnectionParameter(interval))
+        return SYSHAL_BLE_ERROR_FAIL;
+
+    return SYSHAL_BLE_NO_ERROR;
+#else
+    (void)mode;
+    DEBUG_PR_ERROR("No supported radio. %s()", __FUNCTION__);
+    return SYSHAL_BLE_ERROR_NOT_DETECTED;
+#endif
+}
+
 void syshal_ble_rx_callback_priv(uint16_t conn_handle)
 {
     (void)conn_handle;
@@ -162,6 +253,8 @@ void syshal_ble_rx_callback_priv(uint16_t conn_handle)
     event.id = SYSHAL_BLE_EVENT_COMMAND_RECEIVED;
 
     syshal_ble_callback(&event);
+
+    event_post(EVENT_BLE_RX);
 }
 
 void syshal_ble_startAdv_priv(void)
@@ -200,6 +293,14 @@ void syshal_ble_connect_callback_priv(uint16_t conn_handle)
     connection->getPeerName(central_name, sizeof(central_name));
 
     DEBUG_PR_TRACE("Connected to %s. %s()", central_name, __FUNCTION__);
+
+    connection_handle = conn_handle;
+    tx_credits = SYSHAL_BLE_HVN_QUEUE_SIZE;
+
+    // Larger notifications and faster PHY, only used by the central if it supports them
+    connection->requestPHY();
+    connection->requestDataLengthUpdate();
+    connection->requestMtuExchange(SYSHAL_BLE_MTU_MAX);
 #else
     DEBUG_PR_ERROR("No supported radio. %s()", __FUNCTION__);
 #endif
@@ -217,7 +318,8 @@ void syshal_ble_disconnect_callback_priv(uint16_t conn_handle, uint8_t reason)
     DEBUG_PR_TRACE("Disconnected, reason = 0x%x. %s()", reason, __FUNCTION__);
 
 #if defined(NRF52_SERIES) && defined(WITH_BLE)
-    // Empty
+    connection_handle = BLE_CONN_HANDLE_INVALID;
+    tx_credits = 0;
 #else
     DEBUG_PR_ERROR("No supported radio. %s()", __FUNCTION__);
 #endif
@@ -227,6 +329,21 @@ void syshal_ble_disconnect_callback_priv(uint16_t conn_handle, uint8_t reason)
     syshal_ble_callback(&event);
 }
 
+#if defined(NRF52_SERIES) && defined(WITH_BLE)
+void syshal_ble_event_callback_priv(ble_evt_t *evt)
+{
+    if (evt->header.evt_id != BLE_GATTS_EVT_HVN_TX_COMPLETE)
+        return;
+
+    taskENTER_CRITICAL();
+    uint16_t credits = tx_credits + evt->evt.gatts_evt.params.hvn_tx_complete.count;
+    tx_credits = credits < SYSHAL_BLE_HVN_QUEUE_SIZE ? credits : SYSHAL_BLE_HVN_QUEUE_SIZE;
+    taskEXIT_CRITICAL();
+
+    event_post(EVENT_BLE_TX_READY);
+}
+#endif
+
 __attribute__((weak)) void syshal_ble_callback(syshal_ble_event_t *event)
 {
     DEBUG_PR_WARN("%s Not implemented", __FUNCTION__);
@@ -23,8 +23,14 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  ******************************************************************************************/
 
+#include <string.h>
 #include "../syshal_flash.h"
 #include "../syshal_config.h"
+#include "../../core/debug/debug.h"
+
+#if defined(NRF52_SERIES)
+#include "flash/flash_nrf5x.h"
+#endif
 
 // #include <Adafruit_FlashTransport.h>
 // Adafruit_FlashTransport_QSPI flashTransport;
@@ -40,5 +46,91 @@ int syshal_flash_init(void)
 
 int syshal_flash_term(void)
 {
+    return SYSHAL_FLASH_NO_ERROR;
+}
+
+// Reserved in the program flash, erased rows read as 0xFF once written (same approach as FlashStorage)
+__attribute__((__aligned__(SYSHAL_FLASH_CONFIG_SLOT_SIZE))) static const uint8_t config_area[SYSHAL_FLASH_CONFIG_SLOT_NB * SYSHAL_FLASH_CONFIG_SLOT_SIZE] = {};
+// Accessed through a volatile pointer so that the compiler does not fold the reads to the zero initializer
+static const uint8_t *const volatile config_area_ptr = config_area;
+
+#if defined(ARDUINO_ARCH_SAMD)
+#define SYSHAL_FLASH_PAGE_SIZE (64)
+#define SYSHAL_FLASH_ROW_SIZE (4 * SYSHAL_FLASH_PAGE_SIZE)
+
+static_assert(SYSHAL_FLASH_CONFIG_SLOT_SIZE % SYSHAL_FLASH_ROW_SIZE == 0, "A config slot must be made of whole rows");
+
+static void syshal_flash_wait_ready_priv(void)
+{
+    while (!NVMCTRL->INTFLAG.bit.READY)
+        ;
+}
+#endif
+
+int syshal_flash_config_read(uint8_t slot, void *data, size_t size)
+{
+    if (slot >= SYSHAL_FLASH_CONFIG_SLOT_NB || size > SYSHAL_FLASH_CONFIG_SLOT_SIZE)
+        return SYSHAL_FLASH_ERROR_INVALID_PARAM;
+
+    // Internal flash is memory mapped
+    memcpy(data, config_area_ptr + slot * SYSHAL_FLASH_CONFIG_SLOT_SIZE, size);
+
+    return SYSHAL_FLASH_NO_ERROR;
+}
+
+// Erase the slot then program it, data is padded with 0xFF to the write unit
+int syshal_flash_config_write(uint8_t slot, const void *data, size_t size)
+{
+    if (slot >= SYSHAL_FLASH_CONFIG_SLOT_NB || size > SYSHAL_FLASH_CONFIG_SLOT_SIZE)
+        return SYSHAL_FLASH_ERROR_INVALID_PARAM;
+
+    uint32_t address = (uint32_t)(config_area_ptr + slot * SYSHAL_FLASH_CONFIG_SLOT_SIZE);
+
+#if defined(NRF52_SERIES)
+    if (!flash_nrf5x_erase(address))
+        return SYSHAL_FLASH_ERROR_DEVICE;
+    if (flash_nrf5x_write(address, data, size) != size)
+        return SYSHAL_FLASH_ERROR_DEVICE;
+    flash_nrf5x_flush();
+#elif defined(ARDUINO_ARCH_SAMD)
+    const uint8_t *src = (const uint8_t *)data;
+
+    NVMCTRL->CTRLB.bit.MANW = 1;
+
+    // Program page by page through the page buffer, 32 bits accesses only
+    for (size_t offset = 0; offset < size; offset += SYSHAL_FLASH_PAGE_SIZE)
+    {
+        // Erase each row before its first page
+        if (offset % SYSHAL_FLASH_ROW_SIZE == 0)
+        {
+            NVMCTRL->ADDR.reg = (address + offset) / 2; // 16 bits word address
+            NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_ER;
+            syshal_flash_wait_ready_priv();
+        }
+
+        NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_PBC;
+        syshal_flash_wait_ready_priv();
+
+        volatile uint32_t *dst = (volatile uint32_t *)(address + offset);
+        for (size_t i = 0; i < SYSHAL_FLASH_PAGE_SIZE; i += sizeof(uint32_t))
+        {
+            uint32_t word = 0xFFFFFFFF;
+            size_t remaining = (offset + i < size) ? (size - offset - i) : 0;
+            memcpy(&word, &src[offset + i], (remaining < sizeof(uint32_t)) ? remaining : sizeof(uint32_t));
+            *dst++ = word;
+        }
+
+        NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_WP;
+        syshal_flash_wait_ready_priv();
+    }
+#else
+    DEBUG_PR_ERROR("No supported internal flash. %s()", __FUNCTION__);
+    return SYSHAL_FLASH_ERROR_DEVICE;
+#endif
+
+    // Check what has been programmed
+    if (memcmp((const void *)address, data, size))
+        return SYSHAL_FLASH_ERROR_DEVICE;
+
     return SYSHAL_FLASH_NO_ERROR;
 }
\ No newline at end of file
@@ -23,10 +23,16 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  ******************************************************************************************/
 
+// The receiver is polled every few seconds while on, its traces would flood the debug output
+#define DEBUG_MODULE_LEVEL DEBUG_INFO
+
 #include "../syshal_gpio.h"
 #include "../syshal_gps.h"
 #include "../syshal_time.h"
+#include "../syshal_batt.h"
 #include "../../core/debug/debug.h"
+#include "../../core/event/event.h"
+#include "../../core/profiler/profiler.h"
 #include "SparkFun_u-blox_GNSS_Arduino_Library.h"
 #include "../syshal_config.h"
 
@@ -41,6 +47,11 @@ static volatile bool new_data_pending = false;
 #ifdef GPIO_GPS_EXT_INT
 #define SYSHAL_GPS_GPIO_INT (GPIO_GPS_EXT_INT)
 #endif
+#if defined(GPIO_GPS_EXT_INT) && defined(GPS_TX_READY_PIO)
+#define SYSHAL_GPS_TX_READY_PIO (GPS_TX_READY_PIO)
+#define SYSHAL_GPS_TX_READY_THRESHOLD (1) // Pin asserted as soon as 8 bytes are pending
+#define SYSHAL_GPS_TX_READY_INTERFACE (0) // I2C
+#endif
 
 #define GPS_NO_FIX 0
 #define GPS_DEAD_RECK_ONLY 1
@@ -54,13 +65,17 @@ static volatile bool new_data_pending = false;
 #define SYSHAL_GPS_DELAY_RESTART_MS 400
 
 // Private functions
-// ...
-/*
-static void syshal_gps_int1_pin_interrupt_priv(const syshal_gpio_event_t *event)
+#ifdef SYSHAL_GPS_TX_READY_PIO
+// Both edges, the falling one once the data is read is ignored
+static void syshal_gps_int1_pin_interrupt_priv(void)
 {
+    if (!syshal_gpio_get_input(SYSHAL_GPS_GPIO_INT))
+        return;
+
     new_data_pending = true;
+    event_post(EVENT_GPS_TX_READY);
 }
-*/
+#endif
 
 int syshal_gps_init(void)
 {
@@ -72,7 +87,9 @@ int syshal_gps_init(void)
 #ifdef SYSHAL_GPS_GPIO_INT
     syshal_gpio_init(SYSHAL_GPS_GPIO_INT, INPUT_PULLDOWN);
 #endif
-    // syshal_gpio_enable_interrupt(SYSHAL_GPS_GPIO_INT, syshal_gps_int1_pin_interrupt_priv);
+#ifdef SYSHAL_GPS_TX_READY_PIO
+    syshal_gpio_enable_interrupt(SYSHAL_GPS_GPIO_INT, syshal_gps_int1_pin_interrupt_priv, CHANGE);
+#endif
 
     // Try establish connection
     syshal_gps_wake_up();
@@ -110,6 +127,16 @@ int syhsal_gps_update_config(syshal_gps_config_t gps_config)
         DEBUG_PR_TRACE("Message on I2C port only. %s()", __FUNCTION__);
         myGNSS.setI2COutput(COM_TYPE_UBX); // Set the I2C port to output UBX only (turn off NMEA noise)
 
+#ifdef SYSHAL_GPS_TX_READY_PIO
+        // Raise the interrupt pin when data is waiting on I2C, no need to poll the receiver
+        DEBUG_PR_TRACE("Activate TX ready on PIO %d. %s()", SYSHAL_GPS_TX_READY_PIO, __FUNCTION__);
+        myGNSS.setVal8(UBLOX_CFG_TXREADY_ENABLED, 1);
+        myGNSS.setVal8(UBLOX_CFG_TXREADY_POLARITY, 0);
+        myGNSS.setVal8(UBLOX_CFG_TXREADY_PIN, SYSHAL_GPS_TX_READY_PIO);
+        myGNSS.setVal16(UBLOX_CFG_TXREADY_THRESHOLD, SYSHAL_GPS_TX_READY_THRESHOLD);
+        myGNSS.setVal8(UBLOX_CFG_TXREADY_INTERFACE, SYSHAL_GPS_TX_READY_INTERFACE);
+#endif
+
         // Set constellations to track
         DEBUG_PR_TRACE("Activate/Deactivate GNSS. %s()", __FUNCTION__);
         myGNSS.enableGNSS(config.gps->contents.with_gps, SFE_UBLOX_GNSS_ID_GPS);
@@ -151,6 +178,7 @@ int syshal_gps_shutdown(void)
     DEBUG_PR_TRACE("Shutdown. %s()", __FUNCTION__);
 
     state = SYSHAL_GPS_STATE_ASLEEP;
+    syshal_batt_set_load(SYSHAL_BATT_LOAD_GPS, false);
 
     syshal_gps_event_t event;
     event.id = SYSHAL_GPS_EVENT_POWERED_OFF;
@@ -170,6 +198,7 @@ int syshal_gps_wake_up(void)
     syshal_time_delay_ms(SYSHAL_GPS_DELAY_RESTART_MS);
 
     state = SYSHAL_GPS_STATE_ACQUIRING;
+    syshal_batt_set_load(SYSHAL_BATT_LOAD_GPS, true);
 
     syshal_gps_event_t event;
     event.id = SYSHAL_GPS_EVENT_POWERED_ON;
@@ -180,6 +209,8 @@ int syshal_gps_wake_up(void)
 
 int syshal_gps_tick(void)
 {
+    PROFILER_ZONE(PROFILER_ZONE_GPS_TICK);
+
     if (state == SYSHAL_GPS_STATE_UNINIT)
         return SYSHAL_GPS_ERROR_INVALID_STATE;
     if (state == SYSHAL_GPS_STATE_ASLEEP)
@@ -266,6 +297,26 @@ syshal_gps_state_t syshal_gps_get_state(void)
     return state;
 }
 
+// True when new data raises EVENT_GPS_TX_READY, otherwise the receiver has to be polled
+bool syshal_gps_has_tx_ready(void)
+{
+#ifdef SYSHAL_GPS_TX_READY_PIO
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Data already waiting when the pin rose before the interrupt was armed, or left unread, raises no edge
+bool syshal_gps_tx_ready_asserted(void)
+{
+#ifdef SYSHAL_GPS_TX_READY_PIO
+    return (state != SYSHAL_GPS_STATE_ASLEEP) && syshal_gpio_get_input(SYSHAL_GPS_GPIO_INT);
+#else
+    return false;
+#endif
+}
+
 __attribute__((weak)) void syshal_gps_callback(syshal_gps_event_t *event)
 {
     DEBUG_PR_WARN("%s Not implemented", __FUNCTION__);
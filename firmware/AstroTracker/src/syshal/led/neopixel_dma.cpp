@@ -0,0 +1,273 @@
+/******************************************************************************************
+ * File:        neopixel_dma.cpp
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#include "neopixel_dma.h"
+#include "../syshal_config.h"
+
+#if defined(ARDUINO_ARCH_SAMD) && defined(NEOPIXEL_DMA_SERCOM)
+#include "wiring_private.h"
+
+#ifndef NEOPIXEL_DMA_CHANNEL
+#define NEOPIXEL_DMA_CHANNEL (0)
+#endif
+
+// NEOPIXEL_DMA_SERCOM is the bare SERCOM number, the registers and ids are named after it
+#define NEOPIXEL_DMA_CAT_PRIV(a, b, c) a##b##c
+#define NEOPIXEL_DMA_XCAT_PRIV(a, b, c) NEOPIXEL_DMA_CAT_PRIV(a, b, c)
+#define NEOPIXEL_DMA_SERCOM_REG (NEOPIXEL_DMA_XCAT_PRIV(SERCOM, NEOPIXEL_DMA_SERCOM, ))
+#define NEOPIXEL_DMA_SERCOM_GCLK_ID (NEOPIXEL_DMA_XCAT_PRIV(GCLK_CLKCTRL_ID_SERCOM, NEOPIXEL_DMA_SERCOM, _CORE))
+#define NEOPIXEL_DMA_SERCOM_APBC (NEOPIXEL_DMA_XCAT_PRIV(PM_APBCMASK_SERCOM, NEOPIXEL_DMA_SERCOM, ))
+#define NEOPIXEL_DMA_SERCOM_TRIG (NEOPIXEL_DMA_XCAT_PRIV(SERCOM, NEOPIXEL_DMA_SERCOM, _DMAC_ID_TX))
+
+// 2.4 MHz from the 48 MHz GCLK0: BAUD = 48 MHz / (2 * 2.4 MHz) - 1
+// A NeoPixel bit is 3 SPI bits of 417 ns: 100 for a 0 (T0H 417 ns), 110 for a 1 (T1H 833 ns)
+#define NEOPIXEL_DMA_SPI_BAUD (9)
+#define NEOPIXEL_DMA_SPI_RESET_SIZE (NEOPIXEL_DMA_RESET_US * 3 / 10) // Low bytes of 3.33 us latching the pixels
+
+static uint8_t spi_buffer[NEOPIXEL_DMA_MAX_SIZE * 3 + NEOPIXEL_DMA_SPI_RESET_SIZE];
+static DmacDescriptor dma_descriptor[NEOPIXEL_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+static DmacDescriptor dma_writeback[NEOPIXEL_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+
+#elif defined(NRF52_SERIES)
+
+// 16 MHz PWM clock, the polarity bit starts each 1.25 us period high for the compare value
+#define NEOPIXEL_DMA_PWM_COUNTERTOP (20)
+#define NEOPIXEL_DMA_PWM_T0H (6 | 0x8000)  // 0.375 us
+#define NEOPIXEL_DMA_PWM_T1H (13 | 0x8000) // 0.8125 us
+#define NEOPIXEL_DMA_PWM_LOW (0 | 0x8000)
+#define NEOPIXEL_DMA_PWM_RESET_SIZE (NEOPIXEL_DMA_RESET_US * 4 / 5) // Low periods latching the pixels
+
+static NRF_PWM_Type *pwm = NULL;
+static bool pwm_running = false;
+static uint16_t pwm_pattern[NEOPIXEL_DMA_MAX_SIZE * 8 + NEOPIXEL_DMA_PWM_RESET_SIZE];
+
+#endif
+
+int neopixel_dma_init(uint32_t pin)
+{
+#if defined(ARDUINO_ARCH_SAMD) && defined(NEOPIXEL_DMA_SERCOM)
+    Sercom *sercom = NEOPIXEL_DMA_SERCOM_REG;
+
+    // The descriptors of an already running DMAC belong to someone else
+    if (DMAC->CTRL.bit.DMAENABLE && DMAC->BASEADDR.reg != (uint32_t)dma_descriptor)
+        return NEOPIXEL_DMA_ERROR_DEVICE;
+
+    // SPI master, transmit only, MSB first
+    PM->APBCMASK.reg |= NEOPIXEL_DMA_SERCOM_APBC;
+    GCLK->CLKCTRL.reg = NEOPIXEL_DMA_SERCOM_GCLK_ID | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_CLKEN;
+    while (GCLK->STATUS.bit.SYNCBUSY)
+        ;
+
+    sercom->SPI.CTRLA.bit.SWRST = 1;
+    while (sercom->SPI.CTRLA.bit.SWRST || sercom->SPI.SYNCBUSY.bit.SWRST)
+        ;
+    sercom->SPI.CTRLA.reg = SERCOM_SPI_CTRLA_MODE_SPI_MASTER | SERCOM_SPI_CTRLA_DOPO(NEOPIXEL_DMA_SERCOM_DOPO);
+    sercom->SPI.CTRLB.reg = 0;
+    sercom->SPI.BAUD.reg = NEOPIXEL_DMA_SPI_BAUD;
+    sercom->SPI.CTRLA.bit.ENABLE = 1;
+    while (sercom->SPI.SYNCBUSY.bit.ENABLE)
+        ;
+
+    pinPeripheral(pin, NEOPIXEL_DMA_PIN_PERIPH);
+
+    // One channel moving a byte to the SERCOM each time its data register is empty
+    PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+    PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+    if (!DMAC->CTRL.bit.DMAENABLE)
+    {
+        DMAC->CTRL.reg = DMAC_CTRL_SWRST;
+        while (DMAC->CTRL.reg & DMAC_CTRL_SWRST)
+            ;
+        DMAC->BASEADDR.reg = (uint32_t)dma_descriptor;
+        DMAC->WRBADDR.reg = (uint32_t)dma_writeback;
+        DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF);
+    }
+
+    DMAC->CHID.reg = DMAC_CHID_ID(NEOPIXEL_DMA_CHANNEL);
+    DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+    while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_SWRST)
+        ;
+    DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) | DMAC_CHCTRLB_TRIGSRC(NEOPIXEL_DMA_SERCOM_TRIG) |
+                        DMAC_CHCTRLB_TRIGACT_BEAT;
+
+    DmacDescriptor *descriptor = &dma_descriptor[NEOPIXEL_DMA_CHANNEL];
+    descriptor->BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC |
+                             DMAC_BTCTRL_BLOCKACT_NOACT;
+    descriptor->DSTADDR.reg = (uint32_t)&sercom->SPI.DATA.reg;
+    descriptor->DESCADDR.reg = 0;
+
+    memset(spi_buffer, 0, sizeof(spi_buffer));
+
+    return NEOPIXEL_DMA_NO_ERROR;
+#elif defined(NRF52_SERIES)
+    NRF_PWM_Type *instances[] = {NRF_PWM0, NRF_PWM1, NRF_PWM2};
+
+    // Take a PWM that nobody drives, keeping its output selected reserves it
+    for (unsigned int i = 0; i < sizeof(instances) / sizeof(instances[0]) && pwm == NULL; i++)
+    {
+        if ((instances[i]->ENABLE == 0) &&
+            (instances[i]->PSEL.OUT[0] & PWM_PSEL_OUT_CONNECT_Msk) &&
+            (instances[i]->PSEL.OUT[1] & PWM_PSEL_OUT_CONNECT_Msk) &&
+            (instances[i]->PSEL.OUT[2] & PWM_PSEL_OUT_CONNECT_Msk) &&
+            (instances[i]->PSEL.OUT[3] & PWM_PSEL_OUT_CONNECT_Msk))
+            pwm = instances[i];
+    }
+
+    if (pwm == NULL)
+        return NEOPIXEL_DMA_ERROR_DEVICE;
+
+    // The line is a GPIO while the PWM is disabled
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+
+    pwm->MODE = (PWM_MODE_UPDOWN_Up << PWM_MODE_UPDOWN_Pos);
+    pwm->PRESCALER = (PWM_PRESCALER_PRESCALER_DIV_1 << PWM_PRESCALER_PRESCALER_Pos);
+    pwm->COUNTERTOP = (NEOPIXEL_DMA_PWM_COUNTERTOP << PWM_COUNTERTOP_COUNTERTOP_Pos);
+    pwm->LOOP = (PWM_LOOP_CNT_Disabled << PWM_LOOP_CNT_Pos);
+    pwm->DECODER = (PWM_DECODER_LOAD_Common << PWM_DECODER_LOAD_Pos) |
+                   (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+    pwm->SEQ[0].PTR = (uint32_t)pwm_pattern << PWM_SEQ_PTR_PTR_Pos;
+    pwm->SEQ[0].REFRESH = 0;
+    pwm->SEQ[0].ENDDELAY = 0;
+    pwm->SHORTS = PWM_SHORTS_SEQEND0_STOP_Msk; // Stops by itself, the output stays low
+#if defined(ARDUINO_ARCH_NRF52840)
+    pwm->PSEL.OUT[0] = g_APinDescription[pin].name;
+#else
+    pwm->PSEL.OUT[0] = g_ADigitalPinMap[pin];
+#endif
+
+    for (size_t i = 0; i < sizeof(pwm_pattern) / sizeof(pwm_pattern[0]); i++)
+        pwm_pattern[i] = NEOPIXEL_DMA_PWM_LOW;
+
+    return NEOPIXEL_DMA_NO_ERROR;
+#else
+    return NEOPIXEL_DMA_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+int neopixel_dma_term(void)
+{
+    while (neopixel_dma_busy())
+        ;
+
+#if defined(ARDUINO_ARCH_SAMD) && defined(NEOPIXEL_DMA_SERCOM)
+    NEOPIXEL_DMA_SERCOM_REG->SPI.CTRLA.bit.ENABLE = 0;
+    while (NEOPIXEL_DMA_SERCOM_REG->SPI.SYNCBUSY.bit.ENABLE)
+        ;
+#elif defined(NRF52_SERIES)
+    if (pwm)
+    {
+        pwm->PSEL.OUT[0] = 0xFFFFFFFFUL;
+        pwm = NULL;
+    }
+#endif
+
+    return NEOPIXEL_DMA_NO_ERROR;
+}
+
+// Encodes the pixels in wire order (GRB) and starts the transfer, a transfer in progress is waited for first
+int neopixel_dma_show(const uint8_t *pixels, size_t size)
+{
+    if (pixels == NULL || size > NEOPIXEL_DMA_MAX_SIZE)
+        return NEOPIXEL_DMA_ERROR_INVALID_PARAM;
+
+#if defined(ARDUINO_ARCH_SAMD) && defined(NEOPIXEL_DMA_SERCOM)
+    while (neopixel_dma_busy())
+        ;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        uint32_t bits = 0;
+        for (uint8_t mask = 0x80; mask; mask >>= 1)
+            bits = (bits << 3) | ((pixels[i] & mask) ? 0x6 : 0x4);
+
+        spi_buffer[3 * i] = bits >> 16;
+        spi_buffer[3 * i + 1] = bits >> 8;
+        spi_buffer[3 * i + 2] = bits;
+    }
+
+    // Followed by low bytes, those after NEOPIXEL_DMA_MAX_SIZE are never written
+    memset(&spi_buffer[3 * size], 0, 3 * (NEOPIXEL_DMA_MAX_SIZE - size));
+    size_t length = 3 * size + NEOPIXEL_DMA_SPI_RESET_SIZE;
+
+    DmacDescriptor *descriptor = &dma_descriptor[NEOPIXEL_DMA_CHANNEL];
+    descriptor->BTCNT.reg = length;
+    descriptor->SRCADDR.reg = (uint32_t)spi_buffer + length; // End address of an incremented source
+
+    DMAC->CHID.reg = DMAC_CHID_ID(NEOPIXEL_DMA_CHANNEL);
+    DMAC->CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+
+    return NEOPIXEL_DMA_NO_ERROR;
+#elif defined(NRF52_SERIES)
+    if (pwm == NULL)
+        return NEOPIXEL_DMA_ERROR_DEVICE;
+
+    while (neopixel_dma_busy())
+        ;
+
+    size_t pos = 0;
+    for (size_t i = 0; i < size; i++)
+        for (uint8_t mask = 0x80; mask; mask >>= 1)
+            pwm_pattern[pos++] = (pixels[i] & mask) ? NEOPIXEL_DMA_PWM_T1H : NEOPIXEL_DMA_PWM_T0H;
+
+    // Followed by low periods, those after NEOPIXEL_DMA_MAX_SIZE are never written
+    for (size_t i = pos; i < NEOPIXEL_DMA_MAX_SIZE * 8; i++)
+        pwm_pattern[i] = NEOPIXEL_DMA_PWM_LOW;
+    pwm->SEQ[0].CNT = (pos + NEOPIXEL_DMA_PWM_RESET_SIZE) << PWM_SEQ_CNT_CNT_Pos;
+
+    pwm->ENABLE = 1;
+    pwm->EVENTS_STOPPED = 0;
+    pwm->TASKS_SEQSTART[0] = 1;
+    pwm_running = true;
+
+    return NEOPIXEL_DMA_NO_ERROR;
+#else
+    return NEOPIXEL_DMA_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+bool neopixel_dma_busy(void)
+{
+#if defined(ARDUINO_ARCH_SAMD) && defined(NEOPIXEL_DMA_SERCOM)
+    // The channel disables itself at the end of the block, only reset bytes may still be shifted out
+    DMAC->CHID.reg = DMAC_CHID_ID(NEOPIXEL_DMA_CHANNEL);
+    return DMAC->CHCTRLA.bit.ENABLE;
+#elif defined(NRF52_SERIES)
+    if (!pwm_running)
+        return false;
+
+    if (!pwm->EVENTS_STOPPED)
+        return true;
+
+    // Disabled until the next show(), the pin goes back to the GPIO driving it low
+    pwm->EVENTS_STOPPED = 0;
+    pwm->ENABLE = 0;
+    pwm_running = false;
+    return false;
+#else
+    return false;
+#endif
+}
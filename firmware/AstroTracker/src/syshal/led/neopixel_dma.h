@@ -0,0 +1,53 @@
+/******************************************************************************************
+ * File:        neopixel_dma.h
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#ifndef _NEOPIXEL_DMA_H_
+#define _NEOPIXEL_DMA_H_
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// NeoPixel (WS2812B, 800 kHz) output timed by a peripheral and fed by DMA, so that the interrupts are not disabled
+// and the CPU does not wait during the transfer:
+//   SAMD21: MOSI of a SERCOM in SPI mode at 2.4 MHz, 3 SPI bits per NeoPixel bit, see NEOPIXEL_DMA_SERCOM
+//   nRF52:  a free PWM instance at 16 MHz, one 16 bit compare value per NeoPixel bit
+
+#define NEOPIXEL_DMA_NO_ERROR (0)
+#define NEOPIXEL_DMA_ERROR_INVALID_PARAM (-1)
+#define NEOPIXEL_DMA_ERROR_NOT_SUPPORTED (-2)
+#define NEOPIXEL_DMA_ERROR_DEVICE (-3)
+
+#define NEOPIXEL_DMA_MAX_SIZE (3) // Bytes per show(), one GRB pixel
+#define NEOPIXEL_DMA_RESET_US (300)
+
+int neopixel_dma_init(uint32_t pin);
+int neopixel_dma_term(void);
+int neopixel_dma_show(const uint8_t *pixels, size_t size);
+bool neopixel_dma_busy(void);
+
+#endif /* _NEOPIXEL_DMA_H_ */
@@ -31,7 +31,9 @@
 
 #ifdef GPIO_LED_NEOPIXEL
 #include "Adafruit_NeoPixel.h"
+#include "neopixel_dma.h"
 Adafruit_NeoPixel neopixel;
+static bool neopixel_dma_ready = false; // Else the pixels are bit-banged with the interrupts disabled
 #endif
 
 #define SYSHAL_LED_GPIO_LED (GPIO_LED)
@@ -39,10 +41,27 @@ Adafruit_NeoPixel neopixel;
 #define NEOPIXEL_NB_LED 1
 #define NEOPIXEL_TYPE NEO_GRB + NEO_KHZ800
 #define NEOPIXEL_BRIGHTNESS 50
+#define NEOPIXEL_BYTES_PER_LED 3
 
 #define SYSHAL_LED_ON (1)
 #define SYSHAL_LED_OFF (0)
 
+// Blinking GPIO_LED is played by a timer driving the pin, it goes on in deep sleep without syshal_led_tick()
+#if defined(ARDUINO_ARCH_SAMD) && defined(LED_TIMER_TCC)
+#include "wiring_private.h"
+#define SYSHAL_LED_TIMER
+#define SYSHAL_LED_TIMER_HZ (512)     // 32768 Hz GCLK1 / 64, keeps running in standby
+#define SYSHAL_LED_TIMER_MAX (0xFFFF) // TCC2 is 16 bit
+#elif defined(NRF52_SERIES)
+#define SYSHAL_LED_TIMER
+#define SYSHAL_LED_TIMER_PWM_TOP (1250)     // 10 ms periods of the 125 kHz PWM clock
+#define SYSHAL_LED_TIMER_PWM_ON (SYSHAL_LED_TIMER_PWM_TOP | 0x8000) // The polarity bit starts the period high
+#define SYSHAL_LED_TIMER_PWM_OFF (0 | 0x8000)
+#define SYSHAL_LED_TIMER_MAX (0xFFFFFF)     // Periods a value is repeated for
+static NRF_PWM_Type *led_pwm = NULL;
+static uint16_t led_pwm_sequence[2];
+#endif
+
 #define UINT32_COLOUR_TO_UINT8_RED(x) ((x >> 16) & 0xFF)
 #define UINT32_COLOUR_TO_UINT8_GREEN(x) ((x >> 8) & 0xFF)
 #define UINT32_COLOUR_TO_UINT8_BLUE(x) (x & 0xFF)
@@ -57,8 +76,153 @@ static enum {
 static volatile uint32_t current_colour = SYSHAL_LED_COLOUR_OFF;
 static volatile uint8_t last_state;
 static syshal_led_sequence_t current_sequence;
-static uint32_t start_blink_time_ms;
+static uint64_t start_blink_time_ms;
 static uint32_t blink_period_ms;
+static bool timer_running = false;
+
+// Private functions
+static bool timer_blink_start(uint32_t time_ms);
+static void timer_stop(void);
+
+#ifdef SYSHAL_LED_TIMER
+// On for time_ms and off for time_ms, repeated until timer_stop()
+static bool timer_blink_start(uint32_t time_ms)
+{
+#if defined(ARDUINO_ARCH_SAMD)
+    uint32_t half_period = time_ms * SYSHAL_LED_TIMER_HZ / 1000;
+    if (!half_period || 2 * half_period > SYSHAL_LED_TIMER_MAX + 1)
+        return false;
+
+    Tcc *tcc = LED_TIMER_TCC;
+
+    PM->APBCMASK.reg |= LED_TIMER_TCC_APBC;
+    GCLK->CLKCTRL.reg = LED_TIMER_TCC_GCLK_ID | GCLK_CLKCTRL_GEN_GCLK1 | GCLK_CLKCTRL_CLKEN;
+    while (GCLK->STATUS.bit.SYNCBUSY)
+        ;
+
+    tcc->CTRLA.bit.ENABLE = 0;
+    while (tcc->SYNCBUSY.bit.ENABLE)
+        ;
+    tcc->CTRLA.reg = TCC_CTRLA_SWRST;
+    while (tcc->SYNCBUSY.bit.SWRST)
+        ;
+
+    // Normal PWM: the output is set at the start of the period and cleared at the CC match
+    tcc->CTRLA.reg = TCC_CTRLA_PRESCALER_DIV64 | TCC_CTRLA_RUNSTDBY;
+#ifdef LED_INVERTED
+    tcc->WAVE.reg = TCC_WAVE_WAVEGEN_NPWM | (TCC_WAVE_POL0 << LED_TIMER_TCC_WO);
+#else
+    tcc->WAVE.reg = TCC_WAVE_WAVEGEN_NPWM;
+#endif
+    tcc->PER.reg = 2 * half_period - 1;
+    tcc->CC[LED_TIMER_TCC_WO].reg = half_period;
+    while (tcc->SYNCBUSY.reg)
+        ;
+
+    pinPeripheral(SYSHAL_LED_GPIO_LED, LED_TIMER_PIN_PERIPH);
+
+    tcc->CTRLA.bit.ENABLE = 1;
+    while (tcc->SYNCBUSY.bit.ENABLE)
+        ;
+#elif defined(NRF52_SERIES)
+    uint32_t refresh = time_ms / 10;
+    if (!refresh || refresh > SYSHAL_LED_TIMER_MAX)
+        return false;
+
+    // Take a PWM that nobody drives, as the NeoPixel does
+    if (led_pwm == NULL)
+    {
+        NRF_PWM_Type *instances[] = {NRF_PWM0, NRF_PWM1, NRF_PWM2};
+        for (unsigned int i = 0; i < sizeof(instances) / sizeof(instances[0]) && led_pwm == NULL; i++)
+        {
+            if ((instances[i]->ENABLE == 0) &&
+                (instances[i]->PSEL.OUT[0] & PWM_PSEL_OUT_CONNECT_Msk) &&
+                (instances[i]->PSEL.OUT[1] & PWM_PSEL_OUT_CONNECT_Msk) &&
+                (instances[i]->PSEL.OUT[2] & PWM_PSEL_OUT_CONNECT_Msk) &&
+                (instances[i]->PSEL.OUT[3] & PWM_PSEL_OUT_CONNECT_Msk))
+                led_pwm = instances[i];
+        }
+
+        if (led_pwm == NULL)
+            return false;
+    }
+
+#ifdef LED_INVERTED
+    led_pwm_sequence[0] = SYSHAL_LED_TIMER_PWM_OFF;
+    led_pwm_sequence[1] = SYSHAL_LED_TIMER_PWM_ON;
+#else
+    led_pwm_sequence[0] = SYSHAL_LED_TIMER_PWM_ON;
+    led_pwm_sequence[1] = SYSHAL_LED_TIMER_PWM_OFF;
+#endif
+
+    // Each value is held refresh periods, both sequences are the same and restart each other
+    led_pwm->MODE = (PWM_MODE_UPDOWN_Up << PWM_MODE_UPDOWN_Pos);
+    led_pwm->PRESCALER = (PWM_PRESCALER_PRESCALER_DIV_128 << PWM_PRESCALER_PRESCALER_Pos);
+    led_pwm->COUNTERTOP = (SYSHAL_LED_TIMER_PWM_TOP << PWM_COUNTERTOP_COUNTERTOP_Pos);
+    led_pwm->DECODER = (PWM_DECODER_LOAD_Common << PWM_DECODER_LOAD_Pos) |
+                       (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+    for (int i = 0; i < 2; i++)
+    {
+        led_pwm->SEQ[i].PTR = (uint32_t)led_pwm_sequence << PWM_SEQ_PTR_PTR_Pos;
+        led_pwm->SEQ[i].CNT = 2 << PWM_SEQ_CNT_CNT_Pos;
+        led_pwm->SEQ[i].REFRESH = refresh - 1;
+        led_pwm->SEQ[i].ENDDELAY = 0;
+    }
+    led_pwm->LOOP = (1 << PWM_LOOP_CNT_Pos);
+    led_pwm->SHORTS = PWM_SHORTS_LOOPSDONE_SEQSTART0_Msk;
+    led_pwm->PSEL.OUT[0] = g_ADigitalPinMap[SYSHAL_LED_GPIO_LED];
+    led_pwm->ENABLE = 1;
+    led_pwm->TASKS_SEQSTART[0] = 1;
+#endif
+
+    timer_running = true;
+    return true;
+}
+
+static void timer_stop(void)
+{
+    if (!timer_running)
+        return;
+
+#if defined(ARDUINO_ARCH_SAMD)
+    LED_TIMER_TCC->CTRLA.bit.ENABLE = 0;
+    while (LED_TIMER_TCC->SYNCBUSY.bit.ENABLE)
+        ;
+#elif defined(NRF52_SERIES)
+    led_pwm->SHORTS = 0;
+    led_pwm->EVENTS_STOPPED = 0;
+    led_pwm->TASKS_STOP = 1;
+    while (!led_pwm->EVENTS_STOPPED)
+        ;
+    led_pwm->ENABLE = 0;
+    led_pwm->PSEL.OUT[0] = 0xFFFFFFFFUL;
+#endif
+
+    // Back to a GPIO, set_colour() drives it again
+    syshal_gpio_init(SYSHAL_LED_GPIO_LED, OUTPUT);
+    timer_running = false;
+}
+#else
+static bool timer_blink_start(uint32_t time_ms)
+{
+    return false;
+}
+
+static void timer_stop(void)
+{
+}
+#endif
+
+#ifdef GPIO_LED_NEOPIXEL
+static void neopixel_show(void)
+{
+    // The pixel buffer is already in wire order with the brightness applied
+    if (neopixel_dma_ready)
+        neopixel_dma_show(neopixel.getPixels(), neopixel.numPixels() * NEOPIXEL_BYTES_PER_LED);
+    else
+        neopixel.show();
+}
+#endif
 
 void set_colour(uint32_t colour)
 {
@@ -66,7 +230,7 @@ void set_colour(uint32_t colour)
     neopixel.fill(neopixel.Color(UINT32_COLOUR_TO_UINT8_RED(colour),
                                  UINT32_COLOUR_TO_UINT8_GREEN(colour),
                                  UINT32_COLOUR_TO_UINT8_BLUE(colour)));
-    neopixel.show();
+    neopixel_show();
 #endif
 
     if (colour == SYSHAL_LED_COLOUR_OFF)
@@ -95,7 +259,10 @@ int syshal_led_init(void)
     neopixel.updateLength(NEOPIXEL_NB_LED);
     neopixel.updateType(NEOPIXEL_TYPE);
     neopixel.setBrightness(NEOPIXEL_BRIGHTNESS);
-    neopixel.show();
+    neopixel_dma_ready = !neopixel_dma_init(GPIO_LED_NEOPIXEL);
+    if (!neopixel_dma_ready)
+        DEBUG_PR_WARN("NeoPixel DMA not available, bit-banging it. %s()", __FUNCTION__);
+    neopixel_show();
 #endif
 
     syshal_gpio_init(SYSHAL_LED_GPIO_LED, OUTPUT);
@@ -105,6 +272,7 @@ int syshal_led_init(void)
 
 int syshal_led_set_solid(uint32_t colour)
 {
+    timer_stop();
     current_colour = colour;
     current_type = SOLID;
     set_colour(colour);
@@ -120,7 +288,9 @@ int syshal_led_set_blinking(uint32_t colour, uint32_t time_ms)
 
     blink_period_ms = time_ms;
     start_blink_time_ms = syshal_time_get_ticks_ms();
+    timer_stop();
     set_colour(colour);
+    timer_blink_start(time_ms);
 
     return SYSHAL_LED_NO_ERROR;
 }
@@ -144,6 +314,7 @@ int syshal_led_set_sequence(syshal_led_sequence_t sequence, uint32_t time_ms)
     switch (sequence)
     {
     case RED_GREEN_BLUE:
+        timer_stop();
         current_type = SEQUENCE;
         current_sequence = RED_GREEN_BLUE;
         current_colour = SYSHAL_LED_COLOUR_RED;
@@ -164,21 +335,46 @@ int syshal_led_set_sequence(syshal_led_sequence_t sequence, uint32_t time_ms)
 
 int syshal_led_off(void)
 {
+    timer_stop();
     current_type = OFF;
     set_colour(SYSHAL_LED_COLOUR_OFF);
 
     return SYSHAL_LED_NO_ERROR;
 }
 
+// The LED data line stops in deep sleep, a NeoPixel update must be sent first
+void syshal_led_flush(void)
+{
+#ifdef GPIO_LED_NEOPIXEL
+    if (neopixel_dma_ready)
+        while (neopixel_dma_busy())
+            ;
+#endif
+}
+
 bool syshal_led_is_active(void)
 {
     return (current_type != OFF);
 }
 
-void syshal_led_tick(void)
+// True while the LED changes only when syshal_led_tick() is called, it must not be left in deep sleep then
+bool syshal_led_needs_tick(void)
 {
     if (current_type == OFF ||
         current_type == SOLID)
+        return false;
+
+#ifdef GPIO_LED_NEOPIXEL
+    return true; // The colour is sent by the CPU
+#else
+    // A plain LED shows every colour of a sequence the same
+    return current_type == BLINK && !timer_running;
+#endif
+}
+
+void syshal_led_tick(void)
+{
+    if (!syshal_led_needs_tick())
         return;
 
     if (syshal_time_get_ticks_ms() - start_blink_time_ms >= blink_period_ms)
@@ -28,7 +28,10 @@
 #include "../syshal_gpio.h"
 #include "../syshal_time.h"
 #include "../syshal_sat.h"
+#include "../syshal_led.h"
+#include "../syshal_batt.h"
 #include "../../core/debug/debug.h"
+#include "../../core/event/event.h"
 #include "../syshal_config.h"
 #include <Wire.h>
 
@@ -86,6 +89,10 @@ void syshal_pmu_sleep(syshal_pmu_sleep_mode_t mode)
     {
     case SLEEP_DEEP:
     {
+        // The debug UART stops in deep sleep, send the buffered records first
+        debug_flush();
+        syshal_led_flush();
+
         // We don't want our soft watchdog to run in deep sleep so disable
         ret = syshal_rtc_soft_watchdog_running(&soft_wdt_running);
         if (ret)
@@ -97,6 +104,8 @@ void syshal_pmu_sleep(syshal_pmu_sleep_mode_t mode)
         }
 
         // Go to sleep
+        syshal_batt_set_load(SYSHAL_BATT_LOAD_MCU, false);
+
 #if defined(NRF52_SERIES)
         Wire.end();
         UART_ANS.end();
@@ -107,7 +116,7 @@ void syshal_pmu_sleep(syshal_pmu_sleep_mode_t mode)
         nrf_gpio_cfg_default(g_ADigitalPinMap[GPIO_ANS_EXT_INT]);
 
 
-        suspendLoop();
+        event_wait();
 
         UART_ANS.begin(SYSHAL_SAT_BAUDRATE);
         Wire.begin();
@@ -133,8 +142,9 @@ void syshal_pmu_sleep(syshal_pmu_sleep_mode_t mode)
         // mode.
         SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
         SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
-        __DSB();
-        __WFI();
+
+        // Events posted since the caller checked, during the flushes, cancel the sleep
+        event_wait();
 
         // Enable systick interrupt
         SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
@@ -143,6 +153,8 @@ void syshal_pmu_sleep(syshal_pmu_sleep_mode_t mode)
         USBDevice.attach();
 #endif
 
+        syshal_batt_set_load(SYSHAL_BATT_LOAD_MCU, true);
+
         // Enable back software watchdog
         syshal_rtc_soft_watchdog_enable();
         break;
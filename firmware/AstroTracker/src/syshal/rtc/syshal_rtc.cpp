@@ -25,6 +25,7 @@
 
 #include "../syshal_rtc.h"
 #include "../../core/debug/debug.h"
+#include "../../core/event/event.h"
 #include "../syshal_config.h"
 
 // All watchdog functions are implemented based on https://github.com/adafruit/Adafruit_SleepyDog
@@ -34,14 +35,20 @@
 #include <nrf_soc.h>
 #include "nrf_wdt.h"
 #define NRF_RTCZ NRF_RTC2
-#define NRF_RTC_OVERFLOW_SEC 0x1FFFFF
 #endif
 
+// The counter runs undivided from the 32.768 kHz crystal, overflows are counted in the ISR to extend it to 64 bits
+#define RTC_TIME_KEEPING_FREQUENCY_HZ (SYSHAL_RTC_TICKS_PER_SECOND)
+
 #if defined(NRF52_SERIES)
-#define RTC_TIME_KEEPING_FREQUENCY_HZ (8) // 8 Hz, this is the lowest speed available
+#define RTC_COUNTER_BITS (24)
+#define RTC_ALARM_MAX_TICKS (NRF_RTC_COUNTER_MAX >> 1) // Compare register is as wide as the counter
 #elif defined(ARDUINO_ARCH_SAMD)
-#define RTC_TIME_KEEPING_FREQUENCY_HZ (32) // 32 Hz, this is the lowest speed available
+#define RTC_COUNTER_BITS (32)
+#define RTC_ALARM_MAX_TICKS (0x7FFFFFFF)
+#define RTC_COUNT_ADDR (0x10) // Offset of the COUNT register for the continuous read synchronization
 #endif
+#define RTC_ALARM_MIN_TICKS (2) // A compare at the current count is already missed
 
 static bool soft_watchdog_init;
 
@@ -52,26 +59,61 @@ static volatile voidFuncPtr _g_RTC_callBack = NULL;     // RTC interrupt user ha
 static volatile bool _g_f_playing_possum = false;       // flag set by ISR to release spin loop
 bool _initialized = false;
 
-static uint32_t timestamp_offset = 0;
+static volatile uint32_t rtc_overflow_count = 0; // Upper bits of the 64 bits tick counter
+
+// Drift compensation
+#define SYSHAL_RTC_DRIFT_DEFAULT_PPB (100000)    // Crystal tolerance over temperature before any estimate
+#define SYSHAL_RTC_DRIFT_FLOOR_PPB (2000)        // Residual error of the estimate (aging, temperature)
+#define SYSHAL_RTC_DRIFT_MAX_PPB (500000)        // Larger measured errors are treated as bad references
+#define SYSHAL_RTC_DRIFT_MIN_INTERVAL_S (86400)  // Each second of reference accuracy is still 12 ppm over a day
+#define SYSHAL_RTC_DRIFT_MAX_INTERVAL_S (604800) // The baseline restarts weekly to follow aging and temperature
+
+static uint32_t ref_timestamp = 0;      // Reference time at ref_ticks
+static uint64_t ref_ticks = 0;          // RTC counter at ref_timestamp
+static uint32_t ref_uncertainty_s = 0;  // Accuracy of the last reference
+static bool ref_disciplined = false;    // Reference comes from a time source (not a hard set)
+static uint32_t drift_ref_timestamp = 0; // Start of the current drift measurement
+static uint64_t drift_ref_ticks = 0;
+static uint32_t drift_ref_uncertainty_s = 0;
+static bool drift_estimated = false;
+static uint32_t drift_estimate_uncertainty_ppb = 0; // Of the last accepted measurement
+static int32_t drift_ppb = 0;                       // Positive when the RTC runs fast, 0 while not significant
+static uint32_t drift_uncertainty_ppb = SYSHAL_RTC_DRIFT_DEFAULT_PPB;
 
 void (*functionPointer)(void);
 
 #if defined(NRF52_SERIES)
 void RTC2_IRQHandler(void)
 {
-    nrf_rtc_event_clear(NRF_RTCZ, NRF_RTC_EVENT_COMPARE_0);
+    if (nrf_rtc_event_check(NRF_RTCZ, NRF_RTC_EVENT_OVERFLOW))
+    {
+        nrf_rtc_event_clear(NRF_RTCZ, NRF_RTC_EVENT_OVERFLOW);
+        rtc_overflow_count++;
+    }
+
+    if (nrf_rtc_event_check(NRF_RTCZ, NRF_RTC_EVENT_COMPARE_0))
+    {
+        nrf_rtc_event_clear(NRF_RTCZ, NRF_RTC_EVENT_COMPARE_0);
 
-    resumeLoop();
+        event_post(EVENT_RTC_ALARM);
 
-    if (functionPointer)
-        functionPointer();
+        if (functionPointer)
+            functionPointer();
+    }
 }
 #endif
 
 #if defined(ARDUINO_ARCH_SAMD)
 void RTC_Handler(void)
 {
-    RTC->MODE0.INTFLAG.reg = RTC_MODE0_INTFLAG_MASK; // clear all interrupt sources
+    uint8_t flags = RTC->MODE0.INTFLAG.reg;
+    RTC->MODE0.INTFLAG.reg = flags; // clear the serviced interrupt sources
+
+    if (flags & RTC_MODE0_INTFLAG_OVF)
+        rtc_overflow_count++;
+
+    if (!(flags & RTC_MODE0_INTFLAG_CMP0))
+        return;
 
     if (_g_RTC_interrupt_interval != 0)
     {
@@ -97,6 +139,8 @@ void RTC_Handler(void)
     }
 
     _g_f_playing_possum = false; // release fake sleep from spin loop
+
+    event_post(EVENT_RTC_ALARM);
 }
 
 void _initialize_wdt()
@@ -128,7 +172,10 @@ void _initialize_wdt()
 
 int syshal_rtc_init(void)
 {
-    timestamp_offset = 0;
+    ref_timestamp = 0;
+    ref_ticks = 0;
+    ref_disciplined = false;
+    rtc_overflow_count = 0;
 
 #if defined(NRF52_SERIES)
     nrf_rtc_int_enable(NRF_RTCZ, NRF_RTC_INT_OVERFLOW_MASK);
@@ -157,13 +204,20 @@ int syshal_rtc_init(void)
         ;
 
     // reset configuration is mode=0, no clear on match
-    RTC->MODE0.CTRL.reg = RTC_MODE0_CTRL_PRESCALER_DIV1024 | RTC_MODE0_CTRL_ENABLE;
+    RTC->MODE0.CTRL.reg = RTC_MODE0_CTRL_PRESCALER_DIV1 | RTC_MODE0_CTRL_ENABLE;
+
+    // keep COUNT synchronized so that it can be read without waiting
+    RTC->MODE0.READREQ.reg = RTC_READREQ_RREQ | RTC_READREQ_RCONT | RTC_READREQ_ADDR(RTC_COUNT_ADDR);
+
+    RTC->MODE0.INTENSET.reg = RTC_MODE0_INTENSET_OVF;
 
     NVIC_EnableIRQ(RTC_IRQn);
     NVIC_SetPriority(RTC_IRQn, 0x00);
 
     // reset to zero in case of warm start
     RTC->MODE0.COUNT.reg = 0;
+    while (RTC->MODE0.STATUS.bit.SYNCBUSY)
+        ;
 #endif
 
     return SYSHAL_RTC_NO_ERROR;
@@ -190,44 +244,160 @@ int syshal_rtc_stash_time(void)
 }
 */
 
+// Monotonic tick count since init, keeps running in sleep
+uint64_t syshal_rtc_return_ticks(void)
+{
+#if defined(NRF52_SERIES) || defined(ARDUINO_ARCH_SAMD)
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t overflows = rtc_overflow_count;
+#if defined(NRF52_SERIES)
+    uint32_t count = nrf_rtc_counter_get(NRF_RTCZ);
+    bool overflow_pending = nrf_rtc_event_check(NRF_RTCZ, NRF_RTC_EVENT_OVERFLOW);
+#else
+    uint32_t count = RTC->MODE0.COUNT.reg;
+    bool overflow_pending = RTC->MODE0.INTFLAG.bit.OVF;
+#endif
+
+    // The counter wrapped but the ISR did not run yet (interrupts masked)
+    if (overflow_pending && !(count >> (RTC_COUNTER_BITS - 1)))
+        overflows++;
+
+    __set_PRIMASK(primask);
+
+    return ((uint64_t)overflows << RTC_COUNTER_BITS) | count;
+#else
+    return 0;
+#endif
+}
+
+// Hard set of the time, the time is not considered as disciplined anymore
 int syshal_rtc_set_timestamp(uint32_t timestamp)
 {
-    uint32_t uptime;
-    syshal_rtc_get_uptime(&uptime);
-    timestamp_offset = timestamp - uptime;
+    ref_ticks = syshal_rtc_return_ticks();
+    ref_timestamp = timestamp;
+    ref_disciplined = false;
+    drift_ref_timestamp = 0;
+
+    return SYSHAL_RTC_NO_ERROR;
+}
+
+// Set the time from a reference source and update the RTC frequency error estimate
+int syshal_rtc_discipline(uint32_t timestamp, uint32_t accuracy_s)
+{
+    uint64_t ticks = syshal_rtc_return_ticks();
+
+    // The baseline runs from the first reference until SYSHAL_RTC_DRIFT_MAX_INTERVAL_S, each longer one measures
+    // the drift more finely. A measurement replaces the estimate only when it is more certain
+    if (drift_ref_timestamp != 0 &&
+        timestamp > drift_ref_timestamp &&
+        (timestamp - drift_ref_timestamp) >= SYSHAL_RTC_DRIFT_MIN_INTERVAL_S)
+    {
+        uint32_t true_elapsed_s = timestamp - drift_ref_timestamp;
+        int64_t rtc_elapsed_ms = (int64_t)(ticks - drift_ref_ticks) * 1000 / RTC_TIME_KEEPING_FREQUENCY_HZ;
+        int64_t measured_ppb = (rtc_elapsed_ms - (int64_t)true_elapsed_s * 1000) * 1000000 / true_elapsed_s;
+
+        // Both references and the tick quantization bound the measurement error
+        uint64_t error_ms = (uint64_t)(accuracy_s + drift_ref_uncertainty_s) * 1000 + 1;
+        uint32_t measured_uncertainty_ppb = (uint32_t)(error_ms * 1000000 / true_elapsed_s) + SYSHAL_RTC_DRIFT_FLOOR_PPB;
+
+        if (measured_ppb > -SYSHAL_RTC_DRIFT_MAX_PPB && measured_ppb < SYSHAL_RTC_DRIFT_MAX_PPB)
+        {
+            if (!drift_estimated ||
+                measured_uncertainty_ppb <= drift_estimate_uncertainty_ppb ||
+                true_elapsed_s >= SYSHAL_RTC_DRIFT_MAX_INTERVAL_S)
+            {
+                uint32_t magnitude_ppb = (uint32_t)(measured_ppb < 0 ? -measured_ppb : measured_ppb);
+
+                // A correction within its own uncertainty would add noise, the error is then only bounded
+                if (magnitude_ppb > measured_uncertainty_ppb)
+                {
+                    drift_ppb = (int32_t)measured_ppb;
+                    drift_uncertainty_ppb = measured_uncertainty_ppb;
+                }
+                else
+                {
+                    drift_ppb = 0;
+                    drift_uncertainty_ppb = magnitude_ppb + measured_uncertainty_ppb;
+                }
+
+                drift_estimated = true;
+                drift_estimate_uncertainty_ppb = measured_uncertainty_ppb;
+
+                DEBUG_PR_TRACE("RTC drift %d ppb measured over %d s, %d ppb applied (+/- %d ppb). %s()",
+                               (int32_t)measured_ppb, true_elapsed_s, drift_ppb, drift_uncertainty_ppb, __FUNCTION__);
+            }
+
+            if (true_elapsed_s >= SYSHAL_RTC_DRIFT_MAX_INTERVAL_S)
+                drift_ref_timestamp = 0;
+        }
+        else
+        {
+            DEBUG_PR_WARN("RTC drift %d ppb out of range, reference ignored. %s()", (int32_t)measured_ppb, __FUNCTION__);
+            drift_ref_timestamp = 0;
+        }
+    }
+
+    if (drift_ref_timestamp == 0)
+    {
+        drift_ref_timestamp = timestamp;
+        drift_ref_ticks = ticks;
+        drift_ref_uncertainty_s = accuracy_s;
+    }
+
+    ref_ticks = ticks;
+    ref_timestamp = timestamp;
+    ref_uncertainty_s = accuracy_s;
+    ref_disciplined = true;
+
+    return SYSHAL_RTC_NO_ERROR;
+}
+
+// Worst case error of the time when the RTC will read timestamp
+int syshal_rtc_get_uncertainty(uint32_t timestamp, uint32_t *uncertainty_s)
+{
+    if (!ref_disciplined)
+    {
+        *uncertainty_s = UINT32_MAX;
+        return SYSHAL_RTC_ERROR_NOT_DISCIPLINED;
+    }
+
+    uint32_t elapsed_s = (timestamp > ref_timestamp) ? (timestamp - ref_timestamp) : 0;
+    *uncertainty_s = ref_uncertainty_s + 1 +
+                     (uint32_t)(((uint64_t)elapsed_s * drift_uncertainty_ppb + 999999999) / 1000000000);
+
+    return SYSHAL_RTC_NO_ERROR;
+}
+
+int syshal_rtc_get_drift(int32_t *drift)
+{
+    *drift = drift_ppb;
+
+    if (!drift_estimated)
+        return SYSHAL_RTC_ERROR_NOT_DISCIPLINED;
 
     return SYSHAL_RTC_NO_ERROR;
 }
 
 uint32_t syshal_rtc_return_timestamp(void)
 {
-    uint32_t uptime;
-    syshal_rtc_get_uptime(&uptime);
-    return uptime + timestamp_offset;
+    // Elapsed RTC time since the reference, corrected by the estimated frequency error
+    int64_t elapsed_ticks = (int64_t)(syshal_rtc_return_ticks() - ref_ticks);
+    elapsed_ticks -= elapsed_ticks * drift_ppb / 1000000000;
+    return ref_timestamp + (uint32_t)(elapsed_ticks / RTC_TIME_KEEPING_FREQUENCY_HZ);
 }
 
 int syshal_rtc_get_timestamp(uint32_t *timestamp)
 {
-    uint32_t uptime;
-    syshal_rtc_get_uptime(&uptime);
-    *timestamp = uptime + timestamp_offset;
+    *timestamp = syshal_rtc_return_timestamp();
 
     return SYSHAL_RTC_NO_ERROR;
 }
 
 int syshal_rtc_get_uptime(uint32_t *uptime)
 {
-#if defined(NRF52_SERIES)
-    *uptime = nrf_rtc_counter_get(NRF_RTCZ) >> 0x3;
-    if (nrf_rtc_event_check(NRF_RTCZ, NRF_RTC_EVENT_OVERFLOW))
-    {
-        nrf_rtc_event_clear(NRF_RTCZ, NRF_RTC_EVENT_OVERFLOW);
-        *uptime += NRF_RTC_OVERFLOW_SEC;
-    }
-#elif defined(ARDUINO_ARCH_SAMD)
-    *uptime = ((RTC->MODE0.COUNT.reg) >> 5);
-    // TODO: Implement check for overflow
-#endif
+    *uptime = (uint32_t)(syshal_rtc_return_ticks() / RTC_TIME_KEEPING_FREQUENCY_HZ);
 
     return SYSHAL_RTC_NO_ERROR;
 }
@@ -241,21 +411,27 @@ uint32_t syshal_rtc_return_uptime(void)
 
 int syshal_rtc_set_alarm(uint32_t timestamp, const voidFuncPtr callback)
 {
-    uint32_t timeout = timestamp - syshal_rtc_return_timestamp();
-    uint32_t uptime;
-    syshal_rtc_get_uptime(&uptime);
-    uint32_t delay_s = timeout + uptime;
+    int32_t timeout = (int32_t)(timestamp - syshal_rtc_return_timestamp()); // Negative when overdue
+
+    // Convert to RTC ticks, the RTC runs drift_ppb faster than real time
+    int64_t timeout_ticks = (int64_t)timeout * RTC_TIME_KEEPING_FREQUENCY_HZ;
+    timeout_ticks += timeout_ticks * drift_ppb / 1000000000;
+    if (timeout_ticks < RTC_ALARM_MIN_TICKS)
+        timeout_ticks = RTC_ALARM_MIN_TICKS; // Overdue, fire as soon as possible
+    if (timeout_ticks > RTC_ALARM_MAX_TICKS)
+        timeout_ticks = RTC_ALARM_MAX_TICKS; // Early wake up, the caller sets the alarm again
+    uint32_t compare_ticks = (uint32_t)(syshal_rtc_return_ticks() + timeout_ticks);
 
 #if defined(NRF52_SERIES)
     functionPointer = callback;
-    nrf_rtc_cc_set(NRF_RTCZ, 0, delay_s * RTC_TIME_KEEPING_FREQUENCY_HZ);
+    nrf_rtc_cc_set(NRF_RTCZ, 0, compare_ticks & NRF_RTC_COUNTER_MAX);
 #elif defined(ARDUINO_ARCH_SAMD)
     syshal_rtc_disable_alarm();
     _g_RTC_callBack = callback;
 
-    // clear any pending interrupts, set compare register and enable interrupt
-    RTC->MODE0.INTFLAG.reg = RTC_MODE0_INTFLAG_MASK;
-    RTC->MODE0.COMP[0].reg = delay_s << 5; // delay_s * RTC_TIME_KEEPING_FREQUENCY_HZ
+    // clear any pending compare interrupt, set compare register and enable interrupt
+    RTC->MODE0.INTFLAG.reg = RTC_MODE0_INTFLAG_CMP0;
+    RTC->MODE0.COMP[0].reg = compare_ticks;
     RTC->MODE0.INTENSET.bit.CMP0 = 1;
 #endif
 
@@ -268,7 +444,7 @@ int syshal_rtc_disable_alarm(void)
     DEBUG_PR_TRACE("%s NOT IMPLEMENTED", __FUNCTION__);
 #elif defined(ARDUINO_ARCH_SAMD)
     _g_RTC_interrupt_interval = 0;
-    RTC->MODE0.INTENCLR.reg = RTC_MODE0_INTENCLR_MASK;
+    RTC->MODE0.INTENCLR.reg = RTC_MODE0_INTENCLR_CMP0; // the overflow interrupt keeps the tick count
 #endif
 
     return SYSHAL_RTC_NO_ERROR;
@@ -23,8 +23,12 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  ******************************************************************************************/
 
+// The request and answer dumps of the module protocol are not built, errors and warnings are
+#define DEBUG_MODULE_LEVEL DEBUG_INFO
+
 #include "astronode.h"
 #include "../../core/debug/debug.h"
+#include "../../core/profiler/profiler.h"
 
 ans_status_e ASTRONODE::begin(Stream &serialPort)
 {
@@ -948,6 +952,8 @@ ans_status_e ASTRONODE::encode_send_request(uint8_t reg,
                                             uint8_t *param,
                                             uint8_t param_length)
 {
+  PROFILER_ZONE(PROFILER_ZONE_SAT_REQUEST);
+
   ans_status_e ret_val;
 
   // Compute CRC
@@ -1000,6 +1006,8 @@ ans_status_e ASTRONODE::receive_decode_answer(uint8_t *reg,
                                               uint8_t *param,
                                               uint8_t param_length)
 {
+  PROFILER_ZONE(PROFILER_ZONE_SAT_ANSWER);
+
   ans_status_e ret_val;
 
   // Read answer
@@ -23,11 +23,17 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  ******************************************************************************************/
 
+// Traced on every satellite job and event pin, sm_main traces the events that matter
+#define DEBUG_MODULE_LEVEL DEBUG_INFO
+
 #include "../syshal_sat.h"
 #include "../syshal_gpio.h"
 #include "../syshal_time.h"
+#include "../syshal_batt.h"
 #include "../syshal_rtc.h"
 #include "../../core/debug/debug.h"
+#include "../../core/event/event.h"
+#include "../../core/profiler/profiler.h"
 #include "../syshal_config.h"
 
 ASTRONODE astronode;
@@ -54,7 +60,6 @@ static volatile bool new_event_pending = false;
 void syshal_sat_reset_priv(void);
 int syshal_sat_clear_all_messages_priv(void);
 int syshal_sat_clear_performance_counter_priv(void);
-int syshal_sat_get_time_priv(uint32_t *time);
 int syshal_sat_read_event_priv(syshal_sat_event_id_t *event);
 int syshal_sat_save_perf_counters_priv(void);
 int syshal_sat_clear_reset_priv(void);
@@ -65,10 +70,7 @@ int syshal_sat_read_message_ack_priv(uint16_t *buffer_id);
 static void syshal_sat_int_pin_event_priv(void)
 {
     new_event_pending = true;
-
-#if defined(NRF52_SERIES)
-    resumeLoop();
-#endif
+    event_post(EVENT_SAT_PIN);
 }
 
 int syshal_sat_init(void)
@@ -185,6 +187,7 @@ int syshal_sat_shutdown(void)
     DEBUG_PR_TRACE("Shutdown. %s()", __FUNCTION__);
 
     state = SYSHAL_SAT_STATE_ASLEEP;
+    syshal_batt_set_load(SYSHAL_BATT_LOAD_SAT, false);
 
     syshal_sat_event_t event;
     event.id = SYSHAL_SAT_EVENT_POWERED_OFF;
@@ -207,6 +210,7 @@ int syshal_sat_wake_up(void)
     syshal_time_delay_ms(SYSHAL_SAT_RESTART_TIME_MS);
 
     state = SYSHAL_SAT_STATE_ACTIVE;
+    syshal_batt_set_load(SYSHAL_BATT_LOAD_SAT, true);
 
     syshal_sat_event_t event;
     event.id = SYSHAL_SAT_EVENT_POWERED_ON;
@@ -331,7 +335,7 @@ int syshal_sat_clear_reset_priv(void)
     return SYSHAL_SAT_NO_ERROR;
 }
 
-int syshal_sat_get_time_priv(uint32_t *time)
+int syshal_sat_get_time(uint32_t *time)
 {
     if (state == SYSHAL_SAT_STATE_ASLEEP)
         return SYSHAL_SAT_ERROR_INVALID_STATE;
@@ -464,6 +468,8 @@ syshal_sat_state_t syshal_sat_get_state(void)
 
 int syshal_sat_tick(void)
 {
+    PROFILER_ZONE(PROFILER_ZONE_SAT_TICK);
+
     if (state == SYSHAL_SAT_STATE_UNINIT)
         return SYSHAL_SAT_ERROR_INVALID_STATE;
 
@@ -0,0 +1,131 @@
+/******************************************************************************************
+ * File:        pcd8544_frame.cpp
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#include "pcd8544_frame.h"
+
+#ifdef WITH_SCREEN
+
+static_assert(PCD8544_FRAME_BANK_NB <= 8, "Dirty banks are tracked in a uint8_t");
+
+#define PCD8544_FRAME_ALL_BANKS ((uint8_t)((1 << PCD8544_FRAME_BANK_NB) - 1))
+
+PCD8544_FRAME::PCD8544_FRAME() : Adafruit_GFX(LCDWIDTH, LCDHEIGHT)
+{
+  memset(buffer, 0, sizeof(buffer));
+  invalidate();
+}
+
+void PCD8544_FRAME::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+  if ((x < 0) || (y < 0) || (x >= _width) || (y >= _height))
+    return;
+
+  int16_t t;
+  switch (rotation)
+  {
+  case 1:
+    t = x;
+    x = WIDTH - 1 - y;
+    y = t;
+    break;
+  case 2:
+    x = WIDTH - 1 - x;
+    y = HEIGHT - 1 - y;
+    break;
+  case 3:
+    t = x;
+    x = y;
+    y = HEIGHT - 1 - t;
+    break;
+  }
+
+  uint8_t bank = y / PCD8544_FRAME_BANK_HEIGHT;
+  uint8_t mask = 1 << (y % PCD8544_FRAME_BANK_HEIGHT);
+  uint8_t old_value = buffer[bank][x];
+
+  if (color)
+    buffer[bank][x] |= mask;
+  else
+    buffer[bank][x] &= ~mask;
+
+  if (buffer[bank][x] != old_value)
+    dirty_banks |= 1 << bank;
+}
+
+void PCD8544_FRAME::fillScreen(uint16_t color)
+{
+  memset(buffer, color ? 0xFF : 0x00, sizeof(buffer));
+  dirty_banks = PCD8544_FRAME_ALL_BANKS;
+}
+
+void PCD8544_FRAME::clearDisplay(void)
+{
+  fillScreen(WHITE);
+  setCursor(0, 0);
+}
+
+void PCD8544_FRAME::invalidate(void)
+{
+  shown_valid = false;
+  dirty_banks = PCD8544_FRAME_ALL_BANKS;
+}
+
+size_t PCD8544_FRAME::flush(Adafruit_PCD8544 &lcd)
+{
+  size_t spi_bytes = 0;
+
+  for (uint8_t bank = 0; bank < PCD8544_FRAME_BANK_NB; bank++)
+  {
+    if (!(dirty_banks & (1 << bank)))
+      continue;
+
+    // A bank drawn back to what is shown (e.g. cleared then redrawn) is skipped
+    uint8_t first = 0, last = LCDWIDTH - 1;
+    if (shown_valid)
+    {
+      while (first < LCDWIDTH && buffer[bank][first] == shown[bank][first])
+        first++;
+      if (first == LCDWIDTH)
+        continue;
+      while (buffer[bank][last] == shown[bank][last])
+        last--;
+    }
+
+    lcd.command(PCD8544_SETYADDR | bank);
+    lcd.command(PCD8544_SETXADDR | first);
+    for (uint8_t col = first; col <= last; col++)
+      lcd.data(buffer[bank][col]);
+
+    memcpy(&shown[bank][first], &buffer[bank][first], last - first + 1);
+    spi_bytes += 2 + last - first + 1;
+  }
+
+  dirty_banks = 0;
+  shown_valid = true;
+
+  return spi_bytes;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/******************************************************************************************
+ * File:        pcd8544_frame.h
+ * Author:      valcesch
+ * Compagny:    NA
+ * Website:     https://github.com/valcesch/AstroTracker
+ * E-mail:      NA
+ *
+ * AstroTracker
+ * Copyright (C) 2023 valcesch
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ ******************************************************************************************/
+
+#ifndef _PCD8544_FRAME_h
+#define _PCD8544_FRAME_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#ifdef WITH_SCREEN
+#include <Adafruit_GFX.h>
+#include "Adafruit_PCD8544.h"
+
+#define PCD8544_FRAME_BANK_HEIGHT (8) // Rows held by one byte of display RAM
+#define PCD8544_FRAME_BANK_NB (LCDHEIGHT / PCD8544_FRAME_BANK_HEIGHT)
+
+// Off-screen copy of the PCD8544 display RAM, drawn with the Adafruit_GFX API.
+// flush() compares it with what the display shows and only sends the banks that
+// changed, from their first to their last modified column.
+class PCD8544_FRAME : public Adafruit_GFX
+{
+public:
+  PCD8544_FRAME();
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color);
+  void fillScreen(uint16_t color);
+  void clearDisplay(void);
+
+  void invalidate(void); // Display RAM lost (reset, power down), the next flush() sends everything
+  size_t flush(Adafruit_PCD8544 &lcd);
+
+private:
+  uint8_t buffer[PCD8544_FRAME_BANK_NB][LCDWIDTH]; // Being drawn
+  uint8_t shown[PCD8544_FRAME_BANK_NB][LCDWIDTH];  // Sent to the display
+  uint8_t dirty_banks;                              // One bit per bank written since the last flush()
+  bool shown_valid;
+};
+
+#endif
+
+#endif
@@ -27,8 +27,11 @@
 #include "../syshal_gpio.h"
 #include "../syshal_rtc.h"
 #include "../syshal_time.h"
+#include "../syshal_batt.h"
 #include "../../core/config/version.h"
 #include "../../core/debug/debug.h"
+#include "../../core/event/event.h"
+#include "../../core/profiler/profiler.h"
 #include "../syshal_config.h"
 
 static volatile bool new_usr_down_pending = false;
@@ -40,6 +43,7 @@ static syshal_screen_state_t state = SYSHAL_SCREEN_STATE_UNINIT;
 #ifdef WITH_SCREEN
 #include <Adafruit_GFX.h>
 #include "Adafruit_PCD8544.h"
+#include "pcd8544_frame.h"
 
 #define SYSHAL_SCREEN_GPIO_BUTTON_DOWN (GPIO_BUTTON_DOWN)
 #define SYSHAL_SCREEN_GPIO_BUTTON_MIDDLE (GPIO_BUTTON_MIDDLE)
@@ -58,6 +62,51 @@ Adafruit_PCD8544 display = Adafruit_PCD8544(SYSHAL_SCREEN_GPIO_LCD_CLK,
                                             SYSHAL_SCREEN_GPIO_LCD_DC,
                                             SYSHAL_SCREEN_GPIO_LCD_CE,
                                             SYSHAL_SCREEN_GPIO_LCD_RST);
+PCD8544_FRAME frame; // Pages are drawn here, display only receives the changes
+
+// Retained mode: pages are only drawn again when something they show has changed
+static bool redraw_pending = false;
+static uint32_t status_page_minute = UINT32_MAX; // Clock shown on the status page, in minutes since epoch
+
+#define SYSHAL_SCREEN_LINE_SIZE (15) // 14 characters of the 6 px font on 84 px, and the terminator
+
+// Page models: their text is formatted when the contents change, pages only print it
+typedef struct
+{
+    char clock[6];
+    char temp[6];
+    char v_bat[6];
+    char counters[3][SYSHAL_SCREEN_LINE_SIZE];
+    char location[2 * SYSHAL_SCREEN_LINE_SIZE];
+} syshal_screen_status_page_t;
+
+typedef struct
+{
+    uint16_t count; // Messages listed since the last clear
+    uint8_t nb;
+    uint16_t id[SYSHAL_SCREEN_MSG_LIST_SIZE]; // Logger slot ids, newest first
+    char title[SYSHAL_SCREEN_LINE_SIZE];
+    char line[SYSHAL_SCREEN_MSG_LIST_SIZE][SYSHAL_SCREEN_LINE_SIZE]; // Acknowledged mark and start of the text
+} syshal_screen_msg_list_t;
+
+static syshal_screen_status_page_t status_page;
+static syshal_screen_msg_list_t msg_lists[SYSHAL_SCREEN_MSG_LIST_NB];
+
+static const char *const msg_list_name[SYSHAL_SCREEN_MSG_LIST_NB] = {
+    [SYSHAL_SCREEN_MSG_LIST_TX] = "TX",
+    [SYSHAL_SCREEN_MSG_LIST_RX] = "RX",
+};
+
+static const int msg_list_page[SYSHAL_SCREEN_MSG_LIST_NB] = {
+    [SYSHAL_SCREEN_MSG_LIST_TX] = SYSHAL_SCREEN_MENU_MODE_TX_MSG_LST_PAGE,
+    [SYSHAL_SCREEN_MSG_LIST_RX] = SYSHAL_SCREEN_MENU_MODE_RX_MSG_LST_PAGE,
+};
+
+// Cost of the display, reset at wake up and reported at shutdown
+static uint64_t on_start_time_ms;
+static uint32_t redraw_cnt;
+static uint32_t spi_bytes;
+static uint32_t render_time_us;
 
 // https://javl.github.io/image2cpp/
 const unsigned char astrocast_logo16_glcd_bmp[] PROGMEM = {
@@ -122,14 +171,22 @@ static void syshal_screen_int_pin_usr_up_priv(void);
 // Callback
 void syshal_screen_callback_status_page_priv();
 void syshal_screen_callback_shutdown_page_priv();
-void syshal_screen_callback_tx_msg_list_page_priv();
-void syshal_screen_callback_rx_msg_list_page_priv();
+void syshal_screen_callback_msg_list_page_priv(syshal_screen_msg_list_id_t list);
 void syshal_screen_callback_preset_msg_page_priv(syshal_screen_preset_msg_id_t id);
 void syshal_screen_callback_update_geoloc_page_priv();
 void syshal_screen_callback_clear_all_user_msg_page_priv();
 void syshal_screen_callback_firmware_info_page_priv();
 
+// Page models
+bool syshal_screen_update_clock_priv();
+void syshal_screen_format_status_priv();
+int syshal_screen_format_coordinate_priv(char *out, size_t size, char hemisphere, int32_t value);
+void syshal_screen_format_msg_list_title_priv(syshal_screen_msg_list_id_t list);
+
 // Graphics
+void syshal_screen_render_priv();
+void syshal_screen_flush_priv();
+void syshal_screen_request_status_priv();
 void syshal_screen_frame_buffer_clear();
 void syshal_screen_menu_set(int m);
 void syshal_screen_menu_end();
@@ -145,28 +202,19 @@ static void syshal_screen_int_pin_usr_up_priv(void);
 static void syshal_screen_int_pin_usr_down_priv(void)
 {
     new_usr_down_pending = true;
-
-#if defined(NRF52_SERIES)
-    resumeLoop();
-#endif
+    event_post(EVENT_BUTTON);
 }
 
 static void syshal_screen_int_pin_usr_middle_priv(void)
 {
     new_usr_middle_pending = true;
-
-#if defined(NRF52_SERIES)
-    resumeLoop();
-#endif
+    event_post(EVENT_BUTTON);
 }
 
 static void syshal_screen_int_pin_usr_up_priv(void)
 {
     new_usr_up_pending = true;
-
-#if defined(NRF52_SERIES)
-    resumeLoop();
-#endif
+    event_post(EVENT_BUTTON);
 }
 
 void syshal_screen_frame_buffer_clear()
@@ -182,8 +230,14 @@ void syshal_screen_frame_buffer_clear()
 void syshal_screen_menu_set(int m)
 {
 #ifdef WITH_SCREEN
+    if (m == SYSHAL_SCREEN_MENU_MODE_STATUS_PAGE)
+    {
+        syshal_screen_request_status_priv();
+        syshal_screen_update_clock_priv();
+    }
+
     menuMode = m;
-    display.clearDisplay();
+    frame.clearDisplay();
     oldPos = encoderPos;
     encoderPos = 0;
 #else
@@ -212,7 +266,7 @@ void syshal_screen_menu_end()
     if (syshal_screen_read_button() > 0)
     {
         menuMode = SYSHAL_SCREEN_MENU_MODE_HOME_PAGE;
-        display.clearDisplay();
+        frame.clearDisplay();
         encoderPos = oldPos;
     }
 #else
@@ -242,11 +296,11 @@ void syshal_screen_draw_menu_slider_priv()
     scrHt = numScrLines;
     syshal_screen_frame_buffer_clear();
     for (y = 0; y < numScrLines * 8; y++)
-        display.drawPixel(1, y, 1);
+        frame.drawPixel(1, y, 1);
     for (y = 0; y < 5; y++)
     {
-        display.drawPixel(0, y + n + 2, 1);
-        display.drawPixel(2, y + n + 2, 1);
+        frame.drawPixel(0, y + n + 2, 1);
+        frame.drawPixel(2, y + n + 2, 1);
     }
 #else
     DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
@@ -256,33 +310,33 @@ void syshal_screen_draw_menu_slider_priv()
 void syshal_screen_callback_preset_msg_page_priv(syshal_screen_preset_msg_id_t id)
 {
 #ifdef WITH_SCREEN
-    display.clearDisplay();
+    frame.clearDisplay();
     if (encoderPos >= 1 * 2)
         encoderPos = 1 * 2;
     int st = encoderPos / 2;
-    display.drawRoundRect(0, 0, 84, 36, 3, BLACK);
-    display.setCursor(0, 3);
-    display.println(presetMsg[id]);
-    display.setCursor(4, 39);
-    display.print("CANCEL");
-    display.setCursor(46, 39);
-    display.println(" SEND ");
+    frame.drawRoundRect(0, 0, 84, 36, 3, BLACK);
+    frame.setCursor(0, 3);
+    frame.println(presetMsg[id]);
+    frame.setCursor(4, 39);
+    frame.print("CANCEL");
+    frame.setCursor(46, 39);
+    frame.println(" SEND ");
     if (st == 0)
-        display.drawRect(2, 37, 39, 11, BLACK); // CANCEL
+        frame.drawRect(2, 37, 39, 11, BLACK); // CANCEL
     else
-        display.drawRect(44, 37, 39, 11, BLACK); // SEND
+        frame.drawRect(44, 37, 39, 11, BLACK); // SEND
     if (syshal_screen_read_button() <= 0)
         return;
     menuMode = SYSHAL_SCREEN_MENU_MODE_HOME_PAGE;
-    display.clearDisplay();
+    frame.clearDisplay();
     if (st > 0)
     {
-        display.drawRoundRect(0, 0, 84, 48, 3, BLACK);
-        display.setCursor(84 / 2 - 30, 48 / 2 - 4);
-        display.print("Queuing...");
-        display.display();
+        frame.drawRoundRect(0, 0, 84, 48, 3, BLACK);
+        frame.setCursor(84 / 2 - 30, 48 / 2 - 4);
+        frame.print("Queuing...");
+        syshal_screen_flush_priv();
         syshal_time_delay_ms(config.screen->contents.page_conf_duration_ms);
-        display.clearDisplay();
+        frame.clearDisplay();
 
         syshal_screen_event_t event;
         sprintf((char *)event.preset_msg.buffer, "%s", presetMsg[id]);
@@ -301,60 +355,30 @@ void syshal_screen_callback_status_page_priv()
 {
 #ifdef WITH_SCREEN
     // Draw canevas
-    display.clearDisplay();
-    display.drawRoundRect(0, 9, 84, 30, 3, BLACK);
-    // display.drawFastVLine(55, 9, 30, BLACK);
+    frame.clearDisplay();
+    frame.drawRoundRect(0, 9, 84, 30, 3, BLACK);
+    // frame.drawFastVLine(55, 9, 30, BLACK);
 
     // Display time
-    display.setCursor(0, 0);
-    time_t tnow = syshal_rtc_return_timestamp();
-
-    int hours = gmtime(&tnow)->tm_hour;
-    int minutes = gmtime(&tnow)->tm_min;
-
-    if (hours < 10)
-    {
-        display.print("0");
-    }
-    display.print(hours);
-    display.print(":");
-    if (minutes < 10)
-    {
-        display.print("0");
-    }
-    display.print(minutes);
-
-    // Update status
-    syshal_screen_event_t event;
-    event.id = SYSHAL_SCREEN_EVENT_UPDATE_STATUS_REQUEST;
-    syshal_screen_callback(&event);
+    frame.setCursor(0, 0);
+    frame.print(status_page.clock);
 
     // Display battery voltage
-    display.setCursor(60, 0);
-    display.print((float)(status.v_bat) / 10, 1);
-    display.print("V");
+    frame.setCursor(60, 0);
+    frame.print(status_page.v_bat);
 
     // Display temperature
-    display.setCursor(40, 0);
-    display.print(status.temp, 1);
-    display.print("C");
+    frame.setCursor(40, 0);
+    frame.print(status_page.temp);
 
     // Display logger counters
-    display.setCursor(0, 12);
-    display.print(" MSG ");
-    display.println(status.u_msg_cnt);
-    display.print(" CMD ");
-    display.println(status.u_cmd_cnt);
-    display.print(" PVT ");
-    display.println(status.pvt_cnt);
+    frame.setCursor(0, 12);
+    for (int i = 0; i < 3; i++)
+        frame.println(status_page.counters[i]);
 
     // Display location
-    display.setCursor(0, 41);
-    display.print("N");
-    display.print((float)(status.last_loc_lat) * 1E-7, 3);
-    display.print(" ");
-    display.print("E");
-    display.println((float)(status.last_loc_lon) * 1E-7, 3);
+    frame.setCursor(0, 41);
+    frame.println(status_page.location);
 #else
     DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
 #endif
@@ -363,12 +387,12 @@ void syshal_screen_callback_status_page_priv()
 void syshal_screen_callback_firmware_info_page_priv()
 {
 #ifdef WITH_SCREEN
-    display.clearDisplay();
-    display.drawRoundRect(0, 0, 84, 48, 3, BLACK);
-    display.setCursor(0, 3);
-    display.println(COMPILE_DATE);
-    display.println(COMPILE_TIME);
-    display.println(COMPILER_NAME);
+    frame.clearDisplay();
+    frame.drawRoundRect(0, 0, 84, 48, 3, BLACK);
+    frame.setCursor(0, 3);
+    frame.println(COMPILE_DATE);
+    frame.println(COMPILE_TIME);
+    frame.println(COMPILER_NAME);
 #else
     DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
 #endif
@@ -377,33 +401,33 @@ void syshal_screen_callback_firmware_info_page_priv()
 void syshal_screen_callback_shutdown_page_priv()
 {
 #ifdef WITH_SCREEN
-    display.clearDisplay();
+    frame.clearDisplay();
     if (encoderPos >= 1 * 2)
         encoderPos = 1 * 2;
     int st = encoderPos / 2;
-    display.drawRoundRect(0, 0, 84, 36, 3, BLACK);
-    display.setCursor(10, 15);
-    display.println("Shut down ?");
-    display.setCursor(4, 39);
-    display.println("  NO");
-    display.setCursor(46, 39);
-    display.print(" YES");
+    frame.drawRoundRect(0, 0, 84, 36, 3, BLACK);
+    frame.setCursor(10, 15);
+    frame.println("Shut down ?");
+    frame.setCursor(4, 39);
+    frame.println("  NO");
+    frame.setCursor(46, 39);
+    frame.print(" YES");
     if (st == 0)
-        display.drawRect(2, 37, 38, 11, BLACK);
+        frame.drawRect(2, 37, 38, 11, BLACK);
     else
-        display.drawRect(44, 37, 38, 11, BLACK);
+        frame.drawRect(44, 37, 38, 11, BLACK);
     if (syshal_screen_read_button() <= 0)
         return;
     menuMode = SYSHAL_SCREEN_MENU_MODE_HOME_PAGE;
-    display.clearDisplay();
+    frame.clearDisplay();
     if (st > 0)
     {
-        display.drawRoundRect(0, 0, 84, 48, 3, BLACK);
-        display.setCursor(0, 48 / 2 - 4);
-        display.print("Shutting down.");
-        display.display();
+        frame.drawRoundRect(0, 0, 84, 48, 3, BLACK);
+        frame.setCursor(0, 48 / 2 - 4);
+        frame.print("Shutting down.");
+        syshal_screen_flush_priv();
         syshal_time_delay_ms(config.screen->contents.page_conf_duration_ms);
-        display.clearDisplay();
+        frame.clearDisplay();
 
         syshal_screen_event_t event;
         event.id = SYSHAL_SCREEN_EVENT_SHUTDOWN;
@@ -416,25 +440,21 @@ void syshal_screen_callback_shutdown_page_priv()
 #endif
 }
 
-void syshal_screen_callback_tx_msg_list_page_priv()
-{
-#ifdef WITH_SCREEN
-    display.clearDisplay();
-    display.drawRoundRect(0, 0, 84, 48, 3, BLACK);
-    display.setCursor(0, 48 / 2 - 4);
-    display.print("   No data.   ");
-#else
-    DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
-#endif
-}
-
-void syshal_screen_callback_rx_msg_list_page_priv()
+void syshal_screen_callback_msg_list_page_priv(syshal_screen_msg_list_id_t list)
 {
 #ifdef WITH_SCREEN
-    display.clearDisplay();
-    display.drawRoundRect(0, 0, 84, 48, 3, BLACK);
-    display.setCursor(0, 48 / 2 - 4);
-    display.print("   No data.   ");
+    frame.clearDisplay();
+    frame.drawRoundRect(0, 0, 84, 48, 3, BLACK);
+    if (!msg_lists[list].nb)
+    {
+        frame.setCursor(0, 48 / 2 - 4);
+        frame.print("   No data.   ");
+        return;
+    }
+    frame.setCursor(0, 3);
+    frame.println(msg_lists[list].title);
+    for (int i = 0; i < msg_lists[list].nb; i++)
+        frame.println(msg_lists[list].line[i]);
 #else
     DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
 #endif
@@ -443,33 +463,33 @@ void syshal_screen_callback_rx_msg_list_page_priv()
 void syshal_screen_callback_update_geoloc_page_priv()
 {
 #ifdef WITH_SCREEN
-    display.clearDisplay();
+    frame.clearDisplay();
     if (encoderPos >= 1 * 2)
         encoderPos = 1 * 2;
     int st = encoderPos / 2;
-    display.drawRoundRect(0, 0, 84, 36, 3, BLACK);
-    display.setCursor(0, 15);
-    display.println("Update GNSS?");
-    display.setCursor(4, 39);
-    display.println("  NO");
-    display.setCursor(46, 39);
-    display.print(" YES");
+    frame.drawRoundRect(0, 0, 84, 36, 3, BLACK);
+    frame.setCursor(0, 15);
+    frame.println("Update GNSS?");
+    frame.setCursor(4, 39);
+    frame.println("  NO");
+    frame.setCursor(46, 39);
+    frame.print(" YES");
     if (st == 0)
-        display.drawRect(2, 37, 38, 11, BLACK);
+        frame.drawRect(2, 37, 38, 11, BLACK);
     else
-        display.drawRect(44, 37, 38, 11, BLACK);
+        frame.drawRect(44, 37, 38, 11, BLACK);
     if (syshal_screen_read_button() <= 0)
         return;
     menuMode = SYSHAL_SCREEN_MENU_MODE_HOME_PAGE;
-    display.clearDisplay();
+    frame.clearDisplay();
     if (st > 0)
     {
-        display.drawRoundRect(0, 0, 84, 48, 3, BLACK);
-        display.setCursor(0, 48 / 2 - 4);
-        display.print(" Updating...");
-        display.display();
+        frame.drawRoundRect(0, 0, 84, 48, 3, BLACK);
+        frame.setCursor(0, 48 / 2 - 4);
+        frame.print(" Updating...");
+        syshal_screen_flush_priv();
         syshal_time_delay_ms(config.screen->contents.page_conf_duration_ms);
-        display.clearDisplay();
+        frame.clearDisplay();
 
         syshal_screen_event_t event;
         event.id = SYSHAL_SCREEN_EVENT_UPDATE_GEOLOC;
@@ -484,33 +504,33 @@ void syshal_screen_callback_update_geoloc_page_priv()
 void syshal_screen_callback_clear_all_user_msg_page_priv()
 {
 #ifdef WITH_SCREEN
-    display.clearDisplay();
+    frame.clearDisplay();
     if (encoderPos >= 1 * 2)
         encoderPos = 1 * 2;
     int st = encoderPos / 2;
-    display.drawRoundRect(0, 0, 84, 36, 3, BLACK);
-    display.setCursor(0, 15);
-    display.println("Clear all msg?");
-    display.setCursor(4, 39);
-    display.println("  NO");
-    display.setCursor(46, 39);
-    display.print(" YES");
+    frame.drawRoundRect(0, 0, 84, 36, 3, BLACK);
+    frame.setCursor(0, 15);
+    frame.println("Clear all msg?");
+    frame.setCursor(4, 39);
+    frame.println("  NO");
+    frame.setCursor(46, 39);
+    frame.print(" YES");
     if (st == 0)
-        display.drawRect(2, 37, 38, 11, BLACK); // NO
+        frame.drawRect(2, 37, 38, 11, BLACK); // NO
     else
-        display.drawRect(44, 37, 38, 11, BLACK); // YES
+        frame.drawRect(44, 37, 38, 11, BLACK); // YES
     if (syshal_screen_read_button() <= 0)
         return;
     menuMode = SYSHAL_SCREEN_MENU_MODE_HOME_PAGE;
-    display.clearDisplay();
+    frame.clearDisplay();
     if (st > 0)
     {
-        display.drawRoundRect(0, 0, 84, 48, 3, BLACK);
-        display.setCursor(0, 48 / 2 - 4);
-        display.print("  Clearing... ");
-        display.display();
+        frame.drawRoundRect(0, 0, 84, 48, 3, BLACK);
+        frame.setCursor(0, 48 / 2 - 4);
+        frame.print("  Clearing... ");
+        syshal_screen_flush_priv();
         syshal_time_delay_ms(config.screen->contents.page_conf_duration_ms);
-        display.clearDisplay();
+        frame.clearDisplay();
 
         syshal_screen_event_t event;
         event.id = SYSHAL_SCREEN_EVENT_CLEAR_ALL_USER_MSG;
@@ -522,6 +542,186 @@ void syshal_screen_callback_clear_all_user_msg_page_priv()
 #endif
 }
 
+void syshal_screen_render_priv()
+{
+#ifdef WITH_SCREEN
+    if (menuMode == SYSHAL_SCREEN_MENU_MODE_HOME_PAGE)
+    {
+        frame.clearDisplay();
+        menuLine = encoderPos / 2;
+        if (menuLine >= numMenus)
+        {
+            menuLine = numMenus - 1;
+            encoderPos = menuLine * 2;
+        }
+        if (menuLine >= menuStart + numScrLines)
+            menuStart = menuLine - numScrLines + 1;
+        if (menuLine < menuStart)
+            menuStart = menuLine;
+        for (int i = 0; i < numScrLines; i++)
+        {
+            if (i + menuStart < numMenus)
+            {
+                syshal_screen_menu_format((char *)menuTxt[i + menuStart], buf, 14);
+                frame.print(buf);
+                if (i + menuStart == menuLine)
+                {
+                    frame.drawRect(4, 8 * (i), 80, 8, BLACK);
+                }
+            }
+        }
+        syshal_screen_draw_menu_slider_priv();
+        if (syshal_screen_read_button())
+        {
+            syshal_screen_menu_set(menuLine);
+        }
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_STATUS_PAGE)
+    {
+        syshal_screen_callback_status_page_priv();
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_SHUTDOWN_PAGE)
+    {
+        syshal_screen_callback_shutdown_page_priv();
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_TX_MSG_LST_PAGE)
+    {
+        syshal_screen_callback_msg_list_page_priv(SYSHAL_SCREEN_MSG_LIST_TX);
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_RX_MSG_LST_PAGE)
+    {
+        syshal_screen_callback_msg_list_page_priv(SYSHAL_SCREEN_MSG_LIST_RX);
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_1)
+    {
+        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_1);
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_2)
+    {
+        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_2);
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_3)
+    {
+        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_3);
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_4)
+    {
+        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_4);
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_5)
+    {
+        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_5);
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_UPDATE_GEOLOC_PAGE)
+    {
+        syshal_screen_callback_update_geoloc_page_priv();
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_CLEAR_ALL_USER_MSG_PAGE)
+    {
+        syshal_screen_callback_clear_all_user_msg_page_priv();
+        syshal_screen_menu_end();
+    }
+    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_FIRMWARE_INFO_PAGE)
+    {
+        syshal_screen_callback_firmware_info_page_priv();
+        syshal_screen_menu_end();
+    }
+    else
+    {
+        menuMode = SYSHAL_SCREEN_MENU_MODE_HOME_PAGE;
+        frame.clearDisplay();
+    }
+#else
+    DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
+#endif
+}
+
+// Returns true if the minute shown on the status page has changed
+bool syshal_screen_update_clock_priv()
+{
+#ifdef WITH_SCREEN
+    uint32_t minute = syshal_rtc_return_timestamp() / 60;
+    if (minute == status_page_minute)
+        return false;
+
+    status_page_minute = minute;
+    snprintf(status_page.clock, sizeof(status_page.clock), "%02u:%02u",
+             (unsigned int)(minute / 60 % 24), (unsigned int)(minute % 60));
+    return true;
+#else
+    DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
+    return false;
+#endif
+}
+
+// Coordinate in 1E-7 degrees, printed with 3 decimals
+int syshal_screen_format_coordinate_priv(char *out, size_t size, char hemisphere, int32_t value)
+{
+    int32_t thousandths = (value + (value < 0 ? -5000 : 5000)) / 10000;
+    uint32_t magnitude = thousandths < 0 ? -thousandths : thousandths;
+    return snprintf(out, size, "%c%s%lu.%03lu", hemisphere, thousandths < 0 ? "-" : "",
+                    (unsigned long)(magnitude / 1000), (unsigned long)(magnitude % 1000));
+}
+
+void syshal_screen_format_status_priv()
+{
+#ifdef WITH_SCREEN
+    snprintf(status_page.temp, sizeof(status_page.temp), "%dC", status.temp);
+    snprintf(status_page.v_bat, sizeof(status_page.v_bat), "%u.%uV", status.v_bat / 10, status.v_bat % 10);
+    snprintf(status_page.counters[0], SYSHAL_SCREEN_LINE_SIZE, " MSG %u", status.u_msg_cnt);
+    snprintf(status_page.counters[1], SYSHAL_SCREEN_LINE_SIZE, " CMD %u", status.u_cmd_cnt);
+    snprintf(status_page.counters[2], SYSHAL_SCREEN_LINE_SIZE, " PVT %u", status.pvt_cnt);
+
+    int len = syshal_screen_format_coordinate_priv(status_page.location, sizeof(status_page.location), 'N',
+                                                   status.last_loc_lat);
+    status_page.location[len++] = ' ';
+    syshal_screen_format_coordinate_priv(&status_page.location[len], sizeof(status_page.location) - len, 'E',
+                                         status.last_loc_lon);
+#else
+    DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
+#endif
+}
+
+void syshal_screen_format_msg_list_title_priv(syshal_screen_msg_list_id_t list)
+{
+#ifdef WITH_SCREEN
+    snprintf(msg_lists[list].title, SYSHAL_SCREEN_LINE_SIZE, " %s msg. %u", msg_list_name[list], msg_lists[list].count);
+#else
+    DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
+#endif
+}
+
+// syshal_screen_set_status() asks for a redraw if the counters changed
+void syshal_screen_request_status_priv()
+{
+#ifdef WITH_SCREEN
+    syshal_screen_event_t event;
+    event.id = SYSHAL_SCREEN_EVENT_UPDATE_STATUS_REQUEST;
+    syshal_screen_callback(&event);
+#else
+    DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
+#endif
+}
+
+void syshal_screen_flush_priv()
+{
+#ifdef WITH_SCREEN
+    spi_bytes += frame.flush(display);
+#else
+    DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
+#endif
+}
+
 int syshal_screen_init(void)
 {
 #ifdef WITH_SCREEN
@@ -542,18 +742,22 @@ int syshal_screen_init(void)
         return SYSHAL_SCREEN_ERROR_DEVICE;
     }
 
-    display.clearDisplay(); // clears the screen and buffer
-    display.setRotation(2); // rotate 90 degrees counter clockwise, can also use values of 2 and 3 to go further.
+    frame.clearDisplay(); // clears the screen and buffer
+    frame.setRotation(2); // rotate 90 degrees counter clockwise, can also use values of 2 and 3 to go further.
 
     // Display company logo
-    display.drawBitmap(0, 8, astrocast_logo16_glcd_bmp, 84, 22, BLACK);
-    display.setTextSize(1);
-    display.setTextColor(BLACK);
-    display.setCursor(6, 33);
-    display.println("AstroTracker");
-    display.display();
+    frame.drawBitmap(0, 8, astrocast_logo16_glcd_bmp, 84, 22, BLACK);
+    frame.setTextSize(1);
+    frame.setTextColor(BLACK);
+    frame.setCursor(6, 33);
+    frame.println("AstroTracker");
+    syshal_screen_flush_priv();
 
     numMenus = sizeof(menuTxt) / sizeof(char *);
+
+    syshal_screen_format_status_priv();
+    for (int i = 0; i < SYSHAL_SCREEN_MSG_LIST_NB; i++)
+        syshal_screen_format_msg_list_title_priv((syshal_screen_msg_list_id_t)i);
 #else
     DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
 #endif
@@ -602,7 +806,14 @@ int syshal_screen_shutdown(void)
 
     DEBUG_PR_TRACE("Shutdown. %s()", __FUNCTION__);
 
+    uint32_t on_time_ms = syshal_time_get_ticks_ms() - on_start_time_ms;
+    if (on_time_ms)
+        DEBUG_PR_TRACE("On for %lu ms, %lu redraws, %lu SPI B/s, %lu us CPU/s. %s()", on_time_ms, redraw_cnt,
+                       (uint32_t)((uint64_t)spi_bytes * 1000 / on_time_ms),
+                       (uint32_t)((uint64_t)render_time_us * 1000 / on_time_ms), __FUNCTION__);
+
     state = SYSHAL_SCREEN_STATE_ASLEEP;
+    syshal_batt_set_load(SYSHAL_BATT_LOAD_SCREEN, false);
 
     syshal_screen_event_t event;
     event.id = SYSHAL_SCREEN_EVENT_DISPLAY_OFF;
@@ -628,6 +839,16 @@ int syshal_screen_wake_up(void)
         return SYSHAL_SCREEN_ERROR_DEVICE;
 
     state = SYSHAL_SCREEN_STATE_DISPLAYING;
+    syshal_batt_set_load(SYSHAL_BATT_LOAD_SCREEN, true);
+
+    // Display RAM content is lost while powered down
+    frame.invalidate();
+    redraw_pending = true;
+
+    on_start_time_ms = syshal_time_get_ticks_ms();
+    redraw_cnt = 0;
+    spi_bytes = 0;
+    render_time_us = 0;
 
     syshal_screen_event_t event;
     event.id = SYSHAL_SCREEN_EVENT_DISPLAY_ON;
@@ -642,12 +863,83 @@ int syshal_screen_wake_up(void)
 void syshal_screen_set_status(syshal_screen_status_t screen_status)
 {
 #ifdef WITH_SCREEN
+    if (!memcmp(&status, &screen_status, sizeof(status)))
+        return;
+
     status = screen_status;
+    syshal_screen_format_status_priv();
+
+    if (menuMode == SYSHAL_SCREEN_MENU_MODE_STATUS_PAGE)
+        redraw_pending = true;
 #else
     DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
 #endif
 }
 
+// Called from the logger events, the list is kept here so that its page does not scan the logger
+void syshal_screen_msg_list_add(syshal_screen_msg_list_id_t list, uint16_t id, const uint8_t *data, size_t size,
+                                bool acknowledged)
+{
+#ifdef WITH_SCREEN
+    if (list >= SYSHAL_SCREEN_MSG_LIST_NB)
+        return;
+
+    // Newest first, the oldest message drops off a full list
+    syshal_screen_msg_list_t *msg_list = &msg_lists[list];
+    if (msg_list->nb < SYSHAL_SCREEN_MSG_LIST_SIZE)
+        msg_list->nb++;
+    memmove(&msg_list->id[1], &msg_list->id[0], (msg_list->nb - 1) * sizeof(msg_list->id[0]));
+    memmove(&msg_list->line[1], &msg_list->line[0], (msg_list->nb - 1) * sizeof(msg_list->line[0]));
+    msg_list->id[0] = id;
+    msg_list->count++;
+
+    char *line = msg_list->line[0];
+    size_t len = 0;
+    line[len++] = acknowledged ? '*' : ' ';
+    for (size_t i = 0; i < size && data[i] && len < SYSHAL_SCREEN_LINE_SIZE - 1; i++)
+        line[len++] = (data[i] >= ' ' && data[i] <= '~') ? data[i] : '.';
+    line[len] = 0;
+
+    syshal_screen_format_msg_list_title_priv(list);
+
+    if (menuMode == msg_list_page[list])
+        redraw_pending = true;
+#endif
+}
+
+void syshal_screen_msg_list_ack(syshal_screen_msg_list_id_t list, uint16_t id)
+{
+#ifdef WITH_SCREEN
+    if (list >= SYSHAL_SCREEN_MSG_LIST_NB)
+        return;
+
+    for (int i = 0; i < msg_lists[list].nb; i++)
+    {
+        if (msg_lists[list].id[i] == id)
+        {
+            msg_lists[list].line[i][0] = '*';
+            if (menuMode == msg_list_page[list])
+                redraw_pending = true;
+        }
+    }
+#endif
+}
+
+void syshal_screen_msg_list_clear(syshal_screen_msg_list_id_t list)
+{
+#ifdef WITH_SCREEN
+    if (list >= SYSHAL_SCREEN_MSG_LIST_NB)
+        return;
+
+    msg_lists[list].nb = 0;
+    msg_lists[list].count = 0;
+    syshal_screen_format_msg_list_title_priv(list);
+
+    if (menuMode == msg_list_page[list])
+        redraw_pending = true;
+#endif
+}
+
 int syshal_screen_tick(void)
 {
 #ifdef WITH_SCREEN
@@ -658,6 +950,7 @@ int syshal_screen_tick(void)
     {
         new_usr_down_pending = false;
         encoderPos--;
+        redraw_pending = true;
 
         syshal_screen_event_t event;
         event.id = SYSHAL_SCREEN_EVENT_BUTTON_PRESSED;
@@ -667,6 +960,7 @@ int syshal_screen_tick(void)
     {
         new_usr_up_pending = false;
         encoderPos++;
+        redraw_pending = true;
 
         syshal_screen_event_t event;
         event.id = SYSHAL_SCREEN_EVENT_BUTTON_PRESSED;
@@ -679,106 +973,36 @@ int syshal_screen_tick(void)
     if (state == SYSHAL_SCREEN_STATE_ASLEEP)
         return SYSHAL_SCREEN_NO_ERROR;
 
+    // Pages read the middle button themselves
+    if (new_usr_middle_pending)
+        redraw_pending = true;
+
+    // The status counters are pushed by syshal_screen_set_status(), only the clock is followed here
+    if (menuMode == SYSHAL_SCREEN_MENU_MODE_STATUS_PAGE && syshal_screen_update_clock_priv())
+        redraw_pending = true;
+
+    if (!redraw_pending)
+        return SYSHAL_SCREEN_NO_ERROR;
+
+    PROFILER_ZONE(PROFILER_ZONE_SCREEN_RENDER);
+
     DEBUG_PR_TRACE("Process EVENT... %s()", __FUNCTION__);
 
-    if (menuMode == SYSHAL_SCREEN_MENU_MODE_HOME_PAGE)
-    {
-        display.clearDisplay();
-        menuLine = encoderPos / 2;
-        if (menuLine >= numMenus)
-        {
-            menuLine = numMenus - 1;
-            encoderPos = menuLine * 2;
-        }
-        if (menuLine >= menuStart + numScrLines)
-            menuStart = menuLine - numScrLines + 1;
-        if (menuLine < menuStart)
-            menuStart = menuLine;
-        for (int i = 0; i < numScrLines; i++)
-        {
-            if (i + menuStart < numMenus)
-            {
-                syshal_screen_menu_format((char *)menuTxt[i + menuStart], buf, 14);
-                display.printf(buf);
-                if (i + menuStart == menuLine)
-                {
-                    display.drawRect(4, 8 * (i), 80, 8, BLACK);
-                }
-            }
-        }
-        syshal_screen_draw_menu_slider_priv();
-        if (syshal_screen_read_button())
-        {
-            syshal_screen_menu_set(menuLine);
-        }
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_STATUS_PAGE)
-    {
-        syshal_screen_callback_status_page_priv();
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_SHUTDOWN_PAGE)
-    {
-        syshal_screen_callback_shutdown_page_priv();
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_TX_MSG_LST_PAGE)
-    {
-        syshal_screen_callback_tx_msg_list_page_priv();
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_RX_MSG_LST_PAGE)
-    {
-        syshal_screen_callback_rx_msg_list_page_priv();
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_1)
-    {
-        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_1);
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_2)
-    {
-        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_2);
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_3)
-    {
-        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_3);
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_4)
-    {
-        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_4);
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_PRESET_MSG_5)
-    {
-        syshal_screen_callback_preset_msg_page_priv(SYSHAL_SCREEN_PRESET_MSG_5);
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_UPDATE_GEOLOC_PAGE)
-    {
-        syshal_screen_callback_update_geoloc_page_priv();
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_CLEAR_ALL_USER_MSG_PAGE)
-    {
-        syshal_screen_callback_clear_all_user_msg_page_priv();
-        syshal_screen_menu_end();
-    }
-    else if (menuMode == SYSHAL_SCREEN_MENU_MODE_FIRMWARE_INFO_PAGE)
-    {
-        syshal_screen_callback_firmware_info_page_priv();
-        syshal_screen_menu_end();
-    }
-    else
+    uint64_t start_time_us = syshal_time_get_ticks_us();
+
+    // A page left on a button press is followed by the next one straight away
+    int drawn_menu_mode;
+    do
     {
-        menuMode = SYSHAL_SCREEN_MENU_MODE_HOME_PAGE;
-        display.clearDisplay();
-    }
+        redraw_pending = false;
+        drawn_menu_mode = menuMode;
+        syshal_screen_render_priv();
+    } while (menuMode != drawn_menu_mode);
+
+    syshal_screen_flush_priv();
 
-    display.display();
+    redraw_cnt++;
+    render_time_us += syshal_time_get_ticks_us() - start_time_us;
 #else
     // DEBUG_PR_ERROR("No supported screen. %s()", __FUNCTION__);
 #endif
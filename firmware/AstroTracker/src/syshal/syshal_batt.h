@@ -32,16 +32,38 @@
 #include "WProgram.h"
 #endif
 
+#include "../core/config/sys_config.h"
+
 // Constants
 #define SYSHAL_BATT_NO_ERROR (0)
 #define SYSHAL_BATT_ERROR_DEVICE (-1)
 #define SYSHAL_BATT_ERROR_BUSY (-2)
 #define SYSHAL_BATT_ERROR_TIMEOUT (-3)
 #define SYSHAL_BATT_ERROR_DEVICE_UNRESPONSIVE (-4)
+#define SYSHAL_BATT_ERROR_NOT_CONFIGURED (-5)
+
+// Parts of the energy model, their supply current is counted while they are on
+typedef enum
+{
+    SYSHAL_BATT_LOAD_MCU, // Awake, not in deep sleep
+    SYSHAL_BATT_LOAD_GPS,
+    SYSHAL_BATT_LOAD_SAT,
+    SYSHAL_BATT_LOAD_SCREEN,
+    SYSHAL_BATT_LOAD_BLE,
+    SYSHAL_BATT_LOAD_NB,
+} syshal_batt_load_t;
+
+typedef struct
+{
+    sys_config_battery_settings_t *battery;
+} syshal_batt_config_t;
 
 int syshal_batt_init(void);
 int syshal_batt_term(void);
+int syshal_batt_update_config(syshal_batt_config_t batt_config);
 int syshal_batt_level(uint8_t *level);
 int syshal_batt_voltage(uint8_t *voltage);
+int syshal_batt_voltage_mv(uint16_t *voltage_mv);
+void syshal_batt_set_load(syshal_batt_load_t load, bool on);
 
 #endif
\ No newline at end of file
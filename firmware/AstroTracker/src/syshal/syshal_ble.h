@@ -39,6 +39,15 @@
 #define SYSHAL_BLE_UUID_SIZE (16)
 #define SYSHAL_BLE_ADVERTISING_SIZE (31)
 
+#define SYSHAL_BLE_ATT_HEADER_SIZE (3)
+#define SYSHAL_BLE_MTU_DEFAULT (23)
+#define SYSHAL_BLE_MTU_MAX (247) // Requested at connection, one notification then fits a 251 B data length extended PDU
+#define SYSHAL_BLE_PAYLOAD_MAX_SIZE (SYSHAL_BLE_MTU_MAX - SYSHAL_BLE_ATT_HEADER_SIZE)
+#define SYSHAL_BLE_HVN_QUEUE_SIZE (4)  // Notifications the softdevice can queue before they are sent
+#define SYSHAL_BLE_EVENT_LENGTH (6)    // Radio time per connection event, in 1.25 ms units
+#define SYSHAL_BLE_CONN_INTERVAL_LOW_POWER (40) // 50 ms, in 1.25 ms units
+#define SYSHAL_BLE_CONN_INTERVAL_THROUGHPUT (6) // 7.5 ms, in 1.25 ms units
+
 #define SYSHAL_BLE_NO_ERROR (0)
 #define SYSHAL_BLE_ERROR_CRC (-1)
 #define SYSHAL_BLE_ERROR_TIMEOUT (-2)
@@ -81,6 +90,12 @@ typedef enum
     SYSHAL_BLE_MODE_DEEP_SLEEP
 } syshal_ble_mode_t;
 
+typedef enum
+{
+    SYSHAL_BLE_LINK_LOW_POWER,  // Long connection interval
+    SYSHAL_BLE_LINK_THROUGHPUT, // Shortest connection interval, for bulk transfers
+} syshal_ble_link_mode_t;
+
 typedef struct
 {
     syshal_ble_event_id_t id;
@@ -97,8 +112,12 @@ typedef struct
 int syshal_ble_init(void);
 int syshal_ble_update_config(syshal_ble_config_t ble_config);
 int syshal_ble_term(void);
-int syshal_ble_send_message(uint8_t *buffer,
+int syshal_ble_send_message(const uint8_t *buffer,
                             size_t buffer_size);
+int syshal_ble_send_notification(const uint8_t *buffer,
+                                 size_t buffer_size);
+uint16_t syshal_ble_get_payload_size(void);
+int syshal_ble_set_link_mode(syshal_ble_link_mode_t mode);
 void syshal_ble_callback(syshal_ble_event_t *event);
 
 #endif
\ No newline at end of file
@@ -35,14 +35,30 @@
 // Constants
 // AstroTracker definitions
 #define GPIO_GPS_EXT_INT            (1u)
+// GNSS PIO driving GPIO_GPS_EXT_INT as TX ready, only on boards where it is wired so. On AstroTracker v06 rev2
+// (hardware/AstroTracker_v06) D1 is net INT_GNSS, tied to EXTINT (pin 5, an input) of the MAX-M8Q U2, which
+// has no UBLOX_CFG_TXREADY_* keys either: the receiver is polled
+// #define GPS_TX_READY_PIO            (5u)
 #define GPIO_GPS_EN                 (5u)
 #define GPIO_LED                    (LED_BUILTIN)
+#define LED_TIMER_TCC               (TCC2)              // SAMD21 timer blinking GPIO_LED, LED_BUILTIN is PA17
+#define LED_TIMER_TCC_WO            (1)                 // PA17 is TCC2/WO[1]
+#define LED_TIMER_TCC_GCLK_ID       (GCLK_CLKCTRL_ID_TCC2_TC3)
+#define LED_TIMER_TCC_APBC          (PM_APBCMASK_TCC2)
+#define LED_TIMER_PIN_PERIPH        (PIO_TIMER)
+// With a NeoPixel on GPIO_LED_NEOPIXEL, the SAMD21 drives it by DMA if it is on the MOSI pad of a SERCOM:
+// #define NEOPIXEL_DMA_SERCOM         1            // SERCOM number, without parentheses
+// #define NEOPIXEL_DMA_SERCOM_DOPO    (0)          // Data out on PAD[0]
+// #define NEOPIXEL_DMA_PIN_PERIPH     (PIO_SERCOM) // Or PIO_SERCOM_ALT
 #define GPIO_ANS_EXT_INT            (8u)
 #define GPIO_ANS_ANT_IN_USE         (9u)
 #define GPIO_ANS_EN                 (4u)
 #define GPIO_ANS_RESET              (3u)
 #define GPIO_HWDT_RESET             (0u)
 #define GPIO_VBAT                   (A4)
+#define VBAT_DIVIDER                (2)                 // GPIO_VBAT sees half of the battery voltage
+#define TEMP_MAX_AGE_MS             (60000)             // A temperature reading is reused for this long
+#define TEMP_AVERAGING              (TZ_AVERAGING_64)   // SAMD21 ADC samples averaged in hardware per reading
 #define GPIO_ANS_UART_RX            (PIN_SERIAL_RX)
 #define GPIO_ANS_UART_TX            (PIN_SERIAL_TX)
 
@@ -36,8 +36,19 @@
 #define SYSHAL_FLASH_NO_ERROR            ( 0)
 #define SYSHAL_FLASH_ERROR_INVALID_DRIVE (-1)
 #define SYSHAL_FLASH_ERROR_DEVICE        (-2)
+#define SYSHAL_FLASH_ERROR_INVALID_PARAM (-3)
+
+// Internal flash area reserved for the configuration, whole erase units per slot
+#define SYSHAL_FLASH_CONFIG_SLOT_NB (2)
+#if defined(NRF52_SERIES)
+#define SYSHAL_FLASH_CONFIG_SLOT_SIZE (4096) // Page
+#else
+#define SYSHAL_FLASH_CONFIG_SLOT_SIZE (1024) // 4 rows
+#endif
 
 int syshal_flash_init(void);
 int syshal_flash_term(void);
+int syshal_flash_config_read(uint8_t slot, void *data, size_t size);
+int syshal_flash_config_write(uint8_t slot, const void *data, size_t size);
 
 #endif
\ No newline at end of file
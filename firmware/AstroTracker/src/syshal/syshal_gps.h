@@ -111,6 +111,8 @@ int syshal_gps_shutdown(void);
 int syshal_gps_wake_up(void);
 int syshal_gps_tick(void);
 syshal_gps_state_t syshal_gps_get_state(void);
+bool syshal_gps_has_tx_ready(void);
+bool syshal_gps_tx_ready_asserted(void);
 void syshal_gps_callback(syshal_gps_event_t *event);
 
 #endif
\ No newline at end of file
@@ -72,8 +72,10 @@ int syshal_led_get(uint32_t * colour, bool * is_blinking);
 int syshal_led_set_sequence(syshal_led_sequence_t sequence, uint32_t time_ms);
 int syshal_led_off(void);
 void syshal_led_tick(void);
+void syshal_led_flush(void);
 
 bool syshal_led_is_active(void);
+bool syshal_led_needs_tick(void);
 
 #endif /* _SYSHAL_LED_H_ */
 
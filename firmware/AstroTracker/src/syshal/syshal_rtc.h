@@ -38,14 +38,21 @@
 #define SYSHAL_RTC_ERROR_TIMEOUT (-3)
 #define SYSHAL_RTC_INVALID_PARAMETER (-4)
 #define SYSHAL_RTC_ERROR_SET_WDT (-5)
+#define SYSHAL_RTC_ERROR_NOT_DISCIPLINED (-6)
+
+#define SYSHAL_RTC_TICKS_PER_SECOND (32768)
 
 int syshal_rtc_init(void);
 int syshal_rtc_term(void);
 int syshal_rtc_set_timestamp(uint32_t timestamp);
+int syshal_rtc_discipline(uint32_t timestamp, uint32_t accuracy_s);
+int syshal_rtc_get_uncertainty(uint32_t timestamp, uint32_t *uncertainty_s);
+int syshal_rtc_get_drift(int32_t *drift_ppb);
 uint32_t syshal_rtc_return_timestamp(void);
 int syshal_rtc_get_timestamp(uint32_t *timestamp);
 int syshal_rtc_get_uptime(uint32_t *uptime);
 uint32_t syshal_rtc_return_uptime(void);
+uint64_t syshal_rtc_return_ticks(void);
 // int syshal_rtc_stash_time(void);
 
 int syshal_rtc_soft_watchdog_set(unsigned int seconds);
@@ -128,6 +128,7 @@ int syshal_sat_send_message(uint8_t *buffer,
                             size_t buffer_size,
                             uint16_t buffer_id);
 int syshal_sat_get_next_contact_oportuinty(uint32_t *delay);
+int syshal_sat_get_time(uint32_t *time);
 int syshal_sat_read_status(syshal_sat_status_t *status);
 syshal_sat_state_t syshal_sat_get_state(void);
 int syshal_sat_tick(void);
@@ -82,6 +82,15 @@ typedef struct __attribute__((__packed__))
     uint32_t timestamp;
 } syshal_screen_event_preset_msg_t;
 
+typedef enum
+{
+    SYSHAL_SCREEN_MSG_LIST_TX,
+    SYSHAL_SCREEN_MSG_LIST_RX,
+    SYSHAL_SCREEN_MSG_LIST_NB,
+} syshal_screen_msg_list_id_t;
+
+#define SYSHAL_SCREEN_MSG_LIST_SIZE (4) // Latest messages shown on a TX/RX list page
+
 typedef enum
 {
     SYSHAL_SCREEN_EVENT_SHUTDOWN,
@@ -118,6 +127,10 @@ int syshal_screen_term(void);
 int syshal_screen_shutdown(void);
 int syshal_screen_wake_up(void);
 void syshal_screen_set_status(syshal_screen_status_t screen_status);
+void syshal_screen_msg_list_add(syshal_screen_msg_list_id_t list, uint16_t id, const uint8_t *data, size_t size,
+                                bool acknowledged);
+void syshal_screen_msg_list_ack(syshal_screen_msg_list_id_t list, uint16_t id);
+void syshal_screen_msg_list_clear(syshal_screen_msg_list_id_t list);
 syshal_screen_state_t syshal_screen_get_state(void);
 int syshal_screen_tick(void);
 void syshal_screen_callback(syshal_screen_event_t *event);
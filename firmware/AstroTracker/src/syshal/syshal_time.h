@@ -40,14 +40,14 @@
 
 int syshal_time_init(void);
 int syshal_time_term(void);
-uint32_t syshal_time_get_ticks_us(void);
-uint32_t syshal_time_get_ticks_ms(void);
+uint64_t syshal_time_get_ticks_us(void);
+uint64_t syshal_time_get_ticks_ms(void);
 void syshal_time_delay_us(uint32_t us);
 void syshal_time_delay_ms(uint32_t ms);
 
 #define TICKS_PER_SECOND ( 1000 )
 #define ROUND_NEAREST_MULTIPLE(value, magnitude) ( (value + magnitude / 2) / magnitude ) // Integer round to nearest manitude
-#define TIME_IN_SECONDS ( ROUND_NEAREST_MULTIPLE(syshal_time_get_ticks_ms(), TICKS_PER_SECOND) ) // Convert millisecond time to seconds
+#define TIME_IN_SECONDS ( (uint32_t)ROUND_NEAREST_MULTIPLE(syshal_time_get_ticks_ms(), TICKS_PER_SECOND) ) // Convert millisecond time to seconds
 
 /*
   time.h - low level time and date functions
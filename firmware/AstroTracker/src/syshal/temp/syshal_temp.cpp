@@ -24,6 +24,7 @@
  ******************************************************************************************/
 
 #include "../syshal_temp.h"
+#include "../syshal_time.h"
 #include "../syshal_config.h"
 #include "../../core/debug/debug.h"
 #if defined(NRF52_SERIES)
@@ -33,47 +34,150 @@
 TemperatureZero TempZero = TemperatureZero();
 #endif
 
+#ifdef TEMP_MAX_AGE_MS
+#define SYSHAL_TEMP_MAX_AGE_MS (TEMP_MAX_AGE_MS)
+#else
+#define SYSHAL_TEMP_MAX_AGE_MS (60000)
+#endif
+
+// Last reading, the sensor is only read again once it is older than SYSHAL_TEMP_MAX_AGE_MS
+static bool cache_valid = false;
+static uint64_t cache_time_ms;
+static int32_t cache_temp_mc; // [1/1000 degC]
+
+#if defined(ARDUINO_ARCH_SAMD)
+#ifdef TEMP_AVERAGING
+#define SYSHAL_TEMP_AVERAGING (TEMP_AVERAGING)
+#else
+#define SYSHAL_TEMP_AVERAGING (TZ_AVERAGING_64)
+#endif
+
+#define SYSHAL_TEMP_ADC_FULL_SCALE (4095)
+
+// Factory calibration of the NVM software calibration row, in the fixed-point form of the conversion:
+// voltages are in uV scaled by the ADC full scale, slopes are Q32
+static int32_t room_temp_mc;
+static int32_t room_ref_uv;      // INT1V reference at the room temperature
+static int64_t room_voltage;     // Room temperature reading compensated by room_ref_uv
+static int64_t temp_slope_q32;   // [1/1000 degC] per unit of compensated voltage
+static int64_t ref_slope_q32;    // [uV] of INT1V reference per 1/1000 degC
+#endif
+
+// Private functions
+#if defined(ARDUINO_ARCH_SAMD)
+int32_t syshal_temp_decimal_mc_priv(uint8_t decimal);
+void syshal_temp_calibrate_priv(void);
+int32_t syshal_temp_raw2temp_priv(uint16_t raw);
+#endif
+
+#if defined(ARDUINO_ARCH_SAMD)
+// Decimal part of a calibration temperature, as TemperatureZero reads it
+int32_t syshal_temp_decimal_mc_priv(uint8_t decimal)
+{
+    if (decimal < 10)
+        return decimal * 100;
+    if (decimal < 100)
+        return decimal * 10;
+    return decimal;
+}
+
+void syshal_temp_calibrate_priv(void)
+{
+    uint8_t room_int = (*(uint32_t *)FUSES_ROOM_TEMP_VAL_INT_ADDR & FUSES_ROOM_TEMP_VAL_INT_Msk) >> FUSES_ROOM_TEMP_VAL_INT_Pos;
+    uint8_t room_dec = (*(uint32_t *)FUSES_ROOM_TEMP_VAL_DEC_ADDR & FUSES_ROOM_TEMP_VAL_DEC_Msk) >> FUSES_ROOM_TEMP_VAL_DEC_Pos;
+    uint8_t hot_int = (*(uint32_t *)FUSES_HOT_TEMP_VAL_INT_ADDR & FUSES_HOT_TEMP_VAL_INT_Msk) >> FUSES_HOT_TEMP_VAL_INT_Pos;
+    uint8_t hot_dec = (*(uint32_t *)FUSES_HOT_TEMP_VAL_DEC_ADDR & FUSES_HOT_TEMP_VAL_DEC_Msk) >> FUSES_HOT_TEMP_VAL_DEC_Pos;
+    uint16_t room_reading = (*(uint32_t *)FUSES_ROOM_ADC_VAL_ADDR & FUSES_ROOM_ADC_VAL_Msk) >> FUSES_ROOM_ADC_VAL_Pos;
+    uint16_t hot_reading = (*(uint32_t *)FUSES_HOT_ADC_VAL_ADDR & FUSES_HOT_ADC_VAL_Msk) >> FUSES_HOT_ADC_VAL_Pos;
+    int8_t room_int1v = (int8_t)((*(uint32_t *)FUSES_ROOM_INT1V_VAL_ADDR & FUSES_ROOM_INT1V_VAL_Msk) >> FUSES_ROOM_INT1V_VAL_Pos);
+    int8_t hot_int1v = (int8_t)((*(uint32_t *)FUSES_HOT_INT1V_VAL_ADDR & FUSES_HOT_INT1V_VAL_Msk) >> FUSES_HOT_INT1V_VAL_Pos);
+
+    room_temp_mc = room_int * 1000 + syshal_temp_decimal_mc_priv(room_dec);
+    int32_t hot_temp_mc = hot_int * 1000 + syshal_temp_decimal_mc_priv(hot_dec);
+
+    // The INT1V values are the deviation from 1 V in mV
+    room_ref_uv = 1000000 - room_int1v * 1000;
+    int32_t hot_ref_uv = 1000000 - hot_int1v * 1000;
+
+    room_voltage = (int64_t)room_reading * room_ref_uv;
+    int64_t hot_voltage = (int64_t)hot_reading * hot_ref_uv;
+
+    temp_slope_q32 = ((int64_t)(hot_temp_mc - room_temp_mc) << 32) / (hot_voltage - room_voltage);
+    ref_slope_q32 = ((int64_t)(hot_ref_uv - room_ref_uv) << 32) / (hot_temp_mc - room_temp_mc);
+}
+
+// Same two steps as TemperatureZero::raw2temp() without floats: a first estimate assuming a 1 V reference gives
+// the actual INT1V reference at that temperature, which compensates the reading for the final one
+int32_t syshal_temp_raw2temp_priv(uint16_t raw)
+{
+    int64_t voltage = (int64_t)raw * 1000000;
+    int32_t coarse_mc = room_temp_mc + (int32_t)(((voltage - room_voltage) * temp_slope_q32) >> 32);
+
+    int32_t ref_uv = room_ref_uv + (int32_t)(((int64_t)(coarse_mc - room_temp_mc) * ref_slope_q32) >> 32);
+    voltage = (int64_t)raw * ref_uv;
+
+    return room_temp_mc + (int32_t)(((voltage - room_voltage) * temp_slope_q32) >> 32);
+}
+#endif
+
 int syshal_temp_init(void)
 {
 #if defined(NRF52_SERIES)
     // Using ARM built in functions
 #elif defined(ARDUINO_ARCH_SAMD)
     TempZero.init();
+    TempZero.setAveraging(SYSHAL_TEMP_AVERAGING);
     TempZero.disable();
+
+    syshal_temp_calibrate_priv();
 #endif
 
+    cache_valid = false;
+
     return SYSHAL_TEMP_NO_ERROR;
 }
 
 int syshal_temp_temperature(int8_t *temperature)
 {
-    float temp = 0;
+    uint64_t now = syshal_time_get_ticks_ms();
 
-#if defined(NRF52_SERIES)
-    int32_t result;
-    /*
-    NRF_TEMP->TASKS_START = 1; // Start temperature measurement
-    while (NRF_TEMP->EVENTS_DATARDY == 0)
+    if (!cache_valid || now - cache_time_ms >= SYSHAL_TEMP_MAX_AGE_MS)
     {
-    }
-    NRF_TEMP->EVENTS_DATARDY = 0; // Temperature measurement complete, data ready
-    result = NRF_TEMP->TEMP;
-    NRF_TEMP->TASKS_STOP = 1; // Stop temperature measurement
-    */
+#if defined(NRF52_SERIES)
+        int32_t result = 0;
+        /*
+        NRF_TEMP->TASKS_START = 1; // Start temperature measurement
+        while (NRF_TEMP->EVENTS_DATARDY == 0)
+        {
+        }
+        NRF_TEMP->EVENTS_DATARDY = 0; // Temperature measurement complete, data ready
+        result = NRF_TEMP->TEMP;
+        NRF_TEMP->TASKS_STOP = 1; // Stop temperature measurement
+        */
 #ifdef _VARIANT_FEATHER52840_
-    sd_temp_get(&result);
+        sd_temp_get(&result);
 #endif
 
-    temp = result * 0.25;
+        cache_temp_mc = result * 250; // 0.25 degC steps
 #elif defined(ARDUINO_ARCH_SAMD)
-    TempZero.wakeup();
-    temp = TempZero.readInternalTemperature();
-    TempZero.disable();
+        TempZero.wakeup();
+        uint16_t raw = TempZero.readInternalTemperatureRaw();
+        TempZero.disable();
+
+        cache_temp_mc = syshal_temp_raw2temp_priv(raw);
+#else
+        cache_temp_mc = 0;
 #endif
 
-    *temperature = (int8_t)temp;
+        cache_valid = true;
+        cache_time_ms = now;
+
+        DEBUG_PR_TRACE("Read temperature %ld/1000 degC", cache_temp_mc);
+    }
 
-    DEBUG_PR_TRACE("Read temperature %d", *temperature);
+    // Round to the nearest degree
+    int32_t temp_c = (cache_temp_mc + (cache_temp_mc < 0 ? -500 : 500)) / 1000;
+    *temperature = (int8_t)temp_c;
 
     return SYSHAL_TEMP_NO_ERROR;
-}
\ No newline at end of file
+}
@@ -24,6 +24,7 @@
  ******************************************************************************************/
 
 #include "../syshal_time.h"
+#include "../syshal_rtc.h"
 #include "../../core/debug/debug.h"
 #include "../syshal_config.h"
 
@@ -50,14 +51,15 @@ int syshal_time_term(void)
     return SYSHAL_TIME_NO_ERROR;
 }
 
-uint32_t syshal_time_get_ticks_ms(void)
+// Both tick counts derive from the RTC so they keep running in sleep and do not wrap
+uint64_t syshal_time_get_ticks_ms(void)
 {
-    return millis();
+    return syshal_rtc_return_ticks() * 1000 / SYSHAL_RTC_TICKS_PER_SECOND;
 }
 
-uint32_t syshal_time_get_ticks_us(void)
+uint64_t syshal_time_get_ticks_us(void)
 {
-    return micros();
+    return syshal_rtc_return_ticks() * 1000000 / SYSHAL_RTC_TICKS_PER_SECOND;
 }
 
 void syshal_time_delay_us(uint32_t us)
@@ -0,0 +1,167 @@
+/******************************************************************************************
+ * Host test of the battery state of charge estimation
+ *
+ * Discharges a simulated cell, with the discharge curve of the configuration, under the duty
+ * cycle of the tracker: a 2 s wake up every 10 min, a 60 s GPS fix every hour, a 30 s
+ * satellite transfer every 2 h and the screen 10 s every 6 h. The ADC readings carry 15 mV
+ * of noise at the battery. The simulated cell is not the configured one: 5 % less capacity,
+ * 200 mOhm instead of 150 mOhm, and load currents off the energy model by -15 % to +15 %.
+ *
+ * The level is read 1 s after each wake up, when the GPS or satellite may still be on, and
+ * compared with the true state of charge. The error of the voltage alone looked up in the
+ * curve is given for reference.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -DARDUINO=100 -DDEBUG_DISABLED -Itest/host -Ifirmware/AstroTracker/src test/batt_soc_test.cpp \
+ *       firmware/AstroTracker/src/syshal/batt/syshal_batt.cpp -o batt_soc_test
+ *   ./batt_soc_test
+ ******************************************************************************************/
+
+#include "syshal/syshal_batt.h"
+#include "syshal/syshal_gpio.h"
+#include "syshal/syshal_time.h"
+#include <random>
+
+uint32_t host_millis;
+
+#define TEST_MAX_ERROR_PERCENT (5)
+
+static const uint16_t curve_mv[11] = {4200, 4060, 3980, 3920, 3870, 3820, 3790, 3770, 3740, 3680, 3450};
+static const uint32_t cell_capacity_mah = 1900;
+static const double cell_resistance_ohm = 0.20;
+static const double load_current_ua[SYSHAL_BATT_LOAD_NB] = {6000, 25000, 40000, 10000, 500};
+
+static uint64_t now_ms;
+static double vbat_mv;
+static std::mt19937 rng(1);
+static std::normal_distribution<double> noise_mv(0, 15);
+
+uint64_t syshal_time_get_ticks_ms(void)
+{
+    return now_ms;
+}
+
+void syshal_gpio_init(uint32_t pin, uint32_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+// 10 bit ADC against 3.3 V behind the divider by 2
+uint32_t syshal_gpio_analog_read(uint32_t pin)
+{
+    (void)pin;
+    long raw = lround((vbat_mv + noise_mv(rng)) / 2 / 3300 * 1023);
+    return raw < 0 ? 0 : raw > 1023 ? 1023 : raw;
+}
+
+// Open circuit voltage of the simulated cell, linear between the points of the curve
+static double cell_ocv_mv(double soc)
+{
+    if (soc >= 1)
+        return curve_mv[0];
+    if (soc <= 0)
+        return curve_mv[10];
+
+    double x = (1 - soc) * 10;
+    int i = (int)x;
+    return curve_mv[i] + (curve_mv[i + 1] - curve_mv[i]) * (x - i);
+}
+
+// Former approach, the loaded voltage straight through the curve
+static double voltage_only_percent(uint16_t voltage_mv)
+{
+    if (voltage_mv >= curve_mv[0])
+        return 100;
+
+    for (int i = 1; i < 11; i++)
+        if (voltage_mv > curve_mv[i])
+            return (10 - i) * 10 + (voltage_mv - curve_mv[i]) * 10.0 / (curve_mv[i - 1] - curve_mv[i]);
+
+    return 0;
+}
+
+// Discharge to empty, return the number of errors
+static int test_trace(double current_scale, double start_soc)
+{
+    sys_config_battery_settings_t settings;
+    settings.hdr.set = true;
+    settings.contents.capacity_mah = 2000;
+    settings.contents.internal_resistance_mohm = 150;
+    memcpy(settings.contents.curve_mv, curve_mv, sizeof(curve_mv));
+
+    syshal_batt_init();
+    syshal_batt_config_t config = {.battery = &settings};
+    syshal_batt_update_config(config);
+
+    double capacity_uams = cell_capacity_mah * 3600.0 * 1e6;
+    double drawn_uams = (1 - start_soc) * capacity_uams;
+    bool load_on[SYSHAL_BATT_LOAD_NB] = {};
+    double error_sum = 0, error_max = 0, voltage_error_sum = 0, voltage_error_max = 0;
+    int readings = 0;
+
+    for (now_ms = 0; drawn_uams < capacity_uams; now_ms += 1000)
+    {
+        uint32_t s = now_ms / 1000;
+        bool gps = s % 3600 < 60;
+        bool sat = (s % 7200 >= 60) && (s % 7200 < 90);
+        bool screen = (s % 21600 >= 100) && (s % 21600 < 110);
+        bool on[SYSHAL_BATT_LOAD_NB] = {(s % 600 < 2) || gps || sat || screen, gps, sat, screen, false};
+
+        double current_ua = 50;
+        for (int load = 0; load < SYSHAL_BATT_LOAD_NB; load++)
+        {
+            if (on[load] != load_on[load])
+            {
+                syshal_batt_set_load((syshal_batt_load_t)load, on[load]);
+                load_on[load] = on[load];
+            }
+            if (on[load])
+                current_ua += load_current_ua[load];
+        }
+        current_ua *= current_scale;
+
+        drawn_uams += current_ua * 1000;
+        double soc = 1 - drawn_uams / capacity_uams;
+        vbat_mv = cell_ocv_mv(soc) - current_ua / 1e3 * cell_resistance_ohm;
+
+        if (s % 600 == 1)
+        {
+            uint8_t level;
+            uint16_t voltage_mv;
+            syshal_batt_level(&level);
+            syshal_batt_voltage_mv(&voltage_mv);
+
+            double error = fabs(level - soc * 100);
+            double voltage_error = fabs(voltage_only_percent(voltage_mv) - soc * 100);
+            error_sum += error;
+            voltage_error_sum += voltage_error;
+            error_max = error > error_max ? error : error_max;
+            voltage_error_max = voltage_error > voltage_error_max ? voltage_error : voltage_error_max;
+            readings++;
+        }
+    }
+
+    bool pass = (error_max <= TEST_MAX_ERROR_PERCENT) && (error_sum < voltage_error_sum);
+    printf("currents %+3.0f %%, from %3.0f %%: %3.0f days, %5d readings, error mean/max %.1f/%.1f %% (voltage only %.1f/%.1f %%)%s\n",
+           (current_scale - 1) * 100, start_soc * 100, now_ms / 86400000.0, readings, error_sum / readings, error_max,
+           voltage_error_sum / readings, voltage_error_max, pass ? "" : ", FAIL");
+
+    return pass ? 0 : 1;
+}
+
+int main(void)
+{
+    static const double current_scales[] = {0.85, 1.0, 1.15};
+    int errors = 0;
+
+    for (size_t i = 0; i < sizeof(current_scales) / sizeof(current_scales[0]); i++)
+    {
+        errors += test_trace(current_scales[i], 1.0);
+        errors += test_trace(current_scales[i], 0.6); // Battery changed for a partly charged one
+    }
+
+    printf("%s: %d errors\n", errors ? "FAIL" : "PASS", errors);
+
+    return errors ? 1 : 0;
+}
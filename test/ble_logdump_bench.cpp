@@ -0,0 +1,245 @@
+/******************************************************************************************
+ * Host benchmark of the BLE log dump
+ *
+ * Dumps a full logger over a fake of the BLE UART link. Notifications are queued like in the
+ * softdevice and drained at each connection event according to the air time of the link
+ * layer PDUs, so the throughput depends on the ATT MTU, the data length, the PHY, the
+ * connection interval and the queue size. The received stream is decoded like the app does
+ * and every record and the end of dump packet are checked, then a dump resumed from an
+ * offset is checked.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -DARDUINO=100 -DDEBUG_DISABLED -Itest/host -Ifirmware/AstroTracker/src \
+ *       test/ble_logdump_bench.cpp firmware/AstroTracker/src/core/logdump/logdump.cpp \
+ *       firmware/AstroTracker/src/core/logger/logger.cpp \
+ *       firmware/AstroTracker/src/core/command/an_packets.cpp \
+ *       firmware/AstroTracker/src/core/command/an_packet_protocol.cpp -o ble_logdump_bench
+ *   ./ble_logdump_bench
+ ******************************************************************************************/
+
+#include "core/logdump/logdump.h"
+#include "core/logger/logger.h"
+#include "core/command/an_packets.h"
+#include "syshal/syshal_ble.h"
+#include <deque>
+#include <vector>
+
+uint32_t host_millis;
+
+#define BENCH_RECORD_SIZE (22) // PVT record
+
+typedef struct
+{
+    const char *name;
+    uint16_t mtu;
+    uint16_t ll_max;    // Link layer payload, 27 without data length extension
+    double us_per_byte; // 8 on the 1M PHY, 4 on the 2M PHY
+    double interval_ms;
+    double event_ms;    // Radio time per connection event
+    uint8_t queue_size; // Notifications queued in the softdevice
+} bench_link_t;
+
+static bench_link_t link;
+static std::deque<std::vector<uint8_t>> queue;
+static std::vector<uint8_t> received;
+static syshal_ble_link_mode_t link_mode;
+
+// Fake of the BLE driver used by the log dump
+uint32_t syshal_rtc_return_timestamp(void)
+{
+    return 0;
+}
+
+uint16_t syshal_ble_get_payload_size(void)
+{
+    return link.mtu - SYSHAL_BLE_ATT_HEADER_SIZE;
+}
+
+int syshal_ble_set_link_mode(syshal_ble_link_mode_t mode)
+{
+    link_mode = mode;
+    return SYSHAL_BLE_NO_ERROR;
+}
+
+int syshal_ble_send_notification(const uint8_t *buffer, size_t length)
+{
+    if (length > syshal_ble_get_payload_size())
+        return SYSHAL_BLE_ERROR_LENGTH;
+
+    if (queue.size() >= link.queue_size)
+        return SYSHAL_BLE_ERROR_BUSY;
+
+    queue.push_back(std::vector<uint8_t>(buffer, buffer + length));
+    return SYSHAL_BLE_NO_ERROR;
+}
+
+// Air time of one data PDU (preamble, access address, header, payload, CRC) and its empty acknowledge, T_IFS after each
+static double bench_pdu_us(size_t payload)
+{
+    return (1 + 4 + 2 + payload + 3) * link.us_per_byte + 150 + (1 + 4 + 2 + 3) * link.us_per_byte + 150;
+}
+
+// Send the queued notifications that fit in one connection event
+static void bench_connection_event(void)
+{
+    double budget_us = (link.event_ms < link.interval_ms ? link.event_ms : link.interval_ms) * 1000;
+
+    while (!queue.empty())
+    {
+        size_t l2cap_size = queue.front().size() + 3 + 4; // ATT opcode and handle, L2CAP header
+        double air_us = 0;
+        for (size_t left = l2cap_size; left;)
+        {
+            size_t fragment = left < link.ll_max ? left : link.ll_max;
+            air_us += bench_pdu_us(fragment);
+            left -= fragment;
+        }
+
+        if (air_us > budget_us)
+            break;
+
+        budget_us -= air_us;
+        received.insert(received.end(), queue.front().begin(), queue.front().end());
+        queue.pop_front();
+    }
+}
+
+// Run a dump to its end, return the time it took
+static double bench_dump(uint16_t first_slot)
+{
+    double time_ms = 0;
+    bool more;
+
+    queue.clear();
+    received.clear();
+    logdump_start(first_slot);
+
+    while (logdump_is_active() || !queue.empty())
+    {
+        // The main loop processes while asked to, then sleeps until the next connection event
+        do
+            logdump_process(&more);
+        while (more);
+
+        bench_connection_event();
+        time_ms += link.interval_ms;
+    }
+
+    return time_ms;
+}
+
+// Decode the received stream, return the number of errors
+static int bench_check(uint16_t first_slot, uint16_t *record_nb, size_t *record_bytes)
+{
+    static uint8_t data[AN_BULK_MAXIMUM_PACKET_SIZE];
+    an_decoder_t decoder;
+    an_decoder_initialise(&decoder, data, sizeof(data));
+
+    int errors = 0;
+    int end_nb = 0;
+    size_t position = 0;
+    *record_nb = 0;
+    *record_bytes = 0;
+
+    while (position < received.size())
+    {
+        size_t consumed;
+        an_packet_ref_t ref;
+        bool valid = an_packet_decode(&decoder, &received[position], received.size() - position, &consumed, &ref);
+        position += consumed;
+
+        if (!valid)
+            continue;
+
+        an_packet_t packet;
+        packet.id = ref.id;
+        packet.an_length = ref.an_length;
+        memcpy(packet.header, ref.header, AN_PACKET_HEADER_SIZE);
+        memcpy(packet.data, ref.data, ref.an_length);
+
+        log_record_packet_t record;
+        log_dump_end_packet_t end;
+        uint8_t length;
+
+        if (decode_log_record_packet(&record, &length, &packet))
+        {
+            // Records come in slot order with the content they were logged with
+            uint8_t expected[BENCH_RECORD_SIZE];
+            memset(expected, record.offset, sizeof(expected));
+            if ((record.offset != first_slot + *record_nb) || (length != BENCH_RECORD_SIZE) ||
+                memcmp(record.data, expected, length) || (record.createdDate != 1000u + record.offset))
+                errors++;
+
+            (*record_nb)++;
+            *record_bytes += length;
+        }
+        else if (decode_log_dump_end_packet(&end, &packet))
+        {
+            if (end.record_nb != *record_nb)
+                errors++;
+            end_nb++;
+        }
+        else
+        {
+            errors++;
+        }
+    }
+
+    if ((end_nb != 1) || decoder.crc_errors)
+        errors++;
+
+    return errors;
+}
+
+int main(void)
+{
+    static const bench_link_t links[] = {
+        // name                                    mtu  ll   us/B interval event queue
+        {"MTU 23, 1M PHY, 30 ms, queue 2", 23, 27, 8, 30, 3.75, 2},
+        {"MTU 23, 1M PHY, 7.5 ms, queue 4", 23, 27, 8, 7.5, 7.5, 4},
+        {"MTU 247 + DLE, 1M PHY, 7.5 ms, queue 4", 247, 251, 8, 7.5, 7.5, 4},
+        {"MTU 247 + DLE, 2M PHY, 7.5 ms, queue 4", 247, 251, 4, 7.5, 7.5, 4},
+    };
+    int errors = 0;
+
+    logger_init();
+    for (uint16_t i = 0; i < LOGGER_NB_SLOTS; i++)
+    {
+        uint8_t pvt[BENCH_RECORD_SIZE];
+        uint16_t id;
+        memset(pvt, i, sizeof(pvt));
+        logger_insert_data(pvt, sizeof(pvt), 1, 1000 + i, &id);
+    }
+    logdump_init();
+
+    for (size_t i = 0; i < sizeof(links) / sizeof(links[0]); i++)
+    {
+        link = links[i];
+        double time_ms = bench_dump(0);
+
+        uint16_t record_nb;
+        size_t record_bytes;
+        int link_errors = bench_check(0, &record_nb, &record_bytes);
+        if (record_nb != LOGGER_NB_SLOTS)
+            link_errors++;
+
+        printf("%-40s %3d records, %5zu B in %6.1f ms: %6.0f B/s stream, %6.0f B/s log data%s\n", link.name,
+               record_nb, received.size(), time_ms, received.size() / time_ms * 1000, record_bytes / time_ms * 1000,
+               link_errors ? ", ERRORS" : "");
+        errors += link_errors;
+    }
+
+    // Resume an interrupted dump, the link goes back to low power at the end
+    uint16_t record_nb;
+    size_t record_bytes;
+    bench_dump(60);
+    int resume_errors = bench_check(60, &record_nb, &record_bytes);
+    if ((record_nb != LOGGER_NB_SLOTS - 60) || (link_mode != SYSHAL_BLE_LINK_LOW_POWER))
+        resume_errors++;
+    printf("resume from slot 60: %d records%s\n", record_nb, resume_errors ? ", ERRORS" : "");
+    errors += resume_errors;
+
+    printf("%s: %d errors\n", errors ? "FAIL" : "PASS", errors);
+
+    return errors ? 1 : 0;
+}
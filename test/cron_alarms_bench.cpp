@@ -0,0 +1,130 @@
+/******************************************************************************************
+ * Host benchmark of the alarm next trigger computation
+ *
+ * Over the UTC years 2023 to 2026, checks that an interval alarm of h hours fires at the same
+ * times as the cron alarm "0 0 *\/h * * *" the scheduler used to build for the GPS, and
+ * measures the time spent updating the next trigger of each kind. Also checks that an alarm
+ * created at a timestamp fires once and is then freed.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -DARDUINO=100 -Itest/host -Ifirmware/AstroTracker/src/core/scheduler \
+ *       test/cron_alarms_bench.cpp firmware/AstroTracker/src/core/scheduler/CronAlarms.cpp \
+ *       -x c firmware/AstroTracker/src/core/scheduler/CronExpr.c -o cron_alarms_bench
+ *   ./cron_alarms_bench
+ ******************************************************************************************/
+
+#include "CronAlarms.h"
+#include <chrono>
+
+uint32_t host_millis;
+
+#define BENCH_START (1672531200) // 2023-01-01 00:00:00 UTC
+#define BENCH_END (1798761600)   // 2027-01-01 00:00:00 UTC
+
+static uint32_t now;
+static uint32_t nb_ticks;
+
+static uint32_t bench_get_time(void)
+{
+    return now;
+}
+
+static void bench_tick(void)
+{
+    nb_ticks++;
+}
+
+// Run the alarms up to BENCH_END, return the host time spent servicing them
+static double bench_service(CronClass &cron, uint32_t *nb_triggers)
+{
+    double elapsed_ns = 0;
+    CronID_t id;
+
+    *nb_triggers = 0;
+    while ((now = cron.getNextTrigger(&id)) < BENCH_END)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        cron.delay();
+        elapsed_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        (*nb_triggers)++;
+    }
+
+    return elapsed_ns;
+}
+
+int main(void)
+{
+    static const uint8_t interval_h[] = {1, 2, 3, 4, 6, 8, 12, 24};
+    int errors = 0;
+
+    // The cron expressions are evaluated in local time
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    for (uint8_t i = 0; i < sizeof(interval_h); i++)
+    {
+        char cron_str[32];
+        sprintf(cron_str, "0 0 */%d * * *", interval_h[i]);
+
+        now = BENCH_START;
+        CronClass cron_alarm(bench_get_time);
+        CronClass interval_alarm(bench_get_time);
+        CronID_t cron_id = cron_alarm.create(cron_str, bench_tick, false);
+        CronID_t interval_id = interval_alarm.createInterval(interval_h[i] * 3600, bench_tick, false);
+
+        // Both alarms must fire at the same times
+        uint32_t nb_triggers = 0;
+        while (cron_alarm.getNextTrigger(cron_id) < BENCH_END)
+        {
+            if (cron_alarm.getNextTrigger(cron_id) != interval_alarm.getNextTrigger(interval_id))
+            {
+                printf("%2d h: cron alarm at %ld, interval alarm at %ld\n", interval_h[i],
+                       (long)cron_alarm.getNextTrigger(cron_id), (long)interval_alarm.getNextTrigger(interval_id));
+                errors++;
+                break;
+            }
+
+            now = cron_alarm.getNextTrigger(cron_id);
+            cron_alarm.delay();
+            interval_alarm.delay();
+            nb_triggers++;
+        }
+
+        // Then time each kind alone
+        uint32_t nb_cron_triggers, nb_interval_triggers;
+        now = BENCH_START;
+        cron_alarm.free(cron_id);
+        cron_alarm.create(cron_str, bench_tick, false);
+        double cron_ns = bench_service(cron_alarm, &nb_cron_triggers);
+        now = BENCH_START;
+        interval_alarm.free(interval_id);
+        interval_alarm.createInterval(interval_h[i] * 3600, bench_tick, false);
+        double interval_ns = bench_service(interval_alarm, &nb_interval_triggers);
+
+        printf("%2d h: %5u triggers, cron alarm %7.1f ns per trigger, interval alarm %5.1f ns per trigger\n",
+               interval_h[i], nb_triggers, cron_ns / nb_cron_triggers, interval_ns / nb_interval_triggers);
+    }
+
+    // Single trigger at a timestamp, as used for the satellite pass
+    now = BENCH_START;
+    nb_ticks = 0;
+    CronClass cron(bench_get_time);
+    CronID_t at_id = cron.createAt(BENCH_START + 50, bench_tick);
+    cron.delay();
+    now = BENCH_START + 49;
+    cron.delay();
+    bool early = nb_ticks != 0;
+    now = BENCH_START + 50;
+    cron.delay();
+    now = BENCH_START + 3600;
+    cron.delay();
+    if (early || (nb_ticks != 1) || cron.isAllocated(at_id) || cron.count())
+    {
+        printf("timestamp alarm: %u triggers, still allocated %d\n", nb_ticks, cron.isAllocated(at_id));
+        errors++;
+    }
+
+    printf("%s: %d errors\n", errors ? "FAIL" : "PASS", errors);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+/******************************************************************************************
+ * Host model of the operational state wake ups
+ *
+ * Replays one day of wake ups of the operational state: watchdog timeouts, an hourly GPS fix
+ * taking 30 s with the former 3 s polling cadence, and Astronode event pin interrupts. Each
+ * wake up runs either the former polling pass, which ticks every driver, or the event
+ * dispatch, which runs only the handlers of the pending events. Both use the real event
+ * queue and alarms, the drivers are empty stubs that count their calls.
+ *
+ * On Linux the user mode instructions of the loop are counted by single stepping a child
+ * process with ptrace. The scheduler and the model itself are measured alone and subtracted.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -DARDUINO=100 -DDEBUG_DISABLED -Itest/host -Ifirmware/AstroTracker/src \
+ *       -Ifirmware/AstroTracker/src/core/scheduler test/event_wakeup_bench.cpp \
+ *       firmware/AstroTracker/src/core/event/event.cpp \
+ *       firmware/AstroTracker/src/core/scheduler/CronAlarms.cpp \
+ *       -x c firmware/AstroTracker/src/core/scheduler/CronExpr.c -o event_wakeup_bench
+ *   ./event_wakeup_bench
+ ******************************************************************************************/
+
+#include "core/event/event.h"
+#include "CronAlarms.h"
+
+#if defined(__linux__)
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+uint32_t host_millis;
+
+#define BENCH_DAYS (1)
+#define BENCH_WATCHDOG_S (300)      // Wake up without alarm
+#define BENCH_GPS_POLL_S (3)        // Former GPS_ACTIVE_WAKEUP_TIMEOUT_S
+#define BENCH_GPS_FIX_S (30)        // Time to fix after the GPS alarm
+#define BENCH_SAT_EVENT_PERIOD_S (9000) // Astronode event pin
+
+typedef enum
+{
+    BENCH_MODE_BASELINE, // Scheduler only, measures the model itself
+    BENCH_MODE_POLLING,  // Former sm_main_operational() pass
+    BENCH_MODE_EVENTS,   // Event dispatch
+} bench_mode_t;
+
+static uint32_t now_s;
+static uint32_t bench_get_time(void)
+{
+    return now_s;
+}
+
+static CronClass Cron(bench_get_time);
+
+static uint32_t driver_calls;
+static bool gps_on;
+static uint32_t gps_fix_at;
+static bool sat_event;
+static uint8_t last_battery_level;
+static volatile bool request_flag[4]; // Former request_* flags
+static volatile int next_state;
+
+// Driver stubs, out of line so they are not optimised away
+__attribute__((noinline)) static int bench_batt_level(uint8_t *level)
+{
+    driver_calls++;
+    *level = 80;
+    return 0;
+}
+
+__attribute__((noinline)) static int bench_gps_tick(void)
+{
+    driver_calls++;
+    return 0;
+}
+
+__attribute__((noinline)) static int bench_sat_tick(void)
+{
+    driver_calls++;
+    sat_event = false;
+    return 0;
+}
+
+__attribute__((noinline)) static int bench_screen_tick(void)
+{
+    driver_calls++;
+    return 0;
+}
+
+__attribute__((noinline)) static int bench_scheduler_tick(void)
+{
+    driver_calls++;
+    Cron.delay();
+    return 0;
+}
+
+static void bench_gps_alarm(void)
+{
+    gps_on = true;
+    gps_fix_at = now_s + BENCH_GPS_FIX_S;
+}
+
+static void bench_battery_check(void)
+{
+    uint8_t level;
+    if (!bench_batt_level(&level) && (last_battery_level > level))
+    {
+        if (level <= 10)
+            next_state = 1;
+        last_battery_level = level;
+    }
+}
+
+__attribute__((noinline)) static void bench_polling_pass(void)
+{
+    bench_battery_check();
+    bench_gps_tick();
+    bench_sat_tick();
+    bench_screen_tick();
+    bench_screen_tick();
+    bench_scheduler_tick();
+
+    for (uint8_t i = 0; i < 4; i++)
+        if (request_flag[i])
+            request_flag[i] = false;
+}
+
+static void bench_handler_rtc_alarm(void *context)
+{
+    (void)context;
+    bench_battery_check();
+    bench_scheduler_tick();
+    if (gps_on)
+        bench_gps_tick();
+}
+
+static void bench_handler_sat_pin(void *context)
+{
+    (void)context;
+    bench_sat_tick();
+}
+
+static void bench_handler_gps_tx_ready(void *context)
+{
+    (void)context;
+    bench_gps_tick();
+}
+
+static void bench_handler_button(void *context)
+{
+    (void)context;
+    bench_screen_tick();
+}
+
+static const event_handler_t bench_handlers[EVENT_NB] = {
+    bench_handler_rtc_alarm,    // EVENT_RTC_ALARM
+    bench_handler_sat_pin,      // EVENT_SAT_PIN
+    bench_handler_gps_tx_ready, // EVENT_GPS_TX_READY
+    bench_handler_button,       // EVENT_BUTTON
+};
+
+__attribute__((noinline)) static void bench_event_pass(void)
+{
+    event_dispatch(bench_handlers, NULL, NULL);
+}
+
+// Return the number of wake ups
+static uint32_t bench_run(bench_mode_t mode)
+{
+    uint32_t wakes = 0;
+
+    now_s = 1700000000;
+    driver_calls = 0;
+    gps_on = false;
+    sat_event = false;
+    last_battery_level = 100;
+    event_init();
+    CronID_t gps_alarm_id = Cron.createInterval(3600, bench_gps_alarm, false);
+
+    uint32_t end = now_s + BENCH_DAYS * 86400;
+    while (now_s < end)
+    {
+        if (gps_on && (now_s >= gps_fix_at))
+            gps_on = false;
+
+        // Next wake up, from the alarms, the watchdog, the GPS polling or the Astronode
+        CronID_t id;
+        uint32_t wake = now_s + (gps_on ? BENCH_GPS_POLL_S : BENCH_WATCHDOG_S);
+        uint32_t next = Cron.getNextTrigger(&id);
+        if (next && (next < wake))
+            wake = next;
+
+        bool rtc_alarm = true;
+        if ((wake / BENCH_SAT_EVENT_PERIOD_S) != (now_s / BENCH_SAT_EVENT_PERIOD_S))
+        {
+            wake = (now_s / BENCH_SAT_EVENT_PERIOD_S + 1) * BENCH_SAT_EVENT_PERIOD_S;
+            sat_event = true;
+            event_post(EVENT_SAT_PIN);
+
+            // The RTC compare matches too when an alarm is due at the same time
+            rtc_alarm = next && (next <= wake);
+        }
+
+        if (rtc_alarm)
+            event_post(EVENT_RTC_ALARM);
+
+        now_s = wake;
+
+        switch (mode)
+        {
+        case BENCH_MODE_POLLING:
+            bench_polling_pass();
+            break;
+        case BENCH_MODE_EVENTS:
+            bench_event_pass();
+            break;
+        default:
+            event_init();
+            bench_scheduler_tick();
+            break;
+        }
+
+        wakes++;
+    }
+
+    Cron.free(gps_alarm_id);
+    return wakes;
+}
+
+#if defined(__linux__)
+// Run the model in a child process and count its instructions by single stepping, -1 if not possible
+static long bench_count_instructions(bench_mode_t mode)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL))
+            _exit(1);
+        raise(SIGSTOP); // Start of the measure
+        bench_run(mode);
+        raise(SIGSTOP); // End of the measure
+        _exit(0);
+    }
+
+    int status;
+    long count = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFSTOPPED(status))
+        return -1;
+
+    while (!ptrace(PTRACE_SINGLESTEP, pid, NULL, NULL))
+    {
+        waitpid(pid, &status, 0);
+        if (!WIFSTOPPED(status))
+            return -1;
+        if (WSTOPSIG(status) == SIGSTOP)
+            break;
+        count++;
+    }
+
+    ptrace(PTRACE_CONT, pid, NULL, NULL);
+    waitpid(pid, &status, 0);
+
+    return count;
+}
+#endif
+
+int main(void)
+{
+    uint32_t polling_wakes = bench_run(BENCH_MODE_POLLING);
+    uint32_t polling_calls = driver_calls;
+    uint32_t event_wakes = bench_run(BENCH_MODE_EVENTS);
+    uint32_t event_calls = driver_calls;
+
+    printf("%u wake ups per day, %u with events\n", polling_wakes, event_wakes);
+    printf("driver calls per wake up: polling %.2f, events %.2f\n",
+           polling_calls / (double)polling_wakes, event_calls / (double)event_wakes);
+
+#if defined(__linux__)
+    long baseline = bench_count_instructions(BENCH_MODE_BASELINE);
+    long polling = bench_count_instructions(BENCH_MODE_POLLING);
+    long events = bench_count_instructions(BENCH_MODE_EVENTS);
+    if ((baseline < 0) || (polling < 0) || (events < 0))
+    {
+        printf("instructions per wake up: ptrace not available\n");
+    }
+    else
+    {
+        printf("instructions per wake up, without the %.0f of the scheduler and model: polling %.1f, events %.1f\n",
+               baseline / (double)polling_wakes, (polling - baseline) / (double)polling_wakes,
+               (events - baseline) / (double)event_wakes);
+    }
+#endif
+
+    // Same wake ups, the dispatch must skip the drivers without pending work
+    bool pass = (polling_wakes == event_wakes) && (event_calls < polling_calls);
+    printf("%s\n", pass ? "PASS" : "FAIL");
+
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,626 @@
+/******************************************************************************************
+ * Host test of the geofence containment and uplink policy
+ *
+ * Polygons are checked against an exact reference, the crossings of the half line east of
+ * the point computed in 128 bits on unwrapped longitudes, with no tolerance:
+ * - random points around star polygons of 3 to 1000 vertices, one of them across the
+ *   antimeridian, also through geofence_check() to cover the bounding boxes
+ * - tilings of jittered triangles and quadrilaterals, with horizontal and vertical edges, in
+ *   both orientations. Every vertex and points exactly on every edge must be in exactly one
+ *   tile, and the points of the outer boundary in at most one
+ * - polygons spanning the whole range of latitudes and almost 180 deg of longitude, where the
+ *   cross products reach their largest values, tested up to +-90 deg and +-180 deg
+ *
+ * Circles are checked against the same local flat model as the firmware: along 64 bearings
+ * the point 0.1 % inside the radius must be in the fence and the point 0.1 % outside must
+ * not, and the largest error of the boundary is found by bisection.
+ *
+ * The uplink policies are replayed on a track going out of a depot, and the time of the
+ * integer containment is compared with the usual floating point ray casting.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -DARDUINO=100 -DDEBUG_DISABLED -Itest/host -Ifirmware/AstroTracker/src test/geofence_test.cpp \
+ *       firmware/AstroTracker/src/core/geofence/geofence.cpp -o geofence_test
+ *   ./geofence_test
+ ******************************************************************************************/
+
+#include "core/geofence/geofence.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+uint32_t host_millis;
+
+#define TEST_E7_180_DEG (1800000000LL)
+#define TEST_M_PER_DEG (111195.0)
+#define TEST_CIRCLE_MARGIN (0.001) // Relative to the radius
+#define TEST_RANDOM_POINTS (200000)
+
+typedef std::vector<sys_config_geofence_point_t> test_polygon_t;
+
+static std::mt19937 rng(1);
+
+// Longitude relative to lon_ref in [-180, 180) deg, 64 bits
+static int64_t test_unwrap(int64_t lon, int64_t lon_ref)
+{
+    int64_t delta = lon - lon_ref;
+    while (delta >= TEST_E7_180_DEG)
+        delta -= 2 * TEST_E7_180_DEG;
+    while (delta < -TEST_E7_180_DEG)
+        delta += 2 * TEST_E7_180_DEG;
+    return delta;
+}
+
+// deg * 1E7 wrapped to [-180, 180) deg
+static int32_t test_wrap(int64_t lon)
+{
+    return (int32_t)test_unwrap(lon, 0);
+}
+
+// Exact reference on the longitudes unwrapped from the first vertex, which is right for any point as a polygon spans
+// less than 180 deg. The edge crosses the latitude of the point east of it if xi + (xj - xi) * (0 - yi) / (yj - yi) > 0.
+static bool test_ref_contains(const test_polygon_t &v, int32_t lat, int32_t lon)
+{
+    int64_t x = test_unwrap(lon, v[0].lon);
+    bool inside = false;
+
+    for (size_t i = 0, j = v.size() - 1; i < v.size(); j = i++)
+    {
+        int64_t yi = (int64_t)v[i].lat - lat;
+        int64_t yj = (int64_t)v[j].lat - lat;
+        if ((yi > 0) == (yj > 0))
+            continue;
+
+        int64_t xi = test_unwrap(v[i].lon, v[0].lon) - x;
+        int64_t xj = test_unwrap(v[j].lon, v[0].lon) - x;
+        __int128 num = (__int128)xi * (yj - yi) - (__int128)(xj - xi) * yi;
+        if (num != 0 && (num > 0) == (yj > yi))
+            inside = !inside;
+    }
+
+    return inside;
+}
+
+// Whether the point is within the longitudes of the polygon, as geofence_check() makes sure before the containment
+static bool test_in_span(const test_polygon_t &v, int32_t lon)
+{
+    int64_t x = test_unwrap(lon, v[0].lon), x_min = 0, x_max = 0;
+
+    for (size_t i = 0; i < v.size(); i++)
+    {
+        int64_t xi = test_unwrap(v[i].lon, v[0].lon);
+        x_min = xi < x_min ? xi : x_min;
+        x_max = xi > x_max ? xi : x_max;
+    }
+
+    return x >= x_min && x <= x_max;
+}
+
+// Floating point ray casting, for the timing only
+static bool test_double_contains(const test_polygon_t &v, int32_t lat, int32_t lon)
+{
+    bool inside = false;
+
+    for (size_t i = 0, j = v.size() - 1; i < v.size(); j = i++)
+    {
+        double yi = v[i].lat * 1e-7, yj = v[j].lat * 1e-7, y = lat * 1e-7;
+        if ((yi > y) != (yj > y))
+        {
+            double xi = v[i].lon * 1e-7, xj = v[j].lon * 1e-7;
+            if (lon * 1e-7 < xi + (xj - xi) * (y - yi) / (yj - yi))
+                inside = !inside;
+        }
+    }
+
+    return inside;
+}
+
+static sys_config_geofence_point_t test_point(int64_t lat, int64_t lon)
+{
+    sys_config_geofence_point_t p;
+    p.lat = (int32_t)lat;
+    p.lon = test_wrap(lon);
+    return p;
+}
+
+// Star with n vertices and a wobbly radius, so that the edges have every direction
+static test_polygon_t test_star(int n, double lat_deg, double lon_deg, double radius_deg)
+{
+    test_polygon_t v;
+
+    for (int i = 0; i < n; i++)
+    {
+        double a = 2 * M_PI * i / n;
+        double r = radius_deg * (i % 2 ? 0.6 : 1.0) * (1 + 0.1 * sin(7 * a));
+        v.push_back(test_point(llround((lat_deg + r * sin(a)) * 1e7), llround((lon_deg + r * cos(a)) * 1e7)));
+    }
+
+    return v;
+}
+
+// Return 1 on a mismatch, the points out of the longitudes of the polygon are only tested through geofence_check()
+static int test_compare(const test_polygon_t &v, int32_t lat, int32_t lon, long *tests)
+{
+    if (!test_in_span(v, lon))
+        return 0;
+
+    (*tests)++;
+
+    return geofence_polygon_contains(v.data(), v.size(), lat, lon) != test_ref_contains(v, lat, lon);
+}
+
+// Random points around star polygons, return the number of errors
+static int test_polygon_random(void)
+{
+    static const int vertex_nbs[] = {3, 16, 256, 1000};
+    static const double centres[][2] = {{46.5, 6.5}, {0, 179.98}, {-70, -179.99}};
+    int errors = 0;
+    long tests = 0;
+
+    for (size_t c = 0; c < sizeof(centres) / sizeof(centres[0]); c++)
+    {
+        for (size_t k = 0; k < sizeof(vertex_nbs) / sizeof(vertex_nbs[0]); k++)
+        {
+            test_polygon_t v = test_star(vertex_nbs[k], centres[c][0], centres[c][1], 0.05);
+            std::uniform_int_distribution<int32_t> offset(-700000, 700000);
+
+            for (int i = 0; i < TEST_RANDOM_POINTS; i++)
+            {
+                int32_t lat = (int32_t)llround(centres[c][0] * 1e7) + offset(rng);
+                int32_t lon = test_wrap(llround(centres[c][1] * 1e7) + offset(rng));
+                errors += test_compare(v, lat, lon, &tests);
+            }
+        }
+    }
+
+    printf("random points around star polygons: %ld tests, %d errors\n", tests, errors);
+
+    return errors;
+}
+
+// Fences of the configuration, through the bounding boxes of geofence_check(), return the number of errors
+static int test_polygon_module(void)
+{
+    static sys_config_geofence_settings_t settings;
+    static sys_config_geofence_t fences[SYS_CONFIG_GEOFENCE_NB];
+    static const double centres[SYS_CONFIG_GEOFENCE_NB][2] = {{46.5, 6.5}, {46.53, 6.52}, {0, 179.98}, {0.02, -179.99}};
+    int errors = 0;
+    long tests = 0;
+
+    test_polygon_t v[SYS_CONFIG_GEOFENCE_NB];
+    for (int i = 0; i < SYS_CONFIG_GEOFENCE_NB; i++)
+    {
+        v[i] = test_star(i % 2 ? 3 : SYS_CONFIG_GEOFENCE_VERTEX_NB, centres[i][0], centres[i][1], 0.03);
+        fences[i].hdr.set = true;
+        fences[i].contents.type = GEOFENCE_POLYGON;
+        fences[i].contents.vertex_nb = v[i].size();
+        for (size_t j = 0; j < v[i].size(); j++)
+            fences[i].contents.vertex[j] = v[i][j];
+    }
+
+    geofence_init();
+    geofence_config_t config = {.settings = &settings, .fence = fences};
+    if (geofence_update_config(config))
+        errors++;
+
+    std::uniform_int_distribution<int32_t> offset(-600000, 600000);
+    for (int c = 0; c < SYS_CONFIG_GEOFENCE_NB; c += 2)
+    {
+        for (int i = 0; i < TEST_RANDOM_POINTS; i++)
+        {
+            int32_t lat = (int32_t)llround(centres[c][0] * 1e7) + offset(rng);
+            int32_t lon = test_wrap(llround(centres[c][1] * 1e7) + offset(rng));
+            uint8_t inside, expected = 0;
+
+            geofence_check(lat, lon, &inside);
+            for (int j = 0; j < SYS_CONFIG_GEOFENCE_NB; j++)
+                if (test_ref_contains(v[j], lat, lon))
+                    expected |= 1 << j;
+
+            errors += inside != expected;
+            tests++;
+        }
+    }
+
+    geofence_term();
+    printf("random points through geofence_check(): %ld tests, %d errors\n", tests, errors);
+
+    return errors;
+}
+
+// Tiling of rows x cols cells, return the number of errors
+static int test_polygon_tiling(double lat_deg, double lon_deg)
+{
+    const int rows = 6, cols = 8;
+    const int64_t cell = 100000; // 0.01 deg, a multiple of 8
+    std::uniform_int_distribution<int64_t> jitter(-3000, 3000);
+
+    // Inner vertices moved by multiples of 8 units so that the eighths of every edge are exact points.
+    // Odd rows only move east west, which keeps horizontal edges, and a column is not moved, which keeps vertical ones.
+    int64_t lat0 = llround(lat_deg * 1e7), lon0 = llround(lon_deg * 1e7);
+    int64_t grid[rows + 1][cols + 1][2];
+    for (int r = 0; r <= rows; r++)
+    {
+        for (int c = 0; c <= cols; c++)
+        {
+            bool inner = r > 0 && r < rows && c > 0 && c < cols;
+            grid[r][c][0] = lat0 + r * cell + (inner && r % 2 == 0 ? 8 * jitter(rng) : 0);
+            grid[r][c][1] = lon0 + c * cell + (inner && c != 3 ? 8 * jitter(rng) : 0);
+        }
+    }
+
+    std::vector<test_polygon_t> tiles;
+    for (int r = 0; r < rows; r++)
+    {
+        for (int c = 0; c < cols; c++)
+        {
+            // Counter clockwise corners
+            sys_config_geofence_point_t p[4] = {
+                test_point(grid[r][c][0], grid[r][c][1]), test_point(grid[r][c + 1][0], grid[r][c + 1][1]),
+                test_point(grid[r + 1][c + 1][0], grid[r + 1][c + 1][1]), test_point(grid[r + 1][c][0], grid[r + 1][c][1])};
+
+            switch ((r + c) % 3)
+            {
+            case 0:
+                tiles.push_back(test_polygon_t(p, p + 4));
+                break;
+            case 1: // Split along the diagonal 0-2, one of the triangles clockwise
+                tiles.push_back(test_polygon_t{p[0], p[1], p[2]});
+                tiles.push_back(test_polygon_t{p[3], p[2], p[0]});
+                break;
+            default: // Split along the diagonal 1-3, clockwise
+                tiles.push_back(test_polygon_t{p[3], p[1], p[0]});
+                tiles.push_back(test_polygon_t{p[2], p[1], p[3]});
+                break;
+            }
+        }
+    }
+
+    // Points on every edge of every tile, the vertices included
+    int errors = 0;
+    long tests = 0, compares = 0;
+    for (size_t t = 0; t < tiles.size(); t++)
+    {
+        const test_polygon_t &v = tiles[t];
+        for (size_t i = 0, j = v.size() - 1; i < v.size(); j = i++)
+        {
+            int64_t dlon = test_unwrap(v[i].lon, v[j].lon);
+            for (int k = 0; k < 8; k++)
+            {
+                int32_t lat = v[j].lat + ((int64_t)v[i].lat - v[j].lat) * k / 8;
+                int32_t lon = test_wrap(v[j].lon + dlon * k / 8);
+                int count = 0;
+
+                for (size_t u = 0; u < tiles.size(); u++)
+                {
+                    errors += test_compare(tiles[u], lat, lon, &compares);
+                    count += test_in_span(tiles[u], lon) &&
+                             geofence_polygon_contains(tiles[u].data(), tiles[u].size(), lat, lon);
+                }
+
+                int64_t dlon0 = test_unwrap(lon, lon0);
+                bool boundary = lat == lat0 || lat == lat0 + rows * cell || dlon0 == 0 || dlon0 == cols * cell;
+                if (boundary ? count > 1 : count != 1)
+                    errors++;
+                tests++;
+            }
+        }
+    }
+
+    printf("tiling at %6.2f %7.2f: %zu tiles, %ld points on edges, %ld comparisons, %d errors\n", lat_deg, lon_deg,
+           tiles.size(), tests, compares, errors);
+
+    return errors;
+}
+
+// Polygons as large as the fences may be, return the number of errors
+static int test_polygon_extreme(void)
+{
+    const int64_t lat_max = 900000000, dlon_max = TEST_E7_180_DEG / 2 - 1;
+    static sys_config_geofence_settings_t settings;
+    static sys_config_geofence_t fences[SYS_CONFIG_GEOFENCE_NB];
+    int errors = 0;
+    long tests = 0;
+
+    std::vector<test_polygon_t> polygons;
+    for (int64_t lon0 = -TEST_E7_180_DEG; lon0 < TEST_E7_180_DEG; lon0 += TEST_E7_180_DEG / 2)
+    {
+        // Pole to pole with notches in the east and west edges
+        polygons.push_back(test_polygon_t{
+            test_point(-lat_max, lon0 - dlon_max), test_point(-lat_max, lon0 + dlon_max),
+            test_point(0, lon0 + dlon_max / 2), test_point(lat_max, lon0 + dlon_max), test_point(lat_max, lon0 - dlon_max),
+            test_point(lat_max / 3, lon0 - dlon_max), test_point(0, lon0 - 1), test_point(-lat_max / 3, lon0 - dlon_max)});
+    }
+    polygons.push_back(test_star(256, 0, 170, 80));
+
+    std::uniform_int_distribution<int64_t> lat_random(-lat_max, lat_max);
+    std::uniform_int_distribution<int64_t> lon_random(-TEST_E7_180_DEG, TEST_E7_180_DEG - 1);
+    static const int64_t lat_edges[] = {-lat_max, -lat_max + 1, -1, 0, 1, lat_max - 1, lat_max};
+    static const int64_t lon_edges[] = {-TEST_E7_180_DEG, -TEST_E7_180_DEG + 1, -1, 0, 1, TEST_E7_180_DEG - 1};
+
+    for (size_t p = 0; p < polygons.size(); p++)
+    {
+        const test_polygon_t &v = polygons[p];
+
+        for (int i = 0; i < TEST_RANDOM_POINTS; i++)
+        {
+            errors += test_compare(v, lat_random(rng), lon_random(rng), &tests);
+        }
+
+        // Ends of the ranges, the vertices and their neighbours
+        for (size_t i = 0; i < sizeof(lat_edges) / sizeof(lat_edges[0]); i++)
+        {
+            for (size_t j = 0; j < sizeof(lon_edges) / sizeof(lon_edges[0]); j++)
+            {
+                errors += test_compare(v, lat_edges[i], lon_edges[j], &tests);
+            }
+        }
+        for (size_t i = 0; i < v.size(); i++)
+        {
+            for (int dlat = -1; dlat <= 1; dlat++)
+            {
+                for (int dlon = -1; dlon <= 1; dlon++)
+                {
+                    int64_t lat = v[i].lat + dlat;
+                    if (lat >= -lat_max && lat <= lat_max)
+                    {
+                        errors += test_compare(v, lat, test_wrap(v[i].lon + dlon), &tests);
+                    }
+                }
+            }
+        }
+    }
+
+    // The fences are accepted and their bounding boxes reject nothing inside
+    for (int i = 0; i < SYS_CONFIG_GEOFENCE_NB; i++)
+    {
+        fences[i].hdr.set = true;
+        fences[i].contents.type = GEOFENCE_POLYGON;
+        fences[i].contents.vertex_nb = polygons[i].size();
+        for (size_t j = 0; j < polygons[i].size(); j++)
+            fences[i].contents.vertex[j] = polygons[i][j];
+    }
+
+    geofence_init();
+    geofence_config_t config = {.settings = &settings, .fence = fences};
+    if (geofence_update_config(config))
+        errors++;
+
+    for (int i = 0; i < TEST_RANDOM_POINTS; i++)
+    {
+        int32_t lat = lat_random(rng), lon = lon_random(rng);
+        uint8_t inside, expected = 0;
+
+        geofence_check(lat, lon, &inside);
+        for (int j = 0; j < SYS_CONFIG_GEOFENCE_NB; j++)
+            if (test_ref_contains(polygons[j], lat, lon))
+                expected |= 1 << j;
+
+        errors += inside != expected;
+        tests++;
+    }
+
+    // A fence spanning 180 deg of longitude is refused, the others are still used
+    fences[0].contents.vertex[1] = test_point(-lat_max, polygons[0][0].lon + TEST_E7_180_DEG);
+    uint8_t inside;
+    if (geofence_update_config(config) != GEOFENCE_ERROR_INVALID_PARAM)
+        errors++;
+    geofence_check(0, polygons[2][6].lon + 1, &inside);
+    if (inside != 1 << 2)
+        errors++;
+
+    geofence_term();
+    printf("polygons up to +-90 deg and 180 deg of longitude: %ld tests, %d errors\n", tests, errors);
+
+    return errors;
+}
+
+static sys_config_geofence_t test_circle(double lat_deg, double lon_deg, uint16_t radius_m)
+{
+    sys_config_geofence_t fence = {};
+    fence.hdr.set = true;
+    fence.contents.type = GEOFENCE_CIRCLE;
+    fence.contents.radius_m = radius_m;
+    fence.contents.vertex[0] = test_point(llround(lat_deg * 1e7), llround(lon_deg * 1e7));
+    return fence;
+}
+
+// Whether the point at distance_m on the bearing from the centre is in the fence
+static bool test_circle_at(double lat_deg, double lon_deg, double bearing, double distance_m)
+{
+    int64_t lat = llround((lat_deg + distance_m * cos(bearing) / TEST_M_PER_DEG) * 1e7);
+    int64_t lon = llround((lon_deg + distance_m * sin(bearing) / (TEST_M_PER_DEG * cos(lat_deg * M_PI / 180))) * 1e7);
+    uint8_t inside;
+
+    geofence_check(lat, test_wrap(lon), &inside);
+
+    return inside & 1;
+}
+
+// Points on both sides of the radius, return the number of errors
+static int test_circle_margin(void)
+{
+    static const double centres[][2] = {{0, 6.5}, {46.5, 6.5}, {-60, 179.999}, {80, -179.9999}};
+    static const uint16_t radii_m[] = {100, 1000, 65535};
+    static sys_config_geofence_settings_t settings;
+    static sys_config_geofence_t fences[SYS_CONFIG_GEOFENCE_NB];
+    geofence_config_t config = {.settings = &settings, .fence = fences};
+    double error_max = 0;
+    int errors = 0;
+    long tests = 0;
+
+    geofence_init();
+
+    for (size_t c = 0; c < sizeof(centres) / sizeof(centres[0]); c++)
+    {
+        for (size_t r = 0; r < sizeof(radii_m) / sizeof(radii_m[0]); r++)
+        {
+            double lat_deg = centres[c][0], lon_deg = centres[c][1];
+            fences[0] = test_circle(lat_deg, lon_deg, radii_m[r]);
+            if (geofence_update_config(config))
+                errors++;
+
+            for (int b = 0; b < 64; b++)
+            {
+                double bearing = 2 * M_PI * b / 64;
+                errors += !test_circle_at(lat_deg, lon_deg, bearing, 0);
+                errors += !test_circle_at(lat_deg, lon_deg, bearing, radii_m[r] * (1 - TEST_CIRCLE_MARGIN));
+                errors += test_circle_at(lat_deg, lon_deg, bearing, radii_m[r] * (1 + TEST_CIRCLE_MARGIN));
+                tests += 3;
+
+                double in = radii_m[r] * 0.9, out = radii_m[r] * 1.1;
+                for (int i = 0; i < 40; i++)
+                {
+                    double middle = (in + out) / 2;
+                    if (test_circle_at(lat_deg, lon_deg, bearing, middle))
+                        in = middle;
+                    else
+                        out = middle;
+                }
+                double error = fabs(in / radii_m[r] - 1);
+                error_max = error > error_max ? error : error_max;
+            }
+        }
+    }
+
+    // Near the pole the circle covers its whole circle of latitude
+    uint8_t inside;
+    fences[0] = test_circle(89.99, 0, 5000);
+    geofence_update_config(config);
+    for (int64_t lon = -TEST_E7_180_DEG; lon < TEST_E7_180_DEG; lon += TEST_E7_180_DEG / 8)
+    {
+        geofence_check(899900000, lon, &inside);
+        errors += inside != 1;
+        tests++;
+    }
+
+    // Invalid circles are not used
+    fences[0] = test_circle(46.5, 6.5, 0);
+    fences[1] = test_circle(91, 6.5, 1000);
+    if (geofence_update_config(config) != GEOFENCE_ERROR_INVALID_PARAM)
+        errors++;
+    geofence_check(465000000, 65000000, &inside);
+    errors += inside != 0;
+
+    geofence_term();
+    printf("circles: %ld tests, boundary within %.4f %% of the radius, %d errors\n", tests, error_max * 100, errors);
+
+    return errors;
+}
+
+// Uplinked fixes of a track 3 h in the depot, 3 h out, 1 h back, a fix every 10 min
+static int test_policy_uplinks(uint8_t policy, uint16_t heartbeat_m)
+{
+    static sys_config_geofence_settings_t settings;
+    static sys_config_geofence_t fences[SYS_CONFIG_GEOFENCE_NB];
+
+    settings.hdr.set = true;
+    settings.contents.policy = policy;
+    settings.contents.heartbeat_m = heartbeat_m;
+    fences[0] = test_circle(46.5, 6.5, 200);
+    fences[1].hdr.set = true;
+    fences[1].contents.type = GEOFENCE_POLYGON;
+    fences[1].contents.vertex_nb = 4;
+    fences[1].contents.vertex[0] = test_point(464990000, 64990000);
+    fences[1].contents.vertex[1] = test_point(464990000, 65010000);
+    fences[1].contents.vertex[2] = test_point(465010000, 65010000);
+    fences[1].contents.vertex[3] = test_point(465010000, 64990000);
+
+    geofence_init();
+    geofence_config_t config = {.settings = &settings, .fence = fences};
+    geofence_update_config(config);
+
+    int uplinks = 0;
+    for (uint32_t m = 0; m < 7 * 60; m += 10)
+    {
+        bool out = m >= 180 && m < 360;
+        bool uplink;
+        geofence_fix(1700000000 + m * 60, 465000000, out ? 66000000 : 65000000, &uplink);
+        uplinks += uplink;
+    }
+
+    geofence_term();
+
+    return uplinks;
+}
+
+// Return the number of errors
+static int test_policy(void)
+{
+    static const struct
+    {
+        uint8_t policy;
+        uint16_t heartbeat_m;
+        int uplinks;
+    } cases[] = {
+        {GEOFENCE_UPLINK_ALL, 0, 42},
+        {GEOFENCE_UPLINK_OUTSIDE, 0, 20},       // First fix, 18 outside, back in
+        {GEOFENCE_UPLINK_OUTSIDE, 60, 22},      // And the heartbeats at 60 and 120 min
+        {GEOFENCE_UPLINK_TRANSITION, 0, 3},     // First fix, out, back in
+        {GEOFENCE_UPLINK_TRANSITION, 60, 7},    // And the heartbeats at 60, 120, 240 and 300 min
+        {GEOFENCE_POLICY_NB, 60, 42},           // Invalid, every fix
+    };
+    int errors = 0;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        int uplinks = test_policy_uplinks(cases[i].policy, cases[i].heartbeat_m);
+        printf("policy %d, heartbeat %3u min: %2d of 42 fixes uplinked%s\n", cases[i].policy, cases[i].heartbeat_m,
+               uplinks, uplinks == cases[i].uplinks ? "" : ", FAIL");
+        errors += uplinks != cases[i].uplinks;
+    }
+
+    return errors;
+}
+
+static void test_timing(void)
+{
+    static const int vertex_nbs[] = {16, 64, 256, 1024};
+    const int n = 400000;
+    std::uniform_int_distribution<int32_t> offset(-600000, 600000);
+    std::vector<int32_t> lat(n), lon(n);
+
+    for (int i = 0; i < n; i++)
+    {
+        lat[i] = 465000000 + offset(rng);
+        lon[i] = 65000000 + offset(rng);
+    }
+
+    printf("containment time per point:\n");
+    for (size_t k = 0; k < sizeof(vertex_nbs) / sizeof(vertex_nbs[0]); k++)
+    {
+        test_polygon_t v = test_star(vertex_nbs[k], 46.5, 6.5, 0.05);
+        volatile int count = 0;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++)
+            count += geofence_polygon_contains(v.data(), v.size(), lat[i], lon[i]);
+        double int_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++)
+            count += test_double_contains(v, lat[i], lon[i]);
+        double double_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+        printf("  %4d vertices: integer %7.1f ns, double %7.1f ns\n", vertex_nbs[k], int_ns, double_ns);
+    }
+}
+
+int main(void)
+{
+    int errors = 0;
+
+    errors += test_polygon_random();
+    errors += test_polygon_module();
+    errors += test_polygon_tiling(46.5, 6.5);
+    errors += test_polygon_tiling(-0.03, 179.96);
+    errors += test_polygon_tiling(89.94, -10);
+    errors += test_polygon_extreme();
+    errors += test_circle_margin();
+    errors += test_policy();
+    test_timing();
+
+    printf("%s: %d errors\n", errors ? "FAIL" : "PASS", errors);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+/******************************************************************************************
+ * Host evaluation of the adaptive GPS interval
+ *
+ * Runs the scheduler for 30 days on synthetic tracks and compares the fixes per day of fixed
+ * and adaptive GPS intervals with the track error: the track is rebuilt by linear
+ * interpolation between the fixes and compared with the true position every minute. A fix
+ * takes 40 s, has 3 m of noise and a ground speed with 0.15 m/s of noise.
+ *
+ * Tracks:
+ * - stationary asset
+ * - commuter: two 1 h drives at 12 m/s per day, parked the rest of the time
+ * - grazing animal: 8 h per day at 0.6 m/s with frequent heading changes
+ * - ship: always moving at 5 m/s
+ *
+ * The evaluation fails if the adaptive interval takes more than 1.5 fixes per day on the
+ * stationary track, or if with the motion hook it does not beat the fixed 24 h interval
+ * on a moving track.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -DARDUINO=100 -DDEBUG_DISABLED -Itest/host -Ifirmware/AstroTracker/src \
+ *       -Ifirmware/AstroTracker/src/core/scheduler test/gps_adaptive_eval.cpp \
+ *       firmware/AstroTracker/src/core/scheduler/scheduler.cpp \
+ *       firmware/AstroTracker/src/core/scheduler/CronAlarms.cpp \
+ *       firmware/AstroTracker/src/core/sensor/sensor.cpp firmware/AstroTracker/src/core/event/event.cpp \
+ *       -x c firmware/AstroTracker/src/core/scheduler/CronExpr.c -o gps_adaptive_eval
+ *   ./gps_adaptive_eval
+ ******************************************************************************************/
+
+#include "core/scheduler/scheduler.h"
+#include "CronAlarms.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+uint32_t host_millis;
+
+#define EVAL_START (1700000000)
+#define EVAL_DAYS (30)
+#define EVAL_FIX_TIME_S (40)
+#define EVAL_LAT_D (46.5)
+#define EVAL_LON_D (7.0)
+#define EVAL_M_PER_D (111195.0)
+
+typedef enum
+{
+    EVAL_TRACK_STATIONARY,
+    EVAL_TRACK_COMMUTER,
+    EVAL_TRACK_ANIMAL,
+    EVAL_TRACK_SHIP,
+    EVAL_TRACK_NB,
+} eval_track_t;
+
+typedef struct
+{
+    double x, y; // East and north [m]
+    double speed; // [m/s]
+} eval_point_t;
+
+typedef struct
+{
+    const char *name;
+    bool adaptive;
+    uint8_t interval_h;
+    uint16_t interval_min_m;
+    uint16_t interval_max_m;
+    bool motion; // Accelerometer hook called when the asset starts moving
+} eval_policy_t;
+
+typedef struct
+{
+    double fixes_per_day;
+    double error_mean_m;
+    double error_p95_m;
+} eval_result_t;
+
+extern CronClass Cron;
+
+static uint32_t now;
+static uint32_t fix_at;
+static std::vector<eval_point_t> truth; // One point per minute
+
+// Drivers and callback used by the scheduler
+uint32_t syshal_rtc_return_timestamp(void)
+{
+    return now;
+}
+
+int syshal_rtc_set_alarm(const uint32_t timestamp, const voidFuncPtr callback)
+{
+    (void)timestamp;
+    (void)callback;
+    return 0;
+}
+
+int syshal_temp_temperature(int8_t *temperature)
+{
+    *temperature = 20;
+    return 0;
+}
+
+int syshal_batt_voltage_mv(uint16_t *voltage_mv)
+{
+    *voltage_mv = 3900;
+    return 0;
+}
+
+void scheduler_gps_callback(scheduler_event_t *event)
+{
+    (void)event;
+    fix_at = now + EVAL_FIX_TIME_S;
+}
+
+static void eval_make_track(eval_track_t track, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0, 1);
+    double x = 0, y = 0, heading = 0;
+
+    truth.clear();
+    for (uint32_t m = 0; m <= EVAL_DAYS * 1440u; m++)
+    {
+        uint32_t minute_of_day = m % 1440;
+        double speed = 0;
+
+        if ((track == EVAL_TRACK_COMMUTER) &&
+            (((minute_of_day >= 480) && (minute_of_day < 540)) || ((minute_of_day >= 1050) && (minute_of_day < 1110))))
+            speed = 12;
+        else if ((track == EVAL_TRACK_ANIMAL) && (minute_of_day >= 360) && (minute_of_day < 840))
+            speed = 0.6;
+        else if (track == EVAL_TRACK_SHIP)
+            speed = 5;
+
+        heading += (track == EVAL_TRACK_ANIMAL ? 0.3 : 0.05) * noise(rng);
+        x += speed * 60 * cos(heading);
+        y += speed * 60 * sin(heading);
+
+        // The commuter is back home every evening
+        if ((track == EVAL_TRACK_COMMUTER) && (minute_of_day == 1110))
+            x = y = 0;
+
+        eval_point_t point = {x, y, speed};
+        truth.push_back(point);
+    }
+}
+
+static eval_result_t eval_run(const eval_policy_t *policy, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0, 1);
+
+    for (uint8_t id = 0; id < dtNBR_ALARMS; id++)
+        Cron.free(id);
+    now = EVAL_START;
+    fix_at = 0;
+    scheduler_init();
+
+    static sys_config_gps_scheduler_settings_t gps_settings;
+    static sys_config_gps_adaptive_scheduler_settings_t adaptive_settings;
+    gps_settings.hdr.set = true;
+    gps_settings.contents.interval_h = policy->interval_h;
+    adaptive_settings.hdr.set = policy->adaptive;
+    adaptive_settings.contents.interval_min_m = policy->interval_min_m;
+    adaptive_settings.contents.interval_max_m = policy->interval_max_m;
+    adaptive_settings.contents.backoff = 2;
+    adaptive_settings.contents.distance_threshold_m = 100;
+    adaptive_settings.contents.speed_threshold_mm_s = 500;
+    scheduler_gps_config_t config = {.scheduler = &gps_settings, .adaptive = &adaptive_settings};
+    scheduler_gps_update_config(config);
+    scheduler_gps_start();
+
+    std::vector<std::pair<uint32_t, eval_point_t>> fixes;
+    for (now = EVAL_START; now < EVAL_START + EVAL_DAYS * 86400u; now += 10)
+    {
+        uint32_t minute = (now - EVAL_START) / 60;
+        if (policy->motion && ((now - EVAL_START) % 60 == 0) && minute && (truth[minute].speed > 0) &&
+            (truth[minute - 1].speed == 0))
+            scheduler_gps_motion();
+
+        scheduler_tick();
+
+        if (fix_at && (now >= fix_at))
+        {
+            fix_at = 0;
+            const eval_point_t &point = truth[minute];
+            eval_point_t fix = {point.x + 3 * noise(rng), point.y + 3 * noise(rng), 0};
+            double ground_speed = fabs(point.speed + 0.15 * noise(rng));
+            int32_t lat = (int32_t)llround((EVAL_LAT_D + fix.y / EVAL_M_PER_D) * 1e7);
+            int32_t lon = (int32_t)llround((EVAL_LON_D + fix.x / (EVAL_M_PER_D * cos(EVAL_LAT_D * M_PI / 180))) * 1e7);
+            scheduler_gps_fix(lat, lon, 5000, (int32_t)(ground_speed * 1000));
+            fixes.push_back(std::make_pair(now, fix));
+        }
+    }
+
+    // Track rebuilt between the fixes, compared every minute from the first fix
+    std::vector<double> errors;
+    size_t k = 0;
+    for (uint32_t m = 0; m < EVAL_DAYS * 1440u; m++)
+    {
+        uint32_t t = EVAL_START + m * 60;
+        if (fixes.empty() || (t < fixes[0].first))
+            continue;
+
+        while ((k + 1 < fixes.size()) && (fixes[k + 1].first <= t))
+            k++;
+
+        eval_point_t estimate = fixes[k].second;
+        if (k + 1 < fixes.size())
+        {
+            double w = (t - fixes[k].first) / (double)(fixes[k + 1].first - fixes[k].first);
+            estimate.x += w * (fixes[k + 1].second.x - estimate.x);
+            estimate.y += w * (fixes[k + 1].second.y - estimate.y);
+        }
+        errors.push_back(hypot(estimate.x - truth[m].x, estimate.y - truth[m].y));
+    }
+
+    double sum = 0;
+    for (size_t i = 0; i < errors.size(); i++)
+        sum += errors[i];
+    std::sort(errors.begin(), errors.end());
+
+    eval_result_t result = {fixes.size() / (double)EVAL_DAYS, sum / errors.size(), errors[errors.size() * 95 / 100]};
+    return result;
+}
+
+int main(void)
+{
+    static const char *track_names[EVAL_TRACK_NB] = {
+        "stationary",
+        "commuter (2 x 1 h drive)",
+        "animal (8 h at 0.6 m/s)",
+        "ship (5 m/s)",
+    };
+    static const eval_policy_t policies[] = {
+        {"fixed 1 h", false, 1, 0, 0, false},
+        {"fixed 24 h", false, 24, 0, 0, false},
+        {"adaptive 60..1440 min", true, 24, 60, 1440, false},
+        {"adaptive 60..240 min", true, 24, 60, 240, false},
+        {"adaptive 15..1440 min", true, 24, 15, 1440, false},
+        {"  + motion hook", true, 24, 15, 1440, true},
+    };
+    const size_t nb_policies = sizeof(policies) / sizeof(policies[0]);
+    int errors = 0;
+
+    for (int track = 0; track < EVAL_TRACK_NB; track++)
+    {
+        eval_result_t results[nb_policies];
+
+        eval_make_track((eval_track_t)track, 7 + track);
+        printf("%s\n", track_names[track]);
+
+        for (size_t i = 0; i < nb_policies; i++)
+        {
+            results[i] = eval_run(&policies[i], 3);
+            printf("  %-22s %6.1f fixes/day, error mean %8.0f m, p95 %8.0f m\n", policies[i].name,
+                   results[i].fixes_per_day, results[i].error_mean_m, results[i].error_p95_m);
+        }
+
+        if ((track == EVAL_TRACK_STATIONARY) && (results[2].fixes_per_day > 1.5))
+            errors++;
+        if ((track != EVAL_TRACK_STATIONARY) && (results[5].error_mean_m >= results[1].error_mean_m))
+            errors++;
+    }
+
+    printf("%s: %d errors\n", errors ? "FAIL" : "PASS", errors);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+// Print and Stream interfaces of the Arduino core for the host tests
+#ifndef _HOST_STREAM_h
+#define _HOST_STREAM_h
+
+#include "arduino.h"
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (n < size && write(buffer[n]))
+            n++;
+        return n;
+    }
+    size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+    virtual int availableForWrite() { return 0; }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+};
+
+#endif
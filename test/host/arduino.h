@@ -0,0 +1,28 @@
+// Minimal Arduino core for the host tests, only what the tested modules use
+#ifndef _HOST_ARDUINO_h
+#define _HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HEX 16
+#define DEC 10
+
+#define INPUT (0x0)
+#define OUTPUT (0x1)
+#define A4 (18ul)
+
+typedef void (*voidFuncPtr)(void);
+
+// Simulated time, tests move it forward with host_millis. Busy loops on millis() yield, so a
+// yield lets one millisecond elapse
+extern uint32_t host_millis;
+static inline unsigned long millis(void) { return host_millis; }
+static inline void delay(unsigned long ms) { host_millis += ms; }
+static inline void yield(void) { host_millis++; }
+
+#endif
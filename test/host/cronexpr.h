@@ -0,0 +1,2 @@
+// CronExpr.c includes its header in lower case, which only resolves on case-insensitive file systems
+#include "CronExpr.h"
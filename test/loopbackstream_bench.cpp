@@ -0,0 +1,200 @@
+/******************************************************************************************
+ * Host benchmark of LoopbackStream
+ *
+ * Checks the span and zero copy accesses against a reference queue with random operations
+ * that cross the wrap point, then measures the throughput of a 40 B frame written and
+ * drained one byte at a time (the former write(buffer, size) and ble_write_req() loops) and
+ * with the span and zero copy calls.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -DARDUINO=100 -Itest/host -Ifirmware/AstroTracker/src test/loopbackstream_bench.cpp \
+ *       firmware/AstroTracker/src/core/loopbackstream/LoopbackStream.cpp -o loopbackstream_bench
+ *   ./loopbackstream_bench
+ ******************************************************************************************/
+
+#include "core/loopbackstream/LoopbackStream.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+uint32_t host_millis;
+
+#define BENCH_FRAME_SIZE (40)
+#define BENCH_ITERATIONS (2000000)
+
+// Random operations against a std::deque holding the same bytes, return the number of errors
+static int bench_check(void)
+{
+    LoopbackStream stream(60); // Rounded up to 64
+    std::deque<uint8_t> reference;
+    uint8_t value = 0;
+    int errors = 0;
+
+    if (stream.availableForWrite() != 64)
+        errors++;
+
+    srand(1);
+    for (int i = 0; i < 100000; i++)
+    {
+        uint8_t buffer[80];
+        size_t length = rand() % sizeof(buffer);
+
+        switch (rand() % 6)
+        {
+        case 0: // Span write, truncated to the free space
+        {
+            for (size_t j = 0; j < length; j++)
+                buffer[j] = value + j;
+            size_t written = stream.write(buffer, length);
+            size_t expected = 64 - reference.size();
+            if (written != (length < expected ? length : expected))
+                errors++;
+            for (size_t j = 0; j < written; j++)
+                reference.push_back(value++);
+            break;
+        }
+        case 1: // Zero copy write
+        {
+            uint8_t *data;
+            size_t contiguous = stream.acquireWrite(&data);
+            size_t n = length < contiguous ? length : contiguous;
+            for (size_t j = 0; j < n; j++)
+            {
+                data[j] = value;
+                reference.push_back(value++);
+            }
+            stream.commit(n);
+            break;
+        }
+        case 2: // Span read
+        {
+            size_t n = stream.read(buffer, length);
+            if (n != (length < reference.size() ? length : reference.size()))
+                errors++;
+            for (size_t j = 0; j < n; j++)
+            {
+                if (buffer[j] != reference.front())
+                    errors++;
+                reference.pop_front();
+            }
+            break;
+        }
+        case 3: // Span peek, nothing consumed
+        {
+            size_t n = stream.peek(buffer, length);
+            for (size_t j = 0; j < n; j++)
+                if (buffer[j] != reference[j])
+                    errors++;
+            break;
+        }
+        case 4: // Zero copy read
+        {
+            const uint8_t *data;
+            size_t contiguous = stream.acquireRead(&data);
+            size_t n = length < contiguous ? length : contiguous;
+            if (reference.size() && !contiguous)
+                errors++;
+            for (size_t j = 0; j < n; j++)
+            {
+                if (data[j] != reference.front())
+                    errors++;
+                reference.pop_front();
+            }
+            stream.release(n);
+            break;
+        }
+        default: // Byte accesses
+        {
+            if (stream.contains((char)value) != (std::find(reference.begin(), reference.end(), value) != reference.end()))
+                errors++;
+            if (stream.peek() != (reference.empty() ? -1 : reference.front()))
+                errors++;
+            if (!reference.empty())
+            {
+                if (stream.read() != reference.front())
+                    errors++;
+                reference.pop_front();
+            }
+            break;
+        }
+        }
+
+        if (stream.available() != (int)reference.size())
+            errors++;
+    }
+
+    return errors;
+}
+
+static double bench_mb_s(std::chrono::steady_clock::time_point start, uint32_t bytes)
+{
+    return bytes / std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(void)
+{
+    int errors = bench_check();
+
+    LoopbackStream stream(64);
+    uint8_t frame[BENCH_FRAME_SIZE];
+    uint8_t out[64];
+    volatile uint32_t checksum = 0;
+    uint32_t bytes;
+
+    for (size_t i = 0; i < sizeof(frame); i++)
+        frame[i] = i;
+
+    // Byte per byte
+    bytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        for (size_t j = 0; j < sizeof(frame); j++)
+            stream.write(frame[j]);
+
+        size_t n = 0;
+        while (stream.available())
+            out[n++] = stream.read();
+        checksum += out[i % n];
+        bytes += n;
+    }
+    double byte_mb_s = bench_mb_s(start, bytes);
+
+    // Span write, copy out with read()
+    bytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        stream.write(frame, sizeof(frame));
+        size_t n = stream.read(out, sizeof(out));
+        checksum += out[i % n];
+        bytes += n;
+    }
+    double span_mb_s = bench_mb_s(start, bytes);
+
+    // Span write, parsed in place with acquireRead()
+    bytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        stream.write(frame, sizeof(frame));
+
+        const uint8_t *data;
+        size_t n;
+        while ((n = stream.acquireRead(&data)) > 0)
+        {
+            checksum += data[i % n];
+            bytes += n;
+            stream.release(n);
+        }
+    }
+    double zero_copy_mb_s = bench_mb_s(start, bytes);
+
+    printf("%d B frames through a 64 B stream:\n", BENCH_FRAME_SIZE);
+    printf("  byte per byte:             %7.1f MB/s\n", byte_mb_s);
+    printf("  span write and read:       %7.1f MB/s\n", span_mb_s);
+    printf("  span write and zero copy:  %7.1f MB/s\n", zero_copy_mb_s);
+    printf("%s: %d errors\n", errors ? "FAIL" : "PASS", errors);
+
+    return errors ? 1 : 0;
+}
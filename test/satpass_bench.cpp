@@ -0,0 +1,172 @@
+/******************************************************************************************
+ * Host benchmark of the satellite pass predictor
+ *
+ * Runs the incremental search over 30 days for each satellite of a sun-synchronous
+ * constellation, the way the state machine does (next pass asked once the previous one has
+ * elapsed), and checks every AOS/LOS against a brute-force search evaluating every second
+ * with the same position function.
+ *
+ * Near the horizon the search does not step less than sat_pass_search_step_s, so a grazing
+ * pass shorter than the step may be skipped, as with the former fixed step search. Such
+ * passes are only counted, every other pass must match the brute-force times exactly.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -std=gnu++11 -DARDUINO=100 -DDEBUG_DISABLED -Itest/host -Ifirmware/AstroTracker/src \
+ *       test/satpass_bench.cpp firmware/AstroTracker/src/core/satpass/satpass.cpp -o satpass_bench
+ *   ./satpass_bench
+ ******************************************************************************************/
+
+#include "core/satpass/satpass.h"
+#include <chrono>
+#include <vector>
+
+uint32_t host_millis;
+
+// Position function of the predictor, the brute-force reference evaluates it every second
+float satpass_central_angle_priv(uint8_t sat_id, uint32_t timestamp);
+
+#define BENCH_START (1700000000)
+#define BENCH_DAYS (30)
+#define BENCH_END (BENCH_START + BENCH_DAYS * 86400)
+#define BENCH_SATELLITES (4)
+
+static const satpass_orbit_t bench_orbits[BENCH_SATELLITES] = {
+    {BENCH_START, 515.0f, 97.5f, 10.0f, 0.0f},
+    {BENCH_START, 515.0f, 97.5f, 10.0f, 180.0f},
+    {BENCH_START, 530.0f, 97.6f, 100.0f, 45.0f},
+    {BENCH_START, 530.0f, 97.6f, 100.0f, 225.0f},
+};
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int bench_run(uint16_t step_s)
+{
+    sys_config_satpass_settings_t settings;
+    settings.hdr.set = true;
+    settings.contents.sat_pass_search_window_size_s = 86400;
+    settings.contents.sat_pass_search_step_s = step_s;
+    settings.contents.sat_pass_min_elevation_d = 30;
+    settings.contents.lat = 465000000;
+    settings.contents.lon = 65000000;
+
+    satpass_config_t config = {.satpass = &settings, .orbits = NULL};
+
+    uint32_t incremental_evaluations = 0;
+    uint32_t brute_evaluations = 0;
+    double incremental_ms = 0;
+    double brute_ms = 0;
+    int nb_passes = 0;
+    int nb_skipped = 0;
+    int mismatches = 0;
+
+    for (uint8_t sat = 0; sat < BENCH_SATELLITES; sat++)
+    {
+        // One satellite at a time, so that overlapping passes of two satellites do not hide each other
+        satpass_init();
+        satpass_update_config(config);
+        satpass_set_orbits(&bench_orbits[sat], 1);
+
+        std::vector<satpass_pass_t> passes;
+        satpass_pass_t pass;
+        uint32_t t = BENCH_START;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (t < BENCH_END)
+        {
+            // Without a pass in the window the state machine asks again once it has elapsed
+            if (satpass_get_next_pass(t, &pass))
+            {
+                t += settings.contents.sat_pass_search_window_size_s;
+                continue;
+            }
+
+            if (pass.los >= BENCH_END)
+                break;
+
+            passes.push_back(pass);
+            t = pass.los;
+        }
+        incremental_ms += elapsed_ms(start);
+
+        satpass_stats_t stats;
+        satpass_get_stats(&stats);
+        incremental_evaluations += stats.evaluations;
+
+        // Same threshold as satpass_prepare_priv()
+        double a = 6378.137f + bench_orbits[sat].altitude_km;
+        double elev = settings.contents.sat_pass_min_elevation_d * (M_PI / 180.0);
+        float lambda_max = (float)(acos(6378.137f * cos(elev) / a) - elev);
+
+        std::vector<satpass_pass_t> reference;
+        bool visible = satpass_central_angle_priv(0, BENCH_START) <= lambda_max;
+        uint32_t aos = 0;
+
+        start = std::chrono::steady_clock::now();
+        for (t = BENCH_START + 1; t < BENCH_END; t++)
+        {
+            bool visible_now = satpass_central_angle_priv(0, t) <= lambda_max;
+            if (visible_now && !visible)
+            {
+                aos = t;
+            }
+            else if (!visible_now && visible && aos)
+            {
+                satpass_pass_t p = {aos, t, 0};
+                reference.push_back(p);
+            }
+            visible = visible_now;
+        }
+        brute_ms += elapsed_ms(start);
+        brute_evaluations += BENCH_END - BENCH_START;
+
+        size_t i = 0;
+        for (size_t j = 0; j < reference.size(); j++)
+        {
+            if ((i < passes.size()) && (passes[i].aos == reference[j].aos) && (passes[i].los == reference[j].los))
+            {
+                i++;
+            }
+            else if ((reference[j].los - reference[j].aos) < step_s)
+            {
+                nb_skipped++;
+            }
+            else
+            {
+                printf("sat %d: pass %u-%u found at %u-%u\n", sat, reference[j].aos, reference[j].los,
+                       i < passes.size() ? passes[i].aos : 0, i < passes.size() ? passes[i].los : 0);
+                mismatches++;
+            }
+        }
+
+        if (i != passes.size())
+        {
+            printf("sat %d: %zu passes not found by the brute force search\n", sat, passes.size() - i);
+            mismatches++;
+        }
+
+        nb_passes += reference.size();
+    }
+
+    printf("%d s step, %d satellites, %d days, %d passes above %d deg, %d shorter than the step skipped\n",
+           step_s, BENCH_SATELLITES, BENCH_DAYS, nb_passes, settings.contents.sat_pass_min_elevation_d, nb_skipped);
+    printf("  fixed step:      %6d evaluations per satellite per day\n", 86400 / step_s);
+    printf("  incremental:     %6.0f evaluations per satellite per day, %8.3f ms host time per day\n",
+           incremental_evaluations / (double)(BENCH_SATELLITES * BENCH_DAYS), incremental_ms / BENCH_DAYS);
+    printf("  brute force 1 s: %6.0f evaluations per satellite per day, %8.3f ms host time per day\n",
+           brute_evaluations / (double)(BENCH_SATELLITES * BENCH_DAYS), brute_ms / BENCH_DAYS);
+
+    return mismatches;
+}
+
+int main(void)
+{
+    int mismatches = bench_run(30); // Default configuration
+    mismatches += bench_run(1);
+
+    printf("%s: %d mismatches\n", mismatches ? "FAIL" : "PASS", mismatches);
+
+    return mismatches ? 1 : 0;
+}
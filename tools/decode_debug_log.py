@@ -0,0 +1,211 @@
+import argparse
+import json
+import re
+import struct
+import sys
+
+# This script has been tested on python 3.6
+########################################################################################################################
+# Render the binary debug records sent by AstroTracker on its debug UART back to text.
+#
+# The format strings are not sent, only their offset in the debug_fmt section of the firmware. They are read from the
+# ELF file built with the firmware (the Arduino IDE keeps it next to the .bin, see "Export compiled Binary"):
+#   python decode_debug_log.py --elf AstroTracker.ino.elf capture.bin
+# or from a string table extracted once with:
+#   python decode_debug_log.py --elf AstroTracker.ino.elf --extract strings.json
+#   python decode_debug_log.py --table strings.json capture.bin
+# Use - to read the records from stdin, e.g. from a serial port:
+#   stty -F /dev/ttyACM0 115200 raw && cat /dev/ttyACM0 | python decode_debug_log.py --elf AstroTracker.ino.elf -
+########################################################################################################################
+
+# Must match src/core/debug/debug.h
+DEBUG_LOG_SYNC = b"\xA5\x5A"
+DEBUG_LOG_HDR_SIZE = 10
+DEBUG_LOG_FMT_ID_DROPPED = 0xFFFF
+DEBUG_LOG_SECTION = "debug_fmt"
+DEBUG_LEVELS = ["NONE", "SYSTEM", "ERROR", "WARN", "INFO", "TRACE"]
+
+# type: (struct format, size), strings are handled apart
+DEBUG_LOG_ARGS = {
+    0: ("<i", 4),  # DEBUG_LOG_ARG_INT32
+    1: ("<I", 4),  # DEBUG_LOG_ARG_UINT32
+    2: ("<q", 8),  # DEBUG_LOG_ARG_INT64
+    3: ("<Q", 8),  # DEBUG_LOG_ARG_UINT64
+    4: ("<f", 4),  # DEBUG_LOG_ARG_FLOAT
+    6: ("<I", 4),  # DEBUG_LOG_ARG_POINTER
+}
+DEBUG_LOG_ARG_STRING = 5
+
+FORMAT_SPEC = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z)?([diuxXcsfpobB%])")
+
+
+def read_elf_section(path, name):
+    with open(path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF":
+        raise ValueError(f"{path} is not an ELF file")
+    is_64 = elf[4] == 2
+    endian = "<" if elf[5] == 1 else ">"
+
+    if is_64:
+        shoff, = struct.unpack_from(endian + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x3A)
+        section_header = endian + "IIQQQQIIQQ"
+    else:
+        shoff, = struct.unpack_from(endian + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x2E)
+        section_header = endian + "IIIIIIIIII"
+
+    sections = [struct.unpack_from(section_header, elf, shoff + i * shentsize) for i in range(shnum)]
+    names_offset = sections[shstrndx][4]
+    for section in sections:
+        section_name = elf[names_offset + section[0]:elf.index(b"\0", names_offset + section[0])].decode()
+        if section_name == name:
+            return elf[section[4]:section[4] + section[5]]
+
+    raise ValueError(f"{path} has no {name} section, was the firmware built with DEBUG_IMMEDIATE or DEBUG_DISABLED?")
+
+
+def extract_string_table(section):
+    # Format strings may be padded for alignment, every string starts after a NUL
+    table = {}
+    start = 0
+    while start < len(section):
+        end = section.index(b"\0", start)
+        table[start] = section[start:end].decode(errors="replace")
+        start = end + 1
+    return table
+
+
+def parse_args(data):
+    args = []
+    offset = 0
+    while offset < len(data):
+        arg_type = data[offset]
+        offset += 1
+        if arg_type == DEBUG_LOG_ARG_STRING:
+            if offset >= len(data):
+                return None
+            length = data[offset]
+            if offset + 1 + length > len(data):
+                return None
+            args.append(data[offset + 1:offset + 1 + length].decode(errors="replace"))
+            offset += 1 + length
+        elif arg_type in DEBUG_LOG_ARGS:
+            fmt, size = DEBUG_LOG_ARGS[arg_type]
+            if offset + size > len(data):
+                return None
+            args.append(struct.unpack_from(fmt, data, offset)[0])
+            offset += size
+        else:
+            return None
+    return args
+
+
+def render(fmt, args):
+    args = list(args)
+
+    def replace(match):
+        flags, width, precision, _, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        if not args:
+            return "?"
+        value = args.pop(0)
+
+        # Same meaning as in serial_printf()
+        if conversion == "o":
+            return "on" if value else "off"
+        if conversion in "bB":
+            return ("0b" if conversion == "B" else "") + format(int(value), "b")
+
+        if conversion == "s":
+            value = str(value)
+        elif conversion == "c":
+            value = chr(value & 0xFF) if isinstance(value, int) else str(value)[:1]
+            conversion = "s"
+        elif conversion == "f":
+            value = float(value)
+            if precision is None:
+                precision = "2"
+        elif conversion == "p":
+            return f"0x{int(value):08x}"
+        elif isinstance(value, float):
+            value = int(value)
+        elif isinstance(value, str):
+            return value
+
+        spec = "%" + flags + width + ("." + precision if precision is not None else "") + conversion
+        return spec % value
+
+    return FORMAT_SPEC.sub(replace, fmt)
+
+
+def decode(stream, table):
+    buffer = b""
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            break
+        buffer += chunk
+
+        while True:
+            start = buffer.find(DEBUG_LOG_SYNC)
+            if start < 0:
+                buffer = buffer[-1:]
+                break
+            buffer = buffer[start:]
+            if len(buffer) < DEBUG_LOG_HDR_SIZE:
+                break
+
+            length = buffer[2]
+            if len(buffer) < 3 + length:
+                break
+            level, fmt_id, timestamp = struct.unpack_from("<BHI", buffer, 3)
+            args = parse_args(buffer[DEBUG_LOG_HDR_SIZE:3 + length])
+
+            if args is None or level >= len(DEBUG_LEVELS) or \
+                    (fmt_id != DEBUG_LOG_FMT_ID_DROPPED and fmt_id not in table):
+                buffer = buffer[1:]  # Not a record, look for the next sync
+                continue
+            buffer = buffer[3 + length:]
+
+            if fmt_id == DEBUG_LOG_FMT_ID_DROPPED:
+                text = f"<{args[0] if args else '?'} debug records dropped>"
+            else:
+                text = render(table[fmt_id], args)
+
+            if level:
+                text = f"{timestamp / 1000:.3f}\t{DEBUG_LEVELS[level]}\t{text}"
+            yield text
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Render AstroTracker binary debug records to text")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--elf", help="firmware ELF file, the format strings are read from it")
+    source.add_argument("--table", help="string table written by --extract")
+    parser.add_argument("--extract", metavar="TABLE", help="write the string table of --elf to TABLE and exit")
+    parser.add_argument("input", nargs="?", help="binary capture of the debug UART, - for stdin")
+    args = parser.parse_args()
+
+    if args.elf:
+        table = extract_string_table(read_elf_section(args.elf, DEBUG_LOG_SECTION))
+    else:
+        with open(args.table) as f:
+            table = {int(fmt_id): fmt for fmt_id, fmt in json.load(f).items()}
+
+    if args.extract:
+        if not args.elf:
+            parser.error("--extract needs --elf")
+        with open(args.extract, "w") as f:
+            json.dump(table, f, indent=1)
+        sys.exit(0)
+
+    if args.input is None:
+        parser.error("the input capture is missing")
+
+    stream = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+    for line in decode(stream, table):
+        print(line, flush=True)
@@ -0,0 +1,146 @@
+import argparse
+import struct
+
+# This script has been tested on python 3.6
+########################################################################################################################
+# Encode AstroTracker configuration changes as AN_PACKET_CONFIG_DELTA commands.
+#
+# Each update replaces the whole contents of one sys_config tag, all of its fields must be given:
+#   python encode_config_delta.py --transfer-id 3 scheduler_gps_settings:interval_h=6 logging_enable:enable=1
+# A tag is unset with:
+#   python encode_config_delta.py battery_low_threshold:unset
+#
+# One line of hex is printed per 40 B satellite command (or per BLE write with --ble).
+########################################################################################################################
+
+# Must match src/core/config/sys_config.h (struct.pack formats of the packed contents, little endian)
+SYS_CONFIG_TAGS = {
+    "debug_settings": (0x0000, "<B", ["level"]),
+    "ble_settings": (0x0001, "<bHHH",
+                     ["tx_power", "advert_fast_interval", "advert_slow_interval", "advert_fast_timeout"]),
+    "gps_settings": (0x0002, "<?????iBBB",
+                     ["with_gps", "with_galileo", "with_beidou", "with_glonass", "with_rxm_meas20",
+                      "hacc_pvt_threshold", "raw_timeout_s", "pvt_timeout_s", "nav_freq_hz"]),
+    "gps_log_position_enable": (0x0003, "<B", ["enable"]),
+    "sat_settings": (0x0004, "<?????????B",
+                     ["with_pld_ack", "with_geo_loc", "with_ephemeris", "with_deep_sleep_en", "with_msg_ack_pin_en",
+                      "with_msg_reset_pin_en", "with_cmd_event_pin_en", "with_tx_pend_event_pin_en",
+                      "sat_force_search", "sat_search_rate"]),
+    "satpass_settings": (0x0005, "<IIHHHBii",
+                         ["sat_pass_predictor_timeout_s", "sat_pass_search_window_size_s", "sat_pass_search_step_s",
+                          "sat_pass_search_window_back_step_s", "sat_pass_terminal_wakeup_margin_s",
+                          "sat_pass_min_elevation_d", "lon", "lat"]),
+    "satpass_predictor_enable": (0x0006, "<B", ["enable"]),
+    "screen_settings": (0x0007, "<Bh", ["lcd_contrast", "page_conf_duration_ms"]),
+    "scheduler_gps_settings": (0x0008, "<B", ["interval_h"]),
+    "scheduler_satpass_settings": (0x0009, "<I", ["timestamp"]),
+    "scheduler_wake_settings": (0x000A, "<H", ["slack_s"]),
+    "scheduler_gps_adaptive_settings": (0x000B, "<HHBHH",
+                                        ["interval_min_m", "interval_max_m", "backoff", "distance_threshold_m",
+                                         "speed_threshold_mm_s"]),
+    "battery_low_threshold": (0x0901, "<B", ["threshold"]),
+    "logging_enable": (0x0902, "<B", ["enable"]),
+    "battery_settings": (0x0903, "<HH11H",
+                         ["capacity_mah", "internal_resistance_mohm"] +
+                         [f"curve_mv_{soc}" for soc in range(100, -1, -10)]),
+    "sensor_settings": (0x0904, "<HBHB",
+                        ["battery_interval_s", "battery_aggregate_nb",
+                         "temperature_interval_s", "temperature_aggregate_nb"]),
+    "geofence_settings": (0x0A00, "<BH", ["policy", "heartbeat_m"]),
+}
+
+# Geofences: type 0 is a circle of radius_m around lat_0/lon_0, type 1 a polygon of vertex_nb vertices (deg * 1E7).
+# The vertices not given are 0:
+#   python encode_config_delta.py geofence_0:type=0,vertex_nb=1,radius_m=200,lat_0=465000000,lon_0=65000000
+# Satellite orbits, from the elements published by the operator. The orbits after orbit_nb are 0:
+#   python encode_config_delta.py satpass_orbits:orbit_nb=1,epoch_0=1700000000,altitude_km_0=520.5,...
+SATPASS_ORBIT_NB = 8
+SATPASS_ORBIT_FIELDS = ["epoch", "altitude_km", "inclination_d", "raan_d", "arg_lat_d"]
+SATPASS_ORBITS = [f"{field}_{i}" for i in range(SATPASS_ORBIT_NB) for field in SATPASS_ORBIT_FIELDS]
+SYS_CONFIG_TAGS["satpass_orbits"] = (0x000C, "<B" + "Iffff" * SATPASS_ORBIT_NB, ["orbit_nb"] + SATPASS_ORBITS)
+
+GEOFENCE_NB = 4
+GEOFENCE_VERTEX_NB = 16
+GEOFENCE_VERTICES = [f"{axis}_{i}" for i in range(GEOFENCE_VERTEX_NB) for axis in ("lat", "lon")]
+for index in range(GEOFENCE_NB):
+    SYS_CONFIG_TAGS[f"geofence_{index}"] = (0x0A01 + index, "<BBH" + "ii" * GEOFENCE_VERTEX_NB,
+                                            ["type", "vertex_nb", "radius_m"] + GEOFENCE_VERTICES)
+OPTIONAL_FIELDS = set(GEOFENCE_VERTICES) | set(SATPASS_ORBITS)
+
+# Must match src/core/command/an_packets.h and src/core/config/sys_config_delta.h
+PACKET_ID_CONFIG_DELTA = 14
+DATA_CMD_40B_SIZE = 40
+AN_PACKET_HEADER_SIZE = 5
+CONFIG_DELTA_PACKET_HDR_SIZE = 2
+FRAGMENT_SIZE = DATA_CMD_40B_SIZE - AN_PACKET_HEADER_SIZE - CONFIG_DELTA_PACKET_HDR_SIZE
+FRAGMENT_NB_MAX = 5
+
+
+def calculate_crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        x = ((crc >> 8) ^ byte) & 0xFF
+        x ^= x >> 4
+        crc = ((crc << 8) ^ (x << 12) ^ (x << 5) ^ x) & 0xFFFF
+    return crc
+
+
+def an_packet_encode(packet_id, data):
+    header = struct.pack("<BBH", packet_id, len(data), calculate_crc16(data))
+    lrc = ((sum(header) ^ 0xFF) + 1) & 0xFF
+    return bytes([lrc]) + header + data
+
+
+def parse_value(value):
+    try:
+        return int(value, 0)
+    except ValueError:
+        return float(value)
+
+
+def encode_record(update):
+    name, _, values = update.partition(":")
+    if name not in SYS_CONFIG_TAGS:
+        raise ValueError(f"unknown tag {name}, one of: {', '.join(SYS_CONFIG_TAGS)}")
+    tag, fmt, fields = SYS_CONFIG_TAGS[name]
+
+    if values == "unset":
+        return struct.pack("<HB", tag, 0)
+
+    given = dict(value.split("=", 1) for value in values.split(",") if value)
+    missing = [field for field in fields if field not in given and field not in OPTIONAL_FIELDS]
+    unknown = [field for field in given if field not in fields]
+    if missing or unknown:
+        raise ValueError(f"{name}: missing fields {missing}, unknown fields {unknown}")
+
+    contents = struct.pack(fmt, *(parse_value(given.get(field, "0")) for field in fields))
+    return struct.pack("<HB", tag, len(contents)) + contents
+
+
+def encode_config_delta(updates, transfer_id):
+    delta = b"".join(encode_record(update) for update in updates)
+    fragments = [delta[i:i + FRAGMENT_SIZE] for i in range(0, len(delta), FRAGMENT_SIZE)] or [b""]
+    if len(fragments) > FRAGMENT_NB_MAX:
+        raise ValueError(f"delta of {len(delta)} bytes does not fit in {FRAGMENT_NB_MAX} commands")
+
+    packets = []
+    for index, fragment in enumerate(fragments):
+        header = bytes([transfer_id & 0xFF, ((len(fragments) - 1) << 4) | index])
+        packets.append(an_packet_encode(PACKET_ID_CONFIG_DELTA, header + fragment))
+    return delta, packets
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Encode AstroTracker configuration delta commands")
+    parser.add_argument("updates", nargs="+", help="tag:field=value,... or tag:unset")
+    parser.add_argument("--transfer-id", type=int, default=0,
+                        help="change it for every new delta, a repeated id is ignored by the tracker")
+    parser.add_argument("--ble", action="store_true", help="do not pad the commands to 40 bytes")
+    args = parser.parse_args()
+
+    delta, packets = encode_config_delta(args.updates, args.transfer_id)
+    print(f"# {len(delta)} bytes of delta in {len(packets)} command(s)")
+    for packet in packets:
+        if not args.ble:
+            packet = packet.ljust(DATA_CMD_40B_SIZE, b"\x00")
+        print(packet.hex())